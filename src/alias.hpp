@@ -11,6 +11,7 @@
 
 #include <forward_list>
 #include <memory>
+#include "node_pool.hpp"
 #include "nsoptim_forward.hpp"
 
 namespace pense {
@@ -20,8 +21,13 @@ using RegressionDataPtr = std::shared_ptr<nsoptim::PredictorResponseData>;
 using ConstRegressionDataPtr = std::shared_ptr<const nsoptim::PredictorResponseData>;
 
 //! Alias for std::forward_list used throughout the codebase
+template<typename T, typename Allocator = std::allocator<T>>
+using FwdList = std::forward_list<T, Allocator>;
+
+//! Alias for a std::forward_list with nodes allocated from thread-local pools (see NodeAllocator).
+//! Intended for short-lived intermediate lists, which are filled and discarded concurrently by many threads.
 template<typename T>
-using FwdList = std::forward_list<T>;
+using PooledFwdList = FwdList<T, NodeAllocator<T>>;
 
 //! Alias for a list of optima.
 template<typename Optimizer>
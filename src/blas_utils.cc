@@ -0,0 +1,82 @@
+//
+//  blas_utils.cc
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#include "blas_utils.hpp"
+
+#ifndef _WIN32
+#  include <dlfcn.h>
+#endif
+
+#include "omp_utils.hpp"
+
+namespace {
+using SetNumThreadsFunction = void (*)(int);
+using GetNumThreadsFunction = int (*)();
+
+//! Functions of the BLAS library to control the number of threads.
+struct ThreadControl {
+  SetNumThreadsFunction set = nullptr;
+  GetNumThreadsFunction get = nullptr;
+};
+
+//! Find the functions to control the number of threads in the BLAS library linked to R.
+ThreadControl FindThreadControl() noexcept {
+  ThreadControl control;
+#ifndef _WIN32
+  // The names of the setter and getter, for OpenBLAS, Intel MKL, and FlexiBLAS.
+  constexpr const char* kFunctionNames[][2] = {
+    { "openblas_set_num_threads", "openblas_get_num_threads" },
+    { "MKL_Set_Num_Threads", "MKL_Get_Max_Threads" },
+    { "flexiblas_set_num_threads", "flexiblas_get_num_threads" }
+  };
+  for (auto&& names : kFunctionNames) {
+    control.set = reinterpret_cast<SetNumThreadsFunction>(dlsym(RTLD_DEFAULT, names[0]));
+    control.get = reinterpret_cast<GetNumThreadsFunction>(dlsym(RTLD_DEFAULT, names[1]));
+    if (control.set && control.get) {
+      return control;
+    }
+  }
+#endif
+  return ThreadControl();
+}
+
+const ThreadControl& GetThreadControl() noexcept {
+  static const ThreadControl control = FindThreadControl();
+  return control;
+}
+}  // namespace
+
+namespace pense {
+namespace blas {
+int GetNumThreads() noexcept {
+  const auto& control = GetThreadControl();
+  return control.get ? control.get() : 0;
+}
+
+void SetNumThreads(const int num_threads) noexcept {
+  const auto& control = GetThreadControl();
+  if (control.set) {
+    control.set(num_threads);
+  }
+}
+
+SingleThreadGuard::SingleThreadGuard(const int num_threads) noexcept : previous_num_threads_(0) {
+  if (omp::Enabled(num_threads) && !omp::InParallel()) {
+    previous_num_threads_ = GetNumThreads();
+    if (previous_num_threads_ > 1) {
+      SetNumThreads(1);
+    }
+  }
+}
+
+SingleThreadGuard::~SingleThreadGuard() noexcept {
+  if (previous_num_threads_ > 1) {
+    SetNumThreads(previous_num_threads_);
+  }
+}
+}  // namespace blas
+}  // namespace pense
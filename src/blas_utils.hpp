@@ -0,0 +1,45 @@
+//
+//  blas_utils.hpp
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef BLAS_UTILS_HPP_
+#define BLAS_UTILS_HPP_
+
+namespace pense {
+namespace blas {
+//! Get the maximum number of threads the BLAS library uses.
+//! The BLAS library is detected at run time. OpenBLAS, Intel MKL, and FlexiBLAS are supported.
+//!
+//! @return the number of threads, or 0 if the number of threads of the BLAS library can not be controlled.
+int GetNumThreads() noexcept;
+
+//! Set the maximum number of threads the BLAS library uses. Does nothing if the number of threads of the BLAS
+//! library can not be controlled.
+//!
+//! @param num_threads the number of threads.
+void SetNumThreads(const int num_threads) noexcept;
+
+//! Restrict the BLAS library to a single thread for the lifetime of the guard.
+//! Multithreaded BLAS libraries spawn their own threads for every matrix operation. Inside parallel regions, this
+//! oversubscribes the cores. The guard only changes the setting if it is created outside of an active parallel
+//! region and the parallel region will use several threads. The previous setting is restored when the guard is
+//! destroyed, so serial code can use all threads of the BLAS library.
+class SingleThreadGuard {
+ public:
+  //! @param num_threads the number of threads of the parallel region guarded.
+  explicit SingleThreadGuard(const int num_threads) noexcept;
+  ~SingleThreadGuard() noexcept;
+
+  SingleThreadGuard(const SingleThreadGuard&) = delete;
+  SingleThreadGuard& operator=(const SingleThreadGuard&) = delete;
+
+ private:
+  int previous_num_threads_;
+};
+}  // namespace blas
+}  // namespace pense
+
+#endif  // BLAS_UTILS_HPP_
@@ -17,6 +17,7 @@
 #include <memory>
 
 #include "nsoptim.hpp"
+#include "omp_utils.hpp"
 #include "s_loss.hpp"
 #include "robust_scale_location.hpp"
 
@@ -29,18 +30,75 @@ struct CDPenseConfiguration {
   double linesearch_ss_multiplier;
   //! Number of step sizes to be considered for line search.
   int linesearch_ss_num;
-  //! Re-compute the residuals every `reset_iter` iterations to avoid drift.
+  //! Every `reset_iter` iterations, re-compute the residuals if the rounding errors accumulated by the incremental
+  //! updates may be noticeable.
   int reset_iter;
+  //! Only update the non-zero coefficients until convergence, followed by a sweep over all coefficients.
+  bool active_set;
+  //! Use the sequential strong rule to discard coefficients when continuing from the optimum of a different penalty.
+  bool strong_rules;
+  //! Record summaries of the coordinate updates in the metrics of every iteration.
+  bool coordinate_metrics;
+  //! Number of coordinates updated concurrently. If less than 2, the coordinates are updated one after the other.
+  int block_size;
+  //! Number of threads for updating blocks of coordinates.
+  int num_threads;
+  //! Order in which the coordinates are updated in every iteration.
+  nsoptim::CoordinateOrder order;
 };
 
 namespace coorddesc {
-constexpr CDPenseConfiguration kDefaultCDConfiguration = { 1000, 0.5, 10, 8 };
+constexpr CDPenseConfiguration kDefaultCDConfiguration = {
+  1000, 0.5, 10, 8, false, false, true, 0, 1, nsoptim::CoordinateOrder::kCyclic };
+
+//! Minimum number of residuals per thread when computing the combined update of a block of coordinates.
+constexpr arma::uword kMinBlockRowsPerThread = 1024;
+//! Number of rows in a tile of the predictor matrix when computing the surrogate gradients of a block of coordinates.
+//! The tiles of the weights and the residuals (2 x 16 KiB) stay in cache while they are multiplied with the tiles of
+//! all the columns in the block.
+constexpr arma::uword kBlockTileRows = 2048;
+
+//! Counters recorded for every coordinate update.
+enum class CoordinateCounter {
+  kGradient = 0,
+  kLipschitzSurrogate,
+  kLinesearchStepsize,
+  kLinesearchSteps,
+  kMscaleIterations,
+  kScreenedSteps,
+  kCount
+};
+
+//! Names of the coordinate counters in the metrics, in the order of `CoordinateCounter`.
+constexpr char const * kCoordinateCounterNames[] = {
+  "gradient", "lipschitz_surrogate", "ls_stepsize", "ls_steps", "mscale_iterations", "screened_steps"
+};
 
 struct SurrogateGradient {
   const double gradient;
   double lipschitz_constant;
 };
 
+//! Maximum rounding error of the incrementally updated residuals, relative to the M-scale of the residuals, before the
+//! residuals are re-computed from scratch.
+constexpr double kMaxRelativeResidualDrift = 1e-10;
+
+//! Running bound on the rounding errors accumulated by incremental updates of the residuals.
+struct ResidualDrift {
+  //! Upper bound on the largest absolute residual.
+  double max_abs_residual = 0;
+  //! Upper bound on the largest absolute rounding error in the residuals.
+  double error_bound = 0;
+};
+
+//! The levels of the L1 and L2 parts of an EN penalty, i.e., `lambda * alpha` and `lambda * (1 - alpha)`.
+//! For LASSO (ridge) penalties, the L2 (L1) level is exactly 0 and the coordinate update reduces to a plain
+//! soft-thresholding (shrinkage) step.
+struct PenaltyLevels {
+  double l1 = 0;
+  double l2 = 0;
+};
+
 template<class Coefficients>
 struct State {
   Coefficients coefs;
@@ -73,7 +131,7 @@ class CDPense :
     //! Ininitialize the optimizer without a loss or penalty function.
   CDPense(
     const CDPenseConfiguration& config = coorddesc::kDefaultCDConfiguration) noexcept
-      : config_(config) {}
+      : config_(config), counters_(config.coordinate_metrics), scheduler_(config.order) {}
 
   //! Ininitialize the optimizer using the given (weighted) LS loss function
   //! and penalty function.
@@ -83,7 +141,8 @@ class CDPense :
     const PenaltyFunction& penalty,
     const CDPenseConfiguration& config = coorddesc::kDefaultCDConfiguration) noexcept
     : loss_(new SLoss(loss)),
-      penalty_(new PenaltyFunction(penalty)), config_(config) {}
+      penalty_(new PenaltyFunction(penalty)), config_(config), counters_(config.coordinate_metrics),
+      scheduler_(config.order) {}
 
   //! Default copy constructor.
   //!
@@ -93,10 +152,16 @@ class CDPense :
     : loss_(other.loss_? new SLoss(*other.loss_) : nullptr),
       penalty_(other.penalty_ ? new PenaltyFunction(*other.penalty_) : nullptr),
       config_(other.config_),
+      counters_(other.config_.coordinate_metrics),
+      scheduler_(other.scheduler_),
       lipschitz_bounds_(other.lipschitz_bounds_),
       lipschitz_bound_intercept_(other.lipschitz_bound_intercept_),
       state_(other.state_),
-      convergence_tolerance_(other.convergence_tolerance_) {}
+      convergence_tolerance_(other.convergence_tolerance_),
+      screening_lambda_(other.screening_lambda_),
+      penalty_levels_(other.penalty_levels_),
+      column_max_abs_(other.column_max_abs_),
+      drift_(other.drift_) {}
 
   //! Default copy assignment.
   //!
@@ -201,6 +266,7 @@ class CDPense :
     }
 
     auto metrics = std::make_unique<nsoptim::Metrics>("cd-pense");
+    UpdatePenaltyLevels();
 
     if (state_.residuals.n_elem == 0) {
       ResetState(loss_->template ZeroCoefficients<Coefficients>());
@@ -212,6 +278,16 @@ class CDPense :
 
     int iter = 0;
     const auto& data = loss_->data();
+    // The strong set contains all coordinates which are not discarded by the sequential strong rule. After
+    // convergence, the KKT conditions are checked for the discarded coordinates.
+    arma::uvec strong_set = StrongSet();
+    screening_lambda_ = penalty_->lambda();
+    metrics->AddMetric("strong_set_size", static_cast<int>(strong_set.n_elem));
+    // In active-set mode, only the non-zero coefficients are updated until convergence. A full sweep over the
+    // strong set then verifies that no other coefficient needs to become non-zero.
+    bool full_sweep = true;
+    arma::uvec active_set;
+    scheduler_.Reset(data.n_pred());
 
     while (iter++ < max_it) {
       double coef_change = 0;
@@ -220,77 +296,16 @@ class CDPense :
 
       const double objf_before_iter = state_.objf_loss + state_.objf_pen;
 
-      for (arma::uword j = 0; j < data.n_pred(); ++j) {
-        // @TODO -- this iteration is inefficient if we have a sparse vector!
-        auto& cycle_metrics = iteration_metrics.CreateSubMetrics("coordinate");
-        auto gradlip = GradientAndSurrogateLipschitz(j);
-        int total_mscale_iterations = 0;
-        const double objf_pen_prev = state_.objf_pen - PenaltyContribution(state_.coefs.beta[j], j, IsAdaptiveTag{});
-        double updated_coef = state_.coefs.beta[j];
-
-        cycle_metrics.AddMetric("index", static_cast<int>(j));
-        cycle_metrics.AddMetric("gradient", gradlip.gradient);
-        cycle_metrics.AddMetric("lipschitz", lipschitz_bounds_[j]);
-        cycle_metrics.AddMetric("lipschitz_surrogate", gradlip.lipschitz_constant);
-
-        int ls_step = 0;
-        bool improved = false;
-
-        while (ls_step++ < config_.linesearch_ss_num) {
-          const double try_coef = UpdateSlope(j, gradlip.lipschitz_constant, gradlip.gradient, IsAdaptiveTag{});
-
-          if (std::abs(try_coef - state_.coefs.beta[j]) > kNumericZero) {
-            state_.residuals += (updated_coef - try_coef) * data.cx().col(j);
-
-            const auto eval_loss = loss_->EvaluateResiduals(state_.residuals);
-            const double new_objf_pen = objf_pen_prev + PenaltyContribution(try_coef, j, IsAdaptiveTag{});
-            const double new_objf = eval_loss.loss + new_objf_pen;
-
-            total_mscale_iterations += loss_->mscale().LastIterations();
-
-            if (new_objf < state_.objf_loss + state_.objf_pen + convergence_tolerance_) {
-              // The objective function improved or did not change much. Stop here.
-              coef_change += std::abs(state_.coefs.beta[j] - try_coef);
-
-              state_.coefs.beta[j] = try_coef;
-              state_.objf_loss = eval_loss.loss;
-              state_.objf_pen = new_objf_pen;
-              state_.mscale = eval_loss.scale;
-
-              improved = true;
-              cycle_metrics.AddMetric("ls_stepsize", gradlip.lipschitz_constant);
-              break;
-            } else if (gradlip.lipschitz_constant >= lipschitz_bounds_[j]) {
-              // We are at the upper end of the step size range and haven't seen an improvement.
-              // Stop here.
-              updated_coef = try_coef;
-              break;
-            }
-
-            updated_coef = try_coef;
-            gradlip.lipschitz_constant /= config_.linesearch_ss_multiplier;
-          } else {
-            break;
-          }
-        }
-
-        if (!improved) {
-          if (std::abs(updated_coef - state_.coefs.beta[j]) > kNumericZero) {
-            state_.residuals += (updated_coef - state_.coefs.beta[j]) * data.cx().col(j);
-          }
-          cycle_metrics.AddMetric("ls_stepsize", 0.);
-        }
-
-        cycle_metrics.AddMetric("ls_steps", ls_step);
-        cycle_metrics.AddMetric("mscale_iterations", total_mscale_iterations);
-      }
+      counters_.Reset();
+      coef_change += Sweep(full_sweep ? strong_set : active_set);
+      counters_.Report(coorddesc::kCoordinateCounterNames, &iteration_metrics);
+      iteration_metrics.AddMetric("full_sweep", full_sweep ? 1 : 0);
 
       // After updating the slope coefficients, update the intercept.
       if (loss_->IncludeIntercept()) {
         // If we don't do linesearch, also compute the lipschitz constant of the surrogate WLS loss.
         auto gradlip = GradientAndSurrogateLipschitz();
         int total_mscale_iterations = 0;
-        double updated_coef = state_.coefs.intercept;
         iteration_metrics.AddMetric("gradient_int", gradlip.gradient);
         iteration_metrics.AddMetric("lipschitz_int", lipschitz_bound_intercept_);
         iteration_metrics.AddMetric("lipschitz_int_surrogate", gradlip.lipschitz_constant);
@@ -300,38 +315,43 @@ class CDPense :
 
         while (ls_step++ < config_.linesearch_ss_num) {
           const double try_coef = state_.coefs.intercept - gradlip.gradient / gradlip.lipschitz_constant;
-          state_.residuals += updated_coef - try_coef;
-          const auto eval_loss = loss_->EvaluateResiduals(state_.residuals);
-          total_mscale_iterations += loss_->mscale().LastIterations();
+          const double shift = state_.coefs.intercept - try_coef;
+          const double max_objf_loss = state_.objf_loss + convergence_tolerance_;
 
-          if (eval_loss.loss < state_.objf_loss + convergence_tolerance_) {
-            // The objective function improved or did not change much. Stop here.
-            coef_change += std::abs(state_.coefs.intercept - try_coef);
+          // The trial residuals are only formed if the trial step can improve the objective function.
+          if (LossCanBeLessThan(max_objf_loss, shift)) {
+            trial_residuals_ = state_.residuals + shift;
+            const auto eval_loss = loss_->EvaluateResiduals(trial_residuals_);
+            total_mscale_iterations += loss_->mscale().LastIterations();
 
-            state_.coefs.intercept = try_coef;
-            state_.objf_loss = eval_loss.loss;
-            state_.mscale = eval_loss.scale;
+            if (eval_loss.loss < max_objf_loss) {
+              // The objective function improved or did not change much. Stop here.
+              coef_change += std::abs(shift);
 
-            improved = true;
+              state_.residuals.swap(trial_residuals_);
+              TrackResidualUpdate(shift, 1.);
+              state_.coefs.intercept = try_coef;
+              state_.objf_loss = eval_loss.loss;
+              state_.mscale = eval_loss.scale;
 
-            iteration_metrics.AddMetric("ls_stepsize_int", gradlip.lipschitz_constant);
-            iteration_metrics.AddMetric("ls_steps_int", ls_step);
-            break;
-          } else if (gradlip.lipschitz_constant > lipschitz_bound_intercept_) {
+              improved = true;
+
+              iteration_metrics.AddMetric("ls_stepsize_int", gradlip.lipschitz_constant);
+              iteration_metrics.AddMetric("ls_steps_int", ls_step);
+              break;
+            }
+          }
+
+          if (gradlip.lipschitz_constant > lipschitz_bound_intercept_) {
             // We are at the upper end of the step size range and haven't seen an improvement.
-            // Stop here.
-            updated_coef = try_coef;
-            state_.residuals += try_coef - state_.coefs.intercept;
-            // The coefficient value did not change.
+            // Stop here. The coefficient value did not change.
             break;
           }
 
-          updated_coef = try_coef;
           gradlip.lipschitz_constant /= config_.linesearch_ss_multiplier;
         }
 
         if (!improved) {
-          state_.residuals += updated_coef - state_.coefs.intercept;
           iteration_metrics.AddMetric("ls_stepsize_int", 0.);
         }
 
@@ -344,72 +364,489 @@ class CDPense :
       iteration_metrics.AddMetric("coef_change", coef_change);
 
       if (objf_change * objf_change < convergence_tolerance_ * convergence_tolerance_) {
-        // The objective function value did not change. Algorithm converged.
-        metrics->AddMetric("iter", iter);
-        return nsoptim::MakeOptimum(*loss_, *penalty_, state_.coefs, state_.residuals,
-                                    std::move(metrics));
+        if (!full_sweep) {
+          // The active set converged. Check all the other coordinates in the next iteration.
+          full_sweep = true;
+        } else if (strong_set.n_elem == data.n_pred() || AddKktViolations(&strong_set, &iteration_metrics) == 0) {
+          // The objective function value did not change. Algorithm converged.
+          metrics->AddMetric("iter", iter);
+          metrics->AddMetric("coordinate_updates", static_cast<int>(scheduler_.updates()));
+          return nsoptim::MakeOptimum(*loss_, *penalty_, state_.coefs, state_.residuals,
+                                      std::move(metrics));
+        }
+      } else if (config_.active_set && full_sweep) {
+        active_set = ActiveSet();
+        full_sweep = false;
       }
 
-      // Re-compute the residuals after every few cycles to avoid any drifts
-      if (iter > 0 && iter % config_.reset_iter == 0) {
-        state_.residuals = loss_->Residuals(state_.coefs);
+      // Re-compute the residuals after every few cycles, but only if the drift could be noticeable.
+      if (iter > 0 && iter % config_.reset_iter == 0 && ResidualsDrifted()) {
+        RecomputeResiduals();
       }
     }
 
     metrics->AddMetric("iter", iter);
-    state_.residuals = loss_->Residuals(state_.coefs);
+    metrics->AddMetric("coordinate_updates", static_cast<int>(scheduler_.updates()));
+    if (ResidualsDrifted()) {
+      RecomputeResiduals();
+    }
     return nsoptim::MakeOptimum(*loss_, *penalty_, state_.coefs, state_.residuals,
                                 std::move(metrics), nsoptim::OptimumStatus::kWarning,
                                 "Coordinate descent did not converge.");
   }
 
  private:
+  //! Compute the bounds on the Lipschitz constants of the coordinates.
+  //! The bound for coordinate `j` is `(u1^2 + u2 * mscale) * (sum_i x_ij)^2`. The column sums and the largest
+  //! absolute values of the columns are cached with the data and hence shared by all optimizers, penalties and
+  //! tasks working on the same data.
   void UpdateLipschitzBounds() {
-    const auto data = loss_->data();
-    const auto ms = loss_->mscale();
+    const auto& data = loss_->data();
+    const auto& ms = loss_->mscale();
     const double eff_n = data.n_obs() * (1. - ms.delta());
     const double separation = eff_n - std::floor(eff_n);
     const double mult = std::log(separation * (1 - separation)) / std::cbrt(eff_n);
     const double u1 = std::min(80., -40. * mult) / ms.rho().cc();
     const double u2 = std::min(50., 100. * mult * mult * mult * mult) / ms.rho().cc();
-    lipschitz_bounds_ = u1 * u1 * arma::square(arma::sum(data.cx())).t();
-    for (arma::uword j = 0; j < data.n_pred(); ++j) {
-      lipschitz_bounds_[j] += u2 * state_.mscale * std::abs(arma::accu(data.cx().col(j) * data.cx().col(j).t()));
-    }
+    lipschitz_bounds_ = (u1 * u1 + u2 * state_.mscale) * arma::square(data.column_sums());
+    column_max_abs_ = data.column_max_abs();
 
     lipschitz_bound_intercept_ = (u1 * u1 + u2 * state_.mscale) * data.n_obs() * data.n_obs();
   }
 
+  //! Re-compute the residuals from scratch and reset the bound on the accumulated rounding errors.
+  void RecomputeResiduals() {
+    loss_->Residuals(state_.coefs, &state_.residuals);
+    ResetResidualDrift();
+  }
+
+  //! Reset the bound on the accumulated rounding errors for residuals which are computed from scratch.
+  void ResetResidualDrift() {
+    drift_.max_abs_residual = (state_.residuals.n_elem > 0) ? arma::norm(state_.residuals, "inf") : 0.;
+    drift_.error_bound = 0;
+  }
+
+  //! Account for the rounding errors of an incremental update of the residuals by `change` times a vector whose
+  //! elements are at most `max_abs_direction` in absolute value.
+  void TrackResidualUpdate(const double change, const double max_abs_direction) noexcept {
+    const double increment = std::abs(change) * max_abs_direction;
+    drift_.max_abs_residual += increment;
+    drift_.error_bound += std::numeric_limits<double>::epsilon() * (drift_.max_abs_residual + increment);
+  }
+
+  //! Check if the rounding errors accumulated in the residuals may be noticeable.
+  bool ResidualsDrifted() const noexcept {
+    return drift_.error_bound > coorddesc::kMaxRelativeResidualDrift * state_.mscale;
+  }
+
   coorddesc::SurrogateGradient GradientAndSurrogateLipschitz() {
-    const arma::vec wgt = loss_->mscale().rho().Weight(state_.residuals, state_.mscale);
-    const double gradient = -state_.mscale * state_.mscale * arma::dot(wgt, state_.residuals) /
-      arma::dot(wgt, arma::square(state_.residuals));
-    const double lipschitz = 2 * arma::mean(wgt);
+    const double wgt_sq_resid = loss_->mscale().rho().FusedWeight(state_.residuals, state_.mscale, &weights_);
+    const double gradient = -state_.mscale * state_.mscale * arma::dot(weights_, state_.residuals) / wgt_sq_resid;
+    const double lipschitz = 2 * arma::mean(weights_);
     return coorddesc::SurrogateGradient { gradient, lipschitz };
   }
 
   coorddesc::SurrogateGradient GradientAndSurrogateLipschitz(const arma::uword j) {
-    auto&& xmat = loss_->data().cx();
-    const arma::vec wgt = loss_->mscale().rho().Weight(state_.residuals, state_.mscale);
-    const double gradient = -state_.mscale * state_.mscale * arma::dot(wgt % xmat.col(j), state_.residuals) /
-      arma::dot(wgt, arma::square(state_.residuals));
-    const double lipschitz = 2 * arma::mean(wgt % arma::square(xmat.col(j)));
+    const auto& data = loss_->data();
+    const double wgt_sq_resid = loss_->mscale().rho().FusedWeight(state_.residuals, state_.mscale, &weights_);
+    // The weighted inner products of the column with the residuals and with itself are computed in a single pass.
+    const double* const column = data.cx().colptr(j);
+    const double* const weights = weights_.memptr();
+    const double* const residuals = state_.residuals.memptr();
+    double weighted_dot = 0;
+    double weighted_sq = 0;
+    for (arma::uword i = 0; i < data.n_obs(); ++i) {
+      const double weighted_x = weights[i] * column[i];
+      weighted_dot += weighted_x * residuals[i];
+      weighted_sq += weighted_x * column[i];
+    }
+    const double gradient = -state_.mscale * state_.mscale * weighted_dot / wgt_sq_resid;
+    const double lipschitz = 2 * weighted_sq / data.n_obs();
     return coorddesc::SurrogateGradient { gradient, lipschitz };
   }
 
+  //! Compute the weighted inner products of the columns in a block with the residuals and with themselves, i.e.,
+  //! `sum(weights % x_j % residuals)` and `sum(weights % x_j^2)` for every coordinate `j` in the block.
+  //! The rows are processed in tiles, and every tile of the weights and residuals is multiplied with the tiles of all
+  //! columns in the block while it is in cache. The partial sums of the tiles are added in a fixed order, hence the
+  //! result does not depend on the number of threads.
+  //!
+  //! @param block indices of the coefficients in the block.
+  //! @param weighted_dots Out. The weighted inner products of the columns with the residuals.
+  //! @param weighted_sqs Out. The weighted squared norms of the columns.
+  void BlockWeightedProducts(const arma::uvec& block, arma::vec* weighted_dots, arma::vec* weighted_sqs) {
+    const auto& data = loss_->data();
+    const auto& xmat = data.cx();
+    const arma::uword block_n = block.n_elem;
+    const arma::uword n_tiles = std::max<arma::uword>(
+      1, (data.n_obs() + coorddesc::kBlockTileRows - 1) / coorddesc::kBlockTileRows);
+    block_tile_dots_.set_size(block_n, n_tiles);
+    block_tile_sqs_.set_size(block_n, n_tiles);
+
+    // Consecutive tasks share the same tile of rows, hence chunks of tasks re-use the tile of weights and residuals.
+    const double tile_work = 4. * std::min(data.n_obs(), coorddesc::kBlockTileRows);
+    omp::ParallelFor(config_.num_threads, static_cast<int>(n_tiles * block_n), tile_work, [&](const int task) {
+      const arma::uword tile = task / block_n;
+      const arma::uword k = task % block_n;
+      const arma::uword begin = tile * coorddesc::kBlockTileRows;
+      const arma::uword end = std::min(begin + coorddesc::kBlockTileRows, data.n_obs());
+      const double* const column = xmat.colptr(block[k]);
+      const double* const weights = weights_.memptr();
+      const double* const residuals = state_.residuals.memptr();
+      double weighted_dot = 0;
+      double weighted_sq = 0;
+      for (arma::uword i = begin; i < end; ++i) {
+        const double weighted_x = weights[i] * column[i];
+        weighted_dot += weighted_x * residuals[i];
+        weighted_sq += weighted_x * column[i];
+      }
+      block_tile_dots_(k, tile) = weighted_dot;
+      block_tile_sqs_(k, tile) = weighted_sq;
+    });
+
+    *weighted_dots = arma::sum(block_tile_dots_, 1);
+    *weighted_sqs = arma::sum(block_tile_sqs_, 1);
+  }
+
+  //! Update the given slope coefficients, either one after the other or in blocks of coordinates updated concurrently
+  //! (see `UpdateBlock()`), in the order determined by the coordinate scheduler.
+  //!
+  //! @param sweep_coordinates indices of the coefficients to update.
+  //! @return sum of the absolute changes of the coefficients.
+  double Sweep(const arma::uvec& sweep_coordinates) {
+    nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kCdPenseSweep);
+    const arma::uvec& coordinates = scheduler_.Order(sweep_coordinates);
+    double coef_change = 0;
+    const arma::uword block_size = BlockSize();
+    if (block_size < 2 || coordinates.n_elem < 2 * block_size) {
+      for (auto&& j : coordinates) {
+        coef_change += UpdateCoordinate(j);
+      }
+      return coef_change;
+    }
+
+    for (arma::uword begin = 0; begin < coordinates.n_elem; begin += block_size) {
+      const arma::uword end = std::min<arma::uword>(begin + block_size, coordinates.n_elem);
+      coef_change += UpdateBlock(coordinates.subvec(begin, end - 1));
+    }
+    return coef_change;
+  }
+
+  //! Get the number of coordinates to update concurrently, or 0 if the coordinates should be updated sequentially.
+  //! Inside active parallel regions (e.g., while exploring the regularization path in parallel), the coordinates are
+  //! always updated sequentially.
+  arma::uword BlockSize() const noexcept {
+    if (config_.block_size < 2 || !omp::Enabled(config_.num_threads) || omp::InParallel()) {
+      return 0;
+    }
+    return config_.block_size;
+  }
+
+  //! Update a block of slope coefficients concurrently.
+  //! The surrogate gradients of all coordinates in the block are computed in parallel at the current residuals and
+  //! every coordinate proposes an update as in `UpdateCoordinate()`. The proposed updates are combined into a single
+  //! step, which is shortened by backtracking until the objective function does not increase. If no step length
+  //! is acceptable, e.g., because the coordinates in the block are strongly correlated, the coordinates are updated
+  //! one after the other.
+  //!
+  //! @param block indices of the coefficients to update.
+  //! @return sum of the absolute changes of the coefficients.
+  double UpdateBlock(const arma::uvec& block) {
+    using coorddesc::CoordinateCounter;
+    const auto& data = loss_->data();
+    const auto& xmat = data.cx();
+    const int block_n = static_cast<int>(block.n_elem);
+    const double wgt_sq_resid = loss_->mscale().rho().FusedWeight(state_.residuals, state_.mscale, &weights_);
+    const double gradient_mult = -state_.mscale * state_.mscale / wgt_sq_resid;
+
+    // The surrogate gradients only depend on the current residuals and can be computed concurrently.
+    arma::vec gradients;
+    arma::vec lipschitz;
+    BlockWeightedProducts(block, &gradients, &lipschitz);
+    gradients *= gradient_mult;
+    lipschitz *= 2. / data.n_obs();
+
+    // The proposed changes of the residuals, i.e., `current - proposed` for every coefficient in the block.
+    arma::vec current(block_n);
+    arma::vec steps(block_n);
+    bool any_step = false;
+    for (int k = 0; k < block_n; ++k) {
+      current[k] = state_.coefs.beta[block[k]];
+      steps[k] = current[k] - UpdateSlope(block[k], lipschitz[k], gradients[k], IsAdaptiveTag{});
+      scheduler_.Record(block[k], lipschitz[k] * std::abs(steps[k]));
+      if (std::abs(steps[k]) > kNumericZero) {
+        any_step = true;
+      } else {
+        steps[k] = 0;
+      }
+      counters_.Add(CoordinateCounter::kGradient, gradients[k]);
+      counters_.Add(CoordinateCounter::kLipschitzSurrogate, lipschitz[k]);
+    }
+    if (!any_step) {
+      return 0;
+    }
+
+    // Combine the proposed changes of the residuals. The rows are split between the threads.
+    block_direction_.zeros(data.n_obs());
+    const int row_chunks = static_cast<int>(std::max<arma::uword>(1, std::min<arma::uword>(
+      config_.num_threads, data.n_obs() / coorddesc::kMinBlockRowsPerThread)));
+    const arma::uword chunk_rows = data.n_obs() / row_chunks;
+    omp::ParallelFor(config_.num_threads, row_chunks, [&](const int chunk) {
+      const arma::uword begin = chunk * chunk_rows;
+      const arma::uword end = (chunk + 1 < row_chunks) ? begin + chunk_rows : data.n_obs();
+      double* const direction = block_direction_.memptr();
+      for (int k = 0; k < block_n; ++k) {
+        if (steps[k] != 0) {
+          const double* const column = xmat.colptr(block[k]);
+          for (arma::uword i = begin; i < end; ++i) {
+            direction[i] += steps[k] * column[i];
+          }
+        }
+      }
+    });
+
+    // Safeguarded line search along the combined step.
+    double step_length = 1;
+    int total_mscale_iterations = 0;
+    for (int ls_step = 1; ls_step <= config_.linesearch_ss_num; ++ls_step) {
+      double new_objf_pen = state_.objf_pen;
+      for (int k = 0; k < block_n; ++k) {
+        new_objf_pen += PenaltyContribution(current[k] - step_length * steps[k], block[k], IsAdaptiveTag{}) -
+          PenaltyContribution(current[k], block[k], IsAdaptiveTag{});
+      }
+      const double max_objf_loss = state_.objf_loss + state_.objf_pen + convergence_tolerance_ - new_objf_pen;
+
+      if (LossCanBeLessThan(max_objf_loss, step_length, block_direction_)) {
+        trial_residuals_ = state_.residuals + step_length * block_direction_;
+        const auto eval_loss = loss_->EvaluateResiduals(trial_residuals_);
+        total_mscale_iterations += loss_->mscale().LastIterations();
+
+        if (eval_loss.loss < max_objf_loss) {
+          double coef_change = 0;
+          state_.residuals.swap(trial_residuals_);
+          for (int k = 0; k < block_n; ++k) {
+            if (steps[k] != 0) {
+              state_.coefs.beta[block[k]] = current[k] - step_length * steps[k];
+              coef_change += step_length * std::abs(steps[k]);
+              TrackResidualUpdate(step_length * steps[k], column_max_abs_[block[k]]);
+            }
+          }
+          state_.objf_loss = eval_loss.loss;
+          state_.objf_pen = new_objf_pen;
+          state_.mscale = eval_loss.scale;
+
+          counters_.Add(CoordinateCounter::kLinesearchStepsize, step_length);
+          counters_.Add(CoordinateCounter::kLinesearchSteps, ls_step);
+          counters_.Add(CoordinateCounter::kMscaleIterations, total_mscale_iterations);
+          return coef_change;
+        }
+      }
+      step_length *= config_.linesearch_ss_multiplier;
+    }
+
+    // The combined step does not decrease the objective function. Fall back to sequential updates.
+    double coef_change = 0;
+    for (auto&& j : block) {
+      coef_change += UpdateCoordinate(j);
+    }
+    return coef_change;
+  }
+
+  //! Update the j-th slope coefficient using line search along the surrogate gradient.
+  //!
+  //! @param j index of the coefficient to update.
+  //! @return absolute change of the coefficient.
+  double UpdateCoordinate(const arma::uword j) {
+    using coorddesc::CoordinateCounter;
+    const auto& data = loss_->data();
+    double coef_change = 0;
+    auto gradlip = GradientAndSurrogateLipschitz(j);
+    int total_mscale_iterations = 0;
+    int screened_steps = 0;
+    const double objf_pen_prev = state_.objf_pen - PenaltyContribution(state_.coefs.beta[j], j, IsAdaptiveTag{});
+    // Non-owning view of the j-th column of the predictor matrix.
+    const arma::vec column(const_cast<double*>(data.cx().colptr(j)), data.n_obs(), false, true);
+
+    counters_.Add(CoordinateCounter::kGradient, gradlip.gradient);
+    counters_.Add(CoordinateCounter::kLipschitzSurrogate, gradlip.lipschitz_constant);
+
+    int ls_step = 0;
+    bool improved = false;
+
+    while (ls_step++ < config_.linesearch_ss_num) {
+      const double try_coef = UpdateSlope(j, gradlip.lipschitz_constant, gradlip.gradient, IsAdaptiveTag{});
+
+      const double step = state_.coefs.beta[j] - try_coef;
+      if (ls_step == 1) {
+        // The size of the proximal step along the surrogate gradient measures the violation of the optimality
+        // conditions.
+        scheduler_.Record(j, gradlip.lipschitz_constant * std::abs(step));
+      }
+      if (std::abs(step) > kNumericZero) {
+        const double new_objf_pen = objf_pen_prev + PenaltyContribution(try_coef, j, IsAdaptiveTag{});
+        const double max_objf_loss = state_.objf_loss + state_.objf_pen + convergence_tolerance_ - new_objf_pen;
+
+        // Only form the trial residuals and solve the M-scale equation if the trial step can improve the objective
+        // function. The check evaluates the trial residuals on the fly, in a single pass over the column.
+        if (LossCanBeLessThan(max_objf_loss, step, column)) {
+          trial_residuals_ = state_.residuals + step * column;
+          const auto eval_loss = loss_->EvaluateResiduals(trial_residuals_);
+          total_mscale_iterations += loss_->mscale().LastIterations();
+
+          if (eval_loss.loss < max_objf_loss) {
+            // The objective function improved or did not change much. Stop here.
+            coef_change = std::abs(step);
+
+            state_.residuals.swap(trial_residuals_);
+            TrackResidualUpdate(step, column_max_abs_[j]);
+            state_.coefs.beta[j] = try_coef;
+            state_.objf_loss = eval_loss.loss;
+            state_.objf_pen = new_objf_pen;
+            state_.mscale = eval_loss.scale;
+
+            improved = true;
+            counters_.Add(CoordinateCounter::kLinesearchStepsize, gradlip.lipschitz_constant);
+            break;
+          }
+        } else {
+          ++screened_steps;
+        }
+
+        if (gradlip.lipschitz_constant >= lipschitz_bounds_[j]) {
+          // We are at the upper end of the step size range and haven't seen an improvement.
+          // Stop here.
+          break;
+        }
+
+        gradlip.lipschitz_constant /= config_.linesearch_ss_multiplier;
+      } else {
+        break;
+      }
+    }
+
+    if (!improved) {
+      counters_.Add(CoordinateCounter::kLinesearchStepsize, 0.);
+    }
+
+    counters_.Add(CoordinateCounter::kLinesearchSteps, ls_step);
+    counters_.Add(CoordinateCounter::kMscaleIterations, total_mscale_iterations);
+    counters_.Add(CoordinateCounter::kScreenedSteps, screened_steps);
+    return coef_change;
+  }
+
+  //! Compute the gradient of the S-loss with respect to all slope coefficients at the current state.
+  arma::vec SlopeGradient() {
+    const double wgt_sq_resid = loss_->mscale().rho().FusedWeight(state_.residuals, state_.mscale, &weights_);
+    return (-state_.mscale * state_.mscale / wgt_sq_resid) * (loss_->data().cx().t() * (weights_ % state_.residuals));
+  }
+
+  //! Get the indices of the coordinates which are not discarded by the sequential strong rule.
+  //! The rule assumes that the current state is the optimum for penalty level `screening_lambda_` and discards
+  //! zero coefficients with gradient less than `alpha * (2 lambda - screening_lambda_)`.
+  arma::uvec StrongSet() {
+    const arma::uword n_pred = loss_->data().n_pred();
+    if (!config_.strong_rules || screening_lambda_ < 0 || penalty_->lambda() < kNumericZero) {
+      return arma::regspace<arma::uvec>(0, n_pred - 1);
+    }
+    const double factor = std::max(0., 2 - screening_lambda_ / penalty_->lambda());
+    const arma::vec gradient = SlopeGradient();
+    arma::uvec strong_set(n_pred);
+    arma::uword n_strong = 0;
+    for (arma::uword j = 0; j < n_pred; ++j) {
+      if (state_.coefs.beta[j] != 0 || std::abs(gradient[j]) >= factor * PenaltyLevel(j, IsAdaptiveTag{})) {
+        strong_set[n_strong++] = j;
+      }
+    }
+    strong_set.resize(n_strong);
+    return strong_set;
+  }
+
+  //! Add all coordinates not in the strong set which violate the KKT conditions to the strong set.
+  //!
+  //! @param strong_set the sorted strong set.
+  //! @param iteration_metrics metrics of the current iteration.
+  //! @return the number of coordinates added to the strong set.
+  arma::uword AddKktViolations(arma::uvec* strong_set, nsoptim::Metrics* iteration_metrics) {
+    const arma::uword n_pred = loss_->data().n_pred();
+    const arma::vec gradient = SlopeGradient();
+    arma::uvec violations(n_pred - strong_set->n_elem);
+    arma::uword n_violations = 0;
+    auto strong_it = strong_set->cbegin();
+    const auto strong_end = strong_set->cend();
+    for (arma::uword j = 0; j < n_pred; ++j) {
+      if (strong_it != strong_end && *strong_it == j) {
+        ++strong_it;
+      } else if (std::abs(gradient[j]) > PenaltyLevel(j, IsAdaptiveTag{})) {
+        violations[n_violations++] = j;
+      }
+    }
+    iteration_metrics->AddMetric("kkt_violations", static_cast<int>(n_violations));
+    if (n_violations > 0) {
+      violations.resize(n_violations);
+      *strong_set = arma::sort(arma::join_cols(*strong_set, violations));
+    }
+    return n_violations;
+  }
+
+  //! Get the indices of the non-zero slope coefficients.
+  arma::uvec ActiveSet() const {
+    const arma::uword n_pred = loss_->data().n_pred();
+    arma::uvec active_set(n_pred);
+    arma::uword n_active = 0;
+    for (arma::uword j = 0; j < n_pred; ++j) {
+      if (state_.coefs.beta[j] != 0) {
+        active_set[n_active++] = j;
+      }
+    }
+    active_set.resize(n_active);
+    return active_set;
+  }
+
+  //! Check if the S-loss at the current residuals can be less than `max_loss`.
+  //! The S-loss is less than `max_loss` if and only if the M-scale is less than `sqrt(2 max_loss)`, which can be
+  //! checked with a single pass over the residuals instead of solving the M-scale equation.
+  //!
+  //! @param max_loss upper bound for the S-loss.
+  //! @return `true` if the S-loss at the current residuals is less than `max_loss`.
+  bool LossCanBeLessThan(const double max_loss) const {
+    return max_loss > 0 && loss_->mscale().IsLessThan(state_.residuals, std::sqrt(2 * max_loss));
+  }
+
+  //! Check if the loss at the trial residuals `state_.residuals + step * direction` can be less than `max_loss`.
+  bool LossCanBeLessThan(const double max_loss, const double step, const arma::vec& direction) const {
+    return max_loss > 0 && loss_->mscale().IsLessThan(state_.residuals, step, direction, std::sqrt(2 * max_loss));
+  }
+
+  //! Check if the loss at the trial residuals `state_.residuals + shift` can be less than `max_loss`.
+  bool LossCanBeLessThan(const double max_loss, const double shift) const {
+    return max_loss > 0 && loss_->mscale().IsLessThan(state_.residuals, shift, std::sqrt(2 * max_loss));
+  }
+
+  //! Compute the L1 and L2 penalty levels for the current penalty function.
+  void UpdatePenaltyLevels() noexcept {
+    penalty_levels_.l1 = penalty_->lambda() * penalty_->alpha();
+    penalty_levels_.l2 = penalty_->lambda() * (1 - penalty_->alpha());
+  }
+
   double UpdateSlope (const arma::uword j, const double stepsize, const double gradient,
-                      std::false_type /* is_adaptive */) {
+                      std::false_type /* is_adaptive */) const noexcept {
     const double dir = stepsize * state_.coefs.beta[j] - gradient;
-    return nsoptim::SoftThreshold(dir, penalty_->lambda() * penalty_->alpha()) /
-      (stepsize + penalty_->lambda() * (1 - penalty_->alpha()));
+    return nsoptim::SoftThreshold(dir, penalty_levels_.l1) / (stepsize + penalty_levels_.l2);
   }
 
   double UpdateSlope (const arma::uword j, const double stepsize, const double gradient,
-                      std::true_type /* is_adaptive */) {
+                      std::true_type /* is_adaptive */) const noexcept {
     const double dir = stepsize * state_.coefs.beta[j] - gradient;
-    const double penalty_level = penalty_->loadings()[j] * penalty_->lambda();
-    return nsoptim::SoftThreshold(dir, penalty_level * penalty_->alpha()) /
-      (stepsize + penalty_level * (1 - penalty_->alpha()));
+    const double loading = penalty_->loadings()[j];
+    return nsoptim::SoftThreshold(dir, loading * penalty_levels_.l1) / (stepsize + loading * penalty_levels_.l2);
+  }
+
+  double PenaltyLevel(const arma::uword, std::false_type /* is_adaptive */) const noexcept {
+    return penalty_levels_.l1;
+  }
+
+  double PenaltyLevel(const arma::uword j, std::true_type /* is_adaptive */) const noexcept {
+    return penalty_->loadings()[j] * penalty_levels_.l1;
   }
 
   void ResetState (const Coefficients &coefs) {
@@ -419,30 +856,51 @@ class CDPense :
     if (!penalty_) {
       throw std::logic_error("no penalty set");
     }
+    screening_lambda_ = -1;
     state_ = { coefs, loss_->Residuals(coefs), 0, 0, penalty_->Evaluate(coefs) };
     auto loss_eval = loss_->EvaluateResiduals(state_.residuals);
     state_.mscale = loss_eval.scale;
     state_.objf_loss = loss_eval.loss;
+    ResetResidualDrift();
   }
 
-  double PenaltyContribution(const double value, const arma::uword, std::false_type /* is_adaptive */) {
-    return penalty_->lambda() * (penalty_->alpha() * std::abs(value) +
-      0.5 * (1 - penalty_->alpha()) * value * value);
+  double PenaltyContribution(const double value, const arma::uword,
+                             std::false_type /* is_adaptive */) const noexcept {
+    return penalty_levels_.l1 * std::abs(value) + 0.5 * penalty_levels_.l2 * value * value;
   }
 
-  double PenaltyContribution(const double value, const arma::uword j, std::true_type /* is_adaptive */) {
-    return penalty_->loadings()[j] * penalty_->lambda() *
-      (penalty_->alpha() * std::abs(value) +
-        0.5 * (1 - penalty_->alpha()) * value * value);
+  double PenaltyContribution(const double value, const arma::uword j,
+                             std::true_type /* is_adaptive */) const noexcept {
+    return penalty_->loadings()[j] * (penalty_levels_.l1 * std::abs(value) + 0.5 * penalty_levels_.l2 * value * value);
   }
 
   LossFunctionPtr loss_;
   PenaltyPtr penalty_;
   CDPenseConfiguration config_;
+  //! Summaries of the coordinate updates in the current iteration.
+  nsoptim::Counters<coorddesc::CoordinateCounter> counters_;
+  //! Order of the coordinates in every iteration.
+  nsoptim::coorddesc::CoordinateScheduler scheduler_;
   arma::vec lipschitz_bounds_;
   double lipschitz_bound_intercept_;
   coorddesc::State<Coefficients> state_;
+  //! Workspace for the weights of the surrogate gradient, re-used across coordinates and iterations.
+  arma::vec weights_;
+  //! Workspace for the residuals at a trial step of the line search, re-used across coordinates and iterations.
+  arma::vec trial_residuals_;
+  //! Workspace for the combined change of the residuals when updating a block of coordinates.
+  arma::vec block_direction_;
+  //! Workspaces for the partial weighted inner products of every row tile when updating a block of coordinates.
+  arma::mat block_tile_dots_;
+  arma::mat block_tile_sqs_;
   double convergence_tolerance_ = kDefaultConvergenceTolerance;
+  //! Penalty level the current state was optimized for, or negative if the state is not an optimum.
+  double screening_lambda_ = -1;
+  //! L1 and L2 penalty levels of the penalty function, updated at the start of every optimization.
+  coorddesc::PenaltyLevels penalty_levels_;
+  //! Largest absolute value in every column of the predictor matrix, to bound the drift of the residuals.
+  arma::vec column_max_abs_;
+  coorddesc::ResidualDrift drift_;
 };
 } // namespace pense
 
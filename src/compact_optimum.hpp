@@ -0,0 +1,116 @@
+//
+//  compact_optimum.hpp
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef COMPACT_OPTIMUM_HPP_
+#define COMPACT_OPTIMUM_HPP_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+
+#include "nsoptim.hpp"
+
+namespace pense {
+//! Maximum proportion of non-zero slope coefficients for which a dense slope is stored as sparse vector.
+//! A sparse vector needs at least twice the memory of a dense vector per non-zero element.
+constexpr double kMaxCompactSlopeDensity = 0.3;
+
+//! Slope coefficients stored either as dense or as sparse vector, whichever needs less memory.
+class CompactSlope {
+ public:
+  //! Create an empty slope.
+  CompactSlope() noexcept : n_elem(0), is_sparse_(false) {}
+
+  //! Store a dense slope, converted to a sparse vector if the proportion of non-zero elements is at most
+  //! `kMaxCompactSlopeDensity`.
+  explicit CompactSlope(arma::vec&& beta) : n_elem(beta.n_elem), is_sparse_(false) {
+    const arma::uword n_nonzero = arma::accu(beta != 0);
+    if (n_nonzero <= kMaxCompactSlopeDensity * n_elem) {
+      sparse_ = arma::sp_vec(beta);
+      is_sparse_ = true;
+    } else {
+      dense_ = std::move(beta);
+    }
+  }
+
+  //! Store a sparse slope.
+  explicit CompactSlope(arma::sp_vec&& beta) : n_elem(beta.n_elem), sparse_(std::move(beta)), is_sparse_(true) {}
+
+  //! Check if the slope is stored as sparse vector.
+  bool IsSparse() const noexcept {
+    return is_sparse_;
+  }
+
+  //! Get the slope stored as dense vector. Only valid if `IsSparse()` is false.
+  const arma::vec& Dense() const noexcept {
+    return dense_;
+  }
+
+  //! Get the slope stored as sparse vector. Only valid if `IsSparse()` is true.
+  const arma::sp_vec& Sparse() const noexcept {
+    return sparse_;
+  }
+
+  //! Convert the slope to the given vector type.
+  template<typename T>
+  T As() const {
+    return is_sparse_ ? T(sparse_) : T(dense_);
+  }
+
+  //! Number of bytes occupied by the stored slope coefficients.
+  std::size_t MemoryBytes() const noexcept {
+    return is_sparse_ ? nsoptim::timings::MemoryBytes(sparse_) : nsoptim::timings::MemoryBytes(dense_);
+  }
+
+  //! Number of slope coefficients.
+  arma::uword n_elem;
+
+ private:
+  arma::vec dense_;
+  arma::sp_vec sparse_;
+  bool is_sparse_;
+};
+
+//! Regression coefficients with the slope stored compactly.
+struct CompactCoefficients {
+  double intercept;
+  CompactSlope beta;
+};
+
+//! An optimum stored compactly along a regularization path.
+//! In contrast to `Optimum`, the loss function, the residuals and the metrics are not retained and the slope
+//! coefficients are stored as sparse vector if most of them are zero.
+template<typename Optimum>
+struct CompactOptimum {
+  using PenaltyFunction = typename Optimum::PenaltyFunction;
+  using Coefficients = typename Optimum::Coefficients;
+
+  explicit CompactOptimum(Optimum&& optimum)
+      : penalty(std::move(optimum.penalty)),
+        coefs{optimum.coefs.intercept, CompactSlope(std::move(optimum.coefs.beta))},
+        objf_value(optimum.objf_value), status(optimum.status), message(std::move(optimum.message)) {}
+
+  //! Create the optimum from stored coefficients, e.g., restored from a checkpoint.
+  CompactOptimum(const PenaltyFunction& penalty, CompactCoefficients&& coefs, const double objf_value,
+                 const nsoptim::OptimumStatus status, std::string&& message)
+      : penalty(penalty), coefs(std::move(coefs)), objf_value(objf_value), status(status),
+        message(std::move(message)) {}
+
+  //! Get the coefficients in the same form as the coefficients of `Optimum`.
+  Coefficients FullCoefficients() const {
+    return Coefficients(coefs.intercept, coefs.beta.template As<typename Coefficients::SlopeCoefficient>());
+  }
+
+  PenaltyFunction penalty;
+  CompactCoefficients coefs;
+  double objf_value;
+  nsoptim::OptimumStatus status;
+  std::string message;
+};
+}  // namespace pense
+
+#endif  // COMPACT_OPTIMUM_HPP_
@@ -45,6 +45,25 @@ enum class MestEnAlgorithm {
   kMm = 1
 };
 
+//! Integer IDs for the supported starting points of the leave-one-out fits to compute PSCs.
+enum class LooWarmStart {
+  kNone = 0,  //!< Continue from the previous solution of the optimizer.
+  kFullData = 1,  //!< Start from the full-data optimum for the same penalty.
+  kPrevious = 2  //!< Start from the previous leave-one-out optimum for the same penalty.
+};
+
+//! Integer IDs for the supported methods to compute initial estimates for the S-loss.
+enum class InitialEstimatorMethod {
+  kEnpy = 1,  //!< Elastic Net Pena-Yohai procedure.
+  kRandomSubsets = 2  //!< LS-EN estimates on random subsets, concentrated by the S-optimizer.
+};
+
+//! Integer IDs for supported algorithms to solve the M-scale equation
+enum class MscaleAlgorithm {
+  kFixedPoint = 1,
+  kNewton = 2
+};
+
 //! Default tuning constant for the Huber rho function for location estimates.
 constexpr double kDefaultHuberLocationCc = 1.345;
 //! Default tuning constant for the Bisquare rho function for location estimates.
@@ -57,6 +76,9 @@ constexpr double kDefaultMscaleDelta = 0.25;
 constexpr EnAlgorithm kDefaultEnAlgorithm = EnAlgorithm::kLars;
 constexpr PenseAlgorithm kDefaultPenseAlgorithm = PenseAlgorithm::kMm;
 constexpr MestEnAlgorithm kDefaultMestAlgorithm = MestEnAlgorithm::kMm;
+constexpr MscaleAlgorithm kDefaultMscaleAlgorithm = MscaleAlgorithm::kFixedPoint;
+constexpr LooWarmStart kDefaultLooWarmStart = LooWarmStart::kNone;
+constexpr InitialEstimatorMethod kDefaultInitialEstimatorMethod = InitialEstimatorMethod::kEnpy;
 constexpr bool kDefaultUseSparse = false;
 
 }  // namespace pense
@@ -0,0 +1,276 @@
+//
+//  enpy_cache.hpp
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef ENPY_CACHE_HPP_
+#define ENPY_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "nsoptim.hpp"
+#include "omp_utils.hpp"
+#include "enpy_psc.hpp"
+
+namespace pense {
+namespace enpy_initest_internal {
+//! Maximum number of LS-EN estimates on PSC subsets retained in the cache.
+constexpr std::size_t kMaxCachedSubsetOptima = 20000;
+//! Maximum number of PSC results retained in the cache.
+constexpr std::size_t kMaxCachedPscs = 500;
+
+//! Fingerprint of the values in a predictor-response data set.
+//! Two data sets with the same values have the same fingerprint, irrespective of their object ID.
+struct DataFingerprint {
+  arma::uword n_obs;  //!< Number of observations.
+  arma::uword n_pred;  //!< Number of predictors.
+  std::uint64_t hash;  //!< Hash of the values.
+  std::uint64_t check;  //!< Second hash of the values, independent of `hash`, to verify matches of `hash`.
+
+  bool operator==(const DataFingerprint& other) const noexcept {
+    return n_obs == other.n_obs && n_pred == other.n_pred && hash == other.hash && check == other.check;
+  }
+
+  bool operator!=(const DataFingerprint& other) const noexcept {
+    return !(*this == other);
+  }
+};
+
+//! Compute the fingerprint of the values in the given predictor-response data.
+//!
+//! @param data the data to fingerprint.
+//! @return the fingerprint of the values in `data`.
+DataFingerprint FingerprintData(const nsoptim::PredictorResponseData& data) noexcept;
+
+//! Combine a 64-bit hash with the bit pattern of a floating point value.
+//!
+//! @param hash the hash to update.
+//! @param value the value to add to the hash.
+//! @return the updated hash.
+std::uint64_t HashCombine(const std::uint64_t hash, const double value) noexcept;
+
+//! Combine a 64-bit hash with an integer value.
+//!
+//! @param hash the hash to update.
+//! @param value the value to add to the hash.
+//! @return the updated hash.
+std::uint64_t HashCombineInteger(const std::uint64_t hash, const std::uint64_t value) noexcept;
+
+//! Compute the hash of the names and values of all items in a (nested) list of options.
+//! Two lists with the same names and values have the same hash.
+//!
+//! @param options the list of options.
+//! @return the hash of the options.
+std::uint64_t HashOptions(const Rcpp::List& options) noexcept;
+
+//! Compute the hash of penalty functions with a hyper-parameter `alpha` and a penalization level `lambda`.
+template<typename Penalty>
+std::uint64_t HashPenalty(const Penalty& penalty) noexcept {
+  return HashCombine(HashCombine(0, penalty.alpha()), penalty.lambda());
+}
+
+//! Compute the hash of an adaptive EN penalty function, including the penalty loadings.
+inline std::uint64_t HashPenalty(const nsoptim::AdaptiveEnPenalty& penalty) noexcept {
+  std::uint64_t hash = HashCombine(HashCombine(0, penalty.alpha()), penalty.lambda());
+  for (auto&& loading : penalty.loadings()) {
+    hash = HashCombine(hash, loading);
+  }
+  return hash;
+}
+
+//! Compute the hash of an adaptive LASSO penalty function, including the penalty loadings.
+inline std::uint64_t HashPenalty(const nsoptim::AdaptiveLassoPenalty& penalty) noexcept {
+  std::uint64_t hash = HashCombine(HashCombine(0, penalty.alpha()), penalty.lambda());
+  for (auto&& loading : penalty.loadings()) {
+    hash = HashCombine(hash, loading);
+  }
+  return hash;
+}
+
+//! Key of an entry in the ENPY cache. Keys are equal only if the fingerprints of the data and the hash of the
+//! penalty, the intercept and all options affecting the result are equal.
+struct EnpyCacheKey {
+  DataFingerprint data;  //!< Fingerprint of the data.
+  std::uint64_t settings;  //!< Hash of the penalty, the intercept, and the options.
+
+  bool operator==(const EnpyCacheKey& other) const noexcept {
+    return settings == other.settings && data == other.data;
+  }
+};
+
+//! Hash function for keys of the ENPY cache.
+struct EnpyCacheKeyHash {
+  std::size_t operator()(const EnpyCacheKey& key) const noexcept {
+    return static_cast<std::size_t>(HashCombineInteger(key.data.hash, key.settings));
+  }
+};
+
+//! Get the convergence tolerance of optimizers which have one.
+template<typename Optimizer>
+auto OptimizerTolerance(const Optimizer& optimizer, int) noexcept -> decltype(optimizer.convergence_tolerance()) {
+  return optimizer.convergence_tolerance();
+}
+
+//! Direct optimizers do not have a convergence tolerance.
+template<typename Optimizer>
+double OptimizerTolerance(const Optimizer&, long) noexcept {  // NOLINT(runtime/int)
+  return 0;
+}
+
+//! A session-wide cache of LS-EN estimates on PSC subsets and of PSC results.
+//! Entries are identified by the fingerprint of the data, the intercept, the penalty, the convergence tolerance of
+//! the optimizer, and the hash of all options which affect the result (see `Key()`). There is a separate cache for
+//! each optimizer type. The oldest entries are dropped if the cache is full. The cache can be used concurrently from
+//! several threads.
+template<typename Optimizer>
+class EnpyCache {
+  using Optimum = typename Optimizer::Optimum;
+
+ public:
+  //! Get the cache for the optimizer type.
+  static EnpyCache& Instance() {
+    static EnpyCache cache;
+    return cache;
+  }
+
+  EnpyCache(const EnpyCache&) = delete;
+  EnpyCache& operator=(const EnpyCache&) = delete;
+
+  //! Get the key for the LS-EN estimate on the given data with the penalty of the optimizer.
+  //!
+  //! @param loss the LS loss on the data.
+  //! @param optimizer the optimizer with the penalty to identify the estimate.
+  //! @param options_hash hash of all options affecting the result (see `HashOptions()`).
+  //! @return the key of the estimate.
+  static EnpyCacheKey Key(const nsoptim::LsRegressionLoss& loss, const Optimizer& optimizer,
+                          const std::uint64_t options_hash) noexcept {
+    return Key(loss, optimizer.penalty(), optimizer, options_hash);
+  }
+
+  //! Get the key for the LS-EN estimate on the given data with the given penalty.
+  //!
+  //! @param loss the LS loss on the data.
+  //! @param penalty the penalty.
+  //! @param optimizer the optimizer.
+  //! @param options_hash hash of all options affecting the result (see `HashOptions()`).
+  //! @return the key of the estimate.
+  static EnpyCacheKey Key(const nsoptim::LsRegressionLoss& loss, const typename Optimizer::PenaltyFunction& penalty,
+                          const Optimizer& optimizer, const std::uint64_t options_hash) noexcept {
+    std::uint64_t settings = HashCombineInteger(options_hash, HashPenalty(penalty));
+    settings = HashCombine(settings, OptimizerTolerance(optimizer, 0));
+    settings = HashCombine(settings, loss.IncludeIntercept() ? 1. : 0.);
+    return EnpyCacheKey { FingerprintData(loss.data()), settings };
+  }
+
+  //! Find an LS-EN estimate on a PSC subset.
+  //!
+  //! @param key the key of the estimate.
+  //! @param loss the loss to associate with the returned estimate.
+  //! @return the cached estimate or an empty pointer if the estimate is not in the cache.
+  std::unique_ptr<Optimum> FindSubsetOptimum(const EnpyCacheKey& key, const nsoptim::LsRegressionLoss& loss) {
+    omp::Guard guard(&lock_);
+    const auto it = subset_optima_.find(key);
+    if (it == subset_optima_.end()) {
+      return nullptr;
+    }
+    std::unique_ptr<Optimum> optimum(new Optimum(it->second));
+    optimum->loss = loss;
+    return optimum;
+  }
+
+  //! Store an LS-EN estimate on a PSC subset.
+  //!
+  //! @param key the key of the estimate.
+  //! @param optimum the estimate.
+  void StoreSubsetOptimum(const EnpyCacheKey& key, const Optimum& optimum) {
+    omp::Guard guard(&lock_);
+    if (subset_optima_.count(key) == 0) {
+      subset_optima_.emplace(key, Detach(optimum));
+      subset_optima_order_.push_back(key);
+      if (subset_optima_order_.size() > kMaxCachedSubsetOptima) {
+        subset_optima_.erase(subset_optima_order_.front());
+        subset_optima_order_.pop_front();
+      }
+    }
+  }
+
+  //! Find the PSC result on the given data.
+  //!
+  //! @param key the key of the PSC result.
+  //! @param loss the loss to associate with the LS-EN estimate in the returned PSC result.
+  //! @return the cached PSC result or an empty pointer if the PSC result is not in the cache.
+  std::unique_ptr<PscResult<Optimizer>> FindPsc(const EnpyCacheKey& key, const nsoptim::LsRegressionLoss& loss) {
+    omp::Guard guard(&lock_);
+    const auto it = pscs_.find(key);
+    if (it == pscs_.end()) {
+      return nullptr;
+    }
+    std::unique_ptr<PscResult<Optimizer>> psc_result(new PscResult<Optimizer>(it->second.optimum));
+    psc_result->optimum.loss = loss;
+    psc_result->status = it->second.status;
+    psc_result->warnings = it->second.warnings;
+    psc_result->message = it->second.message;
+    psc_result->pscs = it->second.pscs;
+    psc_result->metrics.AddDetail("cached", 1);
+    return psc_result;
+  }
+
+  //! Store a PSC result. The metrics are not stored.
+  //!
+  //! @param key the key of the PSC result.
+  //! @param psc_result the PSC result.
+  void StorePsc(const EnpyCacheKey& key, const PscResult<Optimizer>& psc_result) {
+    if (psc_result.status == PscStatusCode::kError) {
+      return;
+    }
+    omp::Guard guard(&lock_);
+    if (pscs_.count(key) == 0) {
+      pscs_.emplace(key, CachedPsc { Detach(psc_result.optimum), psc_result.status, psc_result.warnings,
+                                     psc_result.message, psc_result.pscs });
+      pscs_order_.push_back(key);
+      if (pscs_order_.size() > kMaxCachedPscs) {
+        pscs_.erase(pscs_order_.front());
+        pscs_order_.pop_front();
+      }
+    }
+  }
+
+ private:
+  //! A PSC result without the metrics.
+  struct CachedPsc {
+    Optimum optimum;
+    PscStatusCode status;
+    int warnings;
+    std::string message;
+    arma::mat pscs;
+  };
+
+  EnpyCache() noexcept : empty_data_(std::make_shared<const nsoptim::PredictorResponseData>()) {}
+
+  //! Copy an estimate without the metrics and without a reference to the data.
+  Optimum Detach(const Optimum& optimum) const {
+    Optimum detached(optimum);
+    detached.loss = nsoptim::LsRegressionLoss(empty_data_, optimum.loss.IncludeIntercept());
+    detached.metrics.reset();
+    return detached;
+  }
+
+  std::shared_ptr<const nsoptim::PredictorResponseData> empty_data_;
+  std::unordered_map<EnpyCacheKey, Optimum, EnpyCacheKeyHash> subset_optima_;
+  std::deque<EnpyCacheKey> subset_optima_order_;
+  std::unordered_map<EnpyCacheKey, CachedPsc, EnpyCacheKeyHash> pscs_;
+  std::deque<EnpyCacheKey> pscs_order_;
+  omp::Lock lock_;
+};
+}  // namespace enpy_initest_internal
+}  // namespace pense
+
+#endif  // ENPY_CACHE_HPP_
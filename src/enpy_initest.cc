@@ -7,12 +7,20 @@
 //
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
 
 #include "nsoptim.hpp"
 #include "alias.hpp"
 #include "constants.hpp"
 #include "rcpp_utils.hpp"
 #include "enpy_initest.hpp"
+#include "enpy_cache.hpp"
+#include "omp_utils.hpp"
 
 using arma::uvec;
 using arma::mat;
@@ -35,6 +43,34 @@ constexpr double kRetainBestFactor = 1.1;  //!< Retain not only the candidates f
                                            //!< but also those that are within this factor of the best candidate.
 constexpr int kRetainMax = -1;  //!< Retain all candidates.
 constexpr int kDefaultNumThreads = 1;  //!< Default number of threads.
+constexpr bool kDefaultUseCache = false;  //!< Do not cache PSCs and estimates on PSC subsets across calls.
+constexpr bool kDefaultLowRankPsc = false;  //!< Compute the PSCs from the full sensitivity matrix.
+constexpr double kDefaultLooSubsample = 1;  //!< Compute the PSCs from the LOO fits of all observations.
+constexpr int kDefaultPscAnchorEvery = 1;  //!< Compute the PSCs for every penalty.
+constexpr double kDefaultPscAlpha = 0;  //!< Compute the PSCs at the `alpha` of the penalty.
+constexpr double kDefaultMemoryBudget = 0;  //!< Do not limit the number of concurrent tasks by their memory.
+constexpr double kDefaultRankSubsample = 1;  //!< Evaluate the S-loss of all candidates on all observations.
+//! Fit the PSC subsets with warm starts from the previous subset.
+constexpr bool kDefaultIndependentSubsets = false;
+//! Minimum number of observations in the subsample for screening the candidates.
+constexpr uword kMinRankSubsample = 50;
+//! Seed for drawing the subsample for screening the candidates. Every call uses the same subsample.
+constexpr std::uint32_t kRankSubsampleSeed = 20220301u;
+//! Constant for combining 64-bit hashes (the fractional part of the golden ratio).
+constexpr std::uint64_t kHashGoldenRatio = 0x9e3779b97f4a7c15ull;
+//! Seed of the second hash in data fingerprints.
+constexpr std::uint64_t kHashCheckSeed = 0x2545f4914f6cdd1dull;
+//! Multiplier of the values in the second hash of data fingerprints.
+constexpr std::uint64_t kHashCheckMultiplier = 0xff51afd7ed558ccdull;
+
+//! Finalize a 64-bit hash such that every bit of the input affects every bit of the output (SplitMix64).
+inline std::uint64_t Mix64(std::uint64_t value) noexcept {
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ull;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebull;
+  return value ^ (value >> 31);
+}
 
 
 inline uword HashUpdate(const uword hash, const uword value) noexcept;
@@ -49,7 +85,7 @@ template<typename RandomAccessIterator>
 uword SortAndHash(RandomAccessIterator start, RandomAccessIterator end) noexcept;
 
 FwdList<uvec> GetSubsetList(const mat& pscs, const uvec& indices, const uword subset_size,
-                            const bool use_indices) noexcept;
+                            const bool use_indices, const int num_threads) noexcept;
 
 //! Comparator class to sort an _index_ vector based on ascending absolute values of the _values_ vector.
 template<typename T>
@@ -98,10 +134,45 @@ PyConfiguration ParseConfiguration(const Rcpp::List& config) noexcept {
     GetFallback(config, "keep_residuals_threshold", kKeepResidualsThreshold),
     GetFallback(config, "retain_best_factor", kRetainBestFactor),
     GetFallback(config, "retain_max", kRetainMax),
-    GetFallback(config, "num_threads", kDefaultNumThreads)
+    GetFallback(config, "num_threads", kDefaultNumThreads),
+    GetFallback(config, "loo_warm_start", kDefaultLooWarmStart),
+    GetFallback(config, "cache", kDefaultUseCache),
+    GetFallback(config, "low_rank_psc", kDefaultLowRankPsc),
+    GetFallback(config, "loo_subsample", kDefaultLooSubsample),
+    GetFallback(config, "psc_anchor_every", kDefaultPscAnchorEvery),
+    GetFallback(config, "psc_alpha", kDefaultPscAlpha),
+    GetFallback(config, "memory_budget", kDefaultMemoryBudget),
+    GetFallback(config, "rank_subsample", kDefaultRankSubsample),
+    GetFallback(config, "independent_subsets", kDefaultIndependentSubsets),
+    HashOptions(config),
+    HashOptions(GetFallback(config, "en_options", Rcpp::List())),
+    nullptr
   };
 }
 
+uvec RankSubsampleIndices(const uword n_obs, const double proportion) {
+  if (proportion >= 1) {
+    return uvec();
+  }
+  const uword size = std::max<uword>(kMinRankSubsample, static_cast<uword>(std::ceil(proportion * n_obs)));
+  // Screening only pays off if the subsample is considerably smaller than the data.
+  if (2 * size > n_obs) {
+    return uvec();
+  }
+
+  // Selection sampling yields a sorted random subset in a single pass.
+  std::mt19937 rng(kRankSubsampleSeed);
+  std::uniform_real_distribution<double> unif(0., 1.);
+  uvec indices(size);
+  uword selected = 0;
+  for (uword i = 0; i < n_obs && selected < size; ++i) {
+    if ((n_obs - i) * unif(rng) < size - selected) {
+      indices[selected++] = i;
+    }
+  }
+  return indices;
+}
+
 uword HashIndexVector(const uvec& vector) noexcept {
   uword hash = vector.n_elem;
   for (auto&& val : vector) {
@@ -110,6 +181,76 @@ uword HashIndexVector(const uvec& vector) noexcept {
   return hash;
 }
 
+std::uint64_t HashCombineInteger(const std::uint64_t hash, const std::uint64_t value) noexcept {
+  return Mix64(hash ^ (value + kHashGoldenRatio + (hash << 6) + (hash >> 2)));
+}
+
+std::uint64_t HashCombine(const std::uint64_t hash, const double value) noexcept {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return HashCombineInteger(hash, bits);
+}
+
+DataFingerprint FingerprintData(const nsoptim::PredictorResponseData& data) noexcept {
+  // The second hash uses a different seed and a different way to combine the values, such that it is independent
+  // of the first hash.
+  std::uint64_t hash = HashCombineInteger(data.n_obs(), data.n_pred());
+  std::uint64_t check = kHashCheckSeed;
+  auto add = [&hash, &check](const double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    hash = HashCombineInteger(hash, bits);
+    check = Mix64(check + bits * kHashCheckMultiplier);
+  };
+  for (auto&& val : data.cx()) {
+    add(val);
+  }
+  for (auto&& val : data.cy()) {
+    add(val);
+  }
+  return DataFingerprint { data.n_obs(), data.n_pred(), hash, check };
+}
+
+std::uint64_t HashOptions(const Rcpp::List& options) noexcept {
+  std::uint64_t hash = HashCombineInteger(kHashCheckSeed, options.size());
+  const Rcpp::RObject names_obj = options.names();
+  const Rcpp::CharacterVector names = names_obj.isNULL() ? Rcpp::CharacterVector(options.size()) :
+    Rcpp::CharacterVector(names_obj);
+  for (R_xlen_t i = 0; i < options.size(); ++i) {
+    for (const char character : std::string(names[i])) {
+      hash = HashCombineInteger(hash, static_cast<unsigned char>(character));
+    }
+    const SEXP item = options[i];
+    hash = HashCombineInteger(hash, TYPEOF(item));
+    switch (TYPEOF(item)) {
+      case REALSXP:
+        for (R_xlen_t j = 0; j < XLENGTH(item); ++j) {
+          hash = HashCombine(hash, REAL(item)[j]);
+        }
+        break;
+      case INTSXP:
+      case LGLSXP:
+        for (R_xlen_t j = 0; j < XLENGTH(item); ++j) {
+          hash = HashCombineInteger(hash, static_cast<std::uint64_t>(INTEGER(item)[j]));
+        }
+        break;
+      case STRSXP:
+        for (R_xlen_t j = 0; j < XLENGTH(item); ++j) {
+          for (const char* character = CHAR(STRING_ELT(item, j)); *character; ++character) {
+            hash = HashCombineInteger(hash, static_cast<unsigned char>(*character));
+          }
+        }
+        break;
+      case VECSXP:
+        hash = HashCombineInteger(hash, HashOptions(Rcpp::List(item)));
+        break;
+      default:
+        break;
+    }
+  }
+  return hash;
+}
+
 uword HashSequence(const uword to) noexcept {
   uword hash = to + 1;
   for (uword val = 0; val <= to; ++val) {
@@ -126,18 +267,21 @@ arma::uvec GetResidualKeepIndices(const arma::vec& residuals, const double mscal
   } else {
     const uword n_resid_keep = std::max<uword>(residuals.n_elem * config.keep_residuals_proportion,
                                                            kMinObs);
-    std::partial_sort(all_indices->begin(), all_indices->begin() + n_resid_keep,
-                      all_indices->end(), IndexCompAbsoluteAscending<arma::vec>(residuals));
+    if (n_resid_keep < all_indices->n_elem) {
+      std::nth_element(all_indices->begin(), all_indices->begin() + n_resid_keep,
+                       all_indices->end(), IndexCompAbsoluteAscending<arma::vec>(residuals));
+    }
     return arma::sort(all_indices->head_rows(n_resid_keep));
   }
 }
 
-alias::FwdList<uvec> GetSubsetList(const mat& pscs, const uword subset_size) noexcept {
-  return ::GetSubsetList(pscs, uvec{}, subset_size, false);
+alias::FwdList<uvec> GetSubsetList(const mat& pscs, const uword subset_size, const int num_threads) noexcept {
+  return ::GetSubsetList(pscs, uvec{}, subset_size, false, num_threads);
 }
 
-alias::FwdList<uvec> GetSubsetList(const mat& pscs, const uvec& indices, const uword subset_size) noexcept {
-  return ::GetSubsetList(pscs, indices, subset_size, true);
+alias::FwdList<uvec> GetSubsetList(const mat& pscs, const uvec& indices, const uword subset_size,
+                                   const int num_threads) noexcept {
+  return ::GetSubsetList(pscs, indices, subset_size, true, num_threads);
 }
 }  // namespace enpy_initest_internal
 }  // namespace pense
@@ -157,51 +301,55 @@ uword SortAndHash(RandomAccessIterator start, RandomAccessIterator end) noexcept
   return hash;
 }
 
-FwdList<uvec> GetSubsetList(const mat& pscs, const uvec& indices, const uword subset_size,
-                            const bool use_indices) noexcept {
-  FwdList<uvec> subsets;
-  HashSet subset_candidate_hashes;
-  uvec subset_indices = arma::regspace<uvec>(0, pscs.n_rows - 1);
-  for (uword psc_col = 0; psc_col < pscs.n_cols; ++psc_col) {
-    // Sort indices according to ascending absolute values of the PSC
-    std::partial_sort(subset_indices.begin(), subset_indices.begin() + subset_size,
-                      subset_indices.end(), IndexCompAbsoluteAscending<subview_vec>(pscs.col(psc_col)));
-
-    const uword subset_abs_hash = SortAndHash(subset_indices.begin(), subset_indices.begin() + subset_size);
-    if (subset_candidate_hashes.insert(subset_abs_hash).second) {
-      // The subset is unique so add it to the list of subsets.
-      if (use_indices) {
-        subsets.emplace_front(indices.elem(subset_indices.head(subset_size)));
-      } else {
-        subsets.emplace_front(subset_indices.head(subset_size));
-      }
-    }
+//! Select the `subset_size` smallest indices according to `comparator` and compute the hash of the selection.
+//! The selection is done by partial selection, and only the selected indices are sorted afterwards. The order of the
+//! other indices in `buffer` is unspecified.
+//!
+//! @param subset_size the number of indices to select.
+//! @param comparator comparator for the indices.
+//! @param buffer the indices to select from. On return, the first `subset_size` elements are the selected indices,
+//!               in ascending order.
+//! @return the hash of the selected indices.
+template<typename Comparator>
+uword SelectSubset(const uword subset_size, const Comparator& comparator, uvec* buffer) noexcept {
+  if (subset_size < buffer->n_elem) {
+    std::nth_element(buffer->begin(), buffer->begin() + subset_size, buffer->end(), comparator);
+  }
+  return SortAndHash(buffer->begin(), buffer->begin() + subset_size);
+}
 
-    // Sort indices according to ascending values of the PSC
-    std::partial_sort(subset_indices.begin(), subset_indices.begin() + subset_size,
-                      subset_indices.end(), IndexCompAscending<subview_vec>(pscs.col(psc_col)));
+FwdList<uvec> GetSubsetList(const mat& pscs, const uvec& indices, const uword subset_size,
+                            const bool use_indices, const int num_threads) noexcept {
+  // For every PSC, the subsets with the smallest absolute, the smallest, and the largest values are considered.
+  constexpr uword kSubsetsPerPsc = 3;
+  std::vector<uvec> candidates(kSubsetsPerPsc * pscs.n_cols);
+  std::vector<uword> candidate_hashes(candidates.size());
 
-    const uword subset_asc_hash = SortAndHash(subset_indices.begin(), subset_indices.begin() + subset_size);
-    if (subset_candidate_hashes.insert(subset_asc_hash).second) {
-      // The subset is unique so add it to the list of subsets.
-      if (use_indices) {
-        subsets.emplace_front(indices.elem(subset_indices.head(subset_size)));
-      } else {
-        subsets.emplace_front(subset_indices.head(subset_size));
-      }
-    }
+  // The candidates for different PSCs are determined in parallel, each with its own re-used index buffer.
+  const double psc_work = static_cast<double>(kSubsetsPerPsc) * pscs.n_rows;
+  omp::ParallelFor(num_threads, static_cast<int>(pscs.n_cols), psc_work, [&](const int psc_col) {
+    const subview_vec psc = pscs.col(psc_col);
+    uvec subset_indices = arma::regspace<uvec>(0, pscs.n_rows - 1);
+    const uword offset = kSubsetsPerPsc * psc_col;
 
-    // Sort indices according to descending values of the PSC
-    std::partial_sort(subset_indices.begin(), subset_indices.begin() + subset_size,
-                      subset_indices.end(), IndexCompDescending<subview_vec>(pscs.col(psc_col)));
+    candidate_hashes[offset] = SelectSubset(subset_size, IndexCompAbsoluteAscending<subview_vec>(psc),
+                                            &subset_indices);
+    candidates[offset] = subset_indices.head(subset_size);
+    candidate_hashes[offset + 1] = SelectSubset(subset_size, IndexCompAscending<subview_vec>(psc), &subset_indices);
+    candidates[offset + 1] = subset_indices.head(subset_size);
+    candidate_hashes[offset + 2] = SelectSubset(subset_size, IndexCompDescending<subview_vec>(psc), &subset_indices);
+    candidates[offset + 2] = subset_indices.head(subset_size);
+  });
 
-    const uword subset_desc_hash = SortAndHash(subset_indices.begin(), subset_indices.begin() + subset_size);
-    if (subset_candidate_hashes.insert(subset_desc_hash).second) {
-      // The subset is unique so add it to the list of subsets.
+  // Only retain unique subsets, in the order of the PSCs.
+  FwdList<uvec> subsets;
+  HashSet subset_candidate_hashes;
+  for (uword i = 0; i < candidates.size(); ++i) {
+    if (subset_candidate_hashes.insert(candidate_hashes[i]).second) {
       if (use_indices) {
-        subsets.emplace_front(indices.elem(subset_indices.head(subset_size)));
+        subsets.emplace_front(indices.elem(candidates[i]));
       } else {
-        subsets.emplace_front(subset_indices.head(subset_size));
+        subsets.emplace_front(std::move(candidates[i]));
       }
     }
   }
@@ -9,22 +9,30 @@
 #ifndef ENPY_INITEST_HPP_
 #define ENPY_INITEST_HPP_
 
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <utility>
 #include <type_traits>
 #include <algorithm>
 #include <unordered_set>
 #include <functional>
+#include <vector>
 
 #include "nsoptim.hpp"
 #include "alias.hpp"
 #include "robust_scale_location.hpp"
 #include "s_loss.hpp"
 #include "enpy_psc.hpp"
+#include "enpy_cache.hpp"
 #include "omp_utils.hpp"
 #include "container_utility.hpp"
 #include "enpy_types.hpp"
+#include "progress.hpp"
 
 namespace pense {
 //! Compute the Pena-Yohai Initial Estimators for the S-loss.
@@ -43,6 +51,18 @@ alias::FwdList<PyResult<Optimizer>> PenaYohaiInitialEstimators(
 
 namespace enpy_initest_internal {
 constexpr arma::uword kMinObs = 3;  //!< Mininum number of observations in the PSC-filtered data.
+//! Maximum number of candidates for which the residuals are computed in a single matrix-matrix product.
+constexpr std::ptrdiff_t kCandidateBatchSize = 32;
+//! Number of passes over the data assumed for fitting the LS-EN estimate on a PSC subset, for estimating the work.
+constexpr double kEstimatedSubsetPasses = 4;
+//! Number of iterations assumed for computing the M-scale of the residuals of a candidate, for estimating the work.
+constexpr double kEstimatedMscaleIterations = 10;
+//! Number of significant digits of the penalization level at the reference `alpha` for the PSCs. Different `alpha`
+//! values then map to the same reference penalties despite round-off errors in their grids of penalization levels.
+constexpr int kReferenceLambdaDigits = 10;
+//! Width of the confidence margin for the M-scale of the residuals on the rank subsample, in multiples of the
+//! standard error of a relative M-scale estimate, approximated by `1 / sqrt(m)` for a subsample of size `m`.
+constexpr double kRankSubsampleConfidence = 3;
 
 template<class Optimizer>
 class CandidateComparator {
@@ -57,17 +77,20 @@ class CandidateComparator {
 //!
 //! @param pscs a matrix of principal sensitivity components.
 //! @param subset_size the desired size of the subsets.
+//! @param num_threads the number of threads to determine the subsets for different PSCs in parallel.
 //! @return a list of unique subsets of length `subset_size`.
-alias::FwdList<arma::uvec> GetSubsetList(const arma::mat& pscs, const arma::uword subset_size) noexcept;
+alias::FwdList<arma::uvec> GetSubsetList(const arma::mat& pscs, const arma::uword subset_size,
+                                         const int num_threads) noexcept;
 
 //! Get a list of subsets from the given PSCs
 //!
 //! @param pscs a matrix of principal sensitivity components.
 //! @param indices the "true" indices of the rows in `pscs`. Must be sorted.
 //! @param subset_size the desired size of the subsets.
+//! @param num_threads the number of threads to determine the subsets for different PSCs in parallel.
 //! @return a list of unique subsets of length `subset_size`.
 alias::FwdList<arma::uvec> GetSubsetList(const arma::mat& pscs, const arma::uvec& indices,
-                                         const arma::uword subset_size) noexcept;
+                                         const arma::uword subset_size, const int num_threads) noexcept;
 
 
 //! Merge the metrics and data from *psc_result* with *metrics*.
@@ -103,6 +126,25 @@ struct PyConfiguration {
   int retain_max;  //!< Retain at most this number of candidates. Candidates are ordered by the objective function.
                    //!< If negative, all candidates are retained.
   int num_threads;  //!< Number of concurrent threads to use.
+  LooWarmStart loo_warm_start;  //!< Starting point for the leave-one-out fits to compute the PSCs.
+  bool cache;  //!< Re-use PSCs and estimates on PSC subsets computed previously on the same data.
+  bool low_rank_psc;  //!< Compute the PSCs from a low-rank factorization of the sensitivity matrix.
+  double loo_subsample;  //!< Compute the PSCs from the LOO fits of a random subset of this proportion of observations.
+  int psc_anchor_every;  //!< Compute the PSCs only for one of this many consecutive penalties. The other penalties
+                         //!< re-use the PSCs of this "anchor" penalty.
+  double psc_alpha;  //!< If positive, compute the PSCs at this reference `alpha` for all penalties.
+  double memory_budget;  //!< If positive, limit the number of concurrent LOO fits and PSC subset fits such that their
+                        //!< estimated memory fits into this many bytes.
+  double rank_subsample;  //!< If less than 1, screen the candidates by their S-loss on a random subset of this
+                          //!< proportion of observations and evaluate only the promising candidates on all data.
+  bool independent_subsets;  //!< Fit the PSC subsets without warm starts from the previous subset and evaluate the
+                            //!< candidates from a common initial M-scale, allowing both to be computed in parallel.
+  std::uint64_t options_hash;  //!< Hash of all ENPY options, including the options of the LS-EN algorithm, to
+                               //!< identify cached PSCs (see `HashOptions()`).
+  std::uint64_t en_options_hash;  //!< Hash of the options of the LS-EN algorithm, to identify cached estimates on
+                                  //!< PSC subsets.
+  nsoptim::PhaseTimings* timings;  //!< Record the time spent computing the PSCs and the PY iterations, unless
+                                   //!< `nullptr`.
 };
 
 //! Parse an Rcpp::List into the PyConfiguration structure.
@@ -133,11 +175,324 @@ arma::uword HashSequence(const arma::uword to) noexcept;
 arma::uvec GetResidualKeepIndices(const arma::vec& residuals, const double mscale_est,
                                   const PyConfiguration& config, arma::uvec* all_indices);
 
+//! Get the observations for screening candidates by their S-loss on a random subset of the data.
+//! The subset is the same for every call with the same arguments.
+//!
+//! @param n_obs the number of observations.
+//! @param proportion the proportion of observations in the subset.
+//! @return a sorted vector of indices, or an empty vector if the subset would contain (almost) all observations.
+arma::uvec RankSubsampleIndices(const arma::uword n_obs, const double proportion);
+
+//! Number of bytes occupied by a copy of (a subset of) the data.
+inline std::size_t DataMemoryBytes(const nsoptim::PredictorResponseData& data) noexcept {
+  return nsoptim::timings::MemoryBytes(data.cx()) + nsoptim::timings::MemoryBytes(data.cy());
+}
+
 //! Enumeration of different results that can occur when computing the minimizer on a subset of the data.
 enum class SubsetEstimateResult {
   kOk, kDuplicate, kOptimizerWarning, kOptimizerError
 };
 
+//! Finalize the optimum computed on a PSC subset and record its status in the metrics of the subset.
+//!
+//! @param subset_optimum the optimum computed on the PSC subset.
+//! @param ls_loss the LS loss on the full data, replacing the reference to the subset loss.
+//! @param psc_metric the metrics for the PSC subset.
+//! @return the finalized optimum.
+template<typename Optimum>
+Optimum FinalizeSubsetOptimum(Optimum&& subset_optimum, const nsoptim::LsRegressionLoss& ls_loss,
+                              nsoptim::Metrics* psc_metric) {
+  // Remove the reference to the subset loss.
+  subset_optimum.loss = ls_loss;
+  psc_metric->AddDetail("estimate_status", static_cast<int>(subset_optimum.status));
+  if (subset_optimum.status != nsoptim::OptimumStatus::kOk) {
+    psc_metric->AddDetail("estimate_status_message", subset_optimum.message);
+  }
+  if (subset_optimum.metrics) {
+    psc_metric->AddSubMetrics(std::move(*subset_optimum.metrics));
+    subset_optimum.metrics.reset();
+  }
+  return std::move(subset_optimum);
+}
+
+//! Compute the residuals of a batch of candidates with a single matrix-matrix product.
+//!
+//! @param x the predictor matrix.
+//! @param y the response vector.
+//! @param first iterator to the iterator of the first candidate in the batch.
+//! @param last iterator past the iterator of the last candidate in the batch.
+//! @return a matrix with the residuals of the candidates in the columns.
+template<typename Iterator>
+arma::mat BatchResiduals(const arma::mat& x, const arma::vec& y, const Iterator first, const Iterator last) {
+  const arma::uword batch_size = static_cast<arma::uword>(std::distance(first, last));
+  arma::mat slopes(x.n_cols, batch_size);
+  arma::rowvec intercepts(batch_size);
+  arma::uword column = 0;
+  for (auto it = first; it != last; ++it, ++column) {
+    slopes.col(column) = arma::vec((*it)->coefs.beta);
+    intercepts[column] = (*it)->coefs.intercept;
+  }
+  arma::mat residuals = x * slopes;
+  residuals.each_row() += intercepts;
+  residuals.each_col() -= y;
+  return -residuals;
+}
+
+//! Compute the residuals of a batch of candidates with a single matrix-matrix product.
+//!
+//! @param data the data.
+//! @param first iterator to the iterator of the first candidate in the batch.
+//! @param last iterator past the iterator of the last candidate in the batch.
+//! @return a matrix with the residuals of the candidates in the columns.
+template<typename Iterator>
+arma::mat BatchResiduals(const nsoptim::PredictorResponseData& data, const Iterator first, const Iterator last) {
+  return BatchResiduals(data.cx(), data.cy(), first, last);
+}
+
+//! Compute the PSCs for a single penalty, re-using cached results if enabled in the configuration.
+//!
+//! @param loss the LS regression loss object to compute the PSCs for.
+//! @param optim the optimizer with the penalty to compute the PSCs for.
+//! @param num_threads number of threads.
+//! @param pyconfig configuration object.
+//! @return the PSC result.
+template<typename Optimizer>
+PscResult<Optimizer> CachedPrincipalSensitivityComponents(const nsoptim::LsRegressionLoss& loss,
+                                                          const Optimizer& optim, const int num_threads,
+                                                          const PyConfiguration& pyconfig) {
+  if (!pyconfig.cache) {
+    return PrincipalSensitiviyComponents(loss, optim, num_threads, pyconfig.loo_warm_start,
+                                         pyconfig.low_rank_psc, pyconfig.loo_subsample, pyconfig.timings,
+                                         pyconfig.memory_budget);
+  }
+  auto& cache = EnpyCache<Optimizer>::Instance();
+  const auto key = cache.Key(loss, optim, pyconfig.options_hash);
+  auto cached_psc = cache.FindPsc(key, loss);
+  if (cached_psc) {
+    return std::move(*cached_psc);
+  }
+  auto psc_result = PrincipalSensitiviyComponents(loss, optim, num_threads, pyconfig.loo_warm_start,
+                                                  pyconfig.low_rank_psc, pyconfig.loo_subsample, pyconfig.timings,
+                                                  pyconfig.memory_budget);
+  cache.StorePsc(key, psc_result);
+  return psc_result;
+}
+
+//! Compute the PSCs for several penalties, re-using cached results if enabled in the configuration.
+//! Only the PSCs not found in the cache are computed.
+//!
+//! @param loss the LS regression loss object to compute the PSCs for.
+//! @param penalties a list of penalties to compute the PSCs for.
+//! @param optim the optimizer to compute the PSCs with.
+//! @param num_threads number of threads.
+//! @param pyconfig configuration object.
+//! @return a list of PSC results, one for each given penalty, in the same order as `penalties`.
+template<typename Optimizer>
+alias::FwdList<PscResult<Optimizer>> CachedPrincipalSensitivityComponents(
+    const nsoptim::LsRegressionLoss& loss, const alias::FwdList<typename Optimizer::PenaltyFunction>& penalties,
+    const Optimizer& optim, const int num_threads, const PyConfiguration& pyconfig) {
+  if (!pyconfig.cache) {
+    return PrincipalSensitiviyComponents(loss, penalties, optim, num_threads, pyconfig.loo_warm_start,
+                                         pyconfig.low_rank_psc, pyconfig.loo_subsample, pyconfig.timings,
+                                         pyconfig.memory_budget);
+  }
+  auto& cache = EnpyCache<Optimizer>::Instance();
+  std::vector<EnpyCacheKey> keys;
+  std::vector<std::unique_ptr<PscResult<Optimizer>>> cached_pscs;
+  alias::FwdList<typename Optimizer::PenaltyFunction> missing_penalties;
+  auto missing_penalties_it = missing_penalties.before_begin();
+  for (auto&& penalty : penalties) {
+    keys.push_back(cache.Key(loss, penalty, optim, pyconfig.options_hash));
+    cached_pscs.emplace_back(cache.FindPsc(keys.back(), loss));
+    if (!cached_pscs.back()) {
+      missing_penalties_it = missing_penalties.insert_after(missing_penalties_it, penalty);
+    }
+  }
+
+  alias::FwdList<PscResult<Optimizer>> computed_pscs;
+  if (!missing_penalties.empty()) {
+    computed_pscs = PrincipalSensitiviyComponents(loss, missing_penalties, optim, num_threads,
+                                                  pyconfig.loo_warm_start, pyconfig.low_rank_psc,
+                                                  pyconfig.loo_subsample, pyconfig.timings,
+                                                  pyconfig.memory_budget);
+  }
+
+  // Merge the cached and the computed PSCs in the order of the penalties.
+  alias::FwdList<PscResult<Optimizer>> psc_results;
+  auto psc_results_it = psc_results.before_begin();
+  auto computed_it = computed_pscs.begin();
+  for (std::size_t i = 0; i < cached_pscs.size(); ++i) {
+    if (cached_pscs[i]) {
+      psc_results_it = psc_results.emplace_after(psc_results_it, std::move(*cached_pscs[i]));
+    } else {
+      cache.StorePsc(keys[i], *computed_it);
+      psc_results_it = psc_results.emplace_after(psc_results_it, std::move(*computed_it++));
+    }
+  }
+  return psc_results;
+}
+
+//! Create the PSC result for a penalty which re-uses the PSCs computed for another penalty.
+//! Only the LS-EN estimate on the full data is computed for the penalty.
+//!
+//! @param source the PSC result to take the PSCs from.
+//! @param penalty the penalty to create the PSC result for.
+//! @param full_optim the optimizer to compute the LS-EN estimate on the full data with.
+//! @return the PSC result for `penalty`.
+template<typename Optimizer>
+PscResult<Optimizer> BorrowPrincipalSensitivityComponents(const PscResult<Optimizer>& source,
+                                                          const typename Optimizer::PenaltyFunction& penalty,
+                                                          Optimizer* full_optim) {
+  full_optim->penalty(penalty);
+  PscResult<Optimizer> psc_result(full_optim->Optimize());
+  auto&& full_fit_metrics = psc_result.metrics.CreateSubMetrics("full_fit");
+  if (psc_result.optimum.metrics) {
+    full_fit_metrics.AddSubMetrics(std::move(*psc_result.optimum.metrics));
+    psc_result.optimum.metrics.reset();
+  }
+  if (psc_result.optimum.status == nsoptim::OptimumStatus::kError) {
+    psc_result.status = PscStatusCode::kError;
+    psc_result.message = std::string("Can not compute LS-EN residuals: ") + psc_result.optimum.message;
+  } else {
+    psc_result.status = source.status;
+    psc_result.warnings = source.warnings;
+    psc_result.message = source.message;
+    psc_result.pscs = source.pscs;
+  }
+  return psc_result;
+}
+
+//! Compute the PSCs for several penalties, but only for one "anchor" penalty in every group of
+//! `pyconfig.psc_anchor_every` consecutive penalties. The PSCs of adjacent penalties are usually almost identical,
+//! hence the other penalties in the group re-use the PSCs of the anchor (and thus the same PSC subsets), and only
+//! the LS-EN estimate on the full data is computed for these penalties.
+//!
+//! @param loss the LS regression loss object to compute the PSCs for.
+//! @param penalties a list of penalties to compute the PSCs for.
+//! @param optim the optimizer to compute the PSCs with.
+//! @param num_threads number of threads.
+//! @param pyconfig configuration object.
+//! @return a list of PSC results, one for each given penalty, in the same order as `penalties`.
+template<typename Optimizer>
+alias::FwdList<PscResult<Optimizer>> AnchoredPrincipalSensitivityComponents(
+    const nsoptim::LsRegressionLoss& loss, const alias::FwdList<typename Optimizer::PenaltyFunction>& penalties,
+    const Optimizer& optim, const int num_threads, const PyConfiguration& pyconfig) {
+  const int n_penalties = static_cast<int>(std::distance(penalties.begin(), penalties.end()));
+  const int group_size = pyconfig.psc_anchor_every;
+  if (group_size < 2 || n_penalties <= 1) {
+    return CachedPrincipalSensitivityComponents(loss, penalties, optim, num_threads, pyconfig);
+  }
+
+  // The anchor of every group is the penalty in the middle of the group.
+  std::vector<int> anchor_positions;
+  std::vector<double> anchor_lambdas;
+  alias::FwdList<typename Optimizer::PenaltyFunction> anchors;
+  auto anchors_it = anchors.before_begin();
+  auto penalty_it = penalties.begin();
+  for (int group_start = 0; group_start < n_penalties; group_start += group_size) {
+    const int anchor_position = group_start + (std::min(group_size, n_penalties - group_start) - 1) / 2;
+    const int skip = anchor_position - (anchor_positions.empty() ? 0 : anchor_positions.back());
+    std::advance(penalty_it, skip);
+    anchor_positions.push_back(anchor_position);
+    anchor_lambdas.push_back(penalty_it->lambda());
+    anchors_it = anchors.insert_after(anchors_it, *penalty_it);
+  }
+
+  auto anchor_pscs = CachedPrincipalSensitivityComponents(loss, anchors, optim, num_threads, pyconfig);
+
+  // Assemble the PSC results for all penalties. Only the LS-EN estimate on the full data is computed for penalties
+  // which are not anchors.
+  alias::FwdList<PscResult<Optimizer>> psc_results;
+  auto psc_results_it = psc_results.before_begin();
+  auto anchor_psc_it = anchor_pscs.begin();
+  // The PSC result of the anchor of the current group. After the anchor is moved into `psc_results`, this points to
+  // the moved result.
+  const PscResult<Optimizer>* anchor = &(*anchor_psc_it);
+  Optimizer full_optim = optim;
+  full_optim.loss(loss);
+  int position = 0;
+  for (auto&& penalty : penalties) {
+    const int group = position / group_size;
+    if (position == anchor_positions[group]) {
+      psc_results_it = psc_results.insert_after(psc_results_it, std::move(*anchor_psc_it));
+      anchor = &(*psc_results_it);
+    } else {
+      psc_results_it = psc_results.insert_after(psc_results_it,
+                                                BorrowPrincipalSensitivityComponents(*anchor, penalty, &full_optim));
+      psc_results_it->metrics.AddDetail("anchor_lambda", anchor_lambdas[group]);
+    }
+    // Move on to the next anchor after the last penalty in the group.
+    if (++position % group_size == 0 && ++anchor_psc_it != anchor_pscs.end()) {
+      anchor = &(*anchor_psc_it);
+    }
+  }
+  return psc_results;
+}
+
+//! Round the positive value `x` to `kReferenceLambdaDigits` significant digits.
+inline double RoundReferenceLambda(const double x) noexcept {
+  if (!(x > 0)) {
+    return x;
+  }
+  const double scale = std::pow(10., kReferenceLambdaDigits - 1 - std::floor(std::log10(x)));
+  return std::round(x * scale) / scale;
+}
+
+//! Compute the PSCs for several penalties at the reference `alpha` given in `pyconfig.psc_alpha`.
+//! The PSCs depend only weakly on `alpha`. The PSCs of a penalty with hyper-parameters `alpha` and `lambda` are
+//! therefore computed at the reference penalty with the same weight of the L1 term, i.e.,
+//! `lambda * alpha / psc_alpha`. Ridge penalties (`alpha = 0`) keep their own PSCs. The reference PSCs are retained
+//! in the cache, even if caching is not enabled in the configuration, hence the PSCs are computed only once for all
+//! `alpha` values on the same data. Only the LS-EN estimate on the full data is computed for the penalty itself.
+//!
+//! This overload is used if the penalty function has a hyper-parameter `alpha`.
+//! See `AnchoredPrincipalSensitivityComponents()` for a description of the parameters.
+template<typename Optimizer>
+auto ReferencePrincipalSensitivityComponents(
+    const nsoptim::LsRegressionLoss& loss, const alias::FwdList<typename Optimizer::PenaltyFunction>& penalties,
+    const Optimizer& optim, const int num_threads, const PyConfiguration& pyconfig, int)
+    -> decltype(std::declval<typename Optimizer::PenaltyFunction&>().alpha(1.),
+                alias::FwdList<PscResult<Optimizer>>()) {
+  if (!(pyconfig.psc_alpha > 0)) {
+    return AnchoredPrincipalSensitivityComponents(loss, penalties, optim, num_threads, pyconfig);
+  }
+  alias::FwdList<typename Optimizer::PenaltyFunction> reference_penalties;
+  auto reference_penalties_it = reference_penalties.before_begin();
+  for (auto&& penalty : penalties) {
+    reference_penalties_it = reference_penalties.insert_after(reference_penalties_it, penalty);
+    if (penalty.alpha() > 0) {
+      reference_penalties_it->alpha(pyconfig.psc_alpha);
+      reference_penalties_it->lambda(RoundReferenceLambda(penalty.lambda() * penalty.alpha() / pyconfig.psc_alpha));
+    }
+  }
+
+  PyConfiguration reference_pyconfig = pyconfig;
+  reference_pyconfig.cache = true;
+  const auto reference_pscs = AnchoredPrincipalSensitivityComponents(loss, reference_penalties, optim, num_threads,
+                                                                     reference_pyconfig);
+
+  alias::FwdList<PscResult<Optimizer>> psc_results;
+  auto psc_results_it = psc_results.before_begin();
+  auto reference_psc_it = reference_pscs.begin();
+  Optimizer full_optim = optim;
+  full_optim.loss(loss);
+  for (auto&& penalty : penalties) {
+    psc_results_it = psc_results.insert_after(psc_results_it,
+                                              BorrowPrincipalSensitivityComponents(*reference_psc_it++, penalty,
+                                                                                   &full_optim));
+    psc_results_it->metrics.AddDetail("psc_alpha", pyconfig.psc_alpha);
+  }
+  return psc_results;
+}
+
+//! Penalty functions without hyper-parameter `alpha` do not support PSCs at a reference `alpha`.
+template<typename Optimizer>
+alias::FwdList<PscResult<Optimizer>> ReferencePrincipalSensitivityComponents(
+    const nsoptim::LsRegressionLoss& loss, const alias::FwdList<typename Optimizer::PenaltyFunction>& penalties,
+    const Optimizer& optim, const int num_threads, const PyConfiguration& pyconfig, long) {  // NOLINT(runtime/int)
+  return AnchoredPrincipalSensitivityComponents(loss, penalties, optim, num_threads, pyconfig);
+}
+
 //! Compute the Pena-Yohai initial estimator
 //!
 //! @param loss the S-loss for which to obtain initial estimates.
@@ -145,7 +500,9 @@ enum class SubsetEstimateResult {
 //! @param psc_result the PSC result on the full data.
 //! @param optim the optimizer to compute the estimates with.
 //! @param pyconfig configuration object.
-//! @param num_threads the number of threads to use. Overrides the configuration from *pyconfig*.
+//! @param num_threads the number of threads to use. Overrides the configuration from *pyconfig*. If called from
+//!                    within a parallel region, the PSC subsets and the candidates are processed as tasks by the
+//!                    current team.
 template<typename Optimizer>
 PyResult<Optimizer> PYIterations(SLoss loss, const typename Optimizer::PenaltyFunction& penalty,
                                  PscResult<Optimizer>&& full_psc_result, Optimizer optim,
@@ -167,11 +524,16 @@ alias::FwdList<PyResult<Optimizer>> ComputeENPY(const SLoss& loss,
   // For each penalty, compute the optimizer and PSCs on the full data.
   nsoptim::LsRegressionLoss full_ls_loss(loss.SharedData(), loss.IncludeIntercept());
   pense::utility::OrderedList<double, PyResult<Optimizer>, std::greater<double>> py_initest_results;
-  auto psc_results = PrincipalSensitiviyComponents(full_ls_loss, penalties, optim, num_threads);
+  alias::FwdList<PscResult<Optimizer>> psc_results;
+  {
+    nsoptim::ScopedPhaseTimer timer(pyconfig.timings, "enpy_psc");
+    psc_results = ReferencePrincipalSensitivityComponents(full_ls_loss, penalties, optim, num_threads, pyconfig, 0);
+  }
 
   // The PY iterations are done separately for each penalty in parallel.
+  blas::SingleThreadGuard blas_guard(num_threads);
   #pragma omp parallel num_threads(num_threads) default(none) \
-    shared(py_initest_results, psc_results, penalties, optim, loss, pyconfig)
+    shared(py_initest_results, psc_results, penalties, optim, loss, pyconfig, num_threads)
   {
     #pragma omp single nowait
     {
@@ -180,10 +542,11 @@ alias::FwdList<PyResult<Optimizer>> ComputeENPY(const SLoss& loss,
            ++psc_res_it, ++penalty_it) {
         if (psc_res_it->status != PscStatusCode::kError) {
           #pragma omp task default(none) firstprivate(psc_res_it, penalty_it) \
-            shared(py_initest_results, pyconfig, loss, optim)
+            shared(py_initest_results, pyconfig, loss, optim, num_threads)
           {
             // The following line copies the *optim* optimzer, so it is okay that *optim* is shared among threads!
-            auto pyit_res = PYIterations(loss, *penalty_it, std::move(*psc_res_it), optim, pyconfig, 1);
+            auto pyit_res = PYIterations(loss, *penalty_it, std::move(*psc_res_it), optim, pyconfig,
+                                         num_threads);
             #pragma omp critical(emplace_pyit_res)
             py_initest_results.emplace(penalty_it->lambda(), std::move(pyit_res));
           }
@@ -214,7 +577,11 @@ alias::FwdList<PyResult<Optimizer>> ComputeENPY(const SLoss& loss,
   // For each penalty, compute the optimizer and PSCs on the full data.
   nsoptim::LsRegressionLoss full_ls_loss(loss.SharedData(), loss.IncludeIntercept());
   alias::FwdList<PyResult<Optimizer>> py_initest_results;
-  auto psc_results = PrincipalSensitiviyComponents(full_ls_loss, penalties, optim, 1);
+  alias::FwdList<PscResult<Optimizer>> psc_results;
+  {
+    nsoptim::ScopedPhaseTimer timer(pyconfig.timings, "enpy_psc");
+    psc_results = ReferencePrincipalSensitivityComponents(full_ls_loss, penalties, optim, 1, pyconfig, 0);
+  }
 
   // The PY iterations are done separately.
   auto penalty_it = penalties.begin();
@@ -244,7 +611,9 @@ PyResult<Optimizer> PYIterations(SLoss loss, const typename Optimizer::PenaltyFu
   using nsoptim::Metrics;
   using HashSet = std::unordered_set<uword>;
   using SubsetList = alias::FwdList<arma::uvec>;
+  using Optimum = typename Optimizer::Optimum;
 
+  nsoptim::ScopedPhaseTimer timer(pyconfig.timings, "enpy_py_iterations");
   const PredictorResponseData& data = loss.data();
   PyResult<Optimizer> py_result(CreatePscMetrics("full_data", std::move(full_psc_result)));
 
@@ -260,7 +629,8 @@ PyResult<Optimizer> PYIterations(SLoss loss, const typename Optimizer::PenaltyFu
   auto best_candidate_it = py_result.initial_estimates.begin();
   nsoptim::LsRegressionLoss ls_loss(loss.SharedData(), loss.IncludeIntercept());
   SubsetList psc_subsets = GetSubsetList(full_psc_result.pscs,
-                                         std::max<uword>(pyconfig.keep_psc_proportion * data.n_obs(), kMinObs));
+                                         std::max<uword>(pyconfig.keep_psc_proportion * data.n_obs(), kMinObs),
+                                         num_threads);
   SubsetList* current_psc_subsets = &psc_subsets;
 
   // The initial "best candidate" comes from the PSC and thus has the wrong objective function value.
@@ -269,40 +639,114 @@ PyResult<Optimizer> PYIterations(SLoss loss, const typename Optimizer::PenaltyFu
   // Set the correct penalty for the iterations.
   pyinit_optim.penalty(penalty);
 
+  // The PSC subsets and the candidates are only computed in parallel if they are independent of each other, as
+  // requested by `independent_subsets`. Otherwise, every subset fit starts from the previous one, hence the result
+  // does not depend on the number of threads in either case. Inside a parallel region, the PSCs are computed by the
+  // calling thread, while the PSC subsets and the candidates are handed to the current team.
+  const bool parallel_py = pyconfig.independent_subsets;
+  const int psc_num_threads = omp::InParallel() ? 1 : num_threads;
+
+  // Compute the estimate on a PSC subset, or get it from the cache if enabled.
+  EnpyCache<Optimizer>* cache = pyconfig.cache ? &EnpyCache<Optimizer>::Instance() : nullptr;
+  auto estimate_subset = [&](const nsoptim::LsRegressionLoss& subset_loss, Optimizer* optimizer,
+                             Metrics* psc_metric) {
+    EnpyCacheKey key {};
+    if (cache) {
+      key = cache->Key(subset_loss, *optimizer, pyconfig.en_options_hash);
+      auto cached_optimum = cache->FindSubsetOptimum(key, ls_loss);
+      if (cached_optimum) {
+        psc_metric->AddDetail("cached", 1);
+        return FinalizeSubsetOptimum(std::move(*cached_optimum), ls_loss, psc_metric);
+      }
+    }
+    optimizer->loss(subset_loss);
+    auto subset_optimum = FinalizeSubsetOptimum(optimizer->Optimize(), ls_loss, psc_metric);
+    if (cache) {
+      cache->StoreSubsetOptimum(key, subset_optimum);
+    }
+    return subset_optimum;
+  };
+
+  // The data for the PSC subsets is extracted into the same container to avoid allocating new memory for every subset.
+  auto subset_data = std::make_shared<nsoptim::PredictorResponseData>();
+
+  // If enabled, the candidates are first screened by their S-loss on a fixed random subset of the observations.
+  const uvec rank_rows = RankSubsampleIndices(data.n_obs(), pyconfig.rank_subsample);
+  const arma::mat rank_x = rank_rows.is_empty() ? arma::mat() : arma::mat(data.cx().rows(rank_rows));
+  const vec rank_y = rank_rows.is_empty() ? vec() : vec(data.cy().elem(rank_rows));
+  const double rank_margin = rank_rows.is_empty() ? 1. :
+    std::min(1., kRankSubsampleConfidence / std::sqrt(static_cast<double>(rank_rows.n_elem)));
+  // Candidates with the objective function value approximated on the subsample. The candidates are never moved to
+  // another node of the list because they can not become the best candidate.
+  std::unordered_set<const Optimum*> approximate_candidates;
+
   // Start the PY iterations.
   int iter = 0;
   decltype(best_candidate_it) insert_candidate_it;
   while (true) {
     insert_candidate_it = best_candidate_it;
 
-    for (auto&& subset : *current_psc_subsets) {
-      auto&& psc_metric = iter_metrics->CreateSubMetrics("psc_subset");
-      psc_metric.AddDetail("n_obs", static_cast<int>(subset.n_elem));
-      pyinit_optim.loss(nsoptim::LsRegressionLoss(
-        std::make_shared<nsoptim::PredictorResponseData>(loss.data().Observations(subset)), loss.IncludeIntercept()));
-      auto subset_optimum = pyinit_optim.Optimize();
-      // Remove the reference to the subset loss.
-      subset_optimum.loss = ls_loss;
-      psc_metric.AddDetail("estimate_status", static_cast<int>(subset_optimum.status));
-      if (subset_optimum.status != nsoptim::OptimumStatus::kOk) {
-        psc_metric.AddDetail("estimate_status_message", subset_optimum.message);
+    if (parallel_py) {
+      // Fit the PSC subsets in parallel, each with its own copy of the optimizer. The candidates are added in the
+      // order of the subsets, independent of the order in which the fits finish.
+      std::vector<const uvec*> subsets;
+      std::vector<Metrics*> psc_metrics;
+      for (auto&& subset : *current_psc_subsets) {
+        subsets.push_back(&subset);
+        psc_metrics.push_back(&iter_metrics->CreateSubMetrics("psc_subset"));
+      }
+      std::vector<std::unique_ptr<Optimum>> subset_optima(subsets.size());
+
+      // Fitting the LS-EN estimate on a subset needs at least a few passes over the subset of the data.
+      const double subset_work = subsets.empty() ? 0. :
+        static_cast<double>(subsets.front()->n_elem) * data.n_pred() * kEstimatedSubsetPasses;
+      // Every fit holds a copy of the subset of the data.
+      const int max_concurrent = subsets.empty() ? 1 : omp::MemoryLimitedThreads(
+        num_threads, pyconfig.memory_budget, static_cast<double>(subsets.front()->n_elem) * (data.n_pred() + 1) *
+        sizeof(double));
+      omp::BoundedParallelFor(max_concurrent, num_threads, static_cast<int>(subsets.size()), subset_work,
+                              [&](const int subset_index) {
+        psc_metrics[subset_index]->AddDetail("n_obs", static_cast<int>(subsets[subset_index]->n_elem));
+        Optimizer subset_optim = pyinit_optim;
+        const nsoptim::LsRegressionLoss subset_loss(
+          std::make_shared<PredictorResponseData>(data.Observations(*subsets[subset_index])),
+          loss.IncludeIntercept());
+        nsoptim::ScopedMemoryAccount subset_memory(pyconfig.timings, "enpy_py_iterations",
+                                                   DataMemoryBytes(subset_loss.data()));
+        subset_optima[subset_index].reset(new Optimum(estimate_subset(subset_loss, &subset_optim,
+                                                                      psc_metrics[subset_index])));
+      });
+
+      for (auto&& subset_optimum : subset_optima) {
+        // Don't add subsets which result in an error!
+        if (subset_optimum->status != nsoptim::OptimumStatus::kError) {
+          insert_candidate_it = py_result.initial_estimates.insert_after(insert_candidate_it,
+                                                                         std::move(*subset_optimum));
+        }
+      }
+    } else {
+      for (auto&& subset : *current_psc_subsets) {
+        Metrics* psc_metric = &iter_metrics->CreateSubMetrics("psc_subset");
+        psc_metric->AddDetail("n_obs", static_cast<int>(subset.n_elem));
+        loss.data().Observations(subset, subset_data.get());
+        nsoptim::ScopedMemoryAccount subset_memory(pyconfig.timings, "enpy_py_iterations",
+                                                   DataMemoryBytes(*subset_data));
+        auto subset_optimum = estimate_subset(nsoptim::LsRegressionLoss(subset_data, loss.IncludeIntercept()),
+                                              &pyinit_optim, psc_metric);
         if (subset_optimum.status == nsoptim::OptimumStatus::kError) {
           // Don't add subsets which result in an error!
           continue;
         }
+        insert_candidate_it = py_result.initial_estimates.insert_after(insert_candidate_it,
+                                                                       std::move(subset_optimum));
       }
-      if (subset_optimum.metrics) {
-        psc_metric.AddSubMetrics(std::move(*subset_optimum.metrics));
-        subset_optimum.metrics.reset();
-      }
-      insert_candidate_it = py_result.initial_estimates.insert_after(insert_candidate_it, std::move(subset_optimum));
     }
 
     // Reset the loss to the
     pyinit_optim.loss(ls_loss);
 
-    // Check if we are at the end of our iterations
-    if (++iter >= pyconfig.max_it) {
+    // Check if we are at the end of our iterations or if the computation is cancelled.
+    if (++iter >= pyconfig.max_it || progress::Cancelled()) {
       break;
     }
 
@@ -317,16 +761,93 @@ PyResult<Optimizer> PYIterations(SLoss loss, const typename Optimizer::PenaltyFu
     // last inserted element.
     auto end_check_candidate_it = insert_candidate_it;
     ++end_check_candidate_it;
-    for (auto cand_it = ++py_result.initial_estimates.begin(); cand_it != end_check_candidate_it; ++cand_it) {
-      // Compute the S-loss of the candidate
-      const arma::vec candidate_residuals = data.cy() - data.cx() * cand_it->coefs.beta - cand_it->coefs.intercept;
-      const auto candidate_eval = loss.EvaluateResiduals(candidate_residuals);
-      cand_it->objf_value = candidate_eval.loss + penalty.Evaluate(cand_it->coefs);
-
-      if (cand_it->objf_value < new_best_candidate_it->objf_value) {
-        new_best_candidate_it = cand_it;
-        best_candidate_residuals = candidate_residuals;
-        best_candidate_mscale = candidate_eval.scale;
+    std::vector<decltype(best_candidate_it)> candidates;
+    for (auto cand_it = std::next(py_result.initial_estimates.begin()); cand_it != end_check_candidate_it; ++cand_it) {
+      candidates.push_back(cand_it);
+    }
+
+    const SLoss& shared_loss = loss;
+    if (rank_margin < 1) {
+      // Candidates where even the lower end of the confidence interval for the S-loss on the subsample exceeds the
+      // cutoff for retaining candidates can neither become the best candidate nor be retained. Only their approximate
+      // objective function value is recorded.
+      const double rank_cutoff = std::max(1., pyconfig.retain_best_factor) * best_candidate_it->objf_value;
+      const double lower_bound_factor = (1 - rank_margin) * (1 - rank_margin);
+      std::vector<char> screened_out(candidates.size(), 0);
+      for (auto batch_start = candidates.begin(); batch_start != candidates.end(); ) {
+        const auto batch_end = batch_start + std::min(kCandidateBatchSize,
+                                                      std::distance(batch_start, candidates.end()));
+        const arma::mat batch_residuals = BatchResiduals(rank_x, rank_y, batch_start, batch_end);
+        const std::ptrdiff_t batch_offset = std::distance(candidates.begin(), batch_start);
+        const double candidate_work = static_cast<double>(batch_residuals.n_rows) * kEstimatedMscaleIterations;
+        omp::ParallelFor(parallel_py ? num_threads : 1, static_cast<int>(batch_residuals.n_cols), candidate_work,
+                         [&](const int column) {
+          const auto cand_it = *(batch_start + column);
+          const double approx_loss = shared_loss.EvaluateResiduals(batch_residuals.unsafe_col(column)).loss;
+          const double penalty_value = penalty.Evaluate(cand_it->coefs);
+          if (lower_bound_factor * approx_loss + penalty_value > rank_cutoff) {
+            cand_it->objf_value = approx_loss + penalty_value;
+            screened_out[batch_offset + column] = 1;
+          }
+        });
+        batch_start = batch_end;
+      }
+
+      auto keep_it = candidates.begin();
+      for (std::size_t i = 0; i < candidates.size(); ++i) {
+        if (screened_out[i]) {
+          approximate_candidates.insert(&(*candidates[i]));
+        } else {
+          *keep_it++ = candidates[i];
+        }
+      }
+      iter_metrics->AddDetail("rank_screened_out", static_cast<int>(std::distance(keep_it, candidates.end())));
+      candidates.erase(keep_it, candidates.end());
+    }
+
+    // The residuals of the candidates are computed in batches, turning many matrix-vector products into a few
+    // matrix-matrix products.
+    for (auto batch_start = candidates.begin(); batch_start != candidates.end(); ) {
+      const auto batch_end = batch_start + std::min(kCandidateBatchSize,
+                                                    std::distance(batch_start, candidates.end()));
+      const arma::mat batch_residuals = BatchResiduals(data, batch_start, batch_end);
+
+      if (parallel_py) {
+        // Evaluate the candidates in parallel. The M-scale of every candidate is computed from the same initial
+        // guess, hence the objective function values do not depend on the order of evaluation.
+        const int n_candidates = static_cast<int>(batch_residuals.n_cols);
+        const double candidate_work = static_cast<double>(batch_residuals.n_rows) * kEstimatedMscaleIterations;
+        omp::ParallelFor(num_threads, n_candidates, candidate_work, [&](const int column) {
+          const auto cand_it = *(batch_start + column);
+          cand_it->objf_value = shared_loss.EvaluateResiduals(batch_residuals.unsafe_col(column)).loss +
+            penalty.Evaluate(cand_it->coefs);
+        });
+      } else {
+        for (arma::uword column = 0; column < batch_residuals.n_cols; ++column) {
+          // Compute the S-loss of the candidate
+          const auto cand_it = *(batch_start + column);
+          const auto candidate_eval = loss.EvaluateResiduals(batch_residuals.unsafe_col(column));
+          cand_it->objf_value = candidate_eval.loss + penalty.Evaluate(cand_it->coefs);
+
+          if (cand_it->objf_value < new_best_candidate_it->objf_value) {
+            new_best_candidate_it = cand_it;
+            best_candidate_residuals = batch_residuals.col(column);
+            best_candidate_mscale = candidate_eval.scale;
+          }
+        }
+      }
+      batch_start = batch_end;
+    }
+
+    if (parallel_py) {
+      for (auto&& cand_it : candidates) {
+        if (cand_it->objf_value < new_best_candidate_it->objf_value) {
+          new_best_candidate_it = cand_it;
+        }
+      }
+      if (new_best_candidate_it != best_candidate_it) {
+        best_candidate_residuals = loss.Residuals(new_best_candidate_it->coefs);
+        best_candidate_mscale = shared_loss.EvaluateResiduals(best_candidate_residuals).scale;
       }
     }
 
@@ -377,6 +898,8 @@ PyResult<Optimizer> PYIterations(SLoss loss, const typename Optimizer::PenaltyFu
     // This subset of observations was not yet considered. Continue.
     nsoptim::LsRegressionLoss filtered_ls_loss(
       std::make_shared<PredictorResponseData>(data.Observations(residuals_keep_ind)), loss.IncludeIntercept());
+    nsoptim::ScopedMemoryAccount filtered_memory(pyconfig.timings, "enpy_py_iterations",
+                                                 DataMemoryBytes(filtered_ls_loss.data()));
 
     pyinit_optim.loss(filtered_ls_loss);
     iter_metrics->AddDetail("n_obs", static_cast<int>(residuals_keep_ind.n_elem));
@@ -385,8 +908,9 @@ PyResult<Optimizer> PYIterations(SLoss loss, const typename Optimizer::PenaltyFu
     const arma::uword new_subsets_size = std::max<uword>(pyconfig.keep_psc_proportion * residuals_keep_ind.n_elem,
                                                          kMinObs);
 
-    PscResult<Optimizer> psc_result = PrincipalSensitiviyComponents(filtered_ls_loss, pyinit_optim, num_threads);
-    psc_subsets = GetSubsetList(psc_result.pscs, residuals_keep_ind, new_subsets_size);
+    PscResult<Optimizer> psc_result = CachedPrincipalSensitivityComponents(filtered_ls_loss, pyinit_optim,
+                                                                          psc_num_threads, pyconfig);
+    psc_subsets = GetSubsetList(psc_result.pscs, residuals_keep_ind, new_subsets_size, num_threads);
 
     AppendPscMetrics(std::move(psc_result), iter_metrics);
     if (psc_result.status == PscStatusCode::kError) {
@@ -430,6 +954,15 @@ PyResult<Optimizer> PYIterations(SLoss loss, const typename Optimizer::PenaltyFu
     py_result.initial_estimates.erase_after(insert_candidate_it, py_result.initial_estimates.end());
   }
 
+  // The final selection uses the exact objective function value of all remaining candidates.
+  if (!approximate_candidates.empty()) {
+    for (auto&& candidate : py_result.initial_estimates) {
+      if (approximate_candidates.count(&candidate) > 0) {
+        candidate.objf_value = loss.Evaluate(candidate.coefs) + penalty.Evaluate(candidate.coefs);
+      }
+    }
+  }
+
   if (pyconfig.retain_max > 0) {
     // Retain only a certain number of the best candidates.
     if (pyconfig.retain_max < std::distance(py_result.initial_estimates.begin(), py_result.initial_estimates.end())) {
@@ -447,24 +980,47 @@ PyResult<Optimizer> PYIterations(SLoss loss, const typename Optimizer::PenaltyFu
 
 
 //! Compute the Pena-Yohai Initial Estimators for the S-loss.
+//! In contrast to the overload taking an R list with the configuration options, this function does not use the
+//! R API and can be called from any thread.
 //!
 //! @param loss the S loss object for which to obtain initial estimates.
 //! @param penalties a list of penalties to compute the initial estimators for.
 //! @param optim the optimizer to compute the estimates.
-//! @param config list with configuration options.
+//! @param pyconfig the parsed configuration options.
 //! @return a list of ENPY results, one for each given penalty, in the same order as `penalties`.
 template<typename Optimizer>
 alias::FwdList<PyResult<Optimizer>> PenaYohaiInitialEstimators(
     const SLoss& loss, const alias::FwdList<typename Optimizer::PenaltyFunction>& penalties,
-    const Optimizer& optim, const Rcpp::List& config) {
-  const auto pyconfig = enpy_initest_internal::ParseConfiguration(config);
-  if (omp::Enabled(pyconfig.num_threads)) {
+    const Optimizer& optim, const enpy_initest_internal::PyConfiguration& pyconfig) {
+  // The PSCs and the candidates are computed in parallel regions of their own. Nested regions must not spawn more
+  // threads.
+  omp::NestingGuard nesting_guard;
+  // The finest units of parallel work are the leave-one-out fits for the PSCs, each needing at least one pass over
+  // the data for every penalty.
+  const auto& data = loss.data();
+  const double loo_work = static_cast<double>(std::distance(penalties.begin(), penalties.end())) *
+    data.n_obs() * data.n_pred();
+  if (omp::Enabled(pyconfig.num_threads, static_cast<int>(data.n_obs()), loo_work)) {
     return enpy_initest_internal::ComputeENPY(loss, penalties, optim, pyconfig, pyconfig.num_threads);
   } else {
     return enpy_initest_internal::ComputeENPY(loss, penalties, optim, pyconfig);
   }
 }
 
+//! Compute the Pena-Yohai Initial Estimators for the S-loss.
+//!
+//! @param loss the S loss object for which to obtain initial estimates.
+//! @param penalties a list of penalties to compute the initial estimators for.
+//! @param optim the optimizer to compute the estimates.
+//! @param config list with configuration options.
+//! @return a list of ENPY results, one for each given penalty, in the same order as `penalties`.
+template<typename Optimizer>
+alias::FwdList<PyResult<Optimizer>> PenaYohaiInitialEstimators(
+    const SLoss& loss, const alias::FwdList<typename Optimizer::PenaltyFunction>& penalties,
+    const Optimizer& optim, const Rcpp::List& config) {
+  return PenaYohaiInitialEstimators(loss, penalties, optim, enpy_initest_internal::ParseConfiguration(config));
+}
+
 }  // namespace pense
 
 #endif  // ENPY_INITEST_HPP_
@@ -6,6 +6,12 @@
 //  Copyright © 2019 David Kepplinger. All rights reserved.
 //
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+
 #include "constants.hpp"
 #include "enpy_psc.hpp"
 
@@ -16,6 +22,88 @@ using arma::uvec;
 using arma::eig_sym;
 using arma::find;
 
+namespace {
+//! Seed for drawing the subset of observations to leave out.
+constexpr std::uint32_t kLooSubsampleSeed = 19990301u;
+
+//! Hat matrices `X (X'X + c I)^-1 X'` of ridge regressions on the same data, for any ridge penalty `c`.
+//! The predictors are decomposed once with a thin SVD `X = U S V'` (of the centered predictors, if an intercept is
+//! included), such that the hat matrix for any `c` is given by `U diag(s^2 / (s^2 + c)) U'` (plus `1/n` for the
+//! unpenalized intercept). If the SVD fails, every hat matrix is computed from the ridge-augmented Gram matrix.
+class RidgeHatMatrices {
+ public:
+  //! Decompose the predictor matrix.
+  //!
+  //! @param x the predictor matrix `X`.
+  //! @param include_intercept whether the ridge regression includes an unpenalized intercept.
+  RidgeHatMatrices(const mat& x, const bool include_intercept)
+      : include_intercept_(include_intercept), n_obs_(x.n_rows) {
+    mat right_singular_vectors;
+    vec singular_values;
+    if (include_intercept_) {
+      const mat x_centered = x.each_row() - arma::mean(x, 0);
+      has_svd_ = arma::svd_econ(left_singular_vectors_, singular_values, right_singular_vectors, x_centered, "left");
+    } else {
+      has_svd_ = arma::svd_econ(left_singular_vectors_, singular_values, right_singular_vectors, x, "left");
+    }
+    if (has_svd_) {
+      squared_singular_values_ = arma::square(singular_values);
+    } else {
+      left_singular_vectors_.reset();
+      x_ = include_intercept_ ? arma::join_rows(arma::ones(n_obs_), x) : x;
+      gram_ = x_.t() * x_;
+    }
+  }
+
+  //! Compute the hat matrix for the ridge penalty `c`.
+  //!
+  //! @param ridge_penalty the value `c` added to the diagonal of the Gram matrix.
+  //! @return the hat matrix.
+  mat operator()(const double ridge_penalty) const {
+    if (!has_svd_) {
+      return FallbackHatMatrix(ridge_penalty);
+    }
+    const vec denominators = squared_singular_values_ + ridge_penalty;
+    vec shrinkage(squared_singular_values_.n_elem, arma::fill::zeros);
+    for (uword k = 0; k < shrinkage.n_elem; ++k) {
+      if (denominators[k] > 0) {
+        shrinkage[k] = squared_singular_values_[k] / denominators[k];
+      }
+    }
+    mat hat = (left_singular_vectors_.each_row() % shrinkage.t()) * left_singular_vectors_.t();
+    if (include_intercept_) {
+      hat += 1. / n_obs_;
+    }
+    return hat;
+  }
+
+ private:
+  //! Compute the hat matrix from the Cholesky factor of the ridge-augmented Gram matrix. If the Gram matrix is
+  //! numerically not positive definite, the linear system is solved directly.
+  mat FallbackHatMatrix(const double ridge_penalty) const {
+    mat ridge_gram = gram_;
+    ridge_gram.diag() += ridge_penalty;
+    if (include_intercept_) {
+      ridge_gram.at(0, 0) = gram_.at(0, 0);
+    }
+    mat chol_lower;
+    if (arma::chol(chol_lower, ridge_gram, "lower")) {
+      const mat half_hat = arma::solve(arma::trimatl(chol_lower), x_.t());
+      return half_hat.t() * half_hat;
+    }
+    return x_ * arma::solve(ridge_gram, x_.t());
+  }
+
+  const bool include_intercept_;
+  const uword n_obs_;
+  bool has_svd_ = false;
+  mat left_singular_vectors_;
+  vec squared_singular_values_;
+  mat x_;
+  mat gram_;
+};
+}  // namespace
+
 namespace pense {
 namespace enpy_psc_internal {
 //! Compute the Principal Sensitivity Components using identities for the Ridge penalty
@@ -32,29 +120,19 @@ alias::FwdList<pense::PscResult<DirectRidgeOptimizer>> ComputeRidgePscs(const ns
   const nsoptim::PredictorResponseData& data = loss.data();
   // A list of PscResult objects, one per penalty.
   pense::utility::OrderedList<double, pense::PscResult<DirectRidgeOptimizer>, std::greater<double>> psc_results;
-  arma::mat x_int;
-  const arma::mat& x = loss.IncludeIntercept() ? x_int : data.cx();
-  arma::mat ridge_gram;
-  double gram_diag_int = 0;
-
-  if (loss.IncludeIntercept()) {
-    x_int = arma::join_rows(arma::ones(data.n_obs()), data.cx());
-    ridge_gram = x_int.t() * x_int;
-    gram_diag_int = ridge_gram.at(0, 0);
-  } else {
-    ridge_gram = data.cx().t() * data.cx();
-  }
+  // The decomposition is shared by all penalties.
+  const RidgeHatMatrices hat_matrices(data.cx(), loss.IncludeIntercept());
 
   // Computing PSCs can be done in parallel for each penalty. (default(none) does not work in gcc 9 and up)
+  blas::SingleThreadGuard blas_guard(num_threads);
   #pragma omp parallel num_threads(num_threads) \
-    shared(psc_results, penalties, loss, data, x, optim) firstprivate(gram_diag_int, ridge_gram)
+    shared(psc_results, penalties, loss, data, hat_matrices, optim)
   {
     #pragma omp single nowait
     {
       for (auto pen_it = penalties.cbegin(), pen_end = penalties.cend(); pen_it != pen_end; ++pen_it) {
         // Compute optimum on full data.
-        #pragma omp task firstprivate(pen_it, ridge_gram, gram_diag_int) \
-          shared(psc_results, loss, data, x, optim)
+        #pragma omp task firstprivate(pen_it) shared(psc_results, loss, data, hat_matrices, optim)
         {
           auto optimizer = optim;
           optimizer.loss(loss);
@@ -65,12 +143,7 @@ alias::FwdList<pense::PscResult<DirectRidgeOptimizer>> ComputeRidgePscs(const ns
           psc_result_it = psc_results.emplace(pen_it->lambda(), optimizer.Optimize());
 
           // Compute hat matrix for LOO residuals manually
-          ridge_gram.diag() += (data.n_obs() - 1) * pen_it->lambda();
-          if (loss.IncludeIntercept()) {
-            ridge_gram.at(0, 0) = gram_diag_int;
-          }
-
-          arma::mat hat = x * arma::solve(ridge_gram, x.t());
+          arma::mat hat = hat_matrices((data.n_obs() - 1) * pen_it->lambda());
           // Fitted y from all data:
           const arma::vec y_hat = data.cx() * psc_result_it->optimum.coefs.beta +
             psc_result_it->optimum.coefs.intercept;
@@ -103,19 +176,8 @@ alias::FwdList<pense::PscResult<DirectRidgeOptimizer>> ComputeRidgePscs(const ns
   alias::FwdList<pense::PscResult<DirectRidgeOptimizer>> psc_results;
 
   auto psc_result_it = psc_results.before_begin();
-  arma::mat x_int;
-  const arma::mat& x = loss.IncludeIntercept() ? x_int : data.cx();
-  arma::mat ridge_gram;
-  double gram_diag_int = 0;
-
-  if (loss.IncludeIntercept()) {
-    x_int = arma::join_rows(arma::ones(data.n_obs()), data.cx());
-    ridge_gram = x_int.t() * x_int;
-    gram_diag_int = ridge_gram.at(0, 0);
-  } else {
-    ridge_gram = data.cx().t() * data.cx();
-  }
-  double diagonal_offset = 0;
+  // The decomposition is shared by all penalties.
+  const RidgeHatMatrices hat_matrices(data.cx(), loss.IncludeIntercept());
 
   // First optimize with respect to the full data set and compute the predictions.
   optimizer.loss(loss);
@@ -125,14 +187,7 @@ alias::FwdList<pense::PscResult<DirectRidgeOptimizer>> ComputeRidgePscs(const ns
     psc_result_it = psc_results.emplace_after(psc_result_it, optimizer.Optimize());
 
     // Compute hat matrix for LOO residuals manually
-    const double prev_diagonal_offset = diagonal_offset;
-    diagonal_offset = (data.n_obs() - 1) * penalty.lambda();
-    ridge_gram.diag() += (diagonal_offset - prev_diagonal_offset);
-    if (loss.IncludeIntercept()) {
-      ridge_gram.at(0, 0) = gram_diag_int;
-    }
-
-    arma::mat hat = x * arma::solve(ridge_gram, x.t());
+    arma::mat hat = hat_matrices((data.n_obs() - 1) * penalty.lambda());
     // Fitted y from all data:
     const arma::vec y_hat = data.cx() * psc_result_it->optimum.coefs.beta + psc_result_it->optimum.coefs.intercept;
     // Fitted y from LOO
@@ -147,6 +202,27 @@ alias::FwdList<pense::PscResult<DirectRidgeOptimizer>> ComputeRidgePscs(const ns
   return psc_results;
 }
 
+uvec LooIndices(const nsoptim::PredictorResponseData& data, const double subsample) {
+  const uword n_obs = data.n_obs();
+  const uword size = (subsample < 1) ?
+    std::max<uword>(data.n_pred() + 2, static_cast<uword>(std::ceil(subsample * n_obs))) : n_obs;
+  if (size >= n_obs) {
+    return (n_obs > 0) ? arma::regspace<uvec>(0, n_obs - 1) : uvec();
+  }
+
+  // Selection sampling yields a sorted random subset in a single pass.
+  std::mt19937 rng(kLooSubsampleSeed);
+  std::uniform_real_distribution<double> unif(0., 1.);
+  uvec indices(size);
+  uword selected = 0;
+  for (uword i = 0; i < n_obs && selected < size; ++i) {
+    if ((n_obs - i) * unif(rng) < size - selected) {
+      indices[selected++] = i;
+    }
+  }
+  return indices;
+}
+
 void FinalizePSC(const mat& sensitivity_matrix, PscResult* psc_result) {
   if (psc_result->warnings > 0) {
     psc_result->status = PscStatusCode::kWarning;
@@ -186,33 +262,61 @@ void FinalizePSC(const mat& sensitivity_matrix, PscResult* psc_result) {
   }
 }
 
-//! Concatenate two lists containing LooStatus objects, one for each penalty.
-//! The metrics and status from *single* are concatenated to the metrics and the status from *combined*.
-//!
-//! @param single List to concatenate to the other list.
-//! @param combined Output of the concatenated lists.
-void ConcatenateLooStatus(alias::FwdList<LooStatus>* single, alias::FwdList<LooStatus>* combined) noexcept {
-  auto in_it = single->begin();
-  auto out_it = combined->before_begin();
-  const auto in_end = single->end();
-  const auto out_end = combined->end();
-
-  while (in_it != in_end) {
-    auto out_it_insert = out_it++;
-    if (out_it == out_end) {
-      out_it = combined->emplace_after(out_it_insert, std::move(*in_it));
-      out_it->warnings += in_it->warnings;
+void FinalizeLowRankPSC(const mat& x, const mat& coefficient_differences, PscResult* psc_result) {
+  if (psc_result->warnings > 0) {
+    psc_result->status = PscStatusCode::kWarning;
+    psc_result->message.append("Some LOO residuals are unreliable; ");
+  }
+
+  // With `[1 X] = Q T`, the sensitivity matrix is `R = Q (T D)`. The left singular vectors of `R` are therefore
+  // given by `Q U`, where `U` are the left singular vectors of the small matrix `T D`.
+  mat q;
+  mat t;
+  mat left_singular_vectors;
+  mat right_singular_vectors;
+  vec singular_values;
+  const bool success = arma::qr_econ(q, t, arma::join_rows(arma::ones(x.n_rows), x)) &&
+    arma::svd_econ(left_singular_vectors, singular_values, right_singular_vectors, t * coefficient_differences,
+                   "left");
+  if (!success) {
+    psc_result->pscs.reset();
+    psc_result->status = PscStatusCode::kError;
+    psc_result->message.append("Eigendecomposition failed");
+    return;
+  }
+
+  // The Eigenvalues of `R R'` are the squared singular values, in descending order.
+  const vec eigenvalues = arma::square(singular_values);
+  if (eigenvalues.n_elem == 0 || eigenvalues[0] < kNumericZero) {
+    psc_result->pscs.reset();
+    psc_result->status = PscStatusCode::kError;
+    psc_result->message.append("All Eigenvalues are zero");
+    return;
+  }
+
+  // Only use the Eigenvectors with "non-zero" Eigenvalue, in ascending order of the Eigenvalues as in `FinalizePSC`.
+  const uword n_nonzero = arma::accu(eigenvalues > kNumericZero * eigenvalues[0]);
+  psc_result->pscs = arma::fliplr(q * left_singular_vectors.head_cols(n_nonzero));
+}
+
+const std::shared_ptr<nsoptim::PredictorResponseData>& LooWorkspace::LeaveOut(const uword index) {
+  if (!loo_data_) {
+    loo_data_ = std::make_shared<nsoptim::PredictorResponseData>(data_->RemoveObservation(index));
+  } else if (index != left_out_) {
+    // Row `i` of the LOO data holds observation `i` if `i < left_out_` and observation `i + 1` otherwise. Only the
+    // rows between the previous and the new observation left out change.
+    mat& loo_x = loo_data_->x();
+    vec& loo_y = loo_data_->y();
+    if (index > left_out_) {
+      loo_x.rows(left_out_, index - 1) = data_->cx().rows(left_out_, index - 1);
+      loo_y.subvec(left_out_, index - 1) = data_->cy().subvec(left_out_, index - 1);
     } else {
-      out_it->warnings += in_it->warnings;
-      out_it->metrics.splice_after(out_it->metrics.before_begin(), in_it->metrics);
-      if (in_it->status == PscStatusCode::kError) {
-        out_it->status = PscStatusCode::kError;
-      } else if (in_it->status == PscStatusCode::kWarning && out_it->status != PscStatusCode::kError) {
-        out_it->status = PscStatusCode::kWarning;
-      }
+      loo_x.rows(index, left_out_ - 1) = data_->cx().rows(index + 1, left_out_);
+      loo_y.subvec(index, left_out_ - 1) = data_->cy().subvec(index + 1, left_out_);
     }
-    ++in_it;
   }
+  left_out_ = index;
+  return loo_data_;
 }
 
 }  // namespace enpy_psc_internal
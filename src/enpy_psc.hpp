@@ -10,16 +10,23 @@
 #define ENPY_PSC_HPP_
 
 #include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <exception>
 #include <functional>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <utility>
 #include <type_traits>
+#include <vector>
 #include "nsoptim.hpp"
 
 #include "alias.hpp"
+#include "constants.hpp"
 #include "omp_utils.hpp"
 #include "container_utility.hpp"
+#include "progress.hpp"
 
 namespace pense {
 //! PSC status code.
@@ -112,68 +119,231 @@ namespace enpy_psc_internal {
 //! Finalize the PSCs, i.e., compute the eigen decomposition of the sensitivity matrix and add the status messages.
 void FinalizePSC(const arma::mat& sensitivity_matrix, enpy_psc_internal::PscResult* psc_result);
 
-//! Concatenate two lists containing LooStatus objects, one for each penalty.
-//! The metrics and status from *single* are concatenated to the metrics and the status from *combined*.
+//! Finalize the PSCs from the low-rank factorization of the sensitivity matrix `R = [1 X] D`.
+//! Only the at most `p + 1` eigenvectors of `R R'` with non-zero eigenvalue are computed from a QR decomposition of
+//! `[1 X]` and an SVD of a `(p + 1) x n` matrix. The memory requirements are thus proportional to `n p`, not `n^2`.
 //!
-//! @param single List to concatenate to the other list.
-//! @param combined Output of the concatenated lists.
-void ConcatenateLooStatus(alias::FwdList<LooStatus>* single, alias::FwdList<LooStatus>* combined) noexcept;
+//! @param x the predictor matrix `X`.
+//! @param coefficient_differences the matrix `D`, where column `i` is the difference between the LS-EN estimate on
+//!                                the full data and the LS-EN estimate leaving out observation `i`, with the
+//!                                intercept in the first row.
+//! @param psc_result the PSC result to finalize.
+void FinalizeLowRankPSC(const arma::mat& x, const arma::mat& coefficient_differences,
+                        enpy_psc_internal::PscResult* psc_result);
+
+//! Select the observations to leave out for computing the PSCs.
+//! If `subsample` is less than 1, a random subset of `ceil(subsample * n)` observations (but at least `p + 2`) is
+//! selected. The subset is drawn from a fixed seed, hence it is reproducible and does not alter R's RNG state.
+//!
+//! @param data the full data.
+//! @param subsample proportion of observations to leave out, one at a time.
+//! @return the sorted indices of the observations to leave out.
+arma::uvec LooIndices(const nsoptim::PredictorResponseData& data, const double subsample);
+
+//! Number of threads worth using for the leave-one-out fits (see `omp::Threads()`).
+//! Every leave-one-out fit needs at least one pass over the data for every penalty.
+//!
+//! @param data the full data.
+//! @param num_threads the maximum number of threads.
+//! @param subsample proportion of observations to leave out, one at a time.
+//! @param n_penalties the number of penalties for which the leave-one-out fits are computed.
+//! @return the number of threads to use for the leave-one-out fits.
+inline int LooThreads(const nsoptim::PredictorResponseData& data, const int num_threads, const double subsample,
+                      const std::ptrdiff_t n_penalties) noexcept {
+  const double n_loo = std::ceil(std::min(1., subsample) * data.n_obs());
+  return omp::Threads(num_threads, static_cast<int>(n_loo),
+                      static_cast<double>(n_penalties) * data.n_obs() * data.n_pred());
+}
+
+//! Determine whether the low-rank factorization of the sensitivity matrix saves memory for the given data.
+inline bool UseLowRankSensitivity(const bool low_rank, const nsoptim::PredictorResponseData& data) noexcept {
+  return low_rank && data.n_pred() + 1 < data.n_obs();
+}
+
+//! Number of bytes occupied by the sensitivity matrices for the given data.
+//!
+//! @param data the full data.
+//! @param low_rank use the low-rank factorization of the sensitivity matrices, if it saves memory.
+//! @param subsample proportion of observations to leave out, one at a time.
+//! @param n_penalties the number of penalties for which the sensitivity matrices are computed.
+//! @return the number of bytes of all sensitivity matrices.
+inline std::size_t SensitivityMatrixBytes(const nsoptim::PredictorResponseData& data, const bool low_rank,
+                                          const double subsample, const std::ptrdiff_t n_penalties) noexcept {
+  const double n_loo = std::ceil(std::min(1., subsample) * data.n_obs());
+  const double n_rows = UseLowRankSensitivity(low_rank, data) ? data.n_pred() + 1 : data.n_obs();
+  return static_cast<std::size_t>(n_penalties * n_rows * n_loo) * sizeof(double);
+}
+
+//! Number of bytes held by a single thread computing leave-one-out fits, i.e., the copy of the data leaving out one
+//! observation.
+inline std::size_t LooTaskBytes(const nsoptim::PredictorResponseData& data) noexcept {
+  return static_cast<std::size_t>(data.n_obs()) * (data.n_pred() + 1) * sizeof(double);
+}
+
+//! Initialize the sensitivity matrix with the LS-EN estimate on the full data.
+//!
+//! @param data the full data.
+//! @param coefs the LS-EN estimate on the full data.
+//! @param low_rank if `true`, initialize the coefficient matrix `D` of the low-rank factorization of the sensitivity
+//!                 matrix, otherwise the sensitivity matrix itself.
+//! @param n_loo the number of observations left out, i.e., the number of columns of the sensitivity matrix.
+//! @return the initial sensitivity matrix.
+template<typename Coefficients>
+arma::mat InitialSensitivityMatrix(const nsoptim::PredictorResponseData& data, const Coefficients& coefs,
+                                   const bool low_rank, const arma::uword n_loo) {
+  if (low_rank) {
+    return arma::repmat(arma::join_cols(arma::vec { coefs.intercept }, arma::vec(coefs.beta)), 1, n_loo);
+  }
+  return arma::repmat(data.cx() * coefs.beta + coefs.intercept, 1, n_loo);
+}
+
+//! Subtract the LS-EN estimate leaving out an observation from the sensitivity matrix.
+//!
+//! @param data the full data.
+//! @param coefs the LS-EN estimate leaving out the observation.
+//! @param column the column of the sensitivity matrix corresponding to the observation left out.
+//! @param low_rank if `true`, the coefficient matrix of the low-rank factorization is updated.
+//! @param sensitivity_matrix the sensitivity matrix to update.
+template<typename Coefficients>
+void SubtractLooFit(const nsoptim::PredictorResponseData& data, const Coefficients& coefs, const arma::uword column,
+                    const bool low_rank, arma::mat* sensitivity_matrix) {
+  if (low_rank) {
+    sensitivity_matrix->at(0, column) -= coefs.intercept;
+    sensitivity_matrix->col(column).tail(data.n_pred()) -= arma::vec(coefs.beta);
+  } else {
+    sensitivity_matrix->col(column) -= data.cx() * coefs.beta + coefs.intercept;
+  }
+}
+
+//! Leave-one-out data set of a thread, reused for all observations left out by the thread.
+//! The LOO data is allocated when the first observation is left out. Leaving out another observation afterwards only
+//! copies the rows in between instead of all the data.
+class LooWorkspace {
+ public:
+  //! Create a workspace for leaving out observations of `data`.
+  //!
+  //! @param data the full data. Must outlive the workspace.
+  explicit LooWorkspace(const nsoptim::PredictorResponseData& data) noexcept : data_(&data), left_out_(0) {}
+
+  //! Leave out observation `index` of the full data.
+  //!
+  //! @param index the index of the observation to leave out.
+  //! @return the LOO data. Every call returns the same data container, hence losses holding this pointer see the
+  //!         updated data.
+  const std::shared_ptr<nsoptim::PredictorResponseData>& LeaveOut(const arma::uword index);
+
+  //! Get the index of the observation currently left out.
+  arma::uword left_out() const noexcept {
+    return left_out_;
+  }
+
+ private:
+  const nsoptim::PredictorResponseData* data_;
+  std::shared_ptr<nsoptim::PredictorResponseData> loo_data_;
+  arma::uword left_out_;
+};
 
-//! Compute the LOO residuals for rows ``[loo_start_index; loo_end_index)``.
+//! Inform the optimizer that the LOO data changed from leaving out observation `index - 1` to leaving out
+//! observation `index`.
+//!
+//! @param loo_loss the loss with the updated LOO data.
+//! @param data the full data.
+//! @param index the index of the observation left out from the updated LOO data.
+//! @param optimizer the optimizer to update.
+template<typename T>
+void UpdateLooLoss(const nsoptim::LsRegressionLoss& loo_loss, const nsoptim::PredictorResponseData&,
+                   const arma::uword, T* optimizer) {
+  optimizer->loss(loo_loss);
+}
+
+//! Inform the LARS optimizer that the LOO data changed from leaving out observation `index - 1` to leaving out
+//! observation `index`. The LARS optimizer updates the Gram matrix instead of re-computing it from the LOO data.
+//!
+//! @param loo_loss the loss with the updated LOO data.
+//! @param data the full data.
+//! @param index the index of the observation left out from the updated LOO data.
+//! @param optimizer the optimizer to update.
+template<typename PenaltyFunction, typename Coefficients>
+void UpdateLooLoss(
+    const nsoptim::LsRegressionLoss& loo_loss, const nsoptim::PredictorResponseData& data, const arma::uword index,
+    nsoptim::AugmentedLarsOptimizer<nsoptim::LsRegressionLoss, PenaltyFunction, Coefficients>* optimizer) {
+  optimizer->ReplaceObservation(loo_loss, data.cx().row(index), data.cy()[index],
+                                data.cx().row(index - 1), data.cy()[index - 1]);
+}
+
+//! Compute the LOO residuals for rows ``loo_indices[loo_start; loo_end)``.
 //!
 //! @param loss Loss object to compute the LOO residuals for.
 //! @param penalties List of penalties for which the LOO residuals should be computed at once.
-//! @param loo_start_index Lower bound for row indices to leave out. The lower bound is inclusive.
-//! @param loo_end_index Upper bound for the row indices to leave out. The upper bound is exclusive.
+//! @param psc_results List of PSC results with the full-data optima, one for each penalty.
+//! @param loo_indices Sorted indices of all the rows to leave out (see `LooIndices()`).
+//! @param loo_start Lower bound for the positions in `loo_indices`. The lower bound is inclusive.
+//! @param loo_end Upper bound for the positions in `loo_indices`. The upper bound is exclusive.
+//! @param warm_start Starting point for the leave-one-out fits.
+//! @param low_rank if `true`, the sensitivity matrices are the coefficient matrices of the low-rank factorization and
+//!                 the LOO estimates are subtracted instead of the LOO fitted values.
+//! @param workspace In/Out. LOO data of the calling thread.
 //! @param optimizer In/Out. Optimizer to use to compute the leave-one-out residuals.
 //! @param sensitivity_matrices Out. A list, the same length as *penalties*, with matrices from which columns the
 //!                             LOO residuals are subtracted.
-//! @return a list of LooStatus objects, one for each penalty.
+//! @param loo_statuses Out. The status of every LOO fit, for each penalty (in the order of *penalties*) and each
+//!                     position in `loo_indices`, i.e., the status of the LOO fit at position `i` for the `k`-th
+//!                     penalty is at `k * loo_indices.n_elem + i`.
 template<typename T>
-alias::FwdList<LooStatus> ComputeLoo(const nsoptim::LsRegressionLoss& loss,
-                                     const alias::FwdList<typename T::PenaltyFunction>& penalties,
-                                     arma::uword loo_start_index, const arma::uword loo_end_index, T* optimizer,
-                                     alias::FwdList<arma::mat>* sensitivity_matrices) {
+void ComputeLoo(const nsoptim::LsRegressionLoss& loss, const alias::FwdList<typename T::PenaltyFunction>& penalties,
+                const alias::FwdList<pense::PscResult<T>>& psc_results, const arma::uvec& loo_indices,
+                arma::uword loo_start, const arma::uword loo_end, const LooWarmStart warm_start, const bool low_rank,
+                LooWorkspace* workspace, T* optimizer, alias::FwdList<arma::mat>* sensitivity_matrices,
+                std::vector<LooStatus>* loo_statuses) {
   const nsoptim::PredictorResponseData& data = loss.data();
-  // Create the LOO data set by removing the observation at `loo_start_index`.
-  auto loo_data = std::make_shared<nsoptim::PredictorResponseData>(data.RemoveObservation(loo_start_index));
-
-  alias::FwdList<LooStatus> loo_statuses;
-  bool fill_loo_statuses = true;
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kEnpyComputeLoo);
+  const arma::uword n_loo = loo_indices.n_elem;
+
+  // The starting points for the LOO fits, one for each penalty.
+  alias::FwdList<typename T::Coefficients> loo_starts;
+  if (warm_start != LooWarmStart::kNone) {
+    auto loo_start_it = loo_starts.before_begin();
+    for (auto&& psc_result : psc_results) {
+      loo_start_it = loo_starts.emplace_after(loo_start_it, psc_result.optimum.coefs);
+    }
+  }
 
-  // This `loo_loss` holds a shared pointer to the LOO data, therefore, the data used by the loss changes
-  // in accordance to `loo_data`!
+  // This `loo_loss` holds a shared pointer to the LOO data of the workspace, therefore, the data used by the loss
+  // changes in accordance to the workspace!
   // It is nevertheless important to change the loss for the optimizer whenever the data changes to inform the
   // optimizer about the changes!
-  nsoptim::LsRegressionLoss loo_loss(loo_data, loss.IncludeIntercept());
+  nsoptim::LsRegressionLoss loo_loss(workspace->LeaveOut(loo_indices[loo_start]), loss.IncludeIntercept());
 
-  while (loo_start_index < loo_end_index) {
-    // Set the loss to the loss with the LOO data.
-    optimizer->loss(loo_loss);
+  // Set the loss to the loss with the LOO data.
+  optimizer->loss(loo_loss);
 
+  // The LOO fits stop early if the computation is cancelled. The incomplete PSCs are discarded by the caller.
+  while (loo_start < loo_end && !progress::Cancelled()) {
     // Compute the LOO optima for all the penalties.
     auto sens_mat_it = sensitivity_matrices->begin();
-    auto loo_status_it = fill_loo_statuses ? loo_statuses.before_begin() : loo_statuses.before_begin();
+    auto loo_start_it = loo_starts.begin();
+    arma::uword penalty_index = 0;
     for (auto&& penalty : penalties) {
-      if (fill_loo_statuses) {
-        loo_status_it = loo_statuses.emplace_after(loo_status_it, PscStatusCode::kOk);
-      } else {
-        ++loo_status_it;
-      }
-
       // Only compute LOO residuals if the sensitivity matrix is initialized (i.e., the LS-EN estimate on the full
       // data was computed).
       if (sens_mat_it->n_elem > 0) {
+        // Every thread writes only to the statuses and columns of its own positions.
+        LooStatus& loo_status = (*loo_statuses)[penalty_index * n_loo + loo_start];
         optimizer->penalty(penalty);
-        auto loo_optimum = optimizer->Optimize();
+        auto loo_optimum = (warm_start == LooWarmStart::kNone) ? optimizer->Optimize() :
+                                                                  optimizer->Optimize(*loo_start_it);
+        if (warm_start == LooWarmStart::kPrevious && loo_optimum.status != nsoptim::OptimumStatus::kError) {
+          *loo_start_it = loo_optimum.coefs;
+        }
 
         // This write does not need any protection because this thread is guarantueed to be the only one writing
         // to this column!
-        sens_mat_it->col(loo_start_index) -= data.cx() * loo_optimum.coefs.beta + loo_optimum.coefs.intercept;
+        SubtractLooFit(data, loo_optimum.coefs, loo_start, low_rank, &(*sens_mat_it));
 
-        loo_status_it->metrics.emplace_front("loo_fit");
-        auto&& loo_fit_metric = loo_status_it->metrics.front();
-        loo_fit_metric.AddMetric("loo_index", static_cast<int>(loo_start_index));
+        loo_status.metrics.emplace_front("loo_fit");
+        auto&& loo_fit_metric = loo_status.metrics.front();
+        loo_fit_metric.AddMetric("loo_index", static_cast<int>(workspace->left_out()));
+        loo_fit_metric.AddMetric("warm_start", static_cast<int>(warm_start));
 
         if (loo_optimum.metrics) {
           loo_fit_metric.AddSubMetrics(std::move(*loo_optimum.metrics));
@@ -184,22 +354,41 @@ alias::FwdList<LooStatus> ComputeLoo(const nsoptim::LsRegressionLoss& loss,
           loo_fit_metric.AddMetric("lsen_status", static_cast<int>(loo_optimum.status));
           loo_fit_metric.AddMetric("lsen_message", loo_optimum.message);
 
-          loo_status_it->status = WorstStatusCode(loo_status_it->status, loo_optimum.status);
+          loo_status.status = WorstStatusCode(loo_status.status, loo_optimum.status);
         }
       }
       ++sens_mat_it;
+      ++penalty_index;
+      if (warm_start != LooWarmStart::kNone) {
+        ++loo_start_it;
+      }
     }
 
-    // "Hide" next row if there are any rows left.
-    if (loo_start_index < loo_end_index - 1) {
-      loo_data->x().row(loo_start_index) = data.cx().row(loo_start_index);
-      loo_data->y()[loo_start_index] = data.cy()[loo_start_index];
+    // "Hide" next row if there are any rows left. The rows in between are restored one after the other.
+    if (loo_start + 1 < loo_end) {
+      const arma::uword next_index = loo_indices[loo_start + 1];
+      for (arma::uword index = workspace->left_out() + 1; index <= next_index; ++index) {
+        workspace->LeaveOut(index);
+        UpdateLooLoss(loo_loss, data, index, optimizer);
+      }
     }
-    ++loo_start_index;
-    fill_loo_statuses = false;
+    ++loo_start;
   }
+}
 
-  return loo_statuses;
+//! Add the statuses of all LOO fits to the PSC results, in the order of the observations left out.
+//!
+//! @param n_loo the number of observations left out.
+//! @param loo_statuses the statuses of the LOO fits (see `ComputeLoo()`).
+//! @param psc_results the PSC results, one for each penalty.
+template<typename PscResults>
+void SetLooStatuses(const arma::uword n_loo, std::vector<LooStatus>* loo_statuses, PscResults* psc_results) {
+  auto loo_status_it = loo_statuses->begin();
+  for (auto&& psc_result : *psc_results) {
+    for (arma::uword i = 0; i < n_loo; ++i, ++loo_status_it) {
+      psc_result.SetLooStatus(std::move(*loo_status_it));
+    }
+  }
 }
 
 //! Compute the Principal Sensitivity Components if OpenMP is enabled and needed by computing the LOO
@@ -208,21 +397,23 @@ alias::FwdList<LooStatus> ComputeLoo(const nsoptim::LsRegressionLoss& loss,
 //! @param loss the LS-loss object to compute the PSCs for.
 //! @param penalties a lisf of penalties for which the PSCs should be computed at once.
 //! @param optimizer Optimizer to use to compute leave-one-out residuals.
+//! @param loo_warm_start starting point for the leave-one-out fits.
+//! @param low_rank use the low-rank factorization of the sensitivity matrices, if it saves memory.
+//! @param loo_subsample proportion of observations to leave out (see `LooIndices()`).
 //! @param num_threads number of threads to use.
 //! @return A list of PSC structures, one for each given penalty, in the same order as `penalties`.
 template<typename Optimizer, typename = typename std::enable_if<!EnableDirectRidge<Optimizer>::value>::type >
 alias::FwdList<pense::PscResult<Optimizer>> ComputePscs(
     const nsoptim::LsRegressionLoss& loss, const alias::FwdList<typename Optimizer::PenaltyFunction>& penalties,
-    Optimizer optimizer, int num_threads) {
+    Optimizer optimizer, const LooWarmStart loo_warm_start, const bool low_rank, const double loo_subsample,
+    int num_threads) {
   // using PenaltyFunction = typename Optimizer::PenaltyFunction;
   using arma::uword;
   using alias::FwdList;
-  using LooStatusList = FwdList<LooStatus>;
-
-  // Note: the initializer for the following reduction uses the default constructor!
-  #pragma omp declare reduction(c:FwdList<LooStatus>:ConcatenateLooStatus(&omp_in, &omp_out))
 
   const nsoptim::PredictorResponseData& data = loss.data();
+  const bool low_rank_sensitivity = UseLowRankSensitivity(low_rank, data);
+  const arma::uvec loo_indices = LooIndices(data, loo_subsample);
   // A list of PscResult objects and the sensitivity matrices, i.e., matrices `R` in the paper, one tuple for each
   // penalty.
   pense::utility::OrderedList<double, pense::PscResult<Optimizer>, std::greater<double>> psc_results;
@@ -255,40 +446,54 @@ alias::FwdList<pense::PscResult<Optimizer>> ComputePscs(
         // Fall through the case of no error or warning!
       default:
         // If status != kError, fill the sensitivity matrix with the LS-EN residuals.
-        sensitivity_matrices.emplace(penalty.lambda(), arma::repmat(
-          data.cx() * psc_result_it->optimum.coefs.beta + psc_result_it->optimum.coefs.intercept, 1, data.n_obs()));
+        sensitivity_matrices.emplace(penalty.lambda(), InitialSensitivityMatrix(data, psc_result_it->optimum.coefs,
+                                                                                low_rank_sensitivity,
+                                                                                loo_indices.n_elem));
         break;
     }
   }
 
-  const uword block_size = data.n_obs() / num_threads + static_cast<uword>(data.n_obs() % num_threads > 0);
-  LooStatusList loo_statuses;
-  #pragma omp parallel num_threads(num_threads) default(none) firstprivate(block_size) \
-    shared(data, loss, penalties, loo_statuses, sensitivity_matrices, psc_results, optimizer)
+  const uword n_loo = loo_indices.n_elem;
+  const uword block_size = n_loo / num_threads + static_cast<uword>(n_loo % num_threads > 0);
+  // The LOO data of every thread is allocated once and re-used for all blocks of the thread. The status of every LOO
+  // fit has its own slot, hence the threads do not need to merge their statuses.
+  auto workspaces = omp::PerThread<LooWorkspace>(num_threads, data);
+  std::vector<LooStatus> loo_statuses(std::distance(penalties.begin(), penalties.end()) * n_loo,
+                                      LooStatus(PscStatusCode::kOk));
+  blas::SingleThreadGuard blas_guard(num_threads);
+  #pragma omp parallel num_threads(num_threads) default(none) \
+    firstprivate(block_size, n_loo, loo_warm_start, low_rank_sensitivity) \
+    shared(data, loss, penalties, loo_indices, loo_statuses, workspaces, sensitivity_matrices, psc_results, optimizer)
   {
-    #pragma omp for reduction(c:loo_statuses)
-    for (uword start_index = 0; start_index < data.n_obs(); start_index += block_size) {
-      const uword upper_index = std::min(start_index + block_size, data.n_obs());
+    #pragma omp for schedule(static)
+    for (uword start = 0; start < n_loo; start += block_size) {
+      const uword upper = std::min(start + block_size, n_loo);
       Optimizer thread_private_optimizer(optimizer);
-      loo_statuses = ComputeLoo(loss, penalties, start_index, upper_index, &thread_private_optimizer,
-                                &sensitivity_matrices.items());
+      ComputeLoo(loss, penalties, psc_results.items(), loo_indices, start, upper, loo_warm_start,
+                 low_rank_sensitivity, &workspaces[omp::ThreadNum()], &thread_private_optimizer,
+                 &sensitivity_matrices.items(), &loo_statuses);
     }
 
     #pragma omp single nowait
     {
-      auto loo_status_it = loo_statuses.begin();
+      SetLooStatuses(n_loo, &loo_statuses, &psc_results.items());
+      // The LOO data is not needed anymore.
+      workspaces.clear();
       auto sens_mat_it = sensitivity_matrices.begin();
       for (auto psc_result_it = psc_results.begin(), end = psc_results.end(); psc_result_it != end;
-          ++psc_result_it, ++sens_mat_it, ++loo_status_it) {
+          ++psc_result_it, ++sens_mat_it) {
         // Skip results with errors.
-        if (psc_result_it->status == PscStatusCode::kError || loo_status_it->status == PscStatusCode::kError) {
-          psc_result_it->SetLooStatus(std::move(*loo_status_it));
+        if (psc_result_it->status == PscStatusCode::kError) {
           continue;
         }
-        #pragma omp task firstprivate(sens_mat_it, psc_result_it, loo_status_it) default(none)
+        #pragma omp task firstprivate(sens_mat_it, psc_result_it, low_rank_sensitivity) \
+          default(none) shared(data)
         {
-          psc_result_it->SetLooStatus(std::move(*loo_status_it));
-          enpy_psc_internal::FinalizePSC(*sens_mat_it, &(*psc_result_it));
+          if (low_rank_sensitivity) {
+            enpy_psc_internal::FinalizeLowRankPSC(data.cx(), *sens_mat_it, &(*psc_result_it));
+          } else {
+            enpy_psc_internal::FinalizePSC(*sens_mat_it, &(*psc_result_it));
+          }
         }
       }
     }
@@ -303,16 +508,20 @@ alias::FwdList<pense::PscResult<Optimizer>> ComputePscs(
 //! @param loss the LS-loss object to compute the PSCs for.
 //! @param penalties a lisf of penalties for which the PSCs should be computed at once.
 //! @param optimizer Optimizer to use to compute leave-one-out residuals.
+//! @param loo_warm_start starting point for the leave-one-out fits.
+//! @param low_rank use the low-rank factorization of the sensitivity matrices, if it saves memory.
+//! @param loo_subsample proportion of observations to leave out (see `LooIndices()`).
 //! @return A list of PSC structures, one for each given penalty, in the same order as `penalties`.
 template<typename Optimizer, typename = typename std::enable_if<!EnableDirectRidge<Optimizer>::value>::type>
 alias::FwdList<pense::PscResult<Optimizer>> ComputePscs(
     const nsoptim::LsRegressionLoss& loss, const alias::FwdList<typename Optimizer::PenaltyFunction>& penalties,
-    Optimizer optimizer) {
+    Optimizer optimizer, const LooWarmStart loo_warm_start, const bool low_rank, const double loo_subsample) {
   using arma::uword;
   using enpy_psc_internal::ComputeLoo;
-  using LooStatusList = alias::FwdList<enpy_psc_internal::LooStatus>;
 
   const nsoptim::PredictorResponseData& data = loss.data();
+  const bool low_rank_sensitivity = UseLowRankSensitivity(low_rank, data);
+  const arma::uvec loo_indices = LooIndices(data, loo_subsample);
   // A list of PscResult objects and the sensitivity matrices, i.e., matrices `R` in the paper, one per penalty.
   alias::FwdList<pense::PscResult<Optimizer>> psc_results;
   alias::FwdList<arma::mat> sensitivity_matrices;
@@ -348,24 +557,33 @@ alias::FwdList<pense::PscResult<Optimizer>> ComputePscs(
         // Fall through the case of no error or warning!
       default:
         // If status != kError, fill the sensitivity matrix with the LS-EN residuals.
-        sens_mat_it = sensitivity_matrices.emplace_after(sens_mat_it, arma::repmat(
-          data.cx() * psc_result_it->optimum.coefs.beta + psc_result_it->optimum.coefs.intercept, 1, data.n_obs()));
+        sens_mat_it = sensitivity_matrices.emplace_after(sens_mat_it, InitialSensitivityMatrix(
+          data, psc_result_it->optimum.coefs, low_rank_sensitivity, loo_indices.n_elem));
         break;
     }
   }
 
-  LooStatusList loo_statuses = ComputeLoo(loss, penalties, 0, data.n_obs(), &optimizer, &sensitivity_matrices);
-  auto loo_status_it = loo_statuses.begin();
+  const uword n_loo = loo_indices.n_elem;
+  std::vector<LooStatus> loo_statuses(std::distance(penalties.begin(), penalties.end()) * n_loo,
+                                      LooStatus(PscStatusCode::kOk));
+  {
+    LooWorkspace workspace(data);
+    ComputeLoo(loss, penalties, psc_results, loo_indices, 0, n_loo, loo_warm_start, low_rank_sensitivity,
+               &workspace, &optimizer, &sensitivity_matrices, &loo_statuses);
+  }
+  SetLooStatuses(n_loo, &loo_statuses, &psc_results);
   sens_mat_it = sensitivity_matrices.begin();
   for (auto psc_result_it = psc_results.begin(), end = psc_results.end(); psc_result_it != end;
-      ++psc_result_it, ++sens_mat_it, ++loo_status_it) {
-    psc_result_it->SetLooStatus(std::move(*loo_status_it));
-
+      ++psc_result_it, ++sens_mat_it) {
     // Skip results with errors.
     if (psc_result_it->status == PscStatusCode::kError) {
       continue;
     }
-    enpy_psc_internal::FinalizePSC(*sens_mat_it, &(*psc_result_it));
+    if (low_rank_sensitivity) {
+      enpy_psc_internal::FinalizeLowRankPSC(data.cx(), *sens_mat_it, &(*psc_result_it));
+    } else {
+      enpy_psc_internal::FinalizePSC(*sens_mat_it, &(*psc_result_it));
+    }
   }
   return psc_results;
 }
@@ -400,7 +618,8 @@ alias::FwdList<pense::PscResult<DirectRidgeOptimizer>> ComputeRidgePscs(const ns
 //! @return A list of PSC structures, one for each given penalty, in the same order as `penalties`.
 template<typename Optimizer, typename = typename std::enable_if<EnableDirectRidge<Optimizer>::value>::type>
 alias::FwdList<pense::PscResult<Optimizer>> ComputePscs(const nsoptim::LsRegressionLoss& loss,
-    const alias::FwdList<nsoptim::RidgePenalty>& penalties, const Optimizer& optimizer) {
+    const alias::FwdList<nsoptim::RidgePenalty>& penalties, const Optimizer& optimizer, const LooWarmStart,
+    const bool, const double) {
   return ComputeRidgePscs(loss, penalties, optimizer);
 }
 
@@ -414,7 +633,8 @@ alias::FwdList<pense::PscResult<Optimizer>> ComputePscs(const nsoptim::LsRegress
 //! @return A list of PSC structures, one for each given penalty, in the same order as `penalties`.
 template<typename Optimizer, typename = typename std::enable_if<EnableDirectRidge<Optimizer>::value>::type>
 alias::FwdList<pense::PscResult<Optimizer>> ComputePscs(const nsoptim::LsRegressionLoss& loss,
-    const alias::FwdList<nsoptim::RidgePenalty>& penalties, const Optimizer& optimizer, int num_threads) {
+    const alias::FwdList<nsoptim::RidgePenalty>& penalties, const Optimizer& optimizer, const LooWarmStart,
+    const bool, const double, int num_threads) {
   return ComputeRidgePscs(loss, penalties, optimizer, num_threads);
 }
 
@@ -428,15 +648,33 @@ alias::FwdList<pense::PscResult<Optimizer>> ComputePscs(const nsoptim::LsRegress
 //! @param penalties a lisf of penalties for which the PSCs should be computed at once.
 //! @param optimizer Optimizer to use to compute leave-one-out residuals.
 //! @param num_threads number of threads to use.
+//! @param loo_warm_start starting point for the leave-one-out fits.
+//! @param low_rank compute the PSCs from a low-rank factorization of the sensitivity matrix, if it saves memory.
+//!                 Not used for the Ridge penalty.
+//! @param loo_subsample compute the PSCs from the LOO fits of a random subset of this proportion of observations.
+//!                      Not used for the Ridge penalty.
+//! @param timings account the memory of the sensitivity matrices to these timings, unless `nullptr`.
+//! @param memory_budget if positive, limit the number of concurrent leave-one-out fits such that the sensitivity
+//!                      matrices and the leave-one-out data copies fit into this many bytes.
 //! @return A list of PSC structures, one for each given penalty, in the same order as `penalties`.
 template<typename Optimizer>
 alias::FwdList<PscResult<Optimizer>> PrincipalSensitiviyComponents(
     const nsoptim::LsRegressionLoss& loss, const alias::FwdList<typename Optimizer::PenaltyFunction>& penalties,
-    const Optimizer& optimizer, const int num_threads) {
-  if (omp::Enabled(num_threads)) {
-    return enpy_psc_internal::ComputePscs(loss, penalties, optimizer, num_threads);
+    const Optimizer& optimizer, const int num_threads, const LooWarmStart loo_warm_start = kDefaultLooWarmStart,
+    const bool low_rank = false, const double loo_subsample = 1, nsoptim::PhaseTimings* timings = nullptr,
+    const double memory_budget = 0) {
+  const auto n_penalties = std::distance(penalties.begin(), penalties.end());
+  const std::size_t sensitivity_bytes = EnableDirectRidge<Optimizer>::value ? 0 :
+    enpy_psc_internal::SensitivityMatrixBytes(loss.data(), low_rank, loo_subsample, n_penalties);
+  const int loo_threads = omp::MemoryLimitedThreads(
+    enpy_psc_internal::LooThreads(loss.data(), num_threads, loo_subsample, n_penalties), memory_budget,
+    enpy_psc_internal::LooTaskBytes(loss.data()), sensitivity_bytes);
+  nsoptim::ScopedMemoryAccount sensitivity_memory(timings, "enpy_psc", sensitivity_bytes);
+  if (loo_threads > 1) {
+    return enpy_psc_internal::ComputePscs(loss, penalties, optimizer, loo_warm_start, low_rank, loo_subsample,
+                                          loo_threads);
   } else {
-    return enpy_psc_internal::ComputePscs(loss, penalties, optimizer);
+    return enpy_psc_internal::ComputePscs(loss, penalties, optimizer, loo_warm_start, low_rank, loo_subsample);
   }
 }
 
@@ -446,16 +684,36 @@ alias::FwdList<PscResult<Optimizer>> PrincipalSensitiviyComponents(
 //!
 //! @param loss the S-loss object to compute the PSCs for.
 //! @param optim the optimizer to use to compute leave-one-out residuals.
+//! @param num_threads number of threads to use.
+//! @param loo_warm_start starting point for the leave-one-out fits.
+//! @param low_rank compute the PSCs from a low-rank factorization of the sensitivity matrix, if it saves memory.
+//!                 Not used for the Ridge penalty.
+//! @param loo_subsample compute the PSCs from the LOO fits of a random subset of this proportion of observations.
+//!                      Not used for the Ridge penalty.
+//! @param timings account the memory of the sensitivity matrices to these timings, unless `nullptr`.
+//! @param memory_budget if positive, limit the number of concurrent leave-one-out fits such that the sensitivity
+//!                      matrices and the leave-one-out data copies fit into this many bytes.
 //! @return a matrix of PSCs.
 template<typename Optimizer>
 PscResult<Optimizer> PrincipalSensitiviyComponents(const nsoptim::LsRegressionLoss& loss, const Optimizer& optim,
-                                                   const int num_threads) {
+                                                   const int num_threads,
+                                                   const LooWarmStart loo_warm_start = kDefaultLooWarmStart,
+                                                   const bool low_rank = false, const double loo_subsample = 1,
+                                                   nsoptim::PhaseTimings* timings = nullptr,
+                                                   const double memory_budget = 0) {
   const alias::FwdList<typename Optimizer::PenaltyFunction> penalties { optim.penalty() };
 
-  if (omp::Enabled(num_threads)) {
-    return enpy_psc_internal::ComputePscs(loss, penalties, optim, num_threads).front();
+  const std::size_t sensitivity_bytes = EnableDirectRidge<Optimizer>::value ? 0 :
+    enpy_psc_internal::SensitivityMatrixBytes(loss.data(), low_rank, loo_subsample, 1);
+  const int loo_threads = omp::MemoryLimitedThreads(
+    enpy_psc_internal::LooThreads(loss.data(), num_threads, loo_subsample, 1), memory_budget,
+    enpy_psc_internal::LooTaskBytes(loss.data()), sensitivity_bytes);
+  nsoptim::ScopedMemoryAccount sensitivity_memory(timings, "enpy_psc", sensitivity_bytes);
+  if (loo_threads > 1) {
+    return enpy_psc_internal::ComputePscs(loss, penalties, optim, loo_warm_start, low_rank, loo_subsample,
+                                          loo_threads).front();
   } else {
-    return enpy_psc_internal::ComputePscs(loss, penalties, optim).front();
+    return enpy_psc_internal::ComputePscs(loss, penalties, optim, loo_warm_start, low_rank, loo_subsample).front();
   }
 }
 }  // namespace pense
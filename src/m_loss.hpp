@@ -30,7 +30,7 @@ class MLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
 
   MLoss(ConstDataPtr data, const RhoFunction& rho, const double scale, const bool include_intercept = true) noexcept
     : include_intercept_(include_intercept), data_(data), rho_(rho), scale_(scale),
-      pred_norm_(std::min(arma::norm(data->cx(), "inf"), arma::norm(data->cx(), 1))) {}
+      pred_norm_(data->pred_norm_bound()) {}
 
   MLoss(const MLoss& other) = default;
   MLoss& operator=(const MLoss& other) = delete;
@@ -67,7 +67,7 @@ class MLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
   //! @param residuals residuals of the point where to evaluate the loss function.
   //! @return loss evaluated at `where`.
   double Evaluate(const ResidualType& residuals) const {
-    return arma::mean(rho_(residuals, scale_));
+    return rho_.Sum(residuals, scale_) / residuals.n_elem;
   }
 
   //! Evaluate the M loss function.
@@ -85,7 +85,18 @@ class MLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
   //! @return loss evaluated at `where`.
   template<typename T>
   double Evaluate(const nsoptim::RegressionCoefficients<T>& where) const {
-    return arma::mean(rho_(Residuals(where), scale_));
+    return Evaluate(Residuals(where));
+  }
+
+  //! Evaluate the M loss function, using the caller-owned workspace for the residuals.
+  //!
+  //! @param where point where to evaluate the loss function.
+  //! @param residuals workspace for the residuals. On return, holds the residuals at `where`.
+  //! @return loss evaluated at `where`.
+  template<typename T>
+  double Evaluate(const nsoptim::RegressionCoefficients<T>& where, arma::vec* residuals) const {
+    Residuals(where, residuals);
+    return Evaluate(*residuals);
   }
 
   //! Get the residuals for the LS loss function.
@@ -100,12 +111,25 @@ class MLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
     return data_->cy() - data_->cx() * where.beta;
   }
 
+  //! Compute the residuals at `where` and store them in the caller-owned workspace `residuals`.
+  //! If the workspace is already of the correct size, no memory is allocated.
+  //!
+  //! @param where point where to compute the residuals.
+  //! @param residuals workspace for the residuals.
+  template<typename VectorType>
+  void Residuals(const nsoptim::RegressionCoefficients<VectorType>& where, arma::vec* residuals) const {
+    data_->Residuals(where.beta, include_intercept_ ? where.intercept : 0., residuals);
+  }
+
   //! Get the weights for the surrogate LS-loss at the given residuals.
   //!
   //! @param residuals residuals where the surrogate weights are computed.
   //! @return a vector of weights, the same length as `residuals`.
   arma::vec SurrogateWeights(const ResidualType& residuals) const {
-    return rho_.Weight(residuals, scale_) / (scale_ * scale_);
+    arma::vec weights;
+    rho_.Weight(residuals, scale_, &weights);
+    weights /= scale_ * scale_;
+    return weights;
   }
 
   //! Get the weights for the surrogate LS-loss at the given location.
@@ -134,6 +158,14 @@ class MLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
     return ConvexSurrogateType(data_, SurrogateWeights(residuals), include_intercept_);
   }
 
+  //! Update a convex surrogate for the M loss function, previously obtained from `GetConvexSurrogate()`, in place.
+  //!
+  //! @param residuals residuals of the point where the convex surrogate should be constructed.
+  //! @param surrogate the weighted-ls loss surrogate loss function to update.
+  void UpdateConvexSurrogate(const ResidualType& residuals, ConvexSurrogateType* surrogate) const {
+    surrogate->UpdateWeights(SurrogateWeights(residuals));
+  }
+
   //! Clone the M loss function. The returned object does not share anything with this loss function.
   //!
   //! @return a deep copy of this M loss function.
@@ -165,7 +197,7 @@ class MLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
  private:
   MLoss(const MLoss& other, ConstDataPtr data) :
       include_intercept_(other.include_intercept_), data_(data), rho_(other.rho_), scale_(other.scale_),
-      pred_norm_(std::min(arma::norm(data->cx(), "inf"), arma::norm(data->cx(), 1))) {}
+      pred_norm_(data->pred_norm_bound()) {}
 
   bool include_intercept_;
   ConstDataPtr data_;
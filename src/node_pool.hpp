@@ -0,0 +1,198 @@
+//
+//  node_pool.hpp
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef NODE_POOL_HPP_
+#define NODE_POOL_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace pense {
+namespace node_pool {
+//! Number of nodes allocated at once from the system.
+constexpr std::size_t kNodesPerChunk = 256;
+//! Maximum number of free nodes cached by a single thread before they are returned to the shared pool.
+constexpr std::size_t kMaxThreadNodes = 4 * kNodesPerChunk;
+
+//! Node in a list of free memory blocks.
+struct FreeNode {
+  FreeNode* next;
+};
+
+//! Round the size of a node up to a multiple of the fundamental alignment.
+constexpr std::size_t BlockSize(const std::size_t size) noexcept {
+  return ((size < sizeof(FreeNode) ? sizeof(FreeNode) : size) + alignof(std::max_align_t) - 1) /
+    alignof(std::max_align_t) * alignof(std::max_align_t);
+}
+
+//! Process-wide pool of memory blocks of size `kBlockSize`.
+//! The pool owns all memory and releases it only at program exit; blocks are handed out to threads in batches.
+template<std::size_t kBlockSize>
+class SharedPool {
+  using Block = typename std::aligned_storage<kBlockSize, alignof(std::max_align_t)>::type;
+
+ public:
+  static SharedPool& Instance() {
+    static SharedPool pool;
+    return pool;
+  }
+
+  //! Get a list of free blocks, either returned by other threads or from a newly allocated chunk.
+  FreeNode* Take() {
+    FreeNode* head = nullptr;
+    #pragma omp critical(pense_node_pool)
+    {
+      if (free_) {
+        head = free_;
+        free_ = nullptr;
+      } else {
+        chunks_.emplace_back(new Block[kNodesPerChunk]);
+        Block* const chunk = chunks_.back().get();
+        for (std::size_t i = kNodesPerChunk; i > 0; --i) {
+          FreeNode* const node = reinterpret_cast<FreeNode*>(chunk + i - 1);
+          node->next = head;
+          head = node;
+        }
+      }
+    }
+    return head;
+  }
+
+  //! Return the list of free blocks from `head` to `tail` to the pool.
+  void Give(FreeNode* head, FreeNode* tail) {
+    #pragma omp critical(pense_node_pool)
+    {
+      tail->next = free_;
+      free_ = head;
+    }
+  }
+
+ private:
+  SharedPool() noexcept {}
+
+  FreeNode* free_ = nullptr;
+  std::vector<std::unique_ptr<Block[]>> chunks_;
+};
+
+//! Thread-local cache of free memory blocks of size `kBlockSize`.
+//! Blocks can be released by any thread, not only by the thread which allocated them. Released blocks are returned to
+//! the shared pool if a thread caches too many of them and when the thread exits.
+template<std::size_t kBlockSize>
+class ThreadPool {
+ public:
+  static ThreadPool& Local() {
+    static thread_local ThreadPool pool;
+    return pool;
+  }
+
+  ~ThreadPool() {
+    GiveReleased();
+    if (fresh_) {
+      FreeNode* tail = fresh_;
+      while (tail->next) {
+        tail = tail->next;
+      }
+      SharedPool<kBlockSize>::Instance().Give(fresh_, tail);
+    }
+  }
+
+  void* Allocate() {
+    FreeNode* node;
+    if (released_) {
+      node = released_;
+      released_ = node->next;
+      --n_released_;
+    } else {
+      if (!fresh_) {
+        fresh_ = SharedPool<kBlockSize>::Instance().Take();
+      }
+      node = fresh_;
+      fresh_ = node->next;
+    }
+    return node;
+  }
+
+  void Deallocate(void* ptr) {
+    FreeNode* const node = static_cast<FreeNode*>(ptr);
+    if (!released_) {
+      released_tail_ = node;
+    }
+    node->next = released_;
+    released_ = node;
+    if (++n_released_ >= kMaxThreadNodes) {
+      GiveReleased();
+    }
+  }
+
+ private:
+  ThreadPool() noexcept {}
+
+  void GiveReleased() {
+    if (released_) {
+      SharedPool<kBlockSize>::Instance().Give(released_, released_tail_);
+      released_ = released_tail_ = nullptr;
+      n_released_ = 0;
+    }
+  }
+
+  //! Blocks obtained from the shared pool.
+  FreeNode* fresh_ = nullptr;
+  //! Blocks released by this thread.
+  FreeNode* released_ = nullptr;
+  FreeNode* released_tail_ = nullptr;
+  std::size_t n_released_ = 0;
+};
+}  // namespace node_pool
+
+//! Stateless allocator for node-based containers (e.g., std::forward_list or std::unordered_map).
+//! Single objects are served from a thread-local pool of fixed-size blocks, avoiding contention in the system
+//! allocator if many threads create and discard list nodes concurrently. Arrays of objects (e.g., the buckets of a hash
+//! table) are allocated with the global `operator new`.
+//! All instances compare equal, hence nodes can be moved between containers and released by any thread.
+template<typename T>
+class NodeAllocator {
+  static_assert(alignof(T) <= alignof(std::max_align_t), "Over-aligned types are not supported.");
+  using Pool = node_pool::ThreadPool<node_pool::BlockSize(sizeof(T))>;
+
+ public:
+  using value_type = T;
+
+  NodeAllocator() noexcept {}
+  template<typename U>
+  NodeAllocator(const NodeAllocator<U>&) noexcept {}
+
+  T* allocate(const std::size_t n) {
+    if (n == 1) {
+      return static_cast<T*>(Pool::Local().Allocate());
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* ptr, const std::size_t n) noexcept {
+    if (n == 1) {
+      Pool::Local().Deallocate(ptr);
+    } else {
+      ::operator delete(ptr);
+    }
+  }
+};
+
+template<typename T, typename U>
+bool operator==(const NodeAllocator<T>&, const NodeAllocator<U>&) noexcept {
+  return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const NodeAllocator<T>&, const NodeAllocator<U>&) noexcept {
+  return false;
+}
+}  // namespace pense
+
+#endif  // NODE_POOL_HPP_
@@ -26,4 +26,10 @@
 # define NSOPTIM_METRICS_LEVEL 0
 #endif
 
+#ifdef NSOPTIM_PERF_COUNTERS
+# define NSOPTIM_PERF_COUNTERS_ENABLED 1
+#else
+# define NSOPTIM_PERF_COUNTERS_ENABLED 0
+#endif
+
 #endif  // NSOPTIM_CONFIG_HPP_
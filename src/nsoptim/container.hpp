@@ -9,8 +9,12 @@
 #ifndef NSOPTIM_CONTAINER_HPP_
 #define NSOPTIM_CONTAINER_HPP_
 
+#include "container/counters.hpp"
 #include "container/data.hpp"
+#include "container/gram_cache.hpp"
+#include "container/kernel_counters.hpp"
 #include "container/metrics.hpp"
 #include "container/regression_coefficients.hpp"
+#include "container/timings.hpp"
 
 #endif  // NSOPTIM_CONTAINER_HPP_
@@ -0,0 +1,135 @@
+//
+//  counters.hpp
+//  nsoptim
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef NSOPTIM_CONTAINER_COUNTERS_HPP_
+#define NSOPTIM_CONTAINER_COUNTERS_HPP_
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <algorithm>
+
+#include "../config.hpp"
+#include "metrics.hpp"
+
+namespace nsoptim {
+//! Summary of all values recorded by a counter.
+struct CounterSummary {
+  //! Number of bins in the histogram of recorded values.
+  static constexpr std::size_t kHistogramBins = 16;
+
+  //! Number of recorded values.
+  int count = 0;
+  //! Sum of the recorded values.
+  double sum = 0;
+  //! Smallest recorded value.
+  double min = std::numeric_limits<double>::infinity();
+  //! Largest recorded value.
+  double max = -std::numeric_limits<double>::infinity();
+  //! Histogram of the absolute values on a log2 scale. The first bin counts values less than 1 in absolute value,
+  //! bin `k` counts values in `[2^(k-1), 2^k)`, and the last bin counts all larger values.
+  std::array<int, kHistogramBins> histogram {};
+};
+
+//! A fixed set of typed counters for recording metrics in hot loops.
+//! In contrast to Metrics, the counters are identified by the enumerators of `Id`, the storage is allocated once,
+//! and only summaries of the recorded values are retained. The counters can be disabled at runtime, in which case
+//! recording a value costs a single branch. If metrics are disabled at compile time, the counters are always
+//! disabled.
+//! `Id` must be an enumeration with consecutive values starting at 0, and the last enumerator `kCount`.
+//! The counters are not thread-safe and are meant to be owned by the optimizer using them.
+template<typename Id>
+class Counters {
+  static constexpr std::size_t kNumCounters = static_cast<std::size_t>(Id::kCount);
+
+ public:
+  //! Create a set of counters.
+  //!
+  //! @param enabled whether values should be recorded.
+  explicit Counters(const bool enabled = true) noexcept : enabled_(NSOPTIM_METRICS_LEVEL > 0 && enabled) {}
+
+  //! Check if the counters record values.
+  bool enabled() const noexcept {
+    return enabled_;
+  }
+
+  //! Discard all recorded values.
+  void Reset() noexcept {
+    if (enabled_) {
+      counters_.fill(CounterSummary());
+    }
+  }
+
+  //! Record a value.
+  //!
+  //! @param id the counter to record the value for.
+  //! @param value the value to record.
+  void Add(const Id id, const double value) noexcept {
+    if (enabled_) {
+      auto& counter = counters_[static_cast<std::size_t>(id)];
+      ++counter.count;
+      counter.sum += value;
+      counter.min = std::min(counter.min, value);
+      counter.max = std::max(counter.max, value);
+      ++counter.histogram[HistogramBin(value)];
+    }
+  }
+
+  //! Access the summary of a counter.
+  //!
+  //! @param id the counter.
+  //! @return the summary of all values recorded by the counter.
+  const CounterSummary& operator[](const Id id) const noexcept {
+    return counters_[static_cast<std::size_t>(id)];
+  }
+
+  //! Add the summaries of all non-empty counters to a collection of metrics.
+  //! For each counter, the number of values, the mean, the minimum, and the maximum are added as metrics. The
+  //! histogram is added as a detail.
+  //!
+  //! @param names the names of the counters, in the order of the enumerators in `Id`.
+  //! @param metrics the collection of metrics to add the summaries to.
+  template<typename MetricsType>
+  void Report(char const * const names[], MetricsType* metrics) const {
+    if (!enabled_) {
+      return;
+    }
+    for (std::size_t i = 0; i < kNumCounters; ++i) {
+      const auto& counter = counters_[i];
+      if (counter.count > 0) {
+        const std::string name(names[i]);
+        metrics->AddMetric(name + "_count", counter.count);
+        metrics->AddMetric(name + "_mean", counter.sum / counter.count);
+        metrics->AddMetric(name + "_min", counter.min);
+        metrics->AddMetric(name + "_max", counter.max);
+        std::string histogram;
+        for (auto&& bin_count : counter.histogram) {
+          histogram.append(histogram.empty() ? "" : ",").append(std::to_string(bin_count));
+        }
+        metrics->AddDetail(name + "_histogram", histogram);
+      }
+    }
+  }
+
+ private:
+  static std::size_t HistogramBin(const double value) noexcept {
+    const double abs_value = std::abs(value);
+    if (!(abs_value >= 1)) {
+      return 0;
+    }
+    const int exponent = std::ilogb(abs_value) + 1;
+    return std::min(static_cast<std::size_t>(exponent), CounterSummary::kHistogramBins - 1);
+  }
+
+  bool enabled_;
+  std::array<CounterSummary, kNumCounters> counters_;
+};
+}  // namespace nsoptim
+
+#endif  // NSOPTIM_CONTAINER_COUNTERS_HPP_
@@ -9,7 +9,10 @@
 #ifndef NSOPTIM_CONTAINER_DATA_HPP_
 #define NSOPTIM_CONTAINER_DATA_HPP_
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include "../armadillo.hpp"
 #include "../utilities.hpp"
@@ -21,7 +24,7 @@ namespace nsoptim {
 class PredictorResponseData {
  public:
   //! Initialize the predictor-response data with empty x and y
-  PredictorResponseData() noexcept : x_(), y_(), n_obs_(0), n_pred_(0) {}
+  PredictorResponseData() noexcept : x_(), y_(), n_obs_(0), n_pred_(0), norms_(std::make_shared<NormCache>()) {}
 
   //! Initialize predictor-response data with the given x and y.
   //! @note the given data will be copied!
@@ -29,7 +32,8 @@ class PredictorResponseData {
   //! @param other_x predictor matrix to copy.
   //! @param other_y response vector to copy.
   PredictorResponseData(const arma::mat& other_x, const arma::vec& other_y) noexcept
-    : x_(other_x), y_(other_y), n_obs_(other_x.n_rows), n_pred_(other_x.n_cols) {}
+    : x_(other_x), y_(other_y), n_obs_(other_x.n_rows), n_pred_(other_x.n_cols),
+      norms_(std::make_shared<NormCache>()) {}
 
   //! Initialize predictor-response data with the given x and y.
   //! @note the given data will be moved to this container!
@@ -37,21 +41,88 @@ class PredictorResponseData {
   //! @param other_x predictor matrix to move.
   //! @param other_y response vector to move.
   PredictorResponseData(arma::mat&& other_x, arma::vec&& other_y) noexcept
-    : x_(std::move(other_x)), y_(std::move(other_y)), n_obs_(x_.n_rows), n_pred_(x_.n_cols) {}
+    : x_(std::move(other_x)), y_(std::move(other_y)), n_obs_(x_.n_rows), n_pred_(x_.n_cols),
+      norms_(std::make_shared<NormCache>()) {}
+
+  //! Initialize predictor-response data as a read-only view of the given memory.
+  //! @note the memory is not copied! It must remain valid and unchanged for the lifetime of the data container.
+  //!       Copies of the data container own a copy of the memory.
+  //!
+  //! @param x_mem pointer to the predictor values in column-major order.
+  //! @param y_mem pointer to the response values.
+  //! @param n_obs number of observations.
+  //! @param n_pred number of predictors.
+  PredictorResponseData(const double* x_mem, const double* y_mem, const arma::uword n_obs,
+                        const arma::uword n_pred) noexcept
+    : x_(const_cast<double*>(x_mem), n_obs, n_pred, false, true), y_(const_cast<double*>(y_mem), n_obs, false, true),
+      n_obs_(n_obs), n_pred_(n_pred), norms_(std::make_shared<NormCache>()) {}
 
   //! Copy the given predictor-response data, but pointing to the same underlying data!
+  //! The copy shares the cached norms of the predictor matrix with `other`.
   //!
   //! @param other predictor-response data to copy.
   PredictorResponseData(const PredictorResponseData& other) = default;
 
   PredictorResponseData& operator=(const PredictorResponseData& other) = default;
 
+  //! Move the given predictor-response data. If the predictors of `other` are a view of memory owned elsewhere
+  //! (e.g., data created by `WithResponse()`), the moved data container remains a view of the same memory.
+  //!
+  //! @param other predictor-response data to move.
+  PredictorResponseData(PredictorResponseData&& other) = default;
+
+  PredictorResponseData& operator=(PredictorResponseData&& other) = default;
+
   //! Get a data set with the observations at the requested indices.
   //!
   //! @param indices the indicies of the observations to get.
   //! @return the subset of the data with the requested observations.
   PredictorResponseData Observations(const arma::uvec& indices) const {
-    return PredictorResponseData(x_.rows(indices), y_.rows(indices));
+    PredictorResponseData subset(x_.rows(indices), y_.rows(indices));
+    subset.DeriveColumnSums(*this, indices);
+    return subset;
+  }
+
+  //! Extract the observations at the requested indices into the caller-owned data container `subset`.
+  //! The memory of `subset` is re-used if it already holds a data set of the same size.
+  //! The ID of `subset` is renewed to inform optimizers caching data-dependent quantities about the change.
+  //!
+  //! @param indices the indicies of the observations to get.
+  //! @param subset output data container for the subset of the data with the requested observations.
+  void Observations(const arma::uvec& indices, PredictorResponseData* subset) const {
+    const arma::uword n_subset = indices.n_elem;
+    subset->x_.set_size(n_subset, n_pred_);
+    subset->y_.set_size(n_subset);
+    // Gather the rows column by column to access the source matrix in storage order.
+    for (arma::uword j = 0; j < n_pred_; ++j) {
+      const double* source = x_.colptr(j);
+      double* dest = subset->x_.colptr(j);
+      for (arma::uword i = 0; i < n_subset; ++i) {
+        dest[i] = source[indices[i]];
+      }
+    }
+    for (arma::uword i = 0; i < n_subset; ++i) {
+      subset->y_[i] = y_[indices[i]];
+    }
+    subset->n_obs_ = n_subset;
+    subset->n_pred_ = n_pred_;
+    subset->RenewId();
+    subset->DeriveColumnSums(*this, indices);
+  }
+
+  //! Get a data set with the same predictor matrix, but a different response vector.
+  //! The returned data container is a view of the predictor matrix of this data container, hence this data container
+  //! must remain valid and unchanged for the lifetime of the returned data container. The returned data container
+  //! has a different ID, but the same predictors ID, i.e., it shares the cached norms and Gram matrices of the
+  //! predictors with this data container.
+  //!
+  //! @param other_y response vector to move into the returned data container. Must have `n_obs` elements.
+  //! @return the data with the predictors of this data container and the given response.
+  PredictorResponseData WithResponse(arma::vec&& other_y) const {
+    PredictorResponseData with_response(x_.memptr(), std::move(other_y), n_obs_, n_pred_);
+    with_response.predictors_id_ = predictors_id_;
+    with_response.norms_ = norms_;
+    return with_response;
   }
 
   //! Get a data set with the given observation removed.
@@ -59,8 +130,17 @@ class PredictorResponseData {
   //! @param index the index of the observation to remove.
   //! @return the subset of the data with the observation removed.
   PredictorResponseData RemoveObservation(const arma::uword index) const {
-    return PredictorResponseData(arma::join_vert(x_.head_rows(index), x_.tail_rows(n_obs_ - index - 1)),
+    PredictorResponseData subset(arma::join_vert(x_.head_rows(index), x_.tail_rows(n_obs_ - index - 1)),
                                  arma::join_vert(y_.head(index), y_.tail(n_obs_ - index - 1)));
+    std::shared_ptr<const arma::vec> sums;
+    #pragma omp critical(nsoptim_data_norms)
+    {
+      sums = norms_->column_sums;
+    }
+    if (sums) {
+      subset.norms_->column_sums = std::make_shared<const arma::vec>(*sums - x_.row(index).t());
+    }
+    return subset;
   }
 
   //! Get a data set with the first `n_obs` observations of the data.
@@ -79,6 +159,36 @@ class PredictorResponseData {
     return PredictorResponseData(x_.tail_rows(n_obs), y_.tail_rows(n_obs));
   }
 
+  //! Compute the residuals `y - intercept - x * beta` and store them in the caller-owned `residuals`.
+  //! If `residuals` is already of the correct size, no memory is allocated.
+  //!
+  //! @param beta dense slope coefficients.
+  //! @param intercept intercept coefficient.
+  //! @param residuals output vector for the residuals.
+  void Residuals(const arma::vec& beta, const double intercept, arma::vec* residuals) const {
+    *residuals = y_;
+    *residuals -= intercept;
+    for (arma::uword j = 0; j < n_pred_; ++j) {
+      if (beta[j] != 0) {
+        *residuals -= beta[j] * x_.col(j);
+      }
+    }
+  }
+
+  //! Compute the residuals `y - intercept - x * beta` and store them in the caller-owned `residuals`.
+  //! If `residuals` is already of the correct size, no memory is allocated.
+  //!
+  //! @param beta sparse slope coefficients.
+  //! @param intercept intercept coefficient.
+  //! @param residuals output vector for the residuals.
+  void Residuals(const arma::sp_vec& beta, const double intercept, arma::vec* residuals) const {
+    *residuals = y_;
+    *residuals -= intercept;
+    for (auto beta_it = beta.begin(), beta_end = beta.end(); beta_it != beta_end; ++beta_it) {
+      *residuals -= (*beta_it) * x_.col(beta_it.row());
+    }
+  }
+
   //! Compare two data containers based on their object ID.
   //!
   //! This does not compare the actual *data*, it only compares their ID. The ID is only equal if the objects
@@ -108,6 +218,15 @@ class PredictorResponseData {
     return id_;
   }
 
+  //! Get the ID of the predictor matrix in the data container.
+  //! The ID is the same as `id()`, unless the data container was created by `WithResponse()`, in which case the
+  //! ID is shared with the data container providing the predictors.
+  //!
+  //! @return a program-unique ID for the predictor matrix.
+  ObjectId predictors_id() const noexcept {
+    return predictors_id_;
+  }
+
   //! Get a constant reference to the predictor matrix.
   //! Only valid as long as the PredictorResponseData object is in scope.
   //!
@@ -127,20 +246,92 @@ class PredictorResponseData {
   //! Get non-const references to the data
   //! Get a reference to the predictor matrix.
   //! Only valid as long as the PredictorResponseData object is in scope.
+  //! The ID of the data is renewed, because the predictor matrix may be changed through the reference.
   //!
   //! @return reference to the predictor matrix
-  arma::mat& x() noexcept {
+  arma::mat& x() {
+    RenewId();
     return x_;
   }
 
   //! Get a reference to the response vector.
   //! Only valid as long as the PredictorResponseData object is in scope.
+  //! The ID of the data is renewed, because the response vector may be changed through the reference.
   //!
   //! @return reference to the response vector
-  arma::vec& y() noexcept {
+  arma::vec& y() {
+    RenewId();
     return y_;
   }
 
+  //! Get the 1-norms of the rows of the predictor matrix.
+  //! The norms are computed on first use and shared by all copies of the data container.
+  //! Only valid as long as the PredictorResponseData object is in scope and the predictor matrix is not changed.
+  //!
+  //! @return constant reference to the vector of row norms.
+  const arma::vec& row_norms() const {
+    return CachedNorms(&NormCache::row_norms, [this]() {
+      arma::vec row_norms(n_obs_, arma::fill::zeros);
+      for (arma::uword j = 0; j < n_pred_; ++j) {
+        row_norms += arma::abs(x_.col(j));
+      }
+      return row_norms;
+    });
+  }
+
+  //! Get the 1-norms of the columns of the predictor matrix.
+  //! The norms are computed on first use and shared by all copies of the data container.
+  //! Only valid as long as the PredictorResponseData object is in scope and the predictor matrix is not changed.
+  //!
+  //! @return constant reference to the vector of column norms.
+  const arma::vec& column_norms() const {
+    return CachedNorms(&NormCache::column_norms, [this]() {
+      arma::vec column_norms(n_pred_);
+      for (arma::uword j = 0; j < n_pred_; ++j) {
+        column_norms[j] = arma::norm(x_.col(j), 1);
+      }
+      return column_norms;
+    });
+  }
+
+  //! Get the sums of the columns of the predictor matrix.
+  //! The sums are computed on first use and shared by all copies of the data container. For subsets of the
+  //! observations, the sums are derived from the sums of the full data if they are already computed.
+  //! Only valid as long as the PredictorResponseData object is in scope and the predictor matrix is not changed.
+  //!
+  //! @return constant reference to the vector of column sums.
+  const arma::vec& column_sums() const {
+    return CachedNorms(&NormCache::column_sums, [this]() {
+      return arma::vec(arma::sum(x_, 0).t());
+    });
+  }
+
+  //! Get the largest absolute value in every column of the predictor matrix.
+  //! The values are computed on first use and shared by all copies of the data container.
+  //! Only valid as long as the PredictorResponseData object is in scope and the predictor matrix is not changed.
+  //!
+  //! @return constant reference to the vector of the largest absolute values.
+  const arma::vec& column_max_abs() const {
+    return CachedNorms(&NormCache::column_max_abs, [this]() {
+      arma::vec column_max_abs(n_pred_);
+      for (arma::uword j = 0; j < n_pred_; ++j) {
+        column_max_abs[j] = (n_obs_ > 0) ? arma::norm(x_.col(j), "inf") : 0.;
+      }
+      return column_max_abs;
+    });
+  }
+
+  //! Get an upper bound on the spectral norm of the predictor matrix, given by the minimum of the 1- and the
+  //! infinity-norm of the matrix.
+  //!
+  //! @return the upper bound on the spectral norm of the predictor matrix.
+  double pred_norm_bound() const {
+    if (n_obs_ == 0 || n_pred_ == 0) {
+      return 0;
+    }
+    return std::min(arma::max(row_norms()), arma::max(column_norms()));
+  }
+
   //! Get the number of observations in this data set.
   arma::uword n_obs() const noexcept {
     return n_obs_;
@@ -151,11 +342,103 @@ class PredictorResponseData {
   }
 
  private:
+  //! Norms of the predictor matrix, shared by all copies of the data container with the same ID.
+  struct NormCache {
+    std::shared_ptr<const arma::vec> row_norms;
+    std::shared_ptr<const arma::vec> column_norms;
+    std::shared_ptr<const arma::vec> column_sums;
+    std::shared_ptr<const arma::vec> column_max_abs;
+  };
+
+  //! Initialize predictor-response data as a read-only view of the given predictors, owning the given response.
+  //! @note the predictors are not copied! They must remain valid and unchanged for the lifetime of the data container.
+  //!
+  //! @param x_mem pointer to the predictor values in column-major order.
+  //! @param other_y response vector to move into the data container. Must have `n_obs` elements.
+  //! @param n_obs number of observations.
+  //! @param n_pred number of predictors.
+  PredictorResponseData(const double* x_mem, arma::vec&& other_y, const arma::uword n_obs,
+                        const arma::uword n_pred) noexcept
+    : x_(const_cast<double*>(x_mem), n_obs, n_pred, false, true), y_(std::move(other_y)),
+      n_obs_(n_obs), n_pred_(n_pred), norms_(std::make_shared<NormCache>()) {}
+
+  //! Derive the column sums of this subset of the observations in `source` by adjusting the column sums of `source`
+  //! for the observations whose multiplicity in the subset is not one, i.e., left-out and repeated observations.
+  //! Only done if the column sums of `source` are already computed and fewer observations need to be adjusted than
+  //! the subset contains.
+  //!
+  //! @param source the data the subset is taken from.
+  //! @param indices the indices of the observations in the subset, possibly repeated.
+  void DeriveColumnSums(const PredictorResponseData& source, const arma::uvec& indices) {
+    std::shared_ptr<const arma::vec> source_sums;
+    #pragma omp critical(nsoptim_data_norms)
+    {
+      source_sums = source.norms_->column_sums;
+    }
+    if (!source_sums) {
+      return;
+    }
+    std::vector<arma::uword> multiplicity(source.n_obs_, 0);
+    for (const arma::uword index : indices) {
+      ++multiplicity[index];
+    }
+    std::vector<arma::uword> adjusted;
+    for (arma::uword i = 0; i < source.n_obs_; ++i) {
+      if (multiplicity[i] != 1) {
+        adjusted.push_back(i);
+      }
+    }
+    if (adjusted.size() >= indices.n_elem) {
+      return;
+    }
+    arma::vec sums = *source_sums;
+    for (arma::uword j = 0; j < source.n_pred_; ++j) {
+      const double* const column = source.x_.colptr(j);
+      for (const arma::uword i : adjusted) {
+        sums[j] += (static_cast<double>(multiplicity[i]) - 1.) * column[i];
+      }
+    }
+    norms_->column_sums = std::make_shared<const arma::vec>(std::move(sums));
+  }
+
+  //! Renew the ID of this data container and detach it from the cached norms of the previous data.
+  void RenewId() {
+    id_ = ObjectId();
+    predictors_id_ = id_;
+    norms_ = std::make_shared<NormCache>();
+  }
+
+  //! Get the cached norms, computing them with `compute` if they are not yet available.
+  //! The norms are computed outside of the critical section, hence several threads may compute them concurrently,
+  //! but only the first result is retained.
+  template<typename Compute>
+  const arma::vec& CachedNorms(std::shared_ptr<const arma::vec> NormCache::* entry, Compute compute) const {
+    std::shared_ptr<const arma::vec> norms;
+    #pragma omp critical(nsoptim_data_norms)
+    {
+      norms = (*norms_).*entry;
+    }
+    if (!norms) {
+      auto computed = std::make_shared<const arma::vec>(compute());
+      #pragma omp critical(nsoptim_data_norms)
+      {
+        auto&& cached = (*norms_).*entry;
+        if (!cached) {
+          cached = std::move(computed);
+        }
+        norms = cached;
+      }
+    }
+    return *norms;
+  }
+
   ObjectId id_;
+  ObjectId predictors_id_ = id_;
   arma::mat x_;
   arma::vec y_;
   arma::uword n_obs_;   //< The number of observations in the data.
   arma::uword n_pred_;  //< The number of variables in the data.
+  std::shared_ptr<NormCache> norms_;
 };
 
 }  // namespace nsoptim
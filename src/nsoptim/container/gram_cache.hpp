@@ -0,0 +1,121 @@
+//
+//  gram_cache.hpp
+//  nsoptim
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef NSOPTIM_CONTAINER_GRAM_CACHE_HPP_
+#define NSOPTIM_CONTAINER_GRAM_CACHE_HPP_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "../armadillo.hpp"
+#include "../utilities.hpp"
+#include "data.hpp"
+
+namespace nsoptim {
+//! A program-wide cache of the Gram matrices of predictor-response data.
+//! The Gram matrices are identified by the predictors ID of the data and are shared read-only by all optimizers working
+//! on the same data. A Gram matrix is kept only as long as at least one optimizer holds a reference to it, i.e.,
+//! the cache does not extend the lifetime of any Gram matrix.
+//! The cache can be used concurrently from several threads. The Gram matrix is computed outside of the critical
+//! section, hence Gram matrices for different data can be computed in parallel.
+class GramCache {
+ public:
+  using GramPtr = std::shared_ptr<const arma::mat>;
+
+  //! Get the Gram matrix `X'X` of the predictors in the given data.
+  //!
+  //! @param data the predictor-response data.
+  //! @return a shared pointer to the Gram matrix.
+  static GramPtr Gram(const PredictorResponseData& data) {
+    return Get(data, false);
+  }
+
+  //! Get the Gram matrix `X'X` of the predictors in the given data, but only if it is already cached.
+  //!
+  //! @param data the predictor-response data.
+  //! @return a shared pointer to the Gram matrix or an empty pointer if the Gram matrix is not cached.
+  static GramPtr Find(const PredictorResponseData& data) {
+    GramPtr gram;
+    #pragma omp critical(nsoptim_gram_cache)
+    {
+      const auto it = storage().find(Key(data.predictors_id().hash(), false));
+      if (it != storage().end()) {
+        gram = it->second.lock();
+      }
+    }
+    return gram;
+  }
+
+  //! Get the Gram matrix of the centered predictors in the given data, i.e., `(X - 1 m')'(X - 1 m')` with `m` the
+  //! column means of `X`.
+  //!
+  //! @param data the predictor-response data.
+  //! @return a shared pointer to the Gram matrix of the centered predictors.
+  static GramPtr CenteredGram(const PredictorResponseData& data) {
+    return Get(data, true);
+  }
+
+ private:
+  using Key = std::pair<std::size_t, bool>;
+  using Storage = std::map<Key, std::weak_ptr<const arma::mat>>;
+
+  static Storage& storage() {
+    static Storage storage;
+    return storage;
+  }
+
+  static GramPtr Get(const PredictorResponseData& data, const bool centered) {
+    const Key key(data.predictors_id().hash(), centered);
+    GramPtr gram;
+
+    #pragma omp critical(nsoptim_gram_cache)
+    {
+      const auto it = storage().find(key);
+      if (it != storage().end()) {
+        gram = it->second.lock();
+      }
+    }
+
+    if (gram) {
+      return gram;
+    }
+
+    if (centered) {
+      const arma::mat centered_x = data.cx().each_row() - arma::mean(data.cx(), 0);
+      gram = std::make_shared<const arma::mat>(centered_x.t() * centered_x);
+    } else {
+      gram = std::make_shared<const arma::mat>(data.cx().t() * data.cx());
+    }
+
+    #pragma omp critical(nsoptim_gram_cache)
+    {
+      Storage& entries = storage();
+      // Drop entries of Gram matrices which are no longer used by any optimizer.
+      for (auto it = entries.begin(); it != entries.end(); ) {
+        if (it->second.expired()) {
+          it = entries.erase(it);
+        } else {
+          ++it;
+        }
+      }
+      auto&& entry = entries[key];
+      // Another thread may have computed the same Gram matrix in the meantime.
+      GramPtr existing = entry.lock();
+      if (existing) {
+        gram = std::move(existing);
+      } else {
+        entry = gram;
+      }
+    }
+    return gram;
+  }
+};
+}  // namespace nsoptim
+
+#endif  // NSOPTIM_CONTAINER_GRAM_CACHE_HPP_
@@ -0,0 +1,310 @@
+//
+//  kernel_counters.hpp
+//  nsoptim
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef NSOPTIM_CONTAINER_KERNEL_COUNTERS_HPP_
+#define NSOPTIM_CONTAINER_KERNEL_COUNTERS_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include "../config.hpp"
+
+#if defined(NSOPTIM_PERF_COUNTERS) && defined(__linux__)
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+# include <cstring>
+# define NSOPTIM_HAVE_PERF_EVENTS 1
+#endif
+
+namespace nsoptim {
+//! Hardware events counted around the numerical kernels.
+enum class HardwareEvent {
+  kCycles = 0,  //!< CPU cycles.
+  kInstructions = 1,  //!< Retired instructions.
+  kCacheMisses = 2,  //!< Misses in the last-level cache.
+  kBranchMisses = 3,  //!< Mispredicted branches.
+  kCount = 4
+};
+
+//! Numerical kernels which can be counted.
+enum class Kernel {
+  kMscale = 0,  //!< Solving the M-scale equation.
+  kRhoBisquareSum = 1,  //!< Sums of the bisquare rho function.
+  kRhoBisquareDerivative = 2,  //!< Derivatives of the bisquare rho function.
+  kRhoBisquareWeight = 3,  //!< Weights of the bisquare rho function.
+  kCdSweep = 4,  //!< Sweeps of the coordinate descent algorithm for LS-EN.
+  kCdPenseSweep = 5,  //!< Sweeps of the coordinate descent algorithm for PENSE.
+  kAdmmIteration = 6,  //!< Iterations of the ADMM algorithms.
+  kEnpyComputeLoo = 7,  //!< Leave-one-out fits for the Principal Sensitivity Components.
+  kRandomSubsetCandidate = 8,  //!< Candidates for the initial estimates from random subsets.
+  kCount = 9
+};
+
+namespace kernel_counters {
+//! Number of kernels.
+constexpr std::size_t kNumKernels = static_cast<std::size_t>(Kernel::kCount);
+//! Names of the kernels in the reports, in the order of `Kernel`.
+constexpr char const * kKernelNames[] = { "mscale", "rho_bisquare_sum", "rho_bisquare_derivative",
+                                          "rho_bisquare_weight", "cd_sweep", "cd_pense_sweep", "admm_iteration",
+                                          "enpy_compute_loo", "random_subset_candidate" };
+
+//! Number of hardware events.
+constexpr std::size_t kNumEvents = static_cast<std::size_t>(HardwareEvent::kCount);
+//! Names of the hardware events in the reports, in the order of `HardwareEvent`.
+constexpr char const * kEventNames[] = { "cycles", "instructions", "llc_misses", "branch_misses" };
+
+//! Counts of all hardware events.
+using EventCounts = std::array<std::uint64_t, kNumEvents>;
+
+//! The hardware events of the calling thread, read as a single group such that all events cover the same interval.
+//! The events are opened when a thread first reads them and closed when the thread ends. If the events are not
+//! available, e.g., because the platform does not support them or the kernel does not permit unprivileged access,
+//! reading them always fails.
+class ThreadEvents {
+ public:
+  ThreadEvents() noexcept {
+    group_fd_ = -1;
+#ifdef NSOPTIM_HAVE_PERF_EVENTS
+    constexpr std::uint64_t kConfigs[] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                           PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+    for (std::size_t i = 0; i < kNumEvents; ++i) {
+      struct perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = kConfigs[i];
+      attr.read_format = PERF_FORMAT_GROUP;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      const int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd_, 0));
+      if (fd < 0) {
+        Close();
+        return;
+      }
+      fds_[i] = fd;
+      if (i == 0) {
+        group_fd_ = fd;
+      }
+    }
+    ioctl(group_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+  }
+
+  ThreadEvents(const ThreadEvents&) = delete;
+  ThreadEvents& operator=(const ThreadEvents&) = delete;
+
+  ~ThreadEvents() noexcept {
+    Close();
+  }
+
+  //! Check if the hardware events are available on the calling thread.
+  bool available() const noexcept {
+    return group_fd_ >= 0;
+  }
+
+  //! Read the current counts of all events.
+  //!
+  //! @param counts Out. The current counts.
+  //! @return `true` if the counts could be read, `false` otherwise.
+  bool Read(EventCounts* counts) const noexcept {
+#ifdef NSOPTIM_HAVE_PERF_EVENTS
+    if (group_fd_ >= 0) {
+      // With PERF_FORMAT_GROUP, the number of events precedes the counts.
+      std::uint64_t buffer[kNumEvents + 1];
+      if (read(group_fd_, buffer, sizeof(buffer)) == static_cast<ssize_t>(sizeof(buffer))) {
+        std::copy(buffer + 1, buffer + kNumEvents + 1, counts->begin());
+        return true;
+      }
+    }
+#endif
+    return false;
+  }
+
+  //! Get the events of the calling thread.
+  static const ThreadEvents& Instance() {
+    static thread_local ThreadEvents events;
+    return events;
+  }
+
+ private:
+  void Close() noexcept {
+#ifdef NSOPTIM_HAVE_PERF_EVENTS
+    for (auto&& fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+#endif
+    group_fd_ = -1;
+  }
+
+  std::array<int, kNumEvents> fds_ {{ -1, -1, -1, -1 }};
+  int group_fd_;
+};
+}  // namespace kernel_counters
+
+//! Process-wide totals of the wall-clock time and the hardware events spent in the numerical kernels, e.g., the
+//! M-scale solver or the sweeps of a coordinate descent algorithm.
+//! The kernels are counted only while counting is enabled at runtime and if the hardware counters are enabled at
+//! compile time (by defining `NSOPTIM_PERF_COUNTERS`). Otherwise, counting a kernel costs nothing or a single
+//! branch. Kernels can be counted concurrently from several threads. Every thread adds to its own totals, which are
+//! only merged when the totals are reported. Nested kernels are counted in both kernels.
+class KernelCounters {
+ public:
+  //! Totals of a single kernel.
+  struct Totals {
+    int count = 0;  //!< Number of times the kernel was counted.
+    int threads = 0;  //!< Number of threads which executed the kernel.
+    double wall_time = 0;  //!< Total wall-clock time, in seconds.
+    bool events_available = true;  //!< Whether the hardware events were counted for every call of the kernel.
+    kernel_counters::EventCounts events {};  //!< Total counts of the hardware events.
+  };
+
+  //! Get the process-wide counters.
+  static KernelCounters& Instance() {
+    static KernelCounters counters;
+    return counters;
+  }
+
+  //! Check if the kernels are counted.
+  bool enabled() const noexcept {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  //! Enable or disable counting the kernels. Enabling the counters discards all previous totals.
+  //! Must not be called while kernels are counted.
+  //!
+  //! @param enabled whether to enable counting the kernels.
+  //! @return `true` if the hardware events are available on the calling thread.
+  bool Enable(const bool enabled) {
+    if (enabled) {
+      #pragma omp critical(nsoptim_kernel_counters)
+      for (auto&& thread_totals : thread_totals_) {
+        thread_totals.fill(Totals());
+      }
+    }
+    enabled_ = NSOPTIM_PERF_COUNTERS_ENABLED && enabled;
+    return kernel_counters::ThreadEvents::Instance().available();
+  }
+
+  //! Add a single call of a kernel to the totals of the calling thread.
+  //!
+  //! @param kernel the kernel.
+  //! @param wall_time the wall-clock time spent in the kernel, in seconds.
+  //! @param events the counts of the hardware events, or `nullptr` if they are not available.
+  void Add(const Kernel kernel, const double wall_time, const kernel_counters::EventCounts* events) {
+    auto& totals = ThreadTotals()[static_cast<std::size_t>(kernel)];
+    ++totals.count;
+    totals.wall_time += wall_time;
+    if (events) {
+      for (std::size_t i = 0; i < kernel_counters::kNumEvents; ++i) {
+        totals.events[i] += (*events)[i];
+      }
+    } else {
+      totals.events_available = false;
+    }
+  }
+
+  //! Merge the totals of all threads for a kernel. Must not be called while kernels are counted.
+  //!
+  //! @param kernel the kernel.
+  //! @return the totals of the kernel.
+  Totals totals(const Kernel kernel) const noexcept {
+    Totals merged;
+    for (auto&& thread_totals : thread_totals_) {
+      const auto& totals = thread_totals[static_cast<std::size_t>(kernel)];
+      if (totals.count > 0) {
+        ++merged.threads;
+        merged.count += totals.count;
+        merged.wall_time += totals.wall_time;
+        merged.events_available = merged.events_available && totals.events_available;
+        for (std::size_t i = 0; i < kernel_counters::kNumEvents; ++i) {
+          merged.events[i] += totals.events[i];
+        }
+      }
+    }
+    return merged;
+  }
+
+ private:
+  using KernelTotals = std::array<Totals, kernel_counters::kNumKernels>;
+
+  KernelCounters() noexcept : enabled_(false) {}
+
+  //! Get the totals of the calling thread. The totals are created when the thread first counts a kernel and are
+  //! owned by the counters, hence they remain available for reporting after the thread ends.
+  KernelTotals& ThreadTotals() {
+    static thread_local KernelTotals* thread_totals = nullptr;
+    if (!thread_totals) {
+      #pragma omp critical(nsoptim_kernel_counters)
+      {
+        thread_totals_.emplace_back();
+        thread_totals = &thread_totals_.back();
+      }
+    }
+    return *thread_totals;
+  }
+
+  std::atomic<bool> enabled_;
+  //! The totals of every thread. Elements of a deque are not moved when new elements are added.
+  std::deque<KernelTotals> thread_totals_;
+};
+
+//! Count the wall-clock time and the hardware events from construction until destruction and add them to the totals
+//! of a kernel. The hardware events only include the events of the thread constructing the counter.
+class ScopedKernelCounter {
+  using Clock = std::chrono::steady_clock;
+
+ public:
+  //! Start counting a kernel.
+  //!
+  //! @param kernel the kernel.
+  explicit ScopedKernelCounter(const Kernel kernel) noexcept
+      : kernel_(kernel), active_(NSOPTIM_PERF_COUNTERS_ENABLED && KernelCounters::Instance().enabled()) {
+    if (active_) {
+      has_events_ = kernel_counters::ThreadEvents::Instance().Read(&start_events_);
+      start_ = Clock::now();
+    }
+  }
+
+  ScopedKernelCounter(const ScopedKernelCounter&) = delete;
+  ScopedKernelCounter& operator=(const ScopedKernelCounter&) = delete;
+
+  ~ScopedKernelCounter() {
+    if (active_) {
+      const std::chrono::duration<double> wall_time = Clock::now() - start_;
+      kernel_counters::EventCounts events;
+      if (has_events_ && kernel_counters::ThreadEvents::Instance().Read(&events)) {
+        for (std::size_t i = 0; i < kernel_counters::kNumEvents; ++i) {
+          events[i] -= start_events_[i];
+        }
+        KernelCounters::Instance().Add(kernel_, wall_time.count(), &events);
+      } else {
+        KernelCounters::Instance().Add(kernel_, wall_time.count(), nullptr);
+      }
+    }
+  }
+
+ private:
+  const Kernel kernel_;
+  const bool active_;
+  bool has_events_ = false;
+  kernel_counters::EventCounts start_events_;
+  Clock::time_point start_;
+};
+}  // namespace nsoptim
+
+#endif  // NSOPTIM_CONTAINER_KERNEL_COUNTERS_HPP_
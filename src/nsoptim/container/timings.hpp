@@ -0,0 +1,258 @@
+//
+//  timings.hpp
+//  nsoptim
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef NSOPTIM_CONTAINER_TIMINGS_HPP_
+#define NSOPTIM_CONTAINER_TIMINGS_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <ctime>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "../armadillo.hpp"
+#include "../config.hpp"
+#include "metrics.hpp"
+
+namespace nsoptim {
+namespace timings {
+//! Get the CPU time consumed by the calling thread, in seconds.
+//! If the platform does not provide per-thread CPU clocks, the CPU time of the process is returned.
+inline double ThreadCpuTime() noexcept {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  struct timespec now;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == 0) {
+    return now.tv_sec + 1e-9 * now.tv_nsec;
+  }
+#endif
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+//! Number of bytes occupied by the elements of a dense matrix, column or row.
+template<typename T>
+std::size_t MemoryBytes(const arma::Mat<T>& x) noexcept {
+  return x.n_elem * sizeof(T);
+}
+
+//! Number of bytes occupied by the non-zero elements and the indices of a sparse matrix or column.
+template<typename T>
+std::size_t MemoryBytes(const arma::SpMat<T>& x) noexcept {
+  return x.n_nonzero * (sizeof(T) + sizeof(arma::uword)) + (x.n_cols + 1) * sizeof(arma::uword);
+}
+}  // namespace timings
+
+//! Accumulated wall-clock and CPU time of named phases of a computation, together with the memory held by the major
+//! containers allocated in each phase.
+//! Timings and memory can be added concurrently from several threads.
+class PhaseTimings {
+ public:
+  //! Timing of a single phase.
+  struct Timing {
+    int count = 0;  //!< Number of times the phase was timed.
+    double wall_time = 0;  //!< Total wall-clock time, in seconds.
+    double cpu_time = 0;  //!< Total CPU time of the threads executing the phase, in seconds.
+  };
+
+  //! Memory accounted to a single phase.
+  struct Memory {
+    int count = 0;  //!< Number of accounted allocations.
+    double total_bytes = 0;  //!< Total number of bytes allocated.
+    std::size_t current_bytes = 0;  //!< Number of bytes currently held.
+    std::size_t peak_bytes = 0;  //!< High-water mark of the number of bytes held at the same time.
+  };
+
+  //! Add the time spent in a phase.
+  //!
+  //! @param phase the name of the phase.
+  //! @param wall_time the wall-clock time, in seconds.
+  //! @param cpu_time the CPU time, in seconds.
+  void Add(const std::string& phase, const double wall_time, const double cpu_time) {
+    #pragma omp critical(nsoptim_phase_timings)
+    {
+      auto& timing = timings_[phase];
+      ++timing.count;
+      timing.wall_time += wall_time;
+      timing.cpu_time += cpu_time;
+    }
+  }
+
+  //! Account for memory allocated in a phase by the calling thread.
+  //!
+  //! @param phase the name of the phase.
+  //! @param bytes the number of bytes allocated.
+  void AllocateMemory(const std::string& phase, const std::size_t bytes) {
+    const auto thread_id = std::this_thread::get_id();
+    #pragma omp critical(nsoptim_phase_timings)
+    {
+      auto& memory = memory_[phase];
+      ++memory.count;
+      memory.total_bytes += bytes;
+      memory.current_bytes += bytes;
+      memory.peak_bytes = std::max(memory.peak_bytes, memory.current_bytes);
+
+      auto& thread_memory = thread_memory_[thread_id];
+      thread_memory.current_bytes += bytes;
+      thread_memory.peak_bytes = std::max(thread_memory.peak_bytes, thread_memory.current_bytes);
+
+      current_bytes_ += bytes;
+      peak_bytes_ = std::max(peak_bytes_, current_bytes_);
+    }
+  }
+
+  //! Account for memory released in a phase. The memory must have been accounted for with `AllocateMemory()` by
+  //! the same thread.
+  //!
+  //! @param phase the name of the phase.
+  //! @param bytes the number of bytes released.
+  void ReleaseMemory(const std::string& phase, const std::size_t bytes) {
+    const auto thread_id = std::this_thread::get_id();
+    #pragma omp critical(nsoptim_phase_timings)
+    {
+      auto& memory = memory_[phase];
+      memory.current_bytes -= std::min(bytes, memory.current_bytes);
+      auto& thread_memory = thread_memory_[thread_id];
+      thread_memory.current_bytes -= std::min(bytes, thread_memory.current_bytes);
+      current_bytes_ -= std::min(bytes, current_bytes_);
+    }
+  }
+
+  //! Access the timings of all phases.
+  const std::map<std::string, Timing>& Timings() const noexcept {
+    return timings_;
+  }
+
+  //! Access the memory accounted to all phases.
+  const std::map<std::string, Memory>& MemoryUsage() const noexcept {
+    return memory_;
+  }
+
+  //! High-water mark of the number of bytes held at the same time, over all phases and threads.
+  std::size_t PeakMemory() const noexcept {
+    return peak_bytes_;
+  }
+
+  //! Add the timings and the memory usage as compact tables to a collection of metrics.
+  //! The timings are a sub-collection named `timings` with one sub-collection per phase. The memory usage is
+  //! a sub-collection named `memory` with the overall high-water mark, the largest high-water mark of a single thread,
+  //! and one sub-collection per phase.
+  //!
+  //! @param metrics the collection of metrics to add the timings to.
+  template<typename MetricsType>
+  void Report(MetricsType* metrics) const {
+    if (!timings_.empty()) {
+      auto&& timings_metrics = metrics->CreateSubMetrics("timings");
+      for (auto&& phase : timings_) {
+        auto&& phase_metrics = timings_metrics.CreateSubMetrics(phase.first);
+        phase_metrics.AddMetric("count", phase.second.count);
+        phase_metrics.AddMetric("wall_time", phase.second.wall_time);
+        phase_metrics.AddMetric("cpu_time", phase.second.cpu_time);
+      }
+    }
+    if (!memory_.empty()) {
+      std::size_t thread_peak_bytes = 0;
+      for (auto&& thread : thread_memory_) {
+        thread_peak_bytes = std::max(thread_peak_bytes, thread.second.peak_bytes);
+      }
+      auto&& memory_metrics = metrics->CreateSubMetrics("memory");
+      memory_metrics.AddMetric("peak_bytes", static_cast<double>(peak_bytes_));
+      memory_metrics.AddMetric("thread_peak_bytes", static_cast<double>(thread_peak_bytes));
+      memory_metrics.AddMetric("threads", static_cast<int>(thread_memory_.size()));
+      for (auto&& phase : memory_) {
+        auto&& phase_metrics = memory_metrics.CreateSubMetrics(phase.first);
+        phase_metrics.AddMetric("count", phase.second.count);
+        phase_metrics.AddMetric("total_bytes", phase.second.total_bytes);
+        phase_metrics.AddMetric("peak_bytes", static_cast<double>(phase.second.peak_bytes));
+      }
+    }
+  }
+
+ private:
+  std::map<std::string, Timing> timings_;
+  std::map<std::string, Memory> memory_;
+  std::map<std::thread::id, Memory> thread_memory_;
+  std::size_t current_bytes_ = 0;
+  std::size_t peak_bytes_ = 0;
+};
+
+//! Measure the wall-clock and CPU time from construction until destruction and add it to the timings of a phase.
+//! Timers can be nested. The CPU time only includes the time of the thread constructing the timer. Work delegated
+//! to other threads must be timed separately.
+class ScopedPhaseTimer {
+  using Clock = std::chrono::steady_clock;
+
+ public:
+  //! Start timing a phase.
+  //!
+  //! @param timings the timings to add the phase to. If `nullptr` or if metrics are disabled, nothing is timed.
+  //! @param phase the name of the phase.
+  ScopedPhaseTimer(PhaseTimings* timings, const char* phase) noexcept
+      : timings_(NSOPTIM_METRICS_LEVEL > 0 ? timings : nullptr), phase_(phase) {
+    if (timings_) {
+      wall_start_ = Clock::now();
+      cpu_start_ = timings::ThreadCpuTime();
+    }
+  }
+
+  ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+  ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+  ~ScopedPhaseTimer() {
+    if (timings_) {
+      const std::chrono::duration<double> wall_time = Clock::now() - wall_start_;
+      timings_->Add(phase_, wall_time.count(), timings::ThreadCpuTime() - cpu_start_);
+    }
+  }
+
+ private:
+  PhaseTimings* const timings_;
+  const char* const phase_;
+  Clock::time_point wall_start_;
+  double cpu_start_ = 0;
+};
+
+//! Account for memory held by a container from construction until destruction.
+//! The memory is accounted to the phase and to the thread constructing the account.
+class ScopedMemoryAccount {
+ public:
+  //! Account for memory held in a phase.
+  //!
+  //! @param timings the timings to account the memory to. If `nullptr` or if metrics are disabled, nothing is
+  //!                accounted.
+  //! @param phase the name of the phase.
+  //! @param bytes the number of bytes initially held.
+  ScopedMemoryAccount(PhaseTimings* timings, const char* phase, const std::size_t bytes = 0)
+      : timings_(NSOPTIM_METRICS_LEVEL > 0 ? timings : nullptr), phase_(phase) {
+    Add(bytes);
+  }
+
+  ScopedMemoryAccount(const ScopedMemoryAccount&) = delete;
+  ScopedMemoryAccount& operator=(const ScopedMemoryAccount&) = delete;
+
+  ~ScopedMemoryAccount() {
+    if (timings_ && bytes_ > 0) {
+      timings_->ReleaseMemory(phase_, bytes_);
+    }
+  }
+
+  //! Account for additional memory held until destruction.
+  void Add(const std::size_t bytes) {
+    if (timings_ && bytes > 0) {
+      timings_->AllocateMemory(phase_, bytes);
+      bytes_ += bytes;
+    }
+  }
+
+ private:
+  PhaseTimings* const timings_;
+  const char* const phase_;
+  std::size_t bytes_ = 0;
+};
+}  // namespace nsoptim
+
+#endif  // NSOPTIM_CONTAINER_TIMINGS_HPP_
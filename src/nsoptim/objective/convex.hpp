@@ -21,6 +21,11 @@ class ConvexFunction {
   Function& GetConvexSurrogate(const T&) {
     return static_cast<Function&>(*this);
   }
+
+  template<typename T>
+  void UpdateConvexSurrogate(const T&, Function* surrogate) {
+    *surrogate = static_cast<Function&>(*this);
+  }
 };
 
 }  // namespace nsoptim
@@ -10,6 +10,8 @@
 #define NSOPTIM_OBJECTIVE_LS_REGRESSION_LOSS_HPP_
 
 #include <algorithm>
+#include <cmath>
+#include <memory>
 
 #include "../armadillo.hpp"
 #include "../utilities.hpp"
@@ -23,20 +25,25 @@ namespace ls_regression_loss {
 
 //! Compute the minimum of the 1- and infinity norm of the weighted matrix :math:`W X`, where :math:`W` is a diagonal
 //! matrix with entries `sqrt_weights`.
-inline double TwoNormUpper(const arma::mat& x, const arma::vec& sqrt_weights) {
-  double norm_1 = 0, norm_inf = 0;
-
-  // Compute the inf-norm of the weighted matrix
-  for (arma::uword i = 0; i < x.n_rows; ++i) {
-    const double tmp = sqrt_weights[i] * arma::norm(x.row(i), 1);
-    if (tmp > norm_inf) {
-      norm_inf = tmp;
-    }
+//!
+//! @param data the data with predictor matrix `X`.
+//! @param sqrt_weights the diagonal of :math:`W`.
+inline double TwoNormUpper(const PredictorResponseData& data, const arma::vec& sqrt_weights) {
+  if (data.n_obs() == 0 || data.n_pred() == 0) {
+    return 0;
   }
+  // The inf-norm of the weighted matrix only requires the cached row norms.
+  const double norm_inf = arma::max(sqrt_weights % data.row_norms());
 
   // Compute the 1-norm of the weighted matrix
+  const arma::mat& x = data.cx();
+  double norm_1 = 0;
   for (arma::uword j = 0; j < x.n_cols; ++j) {
-    const double tmp = arma::norm(sqrt_weights % x.col(j), 1);
+    const double* const col = x.colptr(j);
+    double tmp = 0;
+    for (arma::uword i = 0; i < x.n_rows; ++i) {
+      tmp += sqrt_weights[i] * std::abs(col[i]);
+    }
     if (tmp > norm_1) {
       norm_1 = tmp;
     }
@@ -72,7 +79,7 @@ class WeightedLsRegressionLoss : public LossFunction<PredictorResponseData>,
   WeightedLsRegressionLoss(std::shared_ptr<const PredictorResponseData> data, std::shared_ptr<const arma::vec> weights,
                  const bool include_intercept = true) noexcept
       : include_intercept_(include_intercept), data_(data), mean_weight_(arma::mean(*weights)),
-        sqrt_weights_(std::make_shared<const arma::vec>(arma::sqrt(*weights / mean_weight_))),
+        sqrt_weights_(std::make_shared<arma::vec>(arma::sqrt(*weights / mean_weight_))),
         weighted_pred_norm_(-1) {}
 
   //! Initialize a weighted LS regression loss.
@@ -176,7 +183,7 @@ class WeightedLsRegressionLoss : public LossFunction<PredictorResponseData>,
   template<typename T>
   double Difference(const RegressionCoefficients<T>& x, const RegressionCoefficients<T>& y) const {
     const double weighted_pred_norm = (weighted_pred_norm_ < 0) ?
-      ls_regression_loss::TwoNormUpper(data_->cx(), *sqrt_weights_) : weighted_pred_norm_;
+      ls_regression_loss::TwoNormUpper(*data_, *sqrt_weights_) : weighted_pred_norm_;
     return std::sqrt(sqrt_weights_->n_elem * mean_weight_) * std::abs(x.intercept - y.intercept) +
       weighted_pred_norm * arma::norm(x.beta - y.beta, 2);
   }
@@ -200,7 +207,7 @@ class WeightedLsRegressionLoss : public LossFunction<PredictorResponseData>,
   template<typename T>
   double Difference(const RegressionCoefficients<T>& x, const RegressionCoefficients<T>& y) {
     if (weighted_pred_norm_ < 0) {
-      weighted_pred_norm_ = ls_regression_loss::TwoNormUpper(data_->cx(), *sqrt_weights_);
+      weighted_pred_norm_ = ls_regression_loss::TwoNormUpper(*data_, *sqrt_weights_);
     }
     return std::sqrt(sqrt_weights_->n_elem * mean_weight_) * std::abs(x.intercept - y.intercept) +
       weighted_pred_norm_ * arma::norm(x.beta - y.beta, 2);
@@ -223,6 +230,21 @@ class WeightedLsRegressionLoss : public LossFunction<PredictorResponseData>,
     return GradientType<T>(0, -arma::mean(data_->cx().each_col() % neg_weighted_residuals, 0));
   }
 
+  //! Replace the observation weights of this weighted LS loss function, keeping the data.
+  //! The sqrt-weights are overwritten in place if the buffer is not shared with any other loss function (e.g.,
+  //! a copy held by an optimizer), otherwise a new buffer is allocated.
+  //!
+  //! @param weights the new vector of observation weights. Must be the same length as the number of observations.
+  void UpdateWeights(const arma::vec& weights) {
+    mean_weight_ = arma::mean(weights);
+    if (sqrt_weights_.use_count() == 1 && sqrt_weights_->n_elem == weights.n_elem) {
+      *sqrt_weights_ = arma::sqrt(weights / mean_weight_);
+    } else {
+      sqrt_weights_ = std::make_shared<arma::vec>(arma::sqrt(weights / mean_weight_));
+    }
+    weighted_pred_norm_ = -1;
+  }
+
   //! Access the data used by this weighted LS loss function.
   //!
   //! @return a constant reference to this loss' data.
@@ -263,7 +285,7 @@ class WeightedLsRegressionLoss : public LossFunction<PredictorResponseData>,
   bool include_intercept_;
   std::shared_ptr<const PredictorResponseData> data_;
   double mean_weight_;
-  std::shared_ptr<const arma::vec> sqrt_weights_;
+  std::shared_ptr<arma::vec> sqrt_weights_;
   double weighted_pred_norm_;
 };
 
@@ -362,8 +384,7 @@ class LsRegressionLoss : public LossFunction<PredictorResponseData>,
   //! @return the relative difference between `x` and `y`.
   template<typename T>
   double Difference(const RegressionCoefficients<T>& x, const RegressionCoefficients<T>& y) const {
-    const double pred_norm = (pred_norm_ < 0) ? std::min(arma::norm(data_->cx(), "inf"), arma::norm(data_->cx(), 1)) :
-                                                pred_norm_;
+    const double pred_norm = (pred_norm_ < 0) ? data_->pred_norm_bound() : pred_norm_;
     return std::sqrt(data_->n_obs()) * std::abs(x.intercept - y.intercept) +
       pred_norm * arma::norm(x.beta - y.beta, 2);
   }
@@ -379,7 +400,7 @@ class LsRegressionLoss : public LossFunction<PredictorResponseData>,
   template<typename T>
   double Difference(const RegressionCoefficients<T>& x, const RegressionCoefficients<T>& y) {
     if (pred_norm_ < 0) {
-      pred_norm_ = std::min(arma::norm(data_->cx(), "inf"), arma::norm(data_->cx(), 1));
+      pred_norm_ = data_->pred_norm_bound();
     }
     return std::sqrt(data_->n_obs()) * std::abs(x.intercept - y.intercept) +
       pred_norm_ * arma::norm(x.beta - y.beta, 2);
@@ -9,15 +9,19 @@
 #ifndef NSOPTIM_OPTIMIZER_ADMM_HPP_
 #define NSOPTIM_OPTIMIZER_ADMM_HPP_
 
+#include <cmath>
 #include <string>
 #include <exception>
 #include <type_traits>
 #include <algorithm>
 #include <limits>
+#include <memory>
 
 #include "../armadillo.hpp"
 #include "../container/regression_coefficients.hpp"
 #include "../container/data.hpp"
+#include "../container/kernel_counters.hpp"
+#include "../container/gram_cache.hpp"
 #include "optimizer_base.hpp"
 #include "optimum.hpp"
 #include "../objective/ls_regression_loss.hpp"
@@ -41,25 +45,53 @@ struct AdmmVarStepConfiguration {
 struct AdmmLinearConfiguration {
   int max_it;  //!< maximum number of iterations allowed.
   double accelerate;  //!< acceleration factor.
+  double relaxation;  //!< over-relaxation factor in (0, 2). A value of 1 disables over-relaxation.
+  bool adaptive_step;  //!< adapt the step size to balance the primal and dual residuals.
 };
 
 namespace admm_optimizer {
 //! Default configuration for the variable-stepsize ADMM algorithm
 constexpr AdmmVarStepConfiguration kDefaultVarStepConfig { 1000, -1, 0.01, 0.98, 0.999 };
 //! Default configuration for the variable-stepsize ADMM algorithm
-constexpr AdmmLinearConfiguration kDefaultLinConfig { 1000, 1. };
+constexpr AdmmLinearConfiguration kDefaultLinConfig { 1000, 1., 1., false };
+
+//! The linearized ADMM adapts the step size if one residual is this many times larger than the other.
+constexpr double kResidualBalancingRatio = 10;
+//! Factor by which the linearized ADMM increases or decreases the step size to balance the residuals.
+constexpr double kResidualBalancingFactor = 2;
+//! Number of iterations during which the linearized ADMM adapts the step size. Afterwards, the step size is fixed
+//! to guarantee convergence.
+constexpr int kStepAdaptationIterations = 100;
 
 //! How often does the secondary convergence criterion (relative to the maximum number of iterations) need to be
 //! fulfulled to stop the linearized ADMM early.
 constexpr int kSecondCriterionMultiplier = 10;
 
+//! Number of Cholesky factorizations of `X'X + tau I` for the same data after which the variable-stepsize ADMM
+//! switches to the Eigendecomposition of `X'X`.
+constexpr int kMaxCholeskyFactorizations = 2;
+
+//! Eigendecomposition `X'X = V D V'` of the Gram matrix.
+struct GramEigen {
+  //! The Eigenvalues (diagonal of `D`).
+  arma::vec values;
+  //! The Eigenvectors (columns of `V`).
+  arma::mat vectors;
+};
+
 // Data cache for inner-products that don't change (often)
+// The matrices are never modified in place, hence they are shared by copies of the optimizer.
 struct DataCache {
-  arma::mat xtx;
+  GramCache::GramPtr xtx;
   arma::vec xty;
   arma::vec xtwgt;
   double chol_xtx_tau;
-  arma::mat chol_xtx;
+  //! Cholesky factor of `X'X + tau I` with `tau = chol_xtx_tau`.
+  std::shared_ptr<const arma::mat> chol_xtx;
+  //! Number of Cholesky factorizations computed for the current data.
+  int cholesky_factorizations = 0;
+  //! Eigendecomposition of `X'X`. Empty if the Eigendecomposition is not (yet) available.
+  std::shared_ptr<const GramEigen> xtx_eigen;
 };
 
 //! Check whether any of the predictors in `x` violates the KKT conditions for a EN-type problem.
@@ -559,8 +591,10 @@ class GenericLinearizedAdmmOptimizer : public Optimizer<typename ProxOp::LossFun
     operator_scaling_f_ = prox_.OperatorScaling();  // this is (1/beta) in Deng & Yin (2016)
     const double scaled_lambda = penalty_->lambda() * prox_.PenaltyScaling();
 
-    const auto en_cutoff = DetermineCutoff(scaled_lambda, IsAdaptiveTag{});
-    const auto en_multiplier = DetermineEnMultiplier(scaled_lambda, IsAdaptiveTag{});
+    auto en_cutoff = DetermineCutoff(scaled_lambda, IsAdaptiveTag{});
+    auto en_multiplier = DetermineEnMultiplier(scaled_lambda, IsAdaptiveTag{});
+    // The norm of X is only used to bound the dual residual.
+    const double norm_x = 1 / std::sqrt(operator_scaling_g_);
 
     double gap = 0;
 
@@ -580,12 +614,14 @@ class GenericLinearizedAdmmOptimizer : public Optimizer<typename ProxOp::LossFun
     metrics->AddDetail("convergence_tolerance", convergence_tolerance_);
     metrics->AddDetail("op_scaling_g", operator_scaling_g_);
     metrics->AddDetail("op_scaling_f", operator_scaling_f_);
+    metrics->AddDetail("relaxation", config_.relaxation);
 
     int iter = 0;
     State prev_state;
 
     while (iter++ < max_it) {
       Metrics& iter_metrics = metrics->CreateSubMetrics("admm-iteration");
+      ScopedKernelCounter kernel_counter(Kernel::kAdmmIteration);
       prev_state = state_;
 
       if (include_intercept) {
@@ -595,23 +631,35 @@ class GenericLinearizedAdmmOptimizer : public Optimizer<typename ProxOp::LossFun
           arma::dot(coefs_.beta, x_col_sum_) - arma::accu(state_.fitted - state_.lagrangian * operator_scaling_f_));
 
         // remember: fitted_step_1 is already fitted_step_1 - state_.fitted
-        coefs_.beta = UpdateSlope(en_multiplier, SoftThreshold(coefs_.beta, -operator_scaling_g_,
+        SoftThreshold(coefs_.beta, -operator_scaling_g_,
           intercept * x_col_sum_ + data.cx().t() * (fitted_step_1 + operator_scaling_f_ * state_.lagrangian),
-          en_cutoff));
+          en_cutoff, en_multiplier, &coefs_.beta);
       } else {
         // remember: fitted_step_1 is already fitted_step_1 - state_.fitted
-        coefs_.beta = UpdateSlope(en_multiplier, SoftThreshold(coefs_.beta, -operator_scaling_g_,
-          data.cx().t() * (fitted_step_1 + operator_scaling_f_ * state_.lagrangian), en_cutoff));
+        SoftThreshold(coefs_.beta, -operator_scaling_g_,
+          data.cx().t() * (fitted_step_1 + operator_scaling_f_ * state_.lagrangian), en_cutoff, en_multiplier,
+          &coefs_.beta);
       }
 
       fitted_step_1 = data.cx() * coefs_.beta;
 
-      state_.fitted = prox_(fitted_step_1 + state_.lagrangian * operator_scaling_f_, state_.fitted,
-                            coefs_.intercept, operator_scaling_f_, &(iter_metrics.CreateSubMetrics("prox")));
+      if (config_.relaxation != 1) {
+        // Over-relaxation: replace `X . beta + intercept` by a convex combination with the previous fitted values
+        // in the updates of the fitted values and the lagrangian. The beta-update still uses `X . beta`.
+        const arma::vec relaxed = config_.relaxation * fitted_step_1 +
+          (1 - config_.relaxation) * (prev_state.fitted - coefs_.intercept);
+        state_.fitted = prox_(relaxed + state_.lagrangian * operator_scaling_f_, state_.fitted,
+                              coefs_.intercept, operator_scaling_f_, &(iter_metrics.CreateSubMetrics("prox")));
+        state_.lagrangian += (relaxed - state_.fitted + coefs_.intercept) * config_.accelerate / operator_scaling_f_;
+        fitted_step_1 -= state_.fitted;
+      } else {
+        state_.fitted = prox_(fitted_step_1 + state_.lagrangian * operator_scaling_f_, state_.fitted,
+                              coefs_.intercept, operator_scaling_f_, &(iter_metrics.CreateSubMetrics("prox")));
 
-      // Instead of `lagrangian -= accelerate * (fitted - fitted_step_1 - intercept) / operator_scaling_f_`, do
-      fitted_step_1 -= state_.fitted;
-      state_.lagrangian += (fitted_step_1 + coefs_.intercept) * config_.accelerate / operator_scaling_f_;
+        // Instead of `lagrangian -= accelerate * (fitted - fitted_step_1 - intercept) / operator_scaling_f_`, do
+        fitted_step_1 -= state_.fitted;
+        state_.lagrangian += (fitted_step_1 + coefs_.intercept) * config_.accelerate / operator_scaling_f_;
+      }
 
       const double fitted_diff = arma::accu(arma::square(state_.fitted - prev_state.fitted));
       const double lagrangian_diff = arma::accu(arma::square(state_.lagrangian - prev_state.lagrangian));
@@ -622,7 +670,39 @@ class GenericLinearizedAdmmOptimizer : public Optimizer<typename ProxOp::LossFun
       iter_metrics.AddDetail("lagrangian_diff", lagrangian_diff);
       iter_metrics.AddDetail("gap", gap);
 
-      if (gap < convergence_tolerance_) {
+      if (config_.adaptive_step) {
+        // Squared primal residual `|X . beta + intercept - fitted|^2` and an upper bound on the squared dual
+        // residual `|X' (fitted - prev. fitted)|^2 / op_scaling_f^2`, which avoids another product with X.
+        const double primal_residual = arma::accu(arma::square(fitted_step_1 + coefs_.intercept));
+        const double dual_residual = fitted_diff * norm_x * norm_x / (operator_scaling_f_ * operator_scaling_f_);
+
+        iter_metrics.AddDetail("primal_residual", primal_residual);
+        iter_metrics.AddDetail("dual_residual", dual_residual);
+
+        gap = primal_residual + dual_residual;
+        if (gap < convergence_tolerance_) {
+          return FinalizeResult(iter, gap, state_.fitted, OptimumStatus::kOk, std::move(metrics));
+        }
+
+        // Balance the residuals by adapting the step size. The lagrangian is not scaled by the step size and hence
+        // remains valid.
+        if (iter <= admm_optimizer::kStepAdaptationIterations) {
+          constexpr double kSqRatio = admm_optimizer::kResidualBalancingRatio * admm_optimizer::kResidualBalancingRatio;
+          bool adapted = false;
+          if (primal_residual > kSqRatio * dual_residual) {
+            operator_scaling_f_ /= admm_optimizer::kResidualBalancingFactor;
+            adapted = true;
+          } else if (dual_residual > kSqRatio * primal_residual) {
+            operator_scaling_f_ *= admm_optimizer::kResidualBalancingFactor;
+            adapted = true;
+          }
+          if (adapted) {
+            en_cutoff = DetermineCutoff(scaled_lambda, IsAdaptiveTag{});
+            en_multiplier = DetermineEnMultiplier(scaled_lambda, IsAdaptiveTag{});
+            iter_metrics.AddDetail("op_scaling_f", operator_scaling_f_);
+          }
+        }
+      } else if (gap < convergence_tolerance_) {
         return FinalizeResult(iter, gap, state_.fitted, OptimumStatus::kOk, std::move(metrics));
       }
     }
@@ -673,21 +753,6 @@ class GenericLinearizedAdmmOptimizer : public Optimizer<typename ProxOp::LossFun
     return 1 / (1 + scaled_lambda * (1 - penalty_->alpha()) * operator_scaling_g_ * operator_scaling_f_);
   }
 
-  //! Update the slope coefficients for adaptive penalties
-  //!
-  template<typename T>
-  T UpdateSlope(const arma::vec& en_mult, const T& soft_thresh) const noexcept {
-    return en_mult % soft_thresh;
-  }
-
-  //! Update the slope coefficients for non-adaptive penalties
-  //!
-  //! @param scaled_lambda scaled adaptive EN penalty parameter
-  template<typename T>
-  T UpdateSlope(const double en_mult, const T& soft_thresh) const noexcept {
-    return en_mult * soft_thresh;
-  }
-
   const AdmmLinearConfiguration config_;
   ProximalOperator prox_;
   LossFunctionPtr loss_;
@@ -753,14 +818,18 @@ class AdmmVarStepOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coe
   //! Default copy constructor.
   //!
   //! The copied optimizer will use the same loss and penalty functions after construction.
+  //! The weighted data and the cached decompositions are read-only and shared with `other`, hence copying is cheap.
+  //! The data pointer remains valid, because it points either to the shared weighted data or to the data shared by
+  //! the copies of the loss function.
   AdmmVarStepOptimizer(const AdmmVarStepOptimizer& other) noexcept
       : config_(other.config_),
         loss_(other.loss_? new LossFunction(*other.loss_) : nullptr),
         penalty_(other.penalty_ ? new PenaltyFunction(*other.penalty_) : nullptr),
         coefs_(other.coefs_),
         state_(other.state_),
-        weighted_data_(other.weighted_data_ ? new PredictorResponseData(*other.weighted_data_) : nullptr),
-        data_(weighted_data_.get()),
+        weighted_data_(other.weighted_data_),
+        data_(other.data_),
+        cache_(other.cache_),
         convergence_tolerance_(other.convergence_tolerance_) {}
 
   //! Default copy assignment.
@@ -937,8 +1006,9 @@ class AdmmVarStepOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coe
     int iter = 0;
     double intercept_change = 0;
     while (iter++ < max_it) {
+      ScopedKernelCounter kernel_counter(Kernel::kAdmmIteration);
       State prev_state = state_;
-      coefs_.beta = en_multiplier * SoftThreshold(state_.v, tau_inv, state_.l, en_cutoff);
+      SoftThreshold(state_.v, tau_inv, state_.l, en_cutoff, en_multiplier, &coefs_.beta);
       if (include_intercept) {
         const double new_intercept = ComputeIntercept(IsWeightedTag{});
         intercept_change = coefs_.intercept - new_intercept;
@@ -1024,8 +1094,8 @@ class AdmmVarStepOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coe
 
   //! Update the data for a weighted LS loss
   void UpdateData(std::true_type) {
-    weighted_data_.reset(new PredictorResponseData(loss_->data().cx().each_col() % loss_->sqrt_weights(),
-                                                   loss_->data().cy() % loss_->sqrt_weights()));
+    weighted_data_ = std::make_shared<const PredictorResponseData>(
+      loss_->data().cx().each_col() % loss_->sqrt_weights(), loss_->data().cy() % loss_->sqrt_weights());
     data_ = weighted_data_.get();
     cache_.xtwgt = data_->cx().t() * loss_->sqrt_weights();
     UpdateCache();
@@ -1041,18 +1111,38 @@ class AdmmVarStepOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coe
   //! Update the cache of inner products
   void UpdateCache() {
     cache_.xty = data_->cx().t() * data_->cy();
-    cache_.xtx = data_->cx().t() * data_->cx();
+    cache_.xtx = GramCache::Gram(*data_);
+    cache_.cholesky_factorizations = 0;
+    cache_.xtx_eigen.reset();
     UpdateCholesky();
   }
 
-  //! Update the Choleskey decomposition of `X'X + tau I` for a new `tau`
+  //! Update the Choleskey decomposition of `X'X + tau I` for a new `tau`.
+  //! If `tau` changes repeatedly for the same data, the Eigendecomposition `X'X = V D V'` is computed once and the
+  //! linear systems are solved as `V (D + tau I)^-1 V' b`, without any further factorization.
   bool UpdateCholesky() {
     cache_.chol_xtx_tau = state_.tau;
     if (state_.tau > 0) {
-      cache_.chol_xtx = cache_.xtx;
-      cache_.chol_xtx.diag() += state_.tau;
+      if (cache_.xtx_eigen) {
+        return true;
+      }
+      if (cache_.cholesky_factorizations >= kMaxCholeskyFactorizations) {
+        auto eigen = std::make_shared<admm_optimizer::GramEigen>();
+        if (arma::eig_sym(eigen->values, eigen->vectors, *cache_.xtx)) {
+          // The Gram matrix is positive semi-definite. Negative Eigenvalues are only due to numerical imprecision.
+          eigen->values.elem(arma::find(eigen->values < 0)).zeros();
+          cache_.xtx_eigen = std::move(eigen);
+          return true;
+        }
+      }
+      ++cache_.cholesky_factorizations;
+      // The factor may be shared with copies of this optimizer, hence it is replaced instead of modified in place.
+      auto chol_xtx = std::make_shared<arma::mat>(*cache_.xtx);
+      chol_xtx->diag() += state_.tau;
       // Manually compute Cholesky decomposition to avoid unnecessary copying.
-      return arma::auxlib::chol_simple(cache_.chol_xtx);
+      const bool success = arma::auxlib::chol_simple(*chol_xtx);
+      cache_.chol_xtx = std::move(chol_xtx);
+      return success;
     }
     return true;
   }
@@ -1062,7 +1152,7 @@ class AdmmVarStepOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coe
     state_.v = loss_->IncludeIntercept() ?
       arma::vec(state_.tau * coefs_.beta + cache_.xty - coefs_.intercept * cache_.xtwgt) :
       arma::vec(state_.tau * coefs_.beta + cache_.xty);
-    return linalg::SolveChol(cache_.chol_xtx, &state_.v);
+    return SolveLs();
   }
 
   //! Apply the proximal operator to the vector `tau * beta + X'y - intercept w - l`
@@ -1070,7 +1160,17 @@ class AdmmVarStepOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coe
     state_.v = loss_->IncludeIntercept() ?
       arma::vec(state_.tau * coefs_.beta + cache_.xty - coefs_.intercept * cache_.xtwgt - l) :
       arma::vec(state_.tau * coefs_.beta + cache_.xty - l);
-    return linalg::SolveChol(cache_.chol_xtx, &state_.v);
+    return SolveLs();
+  }
+
+  //! Solve the linear system `(X'X + tau I) x = v` in-place, replacing `v` with `x`.
+  bool SolveLs() {
+    if (cache_.xtx_eigen) {
+      const arma::vec rotated = (cache_.xtx_eigen->vectors.t() * state_.v) / (cache_.xtx_eigen->values + state_.tau);
+      state_.v = cache_.xtx_eigen->vectors * rotated;
+      return true;
+    }
+    return linalg::SolveChol(*cache_.chol_xtx, &state_.v);
   }
 
   //! Compute the intercept for weighted LS
@@ -1129,7 +1229,7 @@ class AdmmVarStepOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coe
   PenaltyPtr penalty_;
   Coefficients coefs_;
   State state_;
-  std::unique_ptr<PredictorResponseData> weighted_data_;
+  std::shared_ptr<const PredictorResponseData> weighted_data_;
   PredictorResponseData const * data_;
   admm_optimizer::DataCache cache_;
   double convergence_tolerance_ = 1e-6;
@@ -14,11 +14,13 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <vector>
 
 #include "../armadillo.hpp"
 #include "../utilities.hpp"
 #include "../container/regression_coefficients.hpp"
 #include "../container/data.hpp"
+#include "../container/gram_cache.hpp"
 #include "optimizer_base.hpp"
 #include "optimum.hpp"
 #include "../objective/ls_regression_loss.hpp"
@@ -186,6 +188,14 @@ class LarsPath {
     chol_.UpdateMatrixDiagonal(add_gram_diagonal);
   }
 
+  //! Add a (low-rank) update to the Gram matrix.
+  //! No other manipulations are performed, hence, the path is invalid afterwards and needs to be reset with `Reset`.
+  //!
+  //! @param update symmetric matrix to add to the Gram matrix.
+  void AddToGram(const arma::mat& update) {
+    chol_.UpdateMatrix(update);
+  }
+
   //! Reset the lars path to the beginning, i.e., no active variables, but use the same Gram matrix.
   //!
   //! @param cor_y the new correlation between X and y.
@@ -275,31 +285,35 @@ class LarsPath {
   void ActivateNext() {
     auto inactive_it = inactive_.begin();
     auto inactive_drop_it = inactive_.before_begin();
+    std::vector<arma::uword> entering;
 
     while (inactive_it != inactive_.end()) {
       const arma::uword inactive_pred = *inactive_it++;
       if (max_cor_ <= std::abs(cor_y_[inactive_pred]) + std::numeric_limits<double>::epsilon()) {
         // This currently inactive predictor has maximum correlation with the response. Add it.
-        // First add it to the decomposition.
-        const bool not_singular = chol_.Add(inactive_pred);
-        if (not_singular) {
-          // No singularity. Add the variable to the active set.
-          const arma::uword new_active_index = chol_.active_size() - 1;
-          cor_signs_[new_active_index] = cor_y_[inactive_pred] < 0 ? -1. : 1.;
-          active_beta_[new_active_index] = 0;
-        } else {
-          // Singularity detected! Drop variable for good.
-          --remaining_usable_vars_;
-          if (remaining_usable_vars_ < max_active_) {
-            --max_active_;
-          }
-        }
+        entering.push_back(inactive_pred);
         // Remove element from inactive set. Ensure that `inactive_it` is incremented before erasing it!
         inactive_.erase_after(inactive_drop_it);
       } else {
         ++inactive_drop_it;
       }
     }
+
+    // Add all entering variables to the decomposition at once. Variables which would make the decomposition singular
+    // are dropped for good.
+    const arma::uword prev_active_size = chol_.active_size();
+    const arma::uword added = chol_.Add(entering.begin(), entering.end());
+    for (arma::uword new_active_index = prev_active_size; new_active_index < chol_.active_size(); ++new_active_index) {
+      const arma::uword new_pred = chol_.active()[new_active_index];
+      cor_signs_[new_active_index] = cor_y_[new_pred] < 0 ? -1. : 1.;
+      active_beta_[new_active_index] = 0;
+    }
+    for (arma::uword singular = added; singular < entering.size(); ++singular) {
+      --remaining_usable_vars_;
+      if (remaining_usable_vars_ < max_active_) {
+        --max_active_;
+      }
+    }
   }
 
   //! Compute step size in the direction of the equiangular vector.
@@ -397,6 +411,7 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
   using IsAdaptiveTag = typename traits::is_adaptive<PenaltyFunction>::type;
   using IsSparseTag = typename std::is_same<typename Coefficients::SlopeCoefficient, arma::sp_vec>::type;
   using Weights = typename std::conditional<IsWeightedTag::value, arma::vec, double>::type;
+  using RidgeType = typename std::conditional<IsAdaptiveTag::value, arma::vec, double>::type;
 
   static_assert(traits::is_en_penalty<PenaltyFunction>::value, "PenaltyFunction must be an EN-type penalty.");
   static_assert(traits::is_ls_regression_loss<LossFunction>::value, "LossFunction must be an least-squares-type loss.");
@@ -421,7 +436,8 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
     : loss_(other.loss_? new LossFunction(*other.loss_) : nullptr),
       penalty_(other.penalty_ ? new PenaltyFunction(*other.penalty_) : nullptr),
       path_(other.path_ ? new auglars::LarsPath(*other.path_) : nullptr), mean_x_(other.mean_x_),
-      mean_y_(other.mean_y_) {}
+      mean_y_(other.mean_y_), resumable_(other.resumable_), knot_max_cor_(other.knot_max_cor_),
+      knot_beta_(other.knot_beta_) {}
 
   //! Default copy assignment.
   //!
@@ -440,6 +456,7 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
     loss_.reset();
     penalty_.reset();
     path_.reset();
+    resumable_ = false;
   }
 
   //! Get the current loss function.
@@ -451,11 +468,37 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
   }
 
   //! Set the new loss function.
+  //! If the new loss function uses the same data and weights as the current loss function (e.g., if the weights in
+  //! an MM iteration did not change), the current LARS path is retained.
   void loss(const LossFunction& loss) noexcept {
-    path_.reset();
+    if (!loss_ || !IsSameLoss(loss, IsWeightedTag{})) {
+      path_.reset();
+      resumable_ = false;
+    }
     loss_.reset(new LossFunction(loss));
   }
 
+  //! Set the new loss function, where the data differs from the data of the current loss function only in a
+  //! single observation, e.g., when computing leave-one-out estimates.
+  //! Instead of re-computing the Gram matrix from the data, the Gram matrix of the current LARS path is updated
+  //! with the difference between the removed and the added observation in O(p^2) operations.
+  //!
+  //! @param loss the new loss function.
+  //! @param removed_x the predictor values of the observation removed from the current data.
+  //! @param removed_y the response value of the observation removed from the current data.
+  //! @param added_x the predictor values of the observation added to the new data.
+  //! @param added_y the response value of the observation added to the new data.
+  void ReplaceObservation(const LossFunction& loss, const arma::rowvec& removed_x, const double removed_y,
+                          const arma::rowvec& added_x, const double added_y) {
+    if (!path_ || !loss_ || !penalty_ || loss.data().n_obs() != loss_->data().n_obs()) {
+      this->loss(loss);
+    } else {
+      loss_.reset(new LossFunction(loss));
+      ReplaceObservation(removed_x, removed_y, added_x, added_y, IsWeightedTag{}, IsAdaptiveTag{});
+    }
+    resumable_ = false;
+  }
+
   PenaltyFunction& penalty() const {
     if (!penalty_) {
       throw std::logic_error("no penalty set");
@@ -463,10 +506,18 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
     return *penalty_;
   }
 
+  //! Set the new penalty function.
+  //! If the Ridge part of the penalty does not change (e.g., for LASSO penalties or for the same penalty), the
+  //! LARS path does not depend on the penalty and the path is resumed from the current position if the new LASSO
+  //! penalty is smaller than the previous one.
   void penalty(const PenaltyFunction& penalty) noexcept {
     if (penalty_ && loss_ && path_) {
-      path_->UpdateGram(LambdaRidge(penalty, IsWeightedTag{}, IsAdaptiveTag{}) -
-                          LambdaRidge(*penalty_, IsWeightedTag{}, IsAdaptiveTag{}));
+      const RidgeType ridge_change = LambdaRidge(penalty, IsWeightedTag{}, IsAdaptiveTag{}) -
+        LambdaRidge(*penalty_, IsWeightedTag{}, IsAdaptiveTag{});
+      if (IsNonZero(ridge_change)) {
+        path_->UpdateGram(ridge_change);
+        resumable_ = false;
+      }
     }
     penalty_.reset(new PenaltyFunction(penalty));
   }
@@ -511,17 +562,27 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
       throw std::logic_error("no penalty set");
     }
 
-    InitializeLarsPath(IsWeightedTag{}, IsAdaptiveTag{});
-
     auto&& data = loss_->data();
-    if (data.n_pred() == 1) {
-      const Coefficients coefs = OptimizeSinglePredictor(IsWeightedTag{}, IsAdaptiveTag{});
-      return MakeOptimum(*loss_, *penalty_, coefs);
-    }
-
     const double lambda_lasso = LambdaLasso(*penalty_, IsWeightedTag{});
-    double prev_max_cor = path_->max_cor();
     auglars::BetaProxy prev_beta(data.n_pred());
+    double prev_max_cor;
+    bool walked = false;
+
+    if (resumable_ && path_ && data.n_pred() > 1 && lambda_lasso <= knot_max_cor_) {
+      // The path is resumed from the current position. Walking from the beginning would pass through the same
+      // knots and not stop before the current position, because all previous knots have a larger correlation.
+      prev_max_cor = knot_max_cor_;
+    } else {
+      InitializeLarsPath(IsWeightedTag{}, IsAdaptiveTag{});
+
+      if (data.n_pred() == 1) {
+        const Coefficients coefs = OptimizeSinglePredictor(IsWeightedTag{}, IsAdaptiveTag{});
+        return MakeOptimum(*loss_, *penalty_, coefs);
+      }
+
+      prev_max_cor = path_->max_cor();
+      knot_beta_ = prev_beta.beta(IsSparseTag{});
+    }
 
     // Walk along the LARS path until all predictors are added or the LASSO lambda is passed.
     while (path_->active_size() < path_->max_active() && path_->max_cor() > lambda_lasso &&
@@ -529,8 +590,16 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
       prev_beta = path_->CurrentSlope();
       prev_max_cor = path_->max_cor();
       path_->Next();
+      walked = true;
     }
 
+    // Remember the last knot before the current position to resume the path for the next penalty.
+    if (walked) {
+      knot_beta_ = prev_beta.beta(IsSparseTag{});
+    }
+    knot_max_cor_ = prev_max_cor;
+    resumable_ = path_->max_cor() <= prev_max_cor + std::numeric_limits<double>::epsilon();
+
     // Either the maximum number of predictors are added, or the maximum correlation is below the desired LASSO lambda.
     Coefficients coefs(path_->CurrentSlope().beta(IsSparseTag{}));
     if (path_->active_size() > 0) {
@@ -541,7 +610,7 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
         // the interpolation is a bit different.
         const double mixing = (path_->active_size() == path_->max_active()) ?
           (lambda_lasso / prev_max_cor) : ((path_->max_cor() - lambda_lasso) / (path_->max_cor() - prev_max_cor));
-        coefs.beta = mixing * prev_beta.beta(IsSparseTag{}) + (1 - mixing) * coefs.beta;
+        coefs.beta = mixing * knot_beta_ + (1 - mixing) * coefs.beta;
       }
     }
 
@@ -554,6 +623,47 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
   }
 
  private:
+  //! Weighted observations change the weighted means, so the path is re-computed from the data.
+  void ReplaceObservation(const arma::rowvec&, const double, const arma::rowvec&, const double,
+                          std::true_type /* is_weighted */, std::true_type /* is_adaptive */) {
+    path_.reset();
+  }
+
+  //! Weighted observations change the weighted means, so the path is re-computed from the data.
+  void ReplaceObservation(const arma::rowvec&, const double, const arma::rowvec&, const double,
+                          std::true_type /* is_weighted */, std::false_type /* is_adaptive */) {
+    path_.reset();
+  }
+
+  void ReplaceObservation(const arma::rowvec& removed_x, const double removed_y, const arma::rowvec& added_x,
+                          const double added_y, std::false_type /* is_weighted */, std::true_type /* is_adaptive */) {
+    UpdateGramObservation(arma::vec(removed_x.t() / penalty_->loadings()), removed_y,
+                          arma::vec(added_x.t() / penalty_->loadings()), added_y);
+  }
+
+  void ReplaceObservation(const arma::rowvec& removed_x, const double removed_y, const arma::rowvec& added_x,
+                          const double added_y, std::false_type /* is_weighted */, std::false_type /* is_adaptive */) {
+    UpdateGramObservation(removed_x.t(), removed_y, added_x.t(), added_y);
+  }
+
+  //! Replace observation `removed` by observation `added` in the Gram matrix of the current path and the means.
+  //! With an intercept, the Gram matrix of the centered predictors changes by
+  //! `b b' - a a' - m d' - d m' - d d' / n`, where `m` is the current mean and `d = b - a`.
+  void UpdateGramObservation(const arma::vec& removed_x, const double removed_y, const arma::vec& added_x,
+                             const double added_y) {
+    if (loss_->IncludeIntercept()) {
+      const double n_obs = loss_->data().n_obs();
+      const arma::vec diff = added_x - removed_x;
+      const arma::vec mean_x = mean_x_.t();
+      path_->AddToGram(added_x * added_x.t() - removed_x * removed_x.t() - mean_x * diff.t() - diff * mean_x.t() -
+                       (diff * diff.t()) / n_obs);
+      mean_x_ += diff.t() / n_obs;
+      mean_y_ += (added_y - removed_y) / n_obs;
+    } else {
+      path_->AddToGram(added_x * added_x.t() - removed_x * removed_x.t());
+    }
+  }
+
   arma::vec FinalizeCoefficients(Coefficients* coefs, std::true_type /* is_weighted */,
                                  std::true_type /* is_adaptive */) const {
     auto&& data = loss_->data();
@@ -780,11 +890,11 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
         mean_x_ = arma::mean(data.cx());
         mean_y_ = arma::mean(data.cy());
         const arma::mat centered_x = data.cx().each_row() - mean_x_;
-        path_.reset(new auglars::LarsPath(centered_x.t() * centered_x, centered_x.t() * data.cy(), max_active));
+        path_.reset(new auglars::LarsPath(*GramCache::CenteredGram(data), centered_x.t() * data.cy(), max_active));
       } else {
         mean_x_.reset();
         mean_y_ = 0;
-        path_.reset(new auglars::LarsPath(data.cx().t() * data.cx(), data.cx().t() * data.cy(), max_active));
+        path_.reset(new auglars::LarsPath(*GramCache::Gram(data), data.cx().t() * data.cy(), max_active));
       }
 
       path_->UpdateGram(LambdaRidge(*penalty_, IsWeightedTag{}, IsAdaptiveTag{}));
@@ -843,12 +953,40 @@ class AugmentedLarsOptimizer : public Optimizer<LossFunction, PenaltyFunction, C
     return LambdaLasso(penalty, std::false_type{}) / loss_->mean_weight();
   }
 
+  //! Check if the given loss function uses the same data as the current loss function.
+  bool IsSameLoss(const LossFunction& loss, std::false_type /* is_weighted */) const noexcept {
+    return &loss.data() == &loss_->data() && loss.IncludeIntercept() == loss_->IncludeIntercept();
+  }
+
+  //! Check if the given loss function uses the same data and weights as the current loss function.
+  bool IsSameLoss(const LossFunction& loss, std::true_type /* is_weighted */) const noexcept {
+    return IsSameLoss(loss, std::false_type{}) && loss.mean_weight() == loss_->mean_weight() &&
+      (&loss.sqrt_weights() == &loss_->sqrt_weights() ||
+       (loss.sqrt_weights().n_elem == loss_->sqrt_weights().n_elem &&
+        arma::all(loss.sqrt_weights() == loss_->sqrt_weights())));
+  }
+
+  static bool IsNonZero(const double value) noexcept {
+    return value != 0;
+  }
+
+  static bool IsNonZero(const arma::vec& values) noexcept {
+    return arma::any(values != 0);
+  }
+
   LossFunctionPtr loss_;
   PenaltyPtr penalty_;
   std::unique_ptr<auglars::LarsPath> path_;
 
   arma::rowvec mean_x_;
   double mean_y_;
+
+  //! Whether the current LARS path can be resumed for a smaller LASSO penalty.
+  bool resumable_ = false;
+  //! Maximum correlation at the last knot before the current position on the LARS path.
+  double knot_max_cor_ = 0;
+  //! Slope at the last knot before the current position on the LARS path.
+  typename Coefficients::SlopeCoefficient knot_beta_;
 };
 
 //! Specialization of the LARS algorithm for Ridge penalty.
@@ -1027,10 +1165,10 @@ class AugmentedLarsOptimizer<LossFunction, RidgePenalty, RegressionCoefficients<
     if (loss_->IncludeIntercept()) {
       UpdateCenteredData();
       // The weights are all identical. Center the predictors and the response.
-      weighted_gram_ = centered_x_.t() * centered_x_;
+      weighted_gram_ = *GramCache::CenteredGram(data);
       weighted_xy_cov_ = data.cx().t() * centered_y_;
     } else {
-      weighted_gram_ = data.cx().t() * data.cx();
+      weighted_gram_ = *GramCache::Gram(data);
       weighted_xy_cov_ = data.cx().t() * data.cy();
     }
   }
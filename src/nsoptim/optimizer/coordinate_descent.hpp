@@ -14,16 +14,20 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <vector>
 
 #include "../armadillo.hpp"
 #include "../utilities.hpp"
 #include "../container/regression_coefficients.hpp"
 #include "../container/data.hpp"
+#include "../container/kernel_counters.hpp"
+#include "../container/gram_cache.hpp"
 #include "optimizer_base.hpp"
 #include "optimum.hpp"
 #include "../objective/ls_regression_loss.hpp"
 #include "../objective/en_penalty.hpp"
 #include "soft_threshold.hpp"
+#include "coordinate_order.hpp"
 #include "../traits/traits.hpp"
 
 namespace nsoptim {
@@ -33,10 +37,17 @@ struct CDConfiguration {
   int max_it;
   //! Re-compute the residuals every `reset_iter` iterations to avoid drift.
   int reset_iter;
+  //! Use the sequential strong rule to discard coefficients when continuing from the optimum of a different penalty.
+  bool strong_rules;
+  //! If there are more observations than predictors, update the gradient through inner products of the predictors
+  //! instead of updating the residuals.
+  bool covariance_updates;
+  //! Order in which the coordinates are updated in every iteration.
+  CoordinateOrder order;
 };
 
 namespace coorddesc {
-constexpr CDConfiguration kDefaultCDConfiguration = { 1000, 8 };
+constexpr CDConfiguration kDefaultCDConfiguration = { 1000, 8, false, true, CoordinateOrder::kCyclic };
 
 template<class Coefficients>
 struct State {
@@ -72,7 +83,7 @@ class CoordinateDescentOptimizer :
     //! Ininitialize the optimizer without a loss or penalty function.
   CoordinateDescentOptimizer(
     const CDConfiguration& config = coorddesc::kDefaultCDConfiguration) noexcept
-      : config_(config) {}
+      : config_(config), scheduler_(config.order) {}
 
   //! Ininitialize the optimizer using the given (weighted) LS loss function
   //! and penalty function.
@@ -82,7 +93,7 @@ class CoordinateDescentOptimizer :
     const PenaltyFunction& penalty,
     const CDConfiguration& config = coorddesc::kDefaultCDConfiguration) noexcept
     : loss_(new LossFunction(loss)),
-      penalty_(new PenaltyFunction(penalty)), config_(config) {}
+      penalty_(new PenaltyFunction(penalty)), config_(config), scheduler_(config.order) {}
 
   //! Default copy constructor.
   //!
@@ -92,8 +103,14 @@ class CoordinateDescentOptimizer :
     : loss_(other.loss_? new LossFunction(*other.loss_) : nullptr),
       penalty_(other.penalty_ ? new PenaltyFunction(*other.penalty_) : nullptr),
       config_(other.config_),
+      scheduler_(other.scheduler_),
       state_(other.state_),
-      convergence_tolerance_(other.convergence_tolerance_) {}
+      convergence_tolerance_(other.convergence_tolerance_),
+      screening_lambda_(other.screening_lambda_),
+      shared_gram_(other.shared_gram_),
+      gram_columns_(other.gram_columns_),
+      weighted_col_sums_(other.weighted_col_sums_),
+      total_weight_(other.total_weight_) {}
 
   //! Default copy assignment.
   //!
@@ -144,6 +161,7 @@ class CoordinateDescentOptimizer :
   void loss(const LossFunction& loss) noexcept {
     loss_.reset(new LossFunction(loss));
     ls_stepsize_.reset();
+    ResetCovarianceCache();
   }
 
   PenaltyFunction& penalty() const {
@@ -215,45 +233,90 @@ class CoordinateDescentOptimizer :
 
     int iter = 0;
     const auto& data = loss_->data();
+    // Only the coordinates in the strong set are updated. After convergence, the KKT conditions are checked for
+    // the discarded coordinates.
+    arma::uvec strong_set = StrongSet();
+    screening_lambda_ = penalty_->lambda();
+    metrics->AddMetric("strong_set_size", static_cast<int>(strong_set.n_elem));
+
+    // With covariance updates, the gradient is updated instead of the residuals, in O(p) per coefficient change.
+    covariance_mode_ = config_.covariance_updates && data.n_obs() > data.n_pred();
+    if (covariance_mode_) {
+      InitializeCovarianceUpdates(IsWeightedTag{});
+    }
+    metrics->AddMetric("covariance_updates", covariance_mode_ ? 1 : 0);
+    scheduler_.Reset(data.n_pred());
+
     while (iter++ < max_it) {
       Metrics& iteration_metrics = metrics->CreateSubMetrics("cd_iteration");
+      ScopedKernelCounter kernel_counter(Kernel::kCdSweep);
 
       auto prev_coefs = state_.coefs;
       double total_change = 0;
       if (loss_->IncludeIntercept()) {
-        state_.coefs.intercept = UpdateIntercept(IsWeightedTag{});
-        const auto diff = prev_coefs.intercept - state_.coefs.intercept;
-        state_.residuals += diff;
-        total_change += std::abs(diff);
+        if (covariance_mode_) {
+          state_.coefs.intercept = UpdateInterceptCovariance(IsWeightedTag{});
+          const auto diff = prev_coefs.intercept - state_.coefs.intercept;
+          gradient_ += diff * weighted_col_sums_;
+          residual_sum_ += diff * total_weight_;
+          total_change += std::abs(diff);
+        } else {
+          state_.coefs.intercept = UpdateIntercept(IsWeightedTag{});
+          const auto diff = prev_coefs.intercept - state_.coefs.intercept;
+          state_.residuals += diff;
+          total_change += std::abs(diff);
+        }
+      }
+
+      if (covariance_mode_ && scheduler_.RecordsViolations()) {
+        // The gradient is current for all coordinates, hence the violations are exact.
+        for (auto&& j : strong_set) {
+          scheduler_.Record(j, std::abs(UpdateSlopeCovariance(j) - state_.coefs.beta[j]) * ls_stepsize_[j]);
+        }
       }
 
-      for (arma::uword j = 0; j < data.n_pred(); ++j) {
+      for (auto&& j : scheduler_.Order(strong_set)) {
         // @TODO -- this is inefficient if we have a sparse vector!
-        state_.coefs.beta[j] = UpdateSlope(j, IsWeightedTag{}, IsAdaptiveTag{});
-        const auto diff = prev_coefs.beta[j] - state_.coefs.beta[j];
-        if (diff != 0) {
-          state_.residuals += diff * data.cx().col(j);
-          total_change += std::abs(diff);
+        if (covariance_mode_) {
+          state_.coefs.beta[j] = UpdateSlopeCovariance(j);
+          const auto diff = prev_coefs.beta[j] - state_.coefs.beta[j];
+          if (diff != 0) {
+            UpdateGradient(j, diff);
+            total_change += std::abs(diff);
+          }
+        } else {
+          state_.coefs.beta[j] = UpdateSlope(j, IsWeightedTag{}, IsAdaptiveTag{});
+          const auto diff = prev_coefs.beta[j] - state_.coefs.beta[j];
+          // The size of the step is the violation of the optimality conditions when the coordinate was visited.
+          scheduler_.Record(j, std::abs(diff) * ls_stepsize_[j]);
+          if (diff != 0) {
+            state_.residuals += diff * data.cx().col(j);
+            total_change += std::abs(diff);
+          }
         }
       }
 
       iteration_metrics.AddMetric("iter", iter);
       iteration_metrics.AddMetric("change", total_change);
 
-      if (total_change < data.n_pred() * convergence_tolerance_) {
+      if (total_change < data.n_pred() * convergence_tolerance_ &&
+          (strong_set.n_elem == data.n_pred() || AddKktViolations(&strong_set, &iteration_metrics) == 0)) {
         metrics->AddMetric("iter", iter);
+        metrics->AddMetric("coordinate_updates", static_cast<int>(scheduler_.updates()));
         state_.residuals = loss_->Residuals(state_.coefs);
         return MakeOptimum(*loss_, *penalty_, state_.coefs, state_.residuals,
                            std::move(metrics));
       }
 
-      // Re-compute the residuals after every few cycles to avoid any drifts
-      if (iter > 0 && iter % config_.reset_iter == 0) {
+      // Re-compute the residuals after every few cycles to avoid any drifts. With covariance updates, the residuals
+      // are only computed after the optimization.
+      if (!covariance_mode_ && iter > 0 && iter % config_.reset_iter == 0) {
         state_.residuals = loss_->Residuals(state_.coefs);
       }
     }
 
     metrics->AddMetric("iter", iter);
+    metrics->AddMetric("coordinate_updates", static_cast<int>(scheduler_.updates()));
     state_.residuals = loss_->Residuals(state_.coefs);
     return MakeOptimum(*loss_, *penalty_, state_.coefs, state_.residuals,
                        std::move(metrics), OptimumStatus::kWarning,
@@ -261,8 +324,86 @@ class CoordinateDescentOptimizer :
   }
 
  private:
+  //! Get the indices of the coordinates which are not discarded by the sequential strong rule.
+  //! The rule assumes that the current state is the optimum for penalty level `screening_lambda_` and discards
+  //! zero coefficients with gradient less than `alpha * (2 lambda - screening_lambda_)`.
+  arma::uvec StrongSet() const {
+    const arma::uword n_pred = loss_->data().n_pred();
+    if (!config_.strong_rules || screening_lambda_ < 0 || penalty_->lambda() <= 0) {
+      return arma::regspace<arma::uvec>(0, n_pred - 1);
+    }
+    const double factor = std::max(0., 2 - screening_lambda_ / penalty_->lambda());
+    const arma::vec gradient = SlopeGradient(IsWeightedTag{});
+    arma::uvec strong_set(n_pred);
+    arma::uword n_strong = 0;
+    for (arma::uword j = 0; j < n_pred; ++j) {
+      if (state_.coefs.beta[j] != 0 ||
+          std::abs(gradient[j]) >= factor * SoftThresholdLevel(j, IsWeightedTag{}, IsAdaptiveTag{})) {
+        strong_set[n_strong++] = j;
+      }
+    }
+    strong_set.resize(n_strong);
+    return strong_set;
+  }
+
+  //! Add all coordinates not in the strong set which violate the KKT conditions to the strong set.
+  //!
+  //! @param strong_set the sorted strong set.
+  //! @param iteration_metrics metrics of the current iteration.
+  //! @return the number of coordinates added to the strong set.
+  arma::uword AddKktViolations(arma::uvec* strong_set, Metrics* iteration_metrics) const {
+    const arma::uword n_pred = loss_->data().n_pred();
+    // With covariance updates, the residuals are outdated but the gradient is maintained for all coordinates.
+    const arma::vec gradient = covariance_mode_ ? gradient_ : SlopeGradient(IsWeightedTag{});
+    arma::uvec violations(n_pred - strong_set->n_elem);
+    arma::uword n_violations = 0;
+    auto strong_it = strong_set->cbegin();
+    const auto strong_end = strong_set->cend();
+    for (arma::uword j = 0; j < n_pred; ++j) {
+      if (strong_it != strong_end && *strong_it == j) {
+        ++strong_it;
+      } else if (std::abs(gradient[j]) > SoftThresholdLevel(j, IsWeightedTag{}, IsAdaptiveTag{})) {
+        violations[n_violations++] = j;
+      }
+    }
+    iteration_metrics->AddMetric("kkt_violations", static_cast<int>(n_violations));
+    if (n_violations > 0) {
+      violations.resize(n_violations);
+      *strong_set = arma::sort(arma::join_cols(*strong_set, violations));
+    }
+    return n_violations;
+  }
+
+  arma::vec SlopeGradient(std::false_type /* is_weighted */) const {
+    return loss_->data().cx().t() * state_.residuals;
+  }
+
+  arma::vec SlopeGradient(std::true_type /* is_weighted */) const {
+    return loss_->data().cx().t() * (arma::square(loss_->sqrt_weights()) % state_.residuals);
+  }
+
+  double SoftThresholdLevel(const arma::uword, std::false_type /* is_weighted */,
+                            std::false_type /* is_adaptive */) const {
+    return en_softthresh_;
+  }
+
+  double SoftThresholdLevel(const arma::uword, std::true_type /* is_weighted */,
+                            std::false_type /* is_adaptive */) const {
+    return en_softthresh_ / loss_->mean_weight();
+  }
+
+  double SoftThresholdLevel(const arma::uword j, std::false_type /* is_weighted */,
+                            std::true_type /* is_adaptive */) const {
+    return en_softthresh_[j];
+  }
+
+  double SoftThresholdLevel(const arma::uword j, std::true_type /* is_weighted */,
+                            std::true_type /* is_adaptive */) const {
+    return en_softthresh_[j] / loss_->mean_weight();
+  }
+
   double UpdateIntercept (std::false_type /* is_weighted */) {
-    return arma::accu(state_.residuals + state_.coefs.intercept);
+    return arma::mean(state_.residuals + state_.coefs.intercept);
   }
 
   double UpdateIntercept (std::true_type /* is_weighted */) {
@@ -313,6 +454,90 @@ class CoordinateDescentOptimizer :
       ls_stepsize_[j];
   }
 
+  //! Compute the weighted column sums of the predictor matrix and prepare the storage of the Gram matrix, unless
+  //! already done for the current loss, and the gradient and weighted sum of the residuals at the current state.
+  void InitializeCovarianceUpdates(std::false_type /* is_weighted */) {
+    const auto& data = loss_->data();
+    if (weighted_col_sums_.n_elem != data.n_pred()) {
+      // Use the Gram matrix if another optimizer already computed it for the same data.
+      shared_gram_ = GramCache::Find(data);
+      if (!shared_gram_) {
+        gram_columns_.assign(data.n_pred(), arma::vec());
+      }
+      weighted_col_sums_ = arma::sum(data.cx(), 0).t();
+      total_weight_ = data.n_obs();
+    }
+    gradient_ = SlopeGradient(std::false_type{});
+    residual_sum_ = arma::accu(state_.residuals);
+  }
+
+  //! Compute the weighted column sums of the predictor matrix and prepare the storage of the weighted Gram matrix,
+  //! unless already done for the current loss, and the gradient and weighted sum of the residuals at the current
+  //! state.
+  void InitializeCovarianceUpdates(std::true_type /* is_weighted */) {
+    const auto& data = loss_->data();
+    if (weighted_col_sums_.n_elem != data.n_pred()) {
+      gram_columns_.assign(data.n_pred(), arma::vec());
+      const arma::vec weights = arma::square(loss_->sqrt_weights());
+      weighted_col_sums_ = data.cx().t() * weights;
+      total_weight_ = arma::accu(weights);
+    }
+    gradient_ = SlopeGradient(std::true_type{});
+    residual_sum_ = arma::dot(arma::square(loss_->sqrt_weights()), state_.residuals);
+  }
+
+  //! Reset the cached (weighted) Gram matrix after the loss function changed.
+  void ResetCovarianceCache() noexcept {
+    shared_gram_.reset();
+    gram_columns_.clear();
+    weighted_col_sums_.reset();
+  }
+
+  //! Get column `j` of the (weighted) Gram matrix, computing it if necessary.
+  const double* GramColumn(const arma::uword j) {
+    if (shared_gram_) {
+      return shared_gram_->colptr(j);
+    }
+    arma::vec& column = gram_columns_[j];
+    if (column.n_elem == 0) {
+      column = ComputeGramColumn(j, IsWeightedTag{});
+    }
+    return column.memptr();
+  }
+
+  arma::vec ComputeGramColumn(const arma::uword j, std::false_type /* is_weighted */) const {
+    return loss_->data().cx().t() * loss_->data().cx().col(j);
+  }
+
+  arma::vec ComputeGramColumn(const arma::uword j, std::true_type /* is_weighted */) const {
+    return loss_->data().cx().t() * (arma::square(loss_->sqrt_weights()) % loss_->data().cx().col(j));
+  }
+
+  //! Update the gradient and the weighted sum of the residuals after slope coefficient `j` decreased by `diff`.
+  void UpdateGradient(const arma::uword j, const double diff) {
+    const double * const gram_col = GramColumn(j);
+    double * const gradient = gradient_.memptr();
+    for (arma::uword k = 0; k < gradient_.n_elem; ++k) {
+      gradient[k] += diff * gram_col[k];
+    }
+    residual_sum_ += diff * weighted_col_sums_[j];
+  }
+
+  //! Compute the new value of slope coefficient `j` from the maintained gradient.
+  double UpdateSlopeCovariance(const arma::uword j) {
+    const double beta_j = state_.coefs.beta[j];
+    const double dir = (beta_j != 0) ? gradient_[j] + beta_j * GramColumn(j)[j] : gradient_[j];
+    return SoftThreshold(dir, SoftThresholdLevel(j, IsWeightedTag{}, IsAdaptiveTag{})) / ls_stepsize_[j];
+  }
+
+  double UpdateInterceptCovariance(std::false_type /* is_weighted */) const {
+    return residual_sum_ / total_weight_ + state_.coefs.intercept;
+  }
+
+  double UpdateInterceptCovariance(std::true_type /* is_weighted */) const {
+    return (residual_sum_ + total_weight_ * state_.coefs.intercept) / loss_->data().n_obs();
+  }
+
   void ResetState (const Coefficients &coefs) {
     if (!loss_) {
       throw std::logic_error("no loss set");
@@ -320,6 +545,7 @@ class CoordinateDescentOptimizer :
     if (!penalty_) {
       throw std::logic_error("no penalty set");
     }
+    screening_lambda_ = -1;
     state_ = { coefs, loss_->Residuals(coefs) };
   }
 
@@ -375,11 +601,29 @@ class CoordinateDescentOptimizer :
   LossFunctionPtr loss_;
   PenaltyPtr penalty_;
   CDConfiguration config_;
+  //! Order of the coordinates in every iteration.
+  coorddesc::CoordinateScheduler scheduler_;
   arma::vec ls_stepsize_;
   EnThreshold en_stepsize_;
   EnThreshold en_softthresh_;
   coorddesc::State<Coefficients> state_;
   double convergence_tolerance_ = 1e-8;
+  //! Penalty level the current state was optimized for, or negative if the state is not an optimum.
+  double screening_lambda_ = -1;
+  //! Whether the current optimization uses covariance updates.
+  bool covariance_mode_ = false;
+  //! The (weighted) Gram matrix shared with other optimizers, if available.
+  GramCache::GramPtr shared_gram_;
+  //! The columns of the (weighted) Gram matrix computed so far, if no shared Gram matrix is available.
+  std::vector<arma::vec> gram_columns_;
+  //! The weighted column sums of the predictor matrix.
+  arma::vec weighted_col_sums_;
+  //! The sum of the observation weights.
+  double total_weight_ = 0;
+  //! The gradient of the LS loss with respect to the slope, maintained with covariance updates.
+  arma::vec gradient_;
+  //! The weighted sum of the residuals, maintained with covariance updates.
+  double residual_sum_ = 0;
 };
 } // namespace nsoptim
 
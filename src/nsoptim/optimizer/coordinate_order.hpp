@@ -0,0 +1,117 @@
+//
+//  coordinate_order.hpp
+//  nsoptim
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef NSOPTIM_OPTIMIZER_COORDINATE_ORDER_HPP_
+#define NSOPTIM_OPTIMIZER_COORDINATE_ORDER_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+#include "../armadillo.hpp"
+
+namespace nsoptim {
+//! Order in which coordinate descent algorithms update the coordinates in every sweep.
+enum class CoordinateOrder {
+  //! Update the coordinates in the order of their indices.
+  kCyclic = 0,
+  //! Update the coordinates in a new random order in every sweep.
+  kRandom = 1,
+  //! Update the coordinates by decreasing violation of the optimality conditions (Gauss-Southwell rule).
+  kGreedy = 2,
+  //! Update the coordinates violating the optimality conditions first, by decreasing violation, followed by the
+  //! remaining coordinates in random order.
+  kHybrid = 3
+};
+
+namespace coorddesc {
+//! Seed for the random orders of the coordinates. Every optimizer uses the same sequence of orders.
+constexpr std::uint32_t kCoordinateOrderSeed = 20220224u;
+
+//! Determine the order of the coordinates in every sweep of a coordinate descent algorithm.
+//! For the greedy orders, the optimizer records the violation of the optimality conditions for every coordinate it
+//! updates, e.g., the size of the proximal step, which is computed from the gradient anyway. The next sweep then
+//! updates the coordinates by decreasing recorded violation.
+class CoordinateScheduler {
+ public:
+  explicit CoordinateScheduler(const CoordinateOrder order = CoordinateOrder::kCyclic) noexcept
+      : order_(order), rng_(kCoordinateOrderSeed) {}
+
+  //! Check if the optimizer needs to record the violations.
+  bool RecordsViolations() const noexcept {
+    return order_ == CoordinateOrder::kGreedy || order_ == CoordinateOrder::kHybrid;
+  }
+
+  //! Forget all recorded violations, e.g., because the loss or the penalty changed. Until all coordinates are
+  //! updated once, coordinates without a recorded violation are updated first.
+  //!
+  //! @param n_coordinates the total number of coordinates.
+  void Reset(const arma::uword n_coordinates) {
+    if (RecordsViolations()) {
+      violations_.set_size(n_coordinates);
+      violations_.fill(arma::datum::inf);
+    }
+    updates_ = 0;
+  }
+
+  //! Record the violation of the optimality conditions of coordinate `j`.
+  void Record(const arma::uword j, const double violation) noexcept {
+    if (RecordsViolations() && j < violations_.n_elem) {
+      violations_[j] = violation;
+    }
+  }
+
+  //! Get the number of coordinates scheduled for an update since the last reset.
+  arma::uword updates() const noexcept {
+    return updates_;
+  }
+
+  //! Get the order in which to update the given coordinates in the next sweep.
+  //!
+  //! @param coordinates the coordinates to update, in cyclic order.
+  //! @return the coordinates in the order in which they should be updated.
+  const arma::uvec& Order(const arma::uvec& coordinates) {
+    updates_ += coordinates.n_elem;
+    if (order_ == CoordinateOrder::kCyclic) {
+      return coordinates;
+    }
+    order_buffer_ = coordinates;
+    switch (order_) {
+      case CoordinateOrder::kRandom:
+        std::shuffle(order_buffer_.begin(), order_buffer_.end(), rng_);
+        break;
+      case CoordinateOrder::kGreedy:
+        std::stable_sort(order_buffer_.begin(), order_buffer_.end(), [this](const arma::uword a, const arma::uword b) {
+          return violations_[a] > violations_[b];
+        });
+        break;
+      case CoordinateOrder::kHybrid: {
+        auto violating_end = std::stable_partition(order_buffer_.begin(), order_buffer_.end(),
+                                                   [this](const arma::uword j) { return violations_[j] > 0; });
+        std::stable_sort(order_buffer_.begin(), violating_end, [this](const arma::uword a, const arma::uword b) {
+          return violations_[a] > violations_[b];
+        });
+        std::shuffle(violating_end, order_buffer_.end(), rng_);
+        break;
+      }
+      default:
+        break;
+    }
+    return order_buffer_;
+  }
+
+ private:
+  CoordinateOrder order_;
+  std::mt19937 rng_;
+  arma::vec violations_;
+  arma::uvec order_buffer_;
+  arma::uword updates_ = 0;
+};
+}  // namespace coorddesc
+}  // namespace nsoptim
+
+#endif  // NSOPTIM_OPTIMIZER_COORDINATE_ORDER_HPP_
@@ -41,10 +41,13 @@ struct DalEnConfiguration {
   double lambda_relchange_aggressive;
   //! Multiplier to scale the proximity parameters at each outer iteration.
   double eta_multiplier;
+  //! Permanently discard predictors which are certified to be zero at the optimum by the duality gap (gap-safe
+  //! screening).
+  bool safe_screening;
 };
 
 namespace _optim_dal_internal {
-constexpr DalEnConfiguration kDefaultDalEnConfiguration = {100, 100, 0.01, 1, 0.25, 2};
+constexpr DalEnConfiguration kDefaultDalEnConfiguration = {100, 100, 0.01, 1, 0.25, 2, false};
 }  // namespace _optim_dal_internal
 
 template <class LossFunction, class PenaltyFunction>
@@ -79,15 +82,17 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
 
   //! Copy constructor.
   //!
-  //! This creates shallow copies of the loss and penalty functions and a deep copy of the hessian as well as possibly
-  //! the weighted data.
+  //! This creates shallow copies of the loss and penalty functions. The (weighted) data and the Gram matrix of the
+  //! active predictors are read-only and shared with `other`. The data proxy remains valid, because it only refers
+  //! to the data and weights shared by the copies of the loss function.
   DalEnOptimizer(const DalEnOptimizer& other) noexcept :
     config_(other.config_),
     loss_(other.loss_ ? LossFunctionPtr(new LossFunction(*other.loss_)) : nullptr),
     penalty_(other.penalty_ ? PenaltyFunctionPtr(new PenaltyFunction(*other.penalty_)) : nullptr),
     coefs_(other.coefs_),
-    data_(loss_.get()), eta_(other.eta_),
-    convergence_tolerance_(other.convergence_tolerance_) {}
+    data_(other.data_), eta_(other.eta_),
+    convergence_tolerance_(other.convergence_tolerance_),
+    column_norms_(other.column_norms_), active_gram_(other.active_gram_) {}
 
   DalEnOptimizer(DalEnOptimizer&& other) = default;
   DalEnOptimizer& operator=(DalEnOptimizer&& other) = default;
@@ -124,6 +129,10 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
       // If the data changed, the proximity parameters must be reset.
       eta_.nxlambda = -1;
     }
+    if (changes.data_changed || changes.weights_changed) {
+      column_norms_.reset();
+      active_gram_.reset();
+    }
   }
 
   //! Access the penalty function.
@@ -242,7 +251,12 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
       coefs_.intercept = 0;
     }
 
-    arma::vec dual_constraint_rhs = data_->cx().t() * phi_argmin;
+    screening_.Reset();
+    if (config_.safe_screening && alpha > 0 && column_norms_.n_elem != data_->n_pred()) {
+      column_norms_ = arma::sqrt(arma::sum(arma::square(data_->cx()), 0)).t();
+    }
+
+    arma::vec dual_constraint_rhs = CrossProduct(phi_argmin);
     int outer_iterations = 0;
     double dual_fun_value = 0;
     double eq_constr_violation = 0;
@@ -252,16 +266,22 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
       // Check if relative duality gap (rdg) is below the threshold
       const double dual_fun_val_prev = dual_fun_value;
       arma::vec dual_vec = ComputeDualVector(phi_argmin, HasWeightsTag{});
-      arma::vec xtr_dual = data_->cx().t() * dual_vec;
+      arma::vec xtr_dual = CrossProduct(dual_vec);
       if (alpha < 1) {
-        SoftThreshold(softthr_cutoff, &xtr_dual);
+        arma::vec xtr_dual_thresholded = xtr_dual;
+        SoftThreshold(softthr_cutoff, &xtr_dual_thresholded);
         dual_fun_value = _optim_dal_internal::DualLoss(dual_vec, data_->cy()) +
-          0.5 * arma::dot(linalg::ElementwiseProduct(update_denom_mult, xtr_dual), xtr_dual);
+          0.5 * arma::dot(linalg::ElementwiseProduct(update_denom_mult, xtr_dual_thresholded), xtr_dual_thresholded);
       } else {
-        dual_vec *= DualVectorUpdate(nxlambda, xtr_dual, IsAdaptiveTag{});
+        const double dual_vec_update = DualVectorUpdate(nxlambda, xtr_dual, IsAdaptiveTag{});
+        dual_vec *= dual_vec_update;
+        xtr_dual *= dual_vec_update;
         dual_fun_value = _optim_dal_internal::DualLoss(dual_vec, data_->cy());
       }
 
+      // The value of the dual function at the current dual vector, required for gap-safe screening.
+      const double current_dual_fun_value = dual_fun_value;
+
       // Ensure that the value of the dual function does not increase.
       if (outer_iterations > 0 && dual_fun_value > dual_fun_val_prev) {
         dual_fun_value = dual_fun_val_prev;
@@ -282,6 +302,9 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
       // Check for convergence or reaching the maximum nr. of iterations.
       if (std::abs(rel_duality_gap) < convergence_tolerance_) {
         metrics->AddMetric("iter", outer_iterations);
+        if (config_.safe_screening) {
+          metrics->AddMetric("screened", static_cast<int>(data_->n_pred() - screening_.n_active(data_->n_pred())));
+        }
         return MakeOptimum(*loss_, *penalty_, coefs_, residuals, orig_objf_value, std::move(metrics));
       } else if (++outer_iterations > max_it) {
         metrics->AddMetric("iter", outer_iterations);
@@ -295,6 +318,12 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
                            OptimumStatus::kError, "Relative duality gap is negative");
       }
 
+      if (config_.safe_screening && alpha > 0) {
+        const int screened = SafeScreening(xtr_dual, softthr_cutoff, primal_fun_val + current_dual_fun_value,
+                                           &dual_constraint_rhs);
+        iteration_metrics.AddDetail("screened", screened);
+      }
+
       // Minimize phi
       const int phi_iter = MinimizePhi(softthr_cutoff, nxlambda, alpha, &phi_argmin, &dual_constraint_rhs,
                                        &iteration_metrics);
@@ -333,6 +362,99 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
   using PenaltyLevelType = typename std::conditional<traits::is_adaptive<PenaltyFunction>::value,
                                                      arma::vec, double>::type;
 
+  //! The predictors retained by gap-safe screening in the current call to `Optimize()`.
+  struct ScreeningState {
+    //! Whether any predictor has been discarded.
+    bool screened = false;
+    //! Indices of the retained predictors. Only valid if `screened` is true.
+    arma::uvec active;
+    //! The retained columns of the predictor matrix. Only valid if `screened` is true.
+    arma::mat x;
+
+    void Reset() noexcept {
+      screened = false;
+      active.reset();
+      x.reset();
+    }
+
+    //! Get the number of retained predictors.
+    arma::uword n_active(const arma::uword n_pred) const noexcept {
+      return screened ? active.n_elem : n_pred;
+    }
+  };
+
+  //! The Gram matrix of the active predictors, re-used across iterations and penalties.
+  //! It is never modified in place, hence it is shared by copies of the optimizer.
+  struct ActiveGram {
+    //! Indices of the predictors in the Gram matrix.
+    arma::uvec active;
+    //! The Gram matrix `X_A' X_A`.
+    arma::mat gram;
+  };
+
+  //! Compute `X' v` for the retained predictors. The elements of discarded predictors are 0.
+  //!
+  //! @param v vector with `n` elements.
+  //! @return vector with `p` elements.
+  arma::vec CrossProduct(const arma::vec& v) const {
+    if (!screening_.screened) {
+      return data_->cx().t() * v;
+    }
+    arma::vec cross_product(data_->n_pred(), arma::fill::zeros);
+    cross_product.elem(screening_.active) = screening_.x.t() * v;
+    return cross_product;
+  }
+
+  //! Get the soft-thresholding cutoff for the `j`-th predictor.
+  static double Cutoff(const double cutoff, const arma::uword) noexcept {
+    return cutoff;
+  }
+
+  //! Get the soft-thresholding cutoff for the `j`-th predictor with adaptive penalties.
+  static double Cutoff(const arma::vec& cutoff, const arma::uword j) noexcept {
+    return cutoff[j];
+  }
+
+  //! Discard predictors which are certified to be zero at the optimum.
+  //! The dual is 1-strongly concave, hence the optimal dual vector is within a ball of radius `sqrt(2 gap)` around
+  //! any feasible dual vector.  If `|x_j' dual| + ||x_j|| sqrt(2 gap)` is less than the threshold of predictor `j`,
+  //! the coefficient is 0 at the optimum.
+  //!
+  //! @param xtr_dual the vector `X' dual` for the current feasible dual vector.
+  //! @param softthr_cutoff the cutoff value(s) for the soft-thresholding function.
+  //! @param duality_gap the (absolute) duality gap at the current iterate.
+  //! @param dual_constraint_rhs the right-hand-side of the current duality constraint. The elements of discarded
+  //!                            predictors are set to 0.
+  //! @return the number of newly discarded predictors.
+  int SafeScreening(const arma::vec& xtr_dual, const PenaltyLevelType& softthr_cutoff, const double duality_gap,
+                    arma::vec * const dual_constraint_rhs) {
+    if (!(duality_gap >= 0)) {
+      return 0;
+    }
+    const double radius = std::sqrt(2 * duality_gap);
+    const arma::uword n_pred = data_->n_pred();
+    const arma::uvec candidates = screening_.screened ? screening_.active :
+                                                         arma::regspace<arma::uvec>(0, n_pred - 1);
+    arma::uvec retained(candidates.n_elem);
+    arma::uword n_retained = 0;
+    for (auto&& j : candidates) {
+      if (std::abs(xtr_dual[j]) + column_norms_[j] * radius < Cutoff(softthr_cutoff, j)) {
+        coefs_.beta[j] = 0;
+        (*dual_constraint_rhs)[j] = 0;
+      } else {
+        retained[n_retained++] = j;
+      }
+    }
+
+    const int n_screened = static_cast<int>(candidates.n_elem - n_retained);
+    if (n_screened > 0) {
+      screening_.screened = true;
+      screening_.active = retained.head(n_retained);
+      screening_.x = data_->cx().cols(screening_.active);
+    }
+    return n_screened;
+  }
+
   //! Minimize the AL function `phi`.
   //!
   //! @param softthr_cutoff the cutoff value(s) for the soft-thresholding function.
@@ -356,7 +478,7 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
     while (true) {
       Metrics& inner_metrics = metrics->CreateSubMetrics("phi_iteration");
       // Update coefficient values
-      coefs_.beta = SoftThreshold(prev_coefs.beta, eta_.slope, *dual_constraint_rhs, softthr_cutoff);
+      SoftThreshold(prev_coefs.beta, eta_.slope, *dual_constraint_rhs, softthr_cutoff, 1., &coefs_.beta);
       coefs_.intercept = prev_coefs.intercept + ComputeInterceptChange(*phi_argmin, HasWeightsTag{});
 
       // Evaluate the phi function and its gradient.
@@ -393,7 +515,7 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
       const double linesearch_step = arma::dot(step_dir, gradient);
       const double intercept_step_base = prev_coefs.intercept + ComputeInterceptChange(*phi_argmin, HasWeightsTag{});
       const double intercept_step_decrease = ComputeInterceptChange(step_dir, HasWeightsTag{});
-      const arma::vec dual_constraint_rhs_step_dir = data_->cx().t() * step_dir;
+      const arma::vec dual_constraint_rhs_step_dir = CrossProduct(step_dir);
       double step_size = 1;
       int line_search_iter = 0;
 
@@ -402,7 +524,7 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
 
       while (++line_search_iter <= _optim_dal_internal::kLinesearchMaxSteps) {
         // Update coefficient values
-        coefs_.beta = SoftThreshold(prev_coefs.beta, eta_.slope, *dual_constraint_rhs, softthr_cutoff);
+        SoftThreshold(prev_coefs.beta, eta_.slope, *dual_constraint_rhs, softthr_cutoff, 1., &coefs_.beta);
         coefs_.intercept = intercept_step_base - step_size * intercept_step_decrease;
 
         // Evaluate the phi function and its gradient.
@@ -538,7 +660,7 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
   //! Find the appropriate step direction.
   //! @return boolean indicating if a solution was found or not.
   bool PhiStepDir(const arma::sp_vec& beta, const arma::vec& gradient, const PenaltyLevelType& moreau_factor,
-                  arma::vec * const step_dir) const {
+                  arma::vec * const step_dir) {
     if (beta.n_nonzero == 0) {
       // No predictors are active. We can compute the inverse of the Hessian and the step direction directly.
       if (loss_->IncludeIntercept()) {
@@ -554,11 +676,138 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
     beta.sync();
     const arma::uvec active(const_cast<arma::uword*>(beta.row_indices), beta.n_nonzero, false, true);
 
+    // If there are fewer active predictors than observations, solve the smaller system.
+    if (active.n_elem + 1 < data_->n_obs()) {
+      return PhiStepDirActive(active, gradient, moreau_factor, step_dir);
+    }
+
     arma::mat hessian = PhiHessian(active, moreau_factor, HasWeightsTag{});
     hessian.diag() += 1;  //< this is faster than adding a diagonal matrix.
     return arma::solve(*step_dir, hessian, gradient, arma::solve_opts::likely_sympd);
   }
 
+  //! Find the step direction by solving the linear system in the space of the active predictors.
+  //! The Hessian is `H = I + U C U'`, with `U = [X_A, w]` and the diagonal matrix `C` holding the proximity
+  //! parameters (times the Moreau factors), and `w` the square-root of the observation weights. By the Woodbury
+  //! identity, `H^-1 g = g - U (C^-1 + U'U)^-1 U' g`, which only requires the solution of a `|A| + 1` system.
+  //! @return boolean indicating if a solution was found or not.
+  bool PhiStepDirActive(const arma::uvec& active, const arma::vec& gradient, const PenaltyLevelType& moreau_factor,
+                        arma::vec * const step_dir) {
+    const arma::mat active_x = data_->cx().cols(active);
+    UpdateActiveGram(active, active_x);
+
+    const arma::uword n_active = active.n_elem;
+    const bool include_intercept = loss_->IncludeIntercept();
+    const arma::uword n_inner = include_intercept ? n_active + 1 : n_active;
+    arma::mat inner(n_inner, n_inner);
+    arma::vec inner_rhs(n_inner);
+
+    inner.submat(0, 0, n_active - 1, n_active - 1) = active_gram_->gram;
+    inner.submat(0, 0, n_active - 1, n_active - 1).diag() += 1 / ActiveSlopeScaling(active, moreau_factor);
+    inner_rhs.head(n_active) = active_x.t() * gradient;
+
+    if (include_intercept) {
+      const arma::vec xtw = InterceptCrossProduct(active_x, HasWeightsTag{});
+      inner.submat(0, n_active, n_active - 1, n_active) = xtw;
+      inner.submat(n_active, 0, n_active, n_active - 1) = xtw.t();
+      inner.at(n_active, n_active) = InterceptSquaredNorm(HasWeightsTag{}) + 1 / eta_.intercept;
+      inner_rhs[n_active] = InterceptCrossProduct(gradient, HasWeightsTag{});
+    }
+
+    arma::vec inner_solution;
+    if (!arma::solve(inner_solution, inner, inner_rhs, arma::solve_opts::likely_sympd)) {
+      return false;
+    }
+
+    *step_dir = gradient - active_x * inner_solution.head(n_active);
+    if (include_intercept) {
+      SubtractIntercept(inner_solution[n_active], step_dir, HasWeightsTag{});
+    }
+    return true;
+  }
+
+  //! Update the Gram matrix of the active predictors. Only the inner products with the predictors which entered
+  //! the active set are computed, the inner products of predictors which remain active are re-used.
+  //!
+  //! @param active the indices of the active predictors.
+  //! @param active_x the columns of the active predictors.
+  void UpdateActiveGram(const arma::uvec& active, const arma::mat& active_x) {
+    if (active_gram_ && active_gram_->active.n_elem == active.n_elem && arma::all(active_gram_->active == active)) {
+      return;
+    }
+
+    arma::mat gram(active.n_elem, active.n_elem);
+    arma::uvec entering_mask(active.n_elem, arma::fill::ones);
+    if (active_gram_ && active_gram_->active.n_elem > 0) {
+      arma::uvec common;
+      arma::uvec prev_positions;
+      arma::uvec positions;
+      arma::intersect(common, prev_positions, positions, active_gram_->active, active);
+      if (common.n_elem > 0) {
+        gram(positions, positions) = active_gram_->gram(prev_positions, prev_positions);
+        entering_mask.elem(positions).zeros();
+      }
+    }
+
+    const arma::uvec entering = arma::find(entering_mask);
+    if (entering.n_elem > 0) {
+      const arma::mat entering_products = active_x.t() * active_x.cols(entering);
+      gram.cols(entering) = entering_products;
+      gram.rows(entering) = entering_products.t();
+    }
+    active_gram_ = std::make_shared<const ActiveGram>(ActiveGram { active, std::move(gram) });
+  }
+
+  //! Get the diagonal of `C` for the active predictors with adaptive penalties.
+  arma::vec ActiveSlopeScaling(const arma::uvec& active, const arma::vec& moreau_factor) const {
+    return eta_.slope * moreau_factor.elem(active);
+  }
+
+  //! Get the diagonal of `C` for the active predictors with non-adaptive penalties.
+  arma::vec ActiveSlopeScaling(const arma::uvec& active, const double moreau_factor) const {
+    return arma::vec(active.n_elem, arma::fill::ones) * (eta_.slope * moreau_factor);
+  }
+
+  //! Compute `X_A' w` for a weighted LS loss.
+  arma::vec InterceptCrossProduct(const arma::mat& active_x, std::true_type) const {
+    return active_x.t() * data_.sqrt_weights();
+  }
+
+  //! Compute `X_A' 1` for an un-weighted LS loss.
+  arma::vec InterceptCrossProduct(const arma::mat& active_x, std::false_type) const {
+    return arma::sum(active_x, 0).t();
+  }
+
+  //! Compute `w' v` for a weighted LS loss.
+  double InterceptCrossProduct(const arma::vec& v, std::true_type) const {
+    return arma::dot(data_.sqrt_weights(), v);
+  }
+
+  //! Compute `1' v` for an un-weighted LS loss.
+  double InterceptCrossProduct(const arma::vec& v, std::false_type) const {
+    return arma::accu(v);
+  }
+
+  //! Compute `w' w` for a weighted LS loss.
+  double InterceptSquaredNorm(std::true_type) const {
+    return arma::dot(data_.sqrt_weights(), data_.sqrt_weights());
+  }
+
+  //! Compute `1' 1` for an un-weighted LS loss.
+  double InterceptSquaredNorm(std::false_type) const {
+    return static_cast<double>(data_->n_obs());
+  }
+
+  //! Subtract `c w` from the vector for a weighted LS loss.
+  void SubtractIntercept(const double c, arma::vec * const v, std::true_type) const {
+    *v -= c * data_.sqrt_weights();
+  }
+
+  //! Subtract `c 1` from the vector for an un-weighted LS loss.
+  void SubtractIntercept(const double c, arma::vec * const v, std::false_type) const {
+    *v -= c;
+  }
+
   //! Compute the Hessian for a weighted LS loss and non-adaptive penalty.
   arma::mat PhiHessian(const arma::uvec& active_predictors, const double moreau_factor,
                        std::true_type) const {
@@ -627,6 +876,10 @@ class DalEnOptimizer : public Optimizer<LossFunction, PenaltyFunction, Regressio
   _optim_dal_internal::DataProxy<LossFunction> data_;
   _optim_dal_internal::ProximityParameters eta_;
   double convergence_tolerance_ = 1e-8;
+  //! The L2 norms of the columns in the predictor matrix, for gap-safe screening.
+  arma::vec column_norms_;
+  ScreeningState screening_;
+  std::shared_ptr<const ActiveGram> active_gram_;
 };
 }  // namespace nsoptim
 
@@ -155,13 +155,10 @@ class DataProxy<LossFunction, std::true_type> {
   //! a new loss!
   explicit DataProxy(LossFunction const * const loss)
     : data_(loss ? &(loss->data()) : nullptr), sqrt_weights_(loss ? &(loss->sqrt_weights()) : nullptr),
-      sqrt_weights_outer_(loss ? loss->sqrt_weights() * loss->sqrt_weights().t() : arma::mat()),
       mean_weight_(loss ? loss->mean_weight() : 1.),
-      weighted_data_(loss ?
-                     PredictorResponseData(data_->cx().each_col() % *sqrt_weights_, data_->cy() % *sqrt_weights_) :
-                     PredictorResponseData()) {}
+      weighted_(loss ? MakeWeighted() : std::make_shared<const Weighted>()) {}
 
-  //! Copying is allowed.
+  //! Copying is allowed. The weighted data is read-only and shared with the copies.
   DataProxy(const DataProxy& other) = default;
   DataProxy& operator=(const DataProxy& other) = default;
   //! Moving is allowed.
@@ -199,10 +196,9 @@ class DataProxy<LossFunction, std::true_type> {
 
     if (changes.data_changed || changes.weights_changed) {
       sqrt_weights_ = &loss.sqrt_weights();
-      sqrt_weights_outer_ = loss.sqrt_weights() * loss.sqrt_weights().t();
       data_ = &loss.data();
       mean_weight_ = loss.mean_weight();
-      weighted_data_ = PredictorResponseData(data_->cx().each_col() % *sqrt_weights_, data_->cy() % *sqrt_weights_);
+      weighted_ = MakeWeighted();
     }
     return changes;
   }
@@ -218,7 +214,7 @@ class DataProxy<LossFunction, std::true_type> {
   //!
   //! @return vector with the sqrt of the observation weights.
   const arma::mat& sqrt_weights_outer() const noexcept {
-    return sqrt_weights_outer_;
+    return weighted_->sqrt_weights_outer;
   }
 
   //! Get the average weight.
@@ -232,29 +228,40 @@ class DataProxy<LossFunction, std::true_type> {
   //!
   //! @return a reference to the weighted data set.
   const PredictorResponseData& operator*() const noexcept {
-    return weighted_data_;
+    return weighted_->data;
   }
 
   //! Get the pointer to the data set.
   //!
   //! @return a reference to the data set.
   PredictorResponseData const * get() const {
-    return &weighted_data_;
+    return &weighted_->data;
   }
 
   //! Access the weighted data set.
   //!
   //! @return a pointer to the weighted data set.
   PredictorResponseData const * operator->() const noexcept {
-    return &weighted_data_;
+    return &weighted_->data;
   }
 
  private:
+  //! The weighted data and the outer product of the square-root of the weights.
+  struct Weighted {
+    arma::mat sqrt_weights_outer;
+    PredictorResponseData data;
+  };
+
+  std::shared_ptr<const Weighted> MakeWeighted() const {
+    return std::make_shared<const Weighted>(Weighted {
+      *sqrt_weights_ * sqrt_weights_->t(),
+      PredictorResponseData(data_->cx().each_col() % *sqrt_weights_, data_->cy() % *sqrt_weights_) });
+  }
+
   PredictorResponseData const * data_ = nullptr;
   arma::vec const * sqrt_weights_ = nullptr;
-  arma::mat sqrt_weights_outer_;
-  double mean_weight_;
-  PredictorResponseData weighted_data_;
+  double mean_weight_ = 1.;
+  std::shared_ptr<const Weighted> weighted_ = std::make_shared<const Weighted>();
 };
 
 
@@ -11,7 +11,9 @@
 
 #include <memory>
 #include <algorithm>
+#include <iterator>
 #include <limits>
+#include <vector>
 
 #include "../armadillo.hpp"
 
@@ -124,6 +126,10 @@ inline arma::uword SolveIterative(const arma::mat& A, const arma::vec& b, const
 }
 
 //! Choleskey decomposition of a subset of the rows/columns of a symmetric positive-semidefinite matrix *A*.
+//!
+//! Copies of a decomposition share the matrix and the packed factor until either of them is modified (copy-on-write).
+//! Copying a decomposition is therefore cheap, e.g., when every OpenMP task starts from the same decomposition.
+//! A copy must not be modified while another thread copies from it.
 class Cholesky {
  public:
   //! Initialize an *empty* Cholesky decomposition for matrix *matrix*.
@@ -131,34 +137,20 @@ class Cholesky {
   //! @param matrix the matrix to decompose.
   //! @param max_active the maximum number of "active" indices, i.e., the maximum size of the subset of rows/columns.
   Cholesky(const arma::mat& matrix, const arma::uword max_active) noexcept
-    : gram_(matrix), max_active_(max_active), active_size_(0), active_cols_(max_active_),
-      gram_decomp_packed_(new double[max_active * (max_active + 1) / 2]) {}
+    : gram_(std::make_shared<arma::mat>(matrix)), max_active_(max_active), active_size_(0),
+      active_cols_(max_active_), gram_decomp_packed_(AllocatePacked(max_active)) {}
 
   //! Copy constructor, optionally resetting the decomposition to be empty.
   Cholesky(const Cholesky& other, const bool reset) noexcept
-    : gram_(other.gram_), max_active_(other.max_active_),
+    : gram_(other.gram_), max_active_(other.max_active_), active_size_(reset ? 0 : other.active_size_),
       active_cols_(reset ? arma::uvec(max_active_) : other.active_cols_),
-      gram_decomp_packed_(new double[max_active_ * (max_active_ + 1) / 2]) {
-    if (!reset) {
-      std::copy(other.gram_decomp_packed_.get(), other.gram_decomp_packed_.get() + max_active_ * (max_active_ + 1) / 2,
-                gram_decomp_packed_.get());
-    }
-  }
+      gram_decomp_packed_(other.gram_decomp_packed_) {}
 
   //! Copy constructor.
   Cholesky(const Cholesky& other) noexcept : Cholesky(other, false) {}
 
   //! Copy assignment.
-  Cholesky& operator=(const Cholesky& other) {
-    gram_ = other.gram_;
-    max_active_ = other.max_active_;
-    active_size_ = other.active_size_;
-    active_cols_ = other.active_cols_;
-    gram_decomp_packed_.reset(new double[max_active_ * (max_active_ + 1) / 2]);
-    std::copy(other.gram_decomp_packed_.get(), other.gram_decomp_packed_.get() + max_active_ * (max_active_ + 1) / 2,
-              gram_decomp_packed_.get());
-    return *this;
-  }
+  Cholesky& operator=(const Cholesky& other) = default;
 
   //! Default move constructor.
   Cholesky(Cholesky&& other) = default;
@@ -170,7 +162,7 @@ class Cholesky {
   //!
   //! @param add value to add to the diagonal of the matrix.
   void UpdateMatrixDiagonal(const double add) noexcept {
-    gram_.diag() += add;
+    mutable_matrix().diag() += add;
     Reset();
   }
 
@@ -178,7 +170,15 @@ class Cholesky {
   //!
   //! @param add values to add to the diagonal of the matrix.
   void UpdateMatrixDiagonal(const arma::vec& add) {
-    gram_.diag() += add;
+    mutable_matrix().diag() += add;
+    Reset();
+  }
+
+  //! Add a (low-rank) update to the matrix and reset the decomposition.
+  //!
+  //! @param update symmetric matrix to add to the matrix.
+  void UpdateMatrix(const arma::mat& update) {
+    mutable_matrix() += update;
     Reset();
   }
 
@@ -198,28 +198,25 @@ class Cholesky {
   //! @return ``true`` if the column was added, ``false`` if the column was not added because either it would make the
   //!         matrix singular and the Cholesky decomposition ill-defined or the gram matrix is at it's maximal size.
   bool Add(const arma::uword add) noexcept {
-    const double sq_norm_new_x = gram_(add, add);
+    const double sq_norm_new_x = gram_->at(add, add);
     const double norm_new_x = std::sqrt(sq_norm_new_x);
 
+    if (active_size_ >= max_active_) {
+      return false;
+    }
+
+    EnsureUniqueFactor();
     if (active_size_ == 0) {
       // No active variables yet and the decomposition is empty.
-      gram_decomp_packed_[0] = norm_new_x;
-    } else if (active_size_ >= max_active_) {
-      return false;
+      gram_decomp_packed_.get()[0] = norm_new_x;
     } else {
-      char upper = 'U';
-      char trans_y = 'T';
-      char diag_n = 'N';
-      const arma::blas_int mat_size = arma::blas_int(active_size_);
-      const arma::blas_int incx = 1;
-
       // Get a view to the next column (really only needed for easy computation of the norm below).
       double *next_column = &gram_decomp_col(active_size_);
       arma::vec l(next_column, active_size_, false, true);
-      l = gram_.unsafe_col(add).elem(active_cols_.head(active_size_));
+      l = gram_->unsafe_col(add).elem(active_cols_.head(active_size_));
 
       // Solve the triangular system of linear equations
-      dtpsv(&upper, &trans_y, &diag_n, &mat_size, gram_decomp_packed_.get(), l.memptr(), &incx);
+      SolveTransposed(active_size_, gram_decomp_packed_.get(), l.memptr());
 
       next_column += active_size_;  //< Now points to the diagonal element of this column.
       *next_column = sq_norm_new_x - arma::dot(l, l);
@@ -237,6 +234,81 @@ class Cholesky {
     return true;
   }
 
+  //! Add several rows/columns of the matrix to the Cholesky decomposition.
+  //!
+  //! The rows/columns are added at the end, in the order given, skipping rows/columns which would make the
+  //! decomposition singular. The result is the same as adding the rows/columns one after the other, but the
+  //! off-diagonal blocks of all new columns are computed by a single level-3 triangular solve against the current
+  //! factor. The added rows/columns are the last elements of `active()`.
+  //!
+  //! @param first iterator pointing to the first column index to add.
+  //! @param last iterator pointing one past the last column index to add.
+  //! @return the number of rows/columns added.
+  template<typename InputIterator>
+  arma::uword Add(InputIterator first, InputIterator last) {
+    static_assert(std::is_integral<typename std::iterator_traits<InputIterator>::value_type>::value,
+                  "Iterator must point to an integral type");
+    const arma::uvec candidates(std::vector<arma::uword>(first, last));
+    if (candidates.n_elem < 2 || active_size_ >= max_active_) {
+      return (candidates.n_elem > 0 && Add(candidates[0])) ? 1 : 0;
+    }
+
+    // Columns beyond the remaining capacity can only be added if some of the block are singular.
+    const arma::uword block_size = std::min<arma::uword>(candidates.n_elem, max_active_ - active_size_);
+    const arma::uvec block = candidates.head(block_size);
+    const arma::uword prev_active_size = active_size_;
+
+    // The off-diagonal block of the new columns is the solution to L_11 X = A_[active, block], with L_11 = U_11'
+    // the lower triangle of the current decomposition.
+    arma::mat cross;
+    arma::mat schur = gram_->submat(block, block);
+    if (prev_active_size > 0) {
+      const arma::uvec active_cols = active_cols_.head(prev_active_size);
+      cross = arma::solve(arma::trimatl(UnpackLower()), gram_->submat(active_cols, block), arma::solve_opts::fast);
+      schur -= cross.t() * cross;
+    }
+
+    // Decompose the Schur complement of the new columns, skipping singular columns.
+    std::unique_ptr<double[]> block_packed(new double[block_size * (block_size + 1) / 2]);
+    arma::uvec accepted(block_size);
+    arma::uword block_accepted = 0;
+    for (arma::uword j = 0; j < block_size; ++j) {
+      double * const next_column = block_packed.get() + block_accepted * (block_accepted + 1) / 2;
+      arma::vec l(next_column, block_accepted, false, true);
+      if (block_accepted > 0) {
+        l = schur.unsafe_col(j).elem(accepted.head(block_accepted));
+        SolveTransposed(block_accepted, block_packed.get(), l.memptr());
+      }
+      const double diag_sq = schur.at(j, j) - arma::dot(l, l);
+      if (diag_sq >= std::numeric_limits<double>::epsilon()) {
+        next_column[block_accepted] = std::sqrt(diag_sq);
+        accepted[block_accepted++] = j;
+      }
+    }
+
+    // Append the new columns to the packed factor.
+    EnsureUniqueFactor();
+    for (arma::uword a = 0; a < block_accepted; ++a) {
+      double * out = &gram_decomp_col(prev_active_size + a);
+      if (prev_active_size > 0) {
+        out = std::copy(cross.colptr(accepted[a]), cross.colptr(accepted[a]) + prev_active_size, out);
+      }
+      const double * const block_column = block_packed.get() + a * (a + 1) / 2;
+      std::copy(block_column, block_column + a + 1, out);
+      active_cols_[prev_active_size + a] = block[accepted[a]];
+    }
+    active_size_ += block_accepted;
+
+    // Fill any capacity freed by singular columns with the remaining candidates.
+    arma::uword added = block_accepted;
+    for (arma::uword i = block_size; i < candidates.n_elem && active_size_ < max_active_; ++i) {
+      if (Add(candidates[i])) {
+        ++added;
+      }
+    }
+    return added;
+  }
+
   //! Drop one or more rows/columns from the decomposition.
   //!
   //! The indices to drop must be in terms of the added rows/columns.
@@ -250,6 +322,9 @@ class Cholesky {
   void Drop(InputIterator first, InputIterator last) noexcept {
     static_assert(std::is_integral<typename InputIterator::value_type>::value,
                   "Iterator must point to an integral type");
+    if (first != last) {
+      EnsureUniqueFactor();
+    }
     // It is assumed that the iterator range is in **descending** order!
     while (first != last) {
       const arma::uword drop = *first++;
@@ -319,7 +394,7 @@ class Cholesky {
   }
 
   const arma::mat& matrix() const noexcept {
-    return gram_;
+    return *gram_;
   }
 
   //! Get the rows/columns that are currently "active" in the order of the composition.
@@ -333,16 +408,62 @@ class Cholesky {
   }
 
  private:
+  //! Allocate storage for a packed upper triangular matrix of the given size.
+  static std::shared_ptr<double> AllocatePacked(const arma::uword size) {
+    return std::shared_ptr<double>(new double[size * (size + 1) / 2], std::default_delete<double[]>());
+  }
+
+  //! Solve *U' x = b* for a packed upper triangular matrix *U*.
+  static void SolveTransposed(const arma::uword size, double* packed, double* b) noexcept {
+    char upper = 'U';
+    char trans_y = 'T';
+    char diag_n = 'N';
+    const arma::blas_int mat_size = arma::blas_int(size);
+    const arma::blas_int incx = 1;
+    dtpsv(&upper, &trans_y, &diag_n, &mat_size, packed, b, &incx);
+  }
+
   //! Access the first element in column *column* of the Cholesky decomposition of the matrix.
   inline double& gram_decomp_col(arma::uword column) {
-    return gram_decomp_packed_[column * (column + 1) / 2];
+    return gram_decomp_packed_.get()[column * (column + 1) / 2];
+  }
+
+  //! Get the matrix for modification, detaching it from any copies.
+  arma::mat& mutable_matrix() {
+    if (gram_.use_count() > 1) {
+      gram_ = std::make_shared<arma::mat>(*gram_);
+    }
+    return *gram_;
+  }
+
+  //! Ensure that the packed factor is not shared with any copies before modifying it.
+  //! Only the columns of the active rows/columns are copied.
+  void EnsureUniqueFactor() {
+    if (gram_decomp_packed_.use_count() > 1) {
+      std::shared_ptr<double> unique = AllocatePacked(max_active_);
+      const double * const shared = gram_decomp_packed_.get();
+      std::copy(shared, shared + active_size_ * (active_size_ + 1) / 2, unique.get());
+      gram_decomp_packed_ = std::move(unique);
+    }
+  }
+
+  //! Unpack the lower triangle *L = U'* of the active decomposition into a dense matrix.
+  arma::mat UnpackLower() const {
+    arma::mat lower(active_size_, active_size_, arma::fill::zeros);
+    const double * packed_col = gram_decomp_packed_.get();
+    for (arma::uword col = 0; col < active_size_; ++col) {
+      for (arma::uword row = 0; row <= col; ++row) {
+        lower.at(col, row) = *packed_col++;
+      }
+    }
+    return lower;
   }
 
-  arma::mat gram_;
+  std::shared_ptr<arma::mat> gram_;
   arma::uword max_active_;
   arma::uword active_size_;
   arma::uvec active_cols_;
-  std::unique_ptr<double[]> gram_decomp_packed_;
+  std::shared_ptr<double> gram_decomp_packed_;
 };
 
 //! Define a proxy to compute elementwise products in-place for "any" type of left-hand-side and
@@ -13,6 +13,7 @@
 #include <memory>
 #include <type_traits>
 #include <algorithm>
+#include <limits>
 
 #include "../armadillo.hpp"
 #include "../traits/traits.hpp"
@@ -46,11 +47,63 @@ struct MMConfiguration {
   TighteningType tightening;
   //! Number of tightening steps if using adaptive thightening.
   int adaptive_tightening_steps;
+  //! Stop the MM algorithm as soon as the relative change in the weights of the convex surrogate is less than this
+  //! threshold (and the inner tolerance cannot be tightened further). In this case the next convex surrogate is
+  //! (almost) identical to the current one and the inner optimizer would merely reproduce the current iterate.
+  //! Only used if the convex surrogate is a weighted loss. A non-positive value disables this check.
+  double min_weight_change;
+  //! Accelerate the outer iterations by extrapolating the MM iterates in the direction of the last step
+  //! (Nesterov-type momentum). The extrapolated point is only used if it improves the objective function,
+  //! hence the MM algorithm remains a descent method.
+  bool accelerate;
 };
 
 namespace mm_optimizer {
 //! Default configuration for the MM algorithm.
-constexpr MMConfiguration kDefaultMMConfiguration = {500, MMConfiguration::TighteningType::kNone, 10};
+constexpr MMConfiguration kDefaultMMConfiguration = {500, MMConfiguration::TighteningType::kNone, 10, 0, false};
+
+//! Compute the relative change in the weights of two weighted convex surrogates.
+//!
+//! @param previous the previous convex surrogate.
+//! @param next the next convex surrogate.
+//! @return the largest absolute change of a weight, relative to the largest previous weight.
+template<typename PreviousSurrogate, typename NextSurrogate>
+double WeightChange(const PreviousSurrogate& previous, const NextSurrogate& next, std::true_type /* is_weighted */) {
+  const arma::vec previous_weights = previous.weights();
+  const double max_weight = std::max(arma::norm(previous_weights, "inf"), std::numeric_limits<double>::epsilon());
+  return arma::norm(next.weights() - previous_weights, "inf") / max_weight;
+}
+
+//! The change in the convex surrogate can not be determined for unweighted surrogates.
+template<typename PreviousSurrogate, typename NextSurrogate>
+double WeightChange(const PreviousSurrogate&, const NextSurrogate&, std::false_type /* is_weighted */) noexcept {
+  return std::numeric_limits<double>::infinity();
+}
+
+//! Update the convex surrogate of the inner optimizer for the given residuals.
+//! For weighted surrogates, the weights of the inner optimizer's loss are replaced in place, retaining the buffers
+//! of the loss. The inner optimizer is then notified by setting its own loss again.
+//!
+//! @param loss the loss function.
+//! @param residuals the residuals where the convex surrogate should be constructed.
+//! @param optimizer the inner optimizer.
+template<typename LossFunction, typename Optimizer>
+void UpdateSurrogate(LossFunction* loss, const arma::vec& residuals, Optimizer* optimizer,
+                     std::true_type /* is_weighted */) {
+  loss->UpdateConvexSurrogate(residuals, &optimizer->loss());
+  optimizer->loss(optimizer->loss());
+}
+
+//! Update the convex surrogate of the inner optimizer for the given residuals.
+//!
+//! @param loss the loss function.
+//! @param residuals the residuals where the convex surrogate should be constructed.
+//! @param optimizer the inner optimizer.
+template<typename LossFunction, typename Optimizer>
+void UpdateSurrogate(LossFunction* loss, const arma::vec& residuals, Optimizer* optimizer,
+                     std::false_type /* is_weighted */) {
+  optimizer->loss(loss->GetConvexSurrogate(residuals));
+}
 
 template<typename Optimizer>
 class InnerToleranceTightening {
@@ -213,6 +266,7 @@ class MMOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coefficients
   using PenaltyFunctionPtr = std::unique_ptr<PenaltyFunction>;
   using IsIterativeAlgorithmTag = typename traits::is_iterative_algorithm<InnerOptimizerType>::type;
   using ResidType = typename LossFunction::ResidualType;
+  using IsWeightedSurrogateTag = typename traits::is_weighted<typename LossFunction::ConvexSurrogateType>::type;
 
   static_assert(traits::has_convex_surrogate<LossFunction, Coefficients>::value,
                 "LossFunction does not provide a convex surrogate.");
@@ -413,6 +467,9 @@ class MMOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coefficients
     bool restart_inner = true;
     bool final_iterations = false;
     int iter = 0;
+    // The previous (non-extrapolated) iterate and the number of consecutive successful extrapolations.
+    Coefficients previous_coefs;
+    int momentum_steps = 1;
 
     while (iter++ < max_it) {
       // UpdateInnerConvergenceTolerance(rel_tol, IsIterativeAlgorithmTag{});
@@ -436,7 +493,7 @@ class MMOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coefficients
       }
 
       // Check for convergence.
-      const double new_objf_value = loss_->Evaluate(optimum.residuals) + penalty_->Evaluate(optimum.coefs);
+      double new_objf_value = loss_->Evaluate(optimum.residuals) + penalty_->Evaluate(optimum.coefs);
       rel_difference = objf_value - new_objf_value;
 
       iter_metrics.AddDetail("iter", iter);
@@ -490,12 +547,55 @@ class MMOptimizer : public Optimizer<LossFunction, PenaltyFunction, Coefficients
       coefs_ = std::move(optimum.coefs);
       residuals = std::move(optimum.residuals);
 
+      if (config_.accelerate) {
+        if (previous_coefs.beta.n_elem > 0) {
+          // Extrapolate in the direction of the last MM step and continue from the extrapolated point if it
+          // improves the objective function. Otherwise, restart the momentum.
+          const double step = static_cast<double>(momentum_steps) / (momentum_steps + 3);
+          Coefficients extrapolated = coefs_;
+          extrapolated.beta += step * (coefs_.beta - previous_coefs.beta);
+          extrapolated.intercept += step * (coefs_.intercept - previous_coefs.intercept);
+          auto extrapolated_residuals = loss_->Residuals(extrapolated);
+          const double extrapolated_objf_value = loss_->Evaluate(extrapolated_residuals) +
+            penalty_->Evaluate(extrapolated);
+          previous_coefs = coefs_;
+          if (extrapolated_objf_value < new_objf_value) {
+            iter_metrics.AddDetail("extrapolation_step", step);
+            ++momentum_steps;
+            coefs_ = std::move(extrapolated);
+            residuals = std::move(extrapolated_residuals);
+            new_objf_value = extrapolated_objf_value;
+            restart_inner = true;
+          } else {
+            momentum_steps = 1;
+          }
+        } else {
+          previous_coefs = coefs_;
+        }
+      }
+
       // Make inner iteration more precise, i.e., decrease the relative tolerance.
       tightener->Tighten(rel_difference);
 
       // Update the convex surrogates for the internal optimizer.
       try {
-        optimizer_.loss(loss_->GetConvexSurrogate(residuals));
+        if (config_.min_weight_change > 0 && !tightener->CanTightenFurther()) {
+          auto surrogate = loss_->GetConvexSurrogate(residuals);
+          // If the surrogate is (almost) unchanged, the inner optimizer would only reproduce the current iterate.
+          const double weight_change = mm_optimizer::WeightChange(optimizer_.loss(), surrogate,
+                                                                  IsWeightedSurrogateTag{});
+          iter_metrics.AddDetail("weight_change", weight_change);
+          if (weight_change < config_.min_weight_change) {
+            metrics->AddMetric("iter", iter);
+            metrics->AddDetail("final_rel_difference", rel_difference);
+            metrics->AddDetail("final_innner_tol", tightener->current_tolerance());
+            metrics->AddDetail("final_weight_change", weight_change);
+            return MakeOptimum(*loss_, *penalty_, coefs_, residuals, new_objf_value, std::move(metrics));
+          }
+          optimizer_.loss(surrogate);
+        } else {
+          mm_optimizer::UpdateSurrogate(loss_.get(), residuals, &optimizer_, IsWeightedSurrogateTag{});
+        }
       } catch(...) {
         metrics->AddMetric("iter", iter);
         metrics->AddDetail("final_rel_difference", rel_difference);
@@ -10,6 +10,7 @@
 #define NSOPTIM_OPTIMIZER_SOFT_THRESHOLD_HPP_
 
 #include <algorithm>
+#include <cmath>
 
 #include "../armadillo.hpp"
 
@@ -20,12 +21,8 @@ namespace nsoptim {
 //! @param gamma the threshold.
 //! @return the soft-thresholded value.
 inline double SoftThreshold(const double z, const double gamma) noexcept {
-  if (std::fabs(z) <= gamma) {
-    return 0.;
-  } else if (z < 0) {
-    return z + gamma;
-  }
-  return z - gamma;
+  // Branch-free form, which compiles to a handful of instructions.
+  return std::copysign(std::max(std::fabs(z) - gamma, 0.), z);
 }
 
 //! Soft-thresholding sign(z) * max(0, |z| - gamma) for a vector of values using the same threshold.
@@ -80,6 +77,47 @@ inline arma::vec SoftThreshold(arma::vec z1, const double c, const arma::vec& z2
 inline arma::sp_vec SoftThreshold(const arma::sp_vec& z1, const double c, const arma::vec& z2,
                                   const arma::vec& gamma) noexcept;
 
+//! Fused soft-thresholding and scaling m * sign(z1 + c * z2) * max(0, |z1 + c * z2| - gamma) for a dense vector `z1`,
+//! written directly into `out`.
+//! The threshold `gamma` and the multiplier `m` are either scalars or vectors with one value per element.
+//! `out` may point to `z1`.
+//!
+//! @param z1 a vector.
+//! @param c a constant multiplicative value.
+//! @param z2 a vector.
+//! @param gamma the threshold(s).
+//! @param multiplier the multiplier(s) applied to the thresholded values.
+//! @param out the vector of thresholded values.
+template<typename Threshold, typename Multiplier>
+inline void SoftThreshold(const arma::vec& z1, const double c, const arma::vec& z2, const Threshold& gamma,
+                          const Multiplier& multiplier, arma::vec* out) noexcept;
+
+//! Fused soft-thresholding and scaling m * sign(z1 + c * z2) * max(0, |z1 + c * z2| - gamma) for a dense vector `z1`,
+//! written directly into the sparse vector `out`.
+//!
+//! @param z1 a vector.
+//! @param c a constant multiplicative value.
+//! @param z2 a vector.
+//! @param gamma the threshold(s).
+//! @param multiplier the multiplier(s) applied to the thresholded values.
+//! @param out the sparse vector of thresholded values.
+template<typename Threshold, typename Multiplier>
+inline void SoftThreshold(const arma::vec& z1, const double c, const arma::vec& z2, const Threshold& gamma,
+                          const Multiplier& multiplier, arma::sp_vec* out);
+
+//! Fused soft-thresholding and scaling m * sign(z1 + c * z2) * max(0, |z1 + c * z2| - gamma) for a sparse vector
+//! `z1`, written directly into `out`. `out` may point to `z1`.
+//!
+//! @param z1 a sparse vector.
+//! @param c a constant multiplicative value.
+//! @param z2 a vector.
+//! @param gamma the threshold(s).
+//! @param multiplier the multiplier(s) applied to the thresholded values.
+//! @param out the sparse vector of thresholded values.
+template<typename Threshold, typename Multiplier>
+inline void SoftThreshold(const arma::sp_vec& z1, const double c, const arma::vec& z2, const Threshold& gamma,
+                          const Multiplier& multiplier, arma::sp_vec* out);
+
 namespace soft_threshold {
 constexpr float kVecSoftthreshInplaceSparse = 1.5;   //< Vectors with more than 2/3 non-zero elements are always
                                                      //< considered dense.
@@ -374,7 +412,7 @@ inline arma::sp_vec SoftThresholdSparse(const arma::sp_vec& z1, const double c,
 //! *actually dense*
 //!
 //! @param gamma the thresholds.
-arma::sp_vec SoftThresholdDense(const arma::sp_vec& sz1, const double c, const arma::vec& z2,
+inline arma::sp_vec SoftThresholdDense(const arma::sp_vec& sz1, const double c, const arma::vec& z2,
                                 const arma::vec& gamma) noexcept {
   // Make a dense copy of the sparse vector `z1`. We know that `z1` is not that sparse
   // after all or small enough to make this operation faster than having to deal with a
@@ -399,7 +437,104 @@ arma::sp_vec SoftThresholdDense(const arma::sp_vec& sz1, const double c, const a
   // Convert back to a sparse vector
   return arma::sp_vec(z1);
 }
+
+//! Get the value for element `i` of a scalar parameter.
+inline double ElementValue(const double value, const arma::uword) noexcept {
+  return value;
+}
+
+//! Get the value for element `i` of a vector-valued parameter.
+inline double ElementValue(const arma::vec& values, const arma::uword i) noexcept {
+  return values[i];
+}
+
+//! Soft-threshold and scale a single value.
+inline double ScaledSoftThreshold(const double z, const double gamma, const double multiplier) noexcept {
+  return multiplier * SoftThreshold(z, gamma);
+}
+
+//! Thread-local storage for the non-zero elements of a sparse vector being constructed.
+//! The storage grows as required and is reused by all subsequent calls on the same thread.
+struct SparseBuffer {
+  arma::uvec indices;
+  arma::vec values;
+};
+
+//! Get the sparse buffer of the calling thread, ensuring it can hold at least `size` non-zero elements.
+inline SparseBuffer& ThreadSparseBuffer(const arma::uword size) {
+  static thread_local SparseBuffer buffer;
+  if (buffer.indices.n_elem < size) {
+    buffer.indices.set_size(size);
+    buffer.values.set_size(size);
+  }
+  return buffer;
+}
+
+//! Create a sparse vector from the first `nnz` elements of the sparse buffer.
+inline void AssignFromBuffer(const SparseBuffer& buffer, const arma::uword nnz, const arma::uword n_elem,
+                             arma::sp_vec* out) {
+  if (nnz > 0) {
+    *out = arma::sp_mat(buffer.indices.head(nnz), arma::uvec {0, nnz}, buffer.values.head(nnz), n_elem, 1);
+  } else {
+    out->zeros(n_elem);
+  }
+}
 }  // namespace soft_threshold
+
+template<typename Threshold, typename Multiplier>
+inline void SoftThreshold(const arma::vec& z1, const double c, const arma::vec& z2, const Threshold& gamma,
+                          const Multiplier& multiplier, arma::vec* out) noexcept {
+  out->set_size(z1.n_elem);
+  const double * const z1_mem = z1.memptr();
+  const double * const z2_mem = z2.memptr();
+  double * const out_mem = out->memptr();
+  for (arma::uword i = 0; i < z1.n_elem; ++i) {
+    out_mem[i] = soft_threshold::ScaledSoftThreshold(z1_mem[i] + c * z2_mem[i],
+                                                     soft_threshold::ElementValue(gamma, i),
+                                                     soft_threshold::ElementValue(multiplier, i));
+  }
+}
+
+template<typename Threshold, typename Multiplier>
+inline void SoftThreshold(const arma::vec& z1, const double c, const arma::vec& z2, const Threshold& gamma,
+                          const Multiplier& multiplier, arma::sp_vec* out) {
+  auto& buffer = soft_threshold::ThreadSparseBuffer(z1.n_elem);
+  arma::uword nnz = 0;
+  for (arma::uword i = 0; i < z1.n_elem; ++i) {
+    const double thresholded = soft_threshold::ScaledSoftThreshold(z1[i] + c * z2[i],
+                                                                   soft_threshold::ElementValue(gamma, i),
+                                                                   soft_threshold::ElementValue(multiplier, i));
+    if (thresholded != 0.) {
+      buffer.indices[nnz] = i;
+      buffer.values[nnz++] = thresholded;
+    }
+  }
+  soft_threshold::AssignFromBuffer(buffer, nnz, z1.n_elem, out);
+}
+
+template<typename Threshold, typename Multiplier>
+inline void SoftThreshold(const arma::sp_vec& z1, const double c, const arma::vec& z2, const Threshold& gamma,
+                          const Multiplier& multiplier, arma::sp_vec* out) {
+  auto& buffer = soft_threshold::ThreadSparseBuffer(z1.n_elem);
+  arma::uword nnz = 0;
+  // Walk through all elements, merging in the non-zero elements of z1 as they come up.
+  auto z1_it = z1.begin();
+  const auto z1_end = z1.end();
+  for (arma::uword i = 0; i < z1.n_elem; ++i) {
+    double z = c * z2[i];
+    if (z1_it != z1_end && z1_it.row() == i) {
+      z += *z1_it;
+      ++z1_it;
+    }
+    const double thresholded = soft_threshold::ScaledSoftThreshold(z, soft_threshold::ElementValue(gamma, i),
+                                                                   soft_threshold::ElementValue(multiplier, i));
+    if (thresholded != 0.) {
+      buffer.indices[nnz] = i;
+      buffer.values[nnz++] = thresholded;
+    }
+  }
+  soft_threshold::AssignFromBuffer(buffer, nnz, z1.n_elem, out);
+}
 }  // namespace nsoptim
 
 #endif  // NSOPTIM_OPTIMIZER_SOFT_THRESHOLD_HPP_
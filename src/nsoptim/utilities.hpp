@@ -45,6 +45,13 @@ class ObjectId {
     return stream;
   }
 
+  //! Get a hash of the ID, e.g., to use the ID as key in associative containers.
+  //!
+  //! @return the hash of the ID.
+  std::size_t hash() const noexcept {
+    return id_;
+  }
+
   static ObjectId null() noexcept {
     return ObjectId(kNullId);
   }
@@ -9,7 +9,14 @@
 #ifndef OMP_UTILS_HPP_
 #define OMP_UTILS_HPP_
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <utility>
+#include <vector>
+
 #include "autoconfig.hpp"
+#include "blas_utils.hpp"
 
 #ifdef PENSE_DISABLE_OPENMP
 #  undef PENSE_ENABLE_OPENMP
@@ -38,6 +45,43 @@ inline bool Enabled(const int nr_threads) noexcept {
   return nr_threads > 1;
 }
 
+//! Get the number of the calling thread within the current team.
+inline int ThreadNum() noexcept {
+  return omp_get_thread_num();
+}
+
+//! Returns ``true`` if called from within an active parallel region.
+inline bool InParallel() noexcept {
+  return omp_in_parallel() != 0;
+}
+
+//! Restrict nested parallelism for the lifetime of the guard.
+//! Parallel regions opened by the calling thread may use several threads, but parallel regions nested inside of
+//! these regions are executed by a single thread. This avoids oversubscribing the cores if, for example, the ENPY
+//! algorithm runs inside a parallel regularization path. The previous setting is restored when the guard is
+//! destroyed. Inside an active parallel region, the guard does not do anything.
+class NestingGuard {
+ public:
+  NestingGuard() noexcept : active_(!InParallel()), previous_levels_(omp_get_max_active_levels()) {
+    if (active_) {
+      omp_set_max_active_levels(omp_get_active_level() + 1);
+    }
+  }
+
+  NestingGuard(const NestingGuard&) = delete;
+  NestingGuard& operator=(const NestingGuard&) = delete;
+
+  ~NestingGuard() noexcept {
+    if (active_) {
+      omp_set_max_active_levels(previous_levels_);
+    }
+  }
+
+ private:
+  const bool active_;
+  const int previous_levels_;
+};
+
 //! A conditional lock.
 //! The lock is only active, if it is constructed as such.
 class Lock {
@@ -108,6 +152,22 @@ inline constexpr bool Enabled(const int) noexcept {
   return false;
 }
 
+//! Get the number of the calling thread. Without OpenMP support, this is always the main thread.
+inline constexpr int ThreadNum() noexcept {
+  return 0;
+}
+
+//! Without OpenMP support, there are no parallel regions.
+inline constexpr bool InParallel() noexcept {
+  return false;
+}
+
+//! Without OpenMP support, there is no nested parallelism to restrict.
+class NestingGuard {
+ public:
+  NestingGuard() noexcept {}
+};
+
 //! A lock object.
 //! If OpenMP support is disabled, this is just a dummy which does not do anything.
 class Lock {
@@ -127,4 +187,184 @@ class Guard {
 
 #endif
 
+namespace pense {
+namespace omp {
+//! Create one object for each thread in a team, e.g., for collecting results without synchronization.
+//! The object for the calling thread is at position `ThreadNum()`.
+//!
+//! @param num_threads number of threads in the team.
+//! @param args arguments passed on to the constructor of every object.
+//! @return a vector of `num_threads` objects (at least one).
+template<typename T, typename... Args>
+std::vector<T> PerThread(const int num_threads, const Args&... args) {
+  std::vector<T> objects;
+  objects.reserve(num_threads > 1 ? num_threads : 1);
+  do {
+    objects.emplace_back(args...);
+  } while (static_cast<int>(objects.size()) < num_threads);
+  return objects;
+}
+
+//! Minimum estimated work (in floating point operations) for every thread of a team.
+//! Starting a team of threads, scheduling the tasks and the synchronization afterwards cost in the order of tens of
+//! microseconds, i.e., as much as several ten-thousand floating point operations.
+constexpr double kMinWorkPerThread = 1e5;
+//! Minimum estimated work (in floating point operations) of a single task. Smaller tasks are merged into chunks.
+constexpr double kMinWorkPerTask = 1e4;
+
+//! Cost model for the number of threads worth using for `n_tasks` independent tasks.
+//! Every thread must receive at least `kMinWorkPerThread` and at least one task. If only one thread is worth
+//! using, the tasks should be executed serially.
+//!
+//! @param num_threads the maximum number of threads.
+//! @param n_tasks the number of tasks.
+//! @param task_work the estimated work of a single task, in floating point operations.
+//! @return the number of threads to use, between 1 and `num_threads`.
+inline int Threads(const int num_threads, const int n_tasks, const double task_work) noexcept {
+  if (!Enabled(num_threads) || n_tasks < 2) {
+    return 1;
+  }
+  const double worthwhile = std::min<double>(n_tasks, n_tasks * task_work / kMinWorkPerThread);
+  return std::max(1, std::min(num_threads, static_cast<int>(worthwhile)));
+}
+
+//! Returns ``true`` if OpenMP is enabled and the estimated work of `n_tasks` independent tasks is large enough to
+//! use several threads.
+//!
+//! @param num_threads the maximum number of threads.
+//! @param n_tasks the number of tasks.
+//! @param task_work the estimated work of a single task, in floating point operations.
+inline bool Enabled(const int num_threads, const int n_tasks, const double task_work) noexcept {
+  return Threads(num_threads, n_tasks, task_work) > 1;
+}
+
+//! Number of memory-heavy tasks which can run concurrently within a memory budget.
+//! Memory shared by all tasks is subtracted from the budget first. At least one task can always run.
+//!
+//! @param num_threads the maximum number of threads.
+//! @param memory_budget the memory budget, in bytes. If not positive, the number of threads is not limited.
+//! @param task_bytes the estimated memory held by a single task while it runs, in bytes.
+//! @param shared_bytes the estimated memory shared by all tasks, in bytes.
+//! @return the number of tasks which can run concurrently, between 1 and `num_threads`.
+inline int MemoryLimitedThreads(const int num_threads, const double memory_budget, const double task_bytes,
+                                const double shared_bytes = 0) noexcept {
+  if (!(memory_budget > 0) || !(task_bytes > 0)) {
+    return num_threads;
+  }
+  const double concurrent = std::floor(std::max(memory_budget - shared_bytes, 0.) / task_bytes);
+  return std::max(1, static_cast<int>(std::min<double>(concurrent, num_threads)));
+}
+
+//! Cost model for the number of consecutive tasks to execute as one chunk, such that every chunk has at least
+//! `kMinWorkPerTask`, but every thread still receives at least one chunk.
+//!
+//! @param num_threads the number of threads used.
+//! @param n_tasks the number of tasks.
+//! @param task_work the estimated work of a single task, in floating point operations.
+//! @return the number of tasks per chunk, at least 1.
+inline int ChunkSize(const int num_threads, const int n_tasks, const double task_work) noexcept {
+  const double merged = std::ceil(kMinWorkPerTask / std::max(task_work, 1.));
+  const int max_chunk_size = std::max(1, n_tasks / std::max(num_threads, 1));
+  return std::max(1, std::min(max_chunk_size, static_cast<int>(std::min<double>(merged, n_tasks))));
+}
+
+//! Call `fn(i)` for every `i = 0, ..., n - 1` using up to `num_threads` threads.
+//! If called from within an active parallel region, the calls are executed as tasks by the current team and the
+//! function returns after all calls are done. Otherwise, a new team of `num_threads` threads is created.
+//! The calls must be independent of each other and `fn` must not throw exceptions.
+//!
+//! @param num_threads the number of threads to use.
+//! @param n the number of calls.
+//! @param fn the function to call.
+template<typename Function>
+void ParallelFor(const int num_threads, const int n, const Function& fn) {
+  if (!Enabled(num_threads) || n < 2) {
+    for (int i = 0; i < n; ++i) {
+      fn(i);
+    }
+  } else if (InParallel()) {
+    for (int i = 0; i < n; ++i) {
+      #pragma omp task firstprivate(i) shared(fn)
+      fn(i);
+    }
+    #pragma omp taskwait
+  } else {
+    blas::SingleThreadGuard blas_guard(num_threads);
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic) default(shared)
+    for (int i = 0; i < n; ++i) {
+      fn(i);
+    }
+  }
+}
+
+//! Call `fn(i)` for every `i = 0, ..., n - 1` using as many of the `num_threads` threads as are worth using
+//! according to the estimated work of every call (see `Threads()`). Calls with little work are merged into chunks
+//! (see `ChunkSize()`), and if the total work is small the calls are executed serially by the calling thread.
+//! The calls must be independent of each other and `fn` must not throw exceptions.
+//!
+//! @param num_threads the maximum number of threads to use.
+//! @param n the number of calls.
+//! @param task_work the estimated work of every call, in floating point operations.
+//! @param fn the function to call.
+template<typename Function>
+void ParallelFor(const int num_threads, const int n, const double task_work, const Function& fn) {
+  const int threads = Threads(num_threads, n, task_work);
+  if (threads < 2) {
+    for (int i = 0; i < n; ++i) {
+      fn(i);
+    }
+    return;
+  }
+  const int chunk_size = ChunkSize(threads, n, task_work);
+  if (InParallel()) {
+    for (int first = 0; first < n; first += chunk_size) {
+      #pragma omp task firstprivate(first, chunk_size, n) shared(fn)
+      for (int i = first, last = std::min(first + chunk_size, n); i < last; ++i) {
+        fn(i);
+      }
+    }
+    #pragma omp taskwait
+  } else {
+    blas::SingleThreadGuard blas_guard(threads);
+    #pragma omp parallel for num_threads(threads) schedule(dynamic, chunk_size) default(shared)
+    for (int i = 0; i < n; ++i) {
+      fn(i);
+    }
+  }
+}
+
+//! Call `fn(i)` for every `i = 0, ..., n - 1` like `ParallelFor(num_threads, n, task_work, fn)`, but never run more
+//! than `max_concurrent` calls at the same time. Inside an active parallel region, the calls are distributed over
+//! at most `max_concurrent` tasks, instead of one task per chunk.
+//! The calls must be independent of each other and `fn` must not throw exceptions.
+//!
+//! @param max_concurrent the maximum number of concurrent calls (see `MemoryLimitedThreads()`).
+//! @param num_threads the maximum number of threads to use.
+//! @param n the number of calls.
+//! @param task_work the estimated work of every call, in floating point operations.
+//! @param fn the function to call.
+template<typename Function>
+void BoundedParallelFor(const int max_concurrent, const int num_threads, const int n, const double task_work,
+                        const Function& fn) {
+  const int threads = std::min(max_concurrent, Threads(num_threads, n, task_work));
+  if (threads < 2) {
+    for (int i = 0; i < n; ++i) {
+      fn(i);
+    }
+  } else if (InParallel()) {
+    std::atomic<int> next_index(0);
+    for (int task = 0; task < threads; ++task) {
+      #pragma omp task firstprivate(n) shared(fn, next_index)
+      for (int i = next_index++; i < n; i = next_index++) {
+        fn(i);
+      }
+    }
+    #pragma omp taskwait
+  } else {
+    ParallelFor(threads, n, task_work, fn);
+  }
+}
+}  // namespace omp
+}  // namespace pense
+
 #endif  // OMP_UTILS_HPP_
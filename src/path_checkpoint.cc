@@ -0,0 +1,165 @@
+//
+//  path_checkpoint.cc
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#include "path_checkpoint.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace pense {
+namespace checkpoint {
+std::string FileName(const std::string& directory, const std::uint64_t key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "pense-%016llx.ckpt", static_cast<unsigned long long>(key));
+  return directory + "/" + name;
+}
+
+Writer::Writer(const std::string& path) : stream_(path, std::ios::binary | std::ios::trunc) {}
+
+void Writer::Write(const std::uint64_t value) {
+  stream_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void Writer::Write(const double value) {
+  stream_.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void Writer::Write(const std::string& value) {
+  Write(static_cast<std::uint64_t>(value.size()));
+  stream_.write(value.data(), value.size());
+}
+
+void Writer::Write(const arma::vec& values) {
+  Write(static_cast<std::uint64_t>(values.n_elem));
+  stream_.write(reinterpret_cast<const char*>(values.memptr()), values.n_elem * sizeof(double));
+}
+
+void Writer::Write(const CompactSlope& slope) {
+  Write(static_cast<std::uint64_t>(slope.n_elem));
+  Write(static_cast<std::uint64_t>(slope.IsSparse()));
+  if (slope.IsSparse()) {
+    const arma::sp_vec& sparse = slope.Sparse();
+    Write(static_cast<std::uint64_t>(sparse.n_nonzero));
+    for (auto it = sparse.begin(), end = sparse.end(); it != end; ++it) {
+      Write(static_cast<std::uint64_t>(it.row()));
+      Write(static_cast<double>(*it));
+    }
+  } else {
+    Write(slope.Dense());
+  }
+}
+
+void Writer::Flush() {
+  stream_.flush();
+}
+
+void WriteIdentity(Writer* writer, const Identity& identity) {
+  writer->Write(identity.n_obs);
+  writer->Write(identity.n_pred);
+  writer->Write(identity.data_hash);
+  writer->Write(identity.data_check);
+  writer->Write(identity.penalty_grid);
+  writer->Write(static_cast<std::uint64_t>(identity.penalty_hashes.size()));
+  for (auto&& hash : identity.penalty_hashes) {
+    writer->Write(hash);
+  }
+  writer->Write(identity.options);
+}
+
+namespace {
+//! Read a vector from the checkpoint and compare it bit-by-bit with `expected`.
+bool MatchVector(Reader* reader, const arma::vec& expected) {
+  arma::vec values;
+  return reader->Read(&values) && values.n_elem == expected.n_elem &&
+    (values.n_elem == 0 || std::memcmp(values.memptr(), expected.memptr(), values.n_elem * sizeof(double)) == 0);
+}
+
+//! Read a list of hashes from the checkpoint and compare it with `expected`.
+bool MatchHashes(Reader* reader, const std::vector<std::uint64_t>& expected) {
+  std::uint64_t n_hashes, hash;
+  if (!reader->Read(&n_hashes) || n_hashes != expected.size()) {
+    return false;
+  }
+  for (auto&& expected_hash : expected) {
+    if (!reader->Read(&hash) || hash != expected_hash) {
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+bool MatchIdentity(Reader* reader, const Identity& identity) {
+  std::uint64_t n_obs, n_pred, data_hash, data_check;
+  return reader->Read(&n_obs) && n_obs == identity.n_obs && reader->Read(&n_pred) && n_pred == identity.n_pred &&
+    reader->Read(&data_hash) && data_hash == identity.data_hash &&
+    reader->Read(&data_check) && data_check == identity.data_check &&
+    MatchVector(reader, identity.penalty_grid) && MatchHashes(reader, identity.penalty_hashes) &&
+    MatchVector(reader, identity.options);
+}
+
+Reader::Reader(const std::string& path) : stream_(path, std::ios::binary) {}
+
+bool Reader::Read(std::uint64_t* value) {
+  return static_cast<bool>(stream_.read(reinterpret_cast<char*>(value), sizeof(*value)));
+}
+
+bool Reader::Read(double* value) {
+  return static_cast<bool>(stream_.read(reinterpret_cast<char*>(value), sizeof(*value)));
+}
+
+bool Reader::Read(std::string* value) {
+  std::uint64_t size;
+  if (!Read(&size)) {
+    return false;
+  }
+  value->resize(size);
+  return size == 0 || static_cast<bool>(stream_.read(&(*value)[0], size));
+}
+
+bool Reader::Read(arma::vec* values) {
+  std::uint64_t n_elem;
+  if (!Read(&n_elem)) {
+    return false;
+  }
+  values->set_size(n_elem);
+  return n_elem == 0 ||
+    static_cast<bool>(stream_.read(reinterpret_cast<char*>(values->memptr()), n_elem * sizeof(double)));
+}
+
+bool Reader::Read(CompactSlope* slope) {
+  std::uint64_t n_elem, is_sparse;
+  if (!Read(&n_elem) || !Read(&is_sparse)) {
+    return false;
+  }
+  if (!is_sparse) {
+    arma::vec dense;
+    if (!Read(&dense) || dense.n_elem != n_elem) {
+      return false;
+    }
+    *slope = CompactSlope(std::move(dense));
+    return true;
+  }
+
+  std::uint64_t n_nonzero;
+  if (!Read(&n_nonzero)) {
+    return false;
+  }
+  arma::umat locations(2, n_nonzero, arma::fill::zeros);
+  arma::vec values(n_nonzero);
+  for (std::uint64_t i = 0; i < n_nonzero; ++i) {
+    std::uint64_t row;
+    if (!Read(&row) || row >= n_elem || !Read(&values[i])) {
+      return false;
+    }
+    locations(0, i) = row;
+  }
+  *slope = CompactSlope(arma::sp_vec(arma::sp_mat(locations, values, n_elem, 1)));
+  return true;
+}
+}  // namespace checkpoint
+}  // namespace pense
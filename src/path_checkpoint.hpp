@@ -0,0 +1,291 @@
+//
+//  path_checkpoint.hpp
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef PATH_CHECKPOINT_HPP_
+#define PATH_CHECKPOINT_HPP_
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nsoptim.hpp"
+#include "alias.hpp"
+#include "compact_optimum.hpp"
+
+namespace pense {
+namespace checkpoint {
+//! Identifies checkpoint files and the version of their layout ("PENSECK2").
+constexpr std::uint64_t kMagic = 0x50454e5345434b32;
+//! Marks the start of the record of a completed penalty.
+constexpr std::uint64_t kPenaltyRecord = 0x50454e414c545931;
+//! Marks the start of the record of a completed segment of the regularization path.
+constexpr std::uint64_t kSegmentRecord = 0x5345474d454e5431;
+
+//! Name of the checkpoint file in `directory` for the regularization path identified by `key`.
+//!
+//! @param directory the directory holding the checkpoint files.
+//! @param key the key identifying the data and the penalties of the regularization path.
+//! @return the path to the checkpoint file.
+std::string FileName(const std::string& directory, const std::uint64_t key);
+
+//! Binary output stream for a checkpoint file.
+//! The file starts with a header and the starting points computed before the first penalty, followed by one record
+//! per completed penalty or per completed segment of penalties. Records are appended and flushed as the penalties
+//! or segments are completed, hence a checkpoint file is valid up to the last complete record if the computation is
+//! aborted while writing.
+class Writer {
+ public:
+  //! Create a new checkpoint file, replacing an existing file at the same path.
+  explicit Writer(const std::string& path);
+
+  //! Check if all writes so far succeeded.
+  bool good() const noexcept {
+    return stream_.good();
+  }
+
+  void Write(const std::uint64_t value);
+  void Write(const double value);
+  void Write(const std::string& value);
+  void Write(const arma::vec& values);
+  void Write(const CompactSlope& slope);
+
+  //! Flush the records written so far to the file.
+  void Flush();
+
+ private:
+  std::ofstream stream_;
+};
+
+//! Binary input stream for a checkpoint file.
+//! All read functions return `false` if the value could not be read, e.g., because the file ends prematurely.
+class Reader {
+ public:
+  //! Open the checkpoint file at `path`. If the file does not exist, all reads fail.
+  explicit Reader(const std::string& path);
+
+  bool Read(std::uint64_t* value);
+  bool Read(double* value);
+  bool Read(std::string* value);
+  bool Read(arma::vec* values);
+  bool Read(CompactSlope* slope);
+
+ private:
+  std::ifstream stream_;
+};
+
+//! Identity of the regularization path a checkpoint was written for.
+//! A checkpoint is only resumed if the identity stored in the file matches exactly, as the key alone may collide.
+struct Identity {
+  std::uint64_t n_obs;  //!< Number of observations.
+  std::uint64_t n_pred;  //!< Number of predictors.
+  std::uint64_t data_hash;  //!< Fingerprint of the data.
+  std::uint64_t data_check;  //!< Independent check sum of the data.
+  arma::vec penalty_grid;  //!< The hyper-parameters alpha and lambda of each penalty, one pair after another.
+  std::vector<std::uint64_t> penalty_hashes;  //!< Hash of each penalty, including the penalty loadings.
+  arma::vec options;  //!< The values of all options affecting the regularization path.
+};
+
+//! Write the identity of a regularization path to a checkpoint file.
+void WriteIdentity(Writer* writer, const Identity& identity);
+
+//! Read the identity of a regularization path from a checkpoint file and compare it with `identity`.
+//!
+//! @return `true` if the identity could be read and is equal to `identity`, `false` otherwise.
+bool MatchIdentity(Reader* reader, const Identity& identity);
+
+//! An optimum restored from a checkpoint.
+struct Solution {
+  CompactCoefficients coefs;
+  double objf_value;
+  nsoptim::OptimumStatus status;
+  std::string message;
+};
+
+//! The state of a regularization path restored from a checkpoint.
+template<typename Coefficients>
+struct State {
+  //! Starting points computed before the first penalty (e.g., the ENPY initial estimates), one list per penalty.
+  alias::FwdList<alias::FwdList<Coefficients>> starts;
+  //! The optima at the completed penalties, in the order of the penalties.
+  std::vector<std::vector<Solution>> completed;
+  //! The optima at the penalties of completed segments, keyed by the index of the first penalty in the segment.
+  std::map<std::uint64_t, std::vector<std::vector<Solution>>> segments;
+};
+
+//! Write the coefficients to a checkpoint file.
+template<typename Coefficients>
+void WriteCoefficients(Writer* writer, const Coefficients& coefs) {
+  writer->Write(coefs.intercept);
+  writer->Write(CompactSlope(typename Coefficients::SlopeCoefficient(coefs.beta)));
+}
+
+//! Write compactly stored coefficients to a checkpoint file.
+inline void WriteCoefficients(Writer* writer, const CompactCoefficients& coefs) {
+  writer->Write(coefs.intercept);
+  writer->Write(coefs.beta);
+}
+
+//! Read coefficients from a checkpoint file.
+template<typename Coefficients>
+bool ReadCoefficients(Reader* reader, Coefficients* coefs) {
+  CompactSlope slope;
+  if (!reader->Read(&coefs->intercept) || !reader->Read(&slope)) {
+    return false;
+  }
+  coefs->beta = slope.template As<typename Coefficients::SlopeCoefficient>();
+  return true;
+}
+
+//! Write the header of a checkpoint file and the starting points computed before the first penalty.
+//!
+//! @param writer the writer for the new checkpoint file.
+//! @param key the key identifying the data and the penalties of the regularization path.
+//! @param identity the full identity of the regularization path.
+//! @param starts lists of starting points, one for each penalty. May be empty.
+template<typename Coefficients>
+void WriteHeader(Writer* writer, const std::uint64_t key, const Identity& identity,
+                 const alias::FwdList<alias::FwdList<Coefficients>>& starts) {
+  writer->Write(kMagic);
+  writer->Write(key);
+  WriteIdentity(writer, identity);
+  writer->Write(static_cast<std::uint64_t>(std::distance(starts.begin(), starts.end())));
+  for (auto&& penalty_starts : starts) {
+    writer->Write(static_cast<std::uint64_t>(std::distance(penalty_starts.begin(), penalty_starts.end())));
+    for (auto&& start : penalty_starts) {
+      WriteCoefficients(writer, start);
+    }
+  }
+  writer->Flush();
+}
+
+//! Write the optima at a single penalty to a checkpoint file.
+template<typename Optima>
+void WriteOptima(Writer* writer, const Optima& optima) {
+  writer->Write(static_cast<std::uint64_t>(std::distance(optima.begin(), optima.end())));
+  for (auto&& optimum : optima) {
+    WriteCoefficients(writer, optimum.coefs);
+    writer->Write(optimum.objf_value);
+    writer->Write(static_cast<std::uint64_t>(optimum.status));
+    writer->Write(optimum.message);
+  }
+}
+
+//! Read the optima at a single penalty from a checkpoint file.
+inline bool ReadSolutions(Reader* reader, std::vector<Solution>* solutions) {
+  std::uint64_t n_optima;
+  if (!reader->Read(&n_optima)) {
+    return false;
+  }
+  solutions->resize(n_optima);
+  for (auto&& solution : *solutions) {
+    std::uint64_t status;
+    if (!reader->Read(&solution.coefs.intercept) || !reader->Read(&solution.coefs.beta) ||
+        !reader->Read(&solution.objf_value) || !reader->Read(&status) || !reader->Read(&solution.message)) {
+      return false;
+    }
+    solution.status = static_cast<nsoptim::OptimumStatus>(status);
+  }
+  return true;
+}
+
+//! Append the record of a completed segment of the regularization path to a checkpoint file.
+//!
+//! @param writer the writer for the checkpoint file.
+//! @param first the index of the first penalty in the segment.
+//! @param begin iterator to the optima at the first penalty in the segment.
+//! @param end iterator past the optima at the last penalty in the segment.
+template<typename Iterator>
+void WriteSegment(Writer* writer, const std::uint64_t first, Iterator begin, Iterator end) {
+  writer->Write(kSegmentRecord);
+  writer->Write(first);
+  writer->Write(static_cast<std::uint64_t>(std::distance(begin, end)));
+  for (; begin != end; ++begin) {
+    WriteOptima(writer, *begin);
+  }
+  writer->Flush();
+}
+
+//! Append the record of a completed penalty to a checkpoint file.
+//!
+//! @param writer the writer for the checkpoint file.
+//! @param optima the compact optima at the completed penalty.
+template<typename Optimum>
+void WritePenalty(Writer* writer, const alias::FwdList<CompactOptimum<Optimum>>& optima) {
+  writer->Write(kPenaltyRecord);
+  WriteOptima(writer, optima);
+  writer->Flush();
+}
+
+//! Restore the state of a regularization path from a checkpoint file.
+//! Incomplete trailing records, e.g., from an aborted write, are ignored.
+//!
+//! @param path the path to the checkpoint file.
+//! @param key the key identifying the data and the penalties of the regularization path.
+//! @param identity the full identity of the regularization path. The checkpoint is not resumed if the identity
+//!                 stored in the file differs in any way.
+//! @param state Out. The restored state.
+//! @return `true` if the file exists and was written for the same key and identity, `false` otherwise.
+template<typename Coefficients>
+bool Load(const std::string& path, const std::uint64_t key, const Identity& identity, State<Coefficients>* state) {
+  Reader reader(path);
+  std::uint64_t magic, file_key, n_lists;
+  if (!reader.Read(&magic) || magic != kMagic || !reader.Read(&file_key) || file_key != key ||
+      !MatchIdentity(&reader, identity) || !reader.Read(&n_lists)) {
+    return false;
+  }
+  auto starts_it = state->starts.before_begin();
+  for (std::uint64_t list = 0; list < n_lists; ++list) {
+    std::uint64_t n_starts;
+    if (!reader.Read(&n_starts)) {
+      return false;
+    }
+    starts_it = state->starts.emplace_after(starts_it);
+    auto start_it = starts_it->before_begin();
+    for (std::uint64_t i = 0; i < n_starts; ++i) {
+      Coefficients start;
+      if (!ReadCoefficients(&reader, &start)) {
+        return false;
+      }
+      start_it = starts_it->emplace_after(start_it, std::move(start));
+    }
+  }
+
+  // Records of penalties and of segments may follow in any order.
+  std::uint64_t marker;
+  while (reader.Read(&marker)) {
+    if (marker == kPenaltyRecord) {
+      std::vector<Solution> solutions;
+      if (!ReadSolutions(&reader, &solutions)) {
+        return true;
+      }
+      state->completed.emplace_back(std::move(solutions));
+    } else if (marker == kSegmentRecord) {
+      std::uint64_t first, n_penalties;
+      if (!reader.Read(&first) || !reader.Read(&n_penalties)) {
+        return true;
+      }
+      std::vector<std::vector<Solution>> segment(n_penalties);
+      for (auto&& solutions : segment) {
+        if (!ReadSolutions(&reader, &solutions)) {
+          return true;
+        }
+      }
+      state->segments[first] = std::move(segment);
+    } else {
+      return true;
+    }
+  }
+  return true;
+}
+}  // namespace checkpoint
+}  // namespace pense
+
+#endif  // PATH_CHECKPOINT_HPP_
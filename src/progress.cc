@@ -0,0 +1,126 @@
+//
+//  progress.cc
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#include "progress.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <Rinternals.h>
+#include <R_ext/Print.h>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+//! Minimum time between two checks for user interrupts.
+constexpr std::chrono::milliseconds kPollInterval(100);
+
+//! State of the active computation. The atomic members can be accessed from any thread, all other members must only
+//! be accessed from the main thread.
+struct ProgressState {
+  std::atomic<bool> active {false};
+  std::atomic<bool> cancelled {false};
+  std::atomic<int> completed_steps {0};
+  std::thread::id main_thread;
+  int total_steps = 0;
+  bool report = false;
+  bool reported = false;
+  Clock::time_point start;
+  Clock::time_point last_poll;
+};
+
+ProgressState& State() noexcept {
+  static ProgressState state;
+  return state;
+}
+
+bool OnMainThread(const ProgressState& state) noexcept {
+  return std::this_thread::get_id() == state.main_thread;
+}
+
+void CheckInterruptFn(void*) {
+  R_CheckUserInterrupt();
+}
+
+//! Check for user interrupts without leaving the current context.
+//! If an interrupt is pending, it is consumed and `true` is returned.
+bool InterruptPending() noexcept {
+  return R_ToplevelExec(CheckInterruptFn, nullptr) == FALSE;
+}
+}  // namespace
+
+namespace pense {
+namespace progress {
+Scope::Scope(const bool report) noexcept : active_(false) {
+  auto& state = State();
+  if (!state.active.exchange(true)) {
+    active_ = true;
+    state.cancelled = false;
+    state.completed_steps = 0;
+    state.main_thread = std::this_thread::get_id();
+    state.total_steps = 0;
+    state.report = report;
+    state.reported = false;
+    state.start = state.last_poll = Clock::now();
+  }
+}
+
+Scope::~Scope() noexcept {
+  if (active_) {
+    auto& state = State();
+    if (state.reported) {
+      REprintf("\n");
+    }
+    state.active = false;
+  }
+}
+
+bool Cancelled() noexcept {
+  auto& state = State();
+  if (!state.active) {
+    return false;
+  }
+  if (!state.cancelled && OnMainThread(state)) {
+    const auto now = Clock::now();
+    if (now - state.last_poll >= kPollInterval) {
+      state.last_poll = now;
+      if (InterruptPending()) {
+        state.cancelled = true;
+      }
+    }
+  }
+  return state.cancelled;
+}
+
+void AddSteps(const int steps) noexcept {
+  auto& state = State();
+  if (state.active && OnMainThread(state)) {
+    state.total_steps += steps;
+  }
+}
+
+void Cancel() noexcept {
+  State().cancelled = true;
+}
+
+void Step() noexcept {
+  auto& state = State();
+  if (!state.active) {
+    return;
+  }
+  const int completed_steps = ++state.completed_steps;
+  if (state.report && OnMainThread(state)) {
+    const std::chrono::duration<double> elapsed = Clock::now() - state.start;
+    const double remaining = elapsed.count() / completed_steps * (state.total_steps - completed_steps);
+    REprintf("\rCompleted %d of %d penalties, about %.0f seconds remaining   ", completed_steps, state.total_steps,
+             remaining > 0 ? remaining : 0.);
+    state.reported = true;
+  }
+}
+}  // namespace progress
+}  // namespace pense
@@ -0,0 +1,54 @@
+//
+//  progress.hpp
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef PROGRESS_HPP_
+#define PROGRESS_HPP_
+
+namespace pense {
+namespace progress {
+//! Track the progress of a long-running computation and allow cancelling it.
+//! While a scope is active, the computation is cancelled as soon as the user interrupts R. The scope must be created
+//! on the main (R) thread. Scopes created while another scope is active are inactive and do not change the state.
+//!
+//! The computation is split into steps (e.g., penalties along the regularization paths). If reporting is enabled, the
+//! number of completed steps and the estimated remaining time are printed on the main thread.
+class Scope {
+ public:
+  //! Start tracking a computation.
+  //!
+  //! @param report print the progress to the R console.
+  explicit Scope(const bool report) noexcept;
+  ~Scope() noexcept;
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  bool active_;
+};
+
+//! Check if the running computation should be cancelled. Can be called from any thread.
+//! If called from the main thread, first checks for user interrupts. R is polled at most every 100 milliseconds.
+//!
+//! @return `true` if the computation should stop as soon as possible.
+bool Cancelled() noexcept;
+
+//! Add steps to the running computation. Must be called from the main thread.
+//!
+//! @param steps the number of additional steps.
+void AddSteps(const int steps) noexcept;
+
+//! Request cancellation of the running computation. Can be called from any thread.
+void Cancel() noexcept;
+
+//! Record that a step of the running computation is completed. Can be called from any thread.
+//! If called from the main thread and reporting is enabled, the progress is printed.
+void Step() noexcept;
+}  // namespace progress
+}  // namespace pense
+
+#endif  // PROGRESS_HPP_
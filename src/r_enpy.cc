@@ -58,7 +58,14 @@ SEXP PenPyInitialEstimatorImpl(SEXP r_x, SEXP r_y, SEXP r_penalties, SEXP r_slos
   SLoss loss(data, mscale, as<bool>(sloss_params["intercept"]));
 
   Optimizer optimizer = MakeOptimizer<Optimizer>(en_options);
-  auto py_res = PenaYohaiInitialEstimators(loss, penalties, optimizer, enpy_opts);
+  nsoptim::PhaseTimings timings;
+  auto pyconfig = pense::enpy_initest_internal::ParseConfiguration(enpy_opts);
+  pyconfig.timings = &timings;
+  auto py_res = PenaYohaiInitialEstimators(loss, penalties, optimizer, pyconfig);
+  // The timings cover all penalties and are reported with the result for the first penalty.
+  if (!py_res.empty()) {
+    timings.Report(&py_res.front().metrics);
+  }
   return wrap(py_res);
 }
 
@@ -30,14 +30,22 @@ const R_CallMethodDef kExportedCallMethods[] = {
   // {"C_run_testthat_tests", (DL_FUNC) &run_testthat_tests, 0},
   {"C_tau_size", (DL_FUNC) &TauSize, 1},
   {"C_approx_match", (DL_FUNC) &ApproximateMatch, 3},
+  {"C_predict_path", (DL_FUNC) &PredictPath, 4},
+  {"C_standardize_columns", (DL_FUNC) &StandardizeColumns, 4},
+  {"C_kernel_counters_start", (DL_FUNC) &KernelCountersStart, 0},
+  {"C_kernel_counters_stop", (DL_FUNC) &KernelCountersStop, 0},
   {"C_mscale", (DL_FUNC) &MScale, 2},
   {"C_mscale_derivative", (DL_FUNC) &MScaleDerivative, 3},
   {"C_max_mscale_derivative", (DL_FUNC) &MaxMScaleDerivative, 4},
   {"C_max_mscale_grad_hess", (DL_FUNC) &MaxMScaleGradientHessian, 4},
   {"C_mloc", (DL_FUNC) &MLocation, 3},
   {"C_mlocscale", (DL_FUNC) &MLocationScale, 3},
+  {"C_mloc_columns", (DL_FUNC) &MLocationColumns, 3},
+  {"C_mlocscale_columns", (DL_FUNC) &MLocationScaleColumns, 5},
   {"C_lsen_regression", (DL_FUNC) &LsEnRegression, 5},
   {"C_pense_regression", (DL_FUNC) &PenseEnRegression, 7},
+  {"C_pense_regression_batch", (DL_FUNC) &PenseEnRegressionBatch, 6},
+  {"C_pense_cv", (DL_FUNC) &PenseEnCrossValidation, 6},
   {"C_pense_max_lambda", (DL_FUNC) &PenseMaxLambda, 4},
   {"C_mesten_regression", (DL_FUNC) &MestEnRegression, 6},
   {"C_mesten_max_lambda", (DL_FUNC) &MestEnMaxLambda, 5},
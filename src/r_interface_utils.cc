@@ -52,8 +52,9 @@ std::unique_ptr<const PredictorResponseData> MakePredictorResponseData(SEXP x, S
     throw std::invalid_argument("y and x must be numeric");
   }
 
-  return std::make_unique<const PredictorResponseData>(arma::mat(REAL(x), x_dims.n_rows, x_dims.n_cols, false, true),
-                                                       vec(REAL(y), nobs_y, false, true));
+  // The data container is a view of the R memory. The memory is only copied if the data is copied (e.g., to modify
+  // the data in place).
+  return std::make_unique<const PredictorResponseData>(REAL(x), REAL(y), x_dims.n_rows, x_dims.n_cols);
 }
 
 AdaptiveEnPenalty MakeAdaptiveEnPenalty(SEXP r_penalty, std::shared_ptr<const vec> loadings) {
@@ -50,25 +50,16 @@ SEXP MestEnRegressionImpl(MMOptimizer optimizer, SEXP x, SEXP y, SEXP scale, SEX
 
 //! Compute the maximum lambda without penalty loadings.
 double MestEnMaxGradient(const arma::mat& x, const arma::vec& weights) {
-  double max_gradient = 0.;
-  for (arma::uword j = 0; j < x.n_cols; ++j) {
-    const double gradient_j = std::abs(arma::mean(x.col(j) % weights));
-    if (gradient_j > max_gradient) {
-      max_gradient = gradient_j;
-    }
-  }
+  // All gradients are computed in a single pass over the predictor matrix.
+  const arma::vec gradients = arma::abs(x.t() * weights) / x.n_rows;
+  const double max_gradient = gradients.n_elem > 0 ? gradients.max() : 0.;
   return max_gradient;
 }
 
 //! Compute the maximum lambda with penalty loadings.
 double MestEnMaxGradient(const arma::mat& x, const arma::vec& weights, std::unique_ptr<const arma::vec> loadings) {
-  double max_gradient = 0.;
-  for (arma::uword j = 0; j < x.n_cols; ++j) {
-    const double gradient_j = std::abs(arma::mean(x.col(j) % weights)) / loadings->at(j);
-    if (gradient_j > max_gradient) {
-      max_gradient = gradient_j;
-    }
-  }
+  const arma::vec gradients = arma::abs(x.t() * weights) / (*loadings * static_cast<double>(x.n_rows));
+  const double max_gradient = gradients.n_elem > 0 ? gradients.max() : 0.;
   return max_gradient;
 }
 
@@ -8,16 +8,29 @@
 
 #include "r_pense_regression.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "rcpp_integration.hpp"
 #include "r_interface_utils.hpp"
 #include "alias.hpp"
 #include "enpy_initest.hpp"
+#include "random_subset_initest.hpp"
 #include "robust_scale_location.hpp"
 #include "s_loss.hpp"
 #include "cd_pense.hpp"
 #include "regularization_path_new.hpp"
+#include "progress.hpp"
+#include "path_checkpoint.hpp"
 #include "constants.hpp"
 
 using Rcpp::as;
@@ -49,12 +62,18 @@ using StartCoefficientsList = FwdList<CoefficientsList<Optimizer>>;
 template<typename Optimizer>
 using PenaltyList = FwdList<typename Optimizer::PenaltyFunction>;
 
+//! A list of optima stored compactly along the regularization path.
+template<typename Optimizer>
+using CompactOptima = FwdList<pense::CompactOptimum<typename Optimizer::Optimum>>;
+
 namespace {
 constexpr double kDefaultExploreTol = 0.1;
 constexpr double kDefaultComparisonTol = 1e-3;
 constexpr double kDefaultExploreIt = 20;
 constexpr int kDefaultMaxOptima = 10;
 constexpr int kDefaultExploreSolutions = 10;
+constexpr bool kDefaultExploreRacing = false;
+constexpr double kDefaultExploreClusterTol = 0;
 constexpr bool kDefaultUseWarmStarts = true;
 constexpr bool kDefaultStrategy0 = true;
 constexpr bool kDefaultStrategyEnpyShared = true;
@@ -62,19 +81,25 @@ constexpr bool kDefaultStrategyEnpyIndividual = false;
 constexpr bool kDefaultStrategyOtherShared = true;
 constexpr bool kDefaultStrategyOtherIndividual = false;
 constexpr int kDefaultNumberOfThreads = 1;
+constexpr double kDefaultMemoryBudget = 0;
+constexpr bool kDefaultReportProgress = false;
+constexpr bool kDefaultCompactResults = false;
+constexpr bool kDefaultNestedMetrics = true;
+constexpr int kDefaultPathSegments = 1;
+//! Relative tolerance for matching the penalty levels of a previous fit.
+constexpr double kContinuationLambdaTolerance = 1e-8;
 
 //! Expand a list of PY Results to a list of start coefficients.
 //!
 //! @param py_res the results of the ENPY algorithm.
 //! @param penalties a list of the penalties.
-//! @param r_indices vector of 1-based indices in the penalties list at which the PY estimates
+//! @param indices vector of 1-based indices in the penalties list at which the PY estimates
 //!     were computed.
 //! @return a list the same length and order as `penalties`.
 template<typename Optimizer>
 StartCoefficientsList<Optimizer> PyResultToStartCoefficients(
      const FwdList<PyResult<Optimizer>>& py_res, const PenaltyList<Optimizer>& penalties,
-     SEXP r_indices) {
-  const Rcpp::IntegerVector indices(r_indices);
+     const std::vector<int>& indices) {
   StartCoefficientsList<Optimizer> start_coefs;
 
   auto start_coefs_it = start_coefs.before_begin();
@@ -148,39 +173,85 @@ InputIterator AddEstimates(InputIterator iterator, InputIterator end, Metrics* m
   return iterator;
 }
 
-//! Compute the ENPY initial estimates using the specified `LsOptimizer` class.
+//! Computation of the ENPY initial estimates, deferred until the regularization path is computed.
+//! The function does not use the R API and can hence be called from any thread.
+template<typename SOptimizer>
+using DeferredEnpy = std::function<StartCoefficientsList<SOptimizer>(const SLoss&, const PenaltyList<SOptimizer>&,
+                                                                     Metrics * const, nsoptim::PhaseTimings * const)>;
+
+//! Prepare the computation of the ENPY initial estimates using the specified `LsOptimizer` class.
 //! This implementation of the function is used if the `LsOptimizer` class can not handle the desired penalty function
 //! or the desired coefficients type.
 //!
-//! @return an empty list of start coefficients.
+//! @return a function returning an empty list of start coefficients.
 template<typename LsOptimizer, typename SOptimizer>
-StartCoefficientsList<SOptimizer> EnpyInitialEstimatesImpl(const SLoss&,
-                                                           const FwdList<typename SOptimizer::PenaltyFunction>&,
-                                                           SEXP, SEXP, const Rcpp::List&, const Rcpp::List&,
-                                                           const Rcpp::List&, Metrics * const, double) {
-  return StartCoefficientsList<SOptimizer>();
+DeferredEnpy<SOptimizer> EnpyInitialEstimatesImpl(SEXP, SEXP, const Rcpp::List&, const Rcpp::List&,
+                                                  const Rcpp::List&, const SOptimizer&, const int, double) {
+  return [](const SLoss&, const PenaltyList<SOptimizer>&, Metrics * const, nsoptim::PhaseTimings * const) {
+    return StartCoefficientsList<SOptimizer>();
+  };
 }
 
-//! Compute the ENPY initial estimates using the specified `LsOptimizer` class.
+//! Prepare the computation of the ENPY initial estimates using the specified `LsOptimizer` class.
 //! This implementation of the function is used if the `LsOptimizer` can handle the desired penalty function and the
 //! desired coefficients type.
+//! If `enpy_opts["method"]` requests initial estimates from random subsets, the candidates are computed by
+//! `RandomSubsetInitialEstimators()` instead of the ENPY procedure and concentrated with `s_optimizer`.
 //!
-//! @return a list of start coefficients. The returned list is either empty or contains lists of start coefficients for
-//!         *each* penalty parameter.
+//! @return a function computing the list of start coefficients. The returned list is either empty or contains lists
+//!         of start coefficients for *each* penalty parameter.
 template<typename LsOptimizer, typename SOptimizer, typename = typename
          std::enable_if<std::is_same<typename LsOptimizer::Coefficients, typename SOptimizer::Coefficients>::value &&
                         std::is_same<typename LsOptimizer::PenaltyFunction,
                                      typename SOptimizer::PenaltyFunction>::value>::type>
-StartCoefficientsList<SOptimizer> EnpyInitialEstimatesImpl(
-    const SLoss& loss, const FwdList<typename SOptimizer::PenaltyFunction>& penalties, SEXP r_penalties,
-    SEXP r_enpy_inds, const Rcpp::List& enpy_opts, const Rcpp::List& en_options, const Rcpp::List& optional_args,
-    Metrics * const metrics, int) {
+DeferredEnpy<SOptimizer> EnpyInitialEstimatesImpl(SEXP r_penalties, SEXP r_enpy_inds, const Rcpp::List& enpy_opts,
+                                                  const Rcpp::List& en_options, const Rcpp::List& optional_args,
+                                                  const SOptimizer& s_optimizer, const int num_threads, int) {
   const auto enpy_penalties = MakePenalties<LsOptimizer>(r_penalties, r_enpy_inds, optional_args);
 
   if (enpy_penalties.empty()) {
-    return StartCoefficientsList<LsOptimizer>();
-  } else {
-    auto py_res = PenaYohaiInitialEstimators(loss, enpy_penalties, MakeOptimizer<LsOptimizer>(en_options), enpy_opts);
+    return [](const SLoss&, const PenaltyList<SOptimizer>&, Metrics * const, nsoptim::PhaseTimings * const) {
+      return StartCoefficientsList<SOptimizer>();
+    };
+  }
+
+  const auto optimizer = MakeOptimizer<LsOptimizer>(en_options);
+  const auto enpy_inds = as<std::vector<int>>(r_enpy_inds);
+
+  if (GetFallback(enpy_opts, "method", pense::kDefaultInitialEstimatorMethod) ==
+      pense::InitialEstimatorMethod::kRandomSubsets) {
+    auto subset_config = pense::random_subset_initest_internal::ParseConfiguration(enpy_opts);
+    if (num_threads > 0) {
+      subset_config.num_threads = num_threads;
+    }
+    return [enpy_penalties, optimizer, s_optimizer, subset_config, enpy_inds](
+        const SLoss& loss, const PenaltyList<SOptimizer>& penalties, Metrics * const metrics,
+        nsoptim::PhaseTimings * const timings) {
+      auto timed_config = subset_config;
+      timed_config.timings = timings;
+      auto subset_res = pense::RandomSubsetInitialEstimators(loss, enpy_penalties, optimizer, s_optimizer,
+                                                             timed_config);
+
+      auto&& subset_metrics = metrics->CreateSubMetrics("random_subset_initest");
+      for (auto&& single_subset_res : subset_res) {
+        subset_metrics.AddSubMetrics(std::move(single_subset_res.metrics));
+      }
+
+      return PyResultToStartCoefficients(subset_res, penalties, enpy_inds);
+    };
+  }
+
+  auto pyconfig = pense::enpy_initest_internal::ParseConfiguration(enpy_opts);
+  if (num_threads > 0) {
+    pyconfig.num_threads = num_threads;
+  }
+
+  return [enpy_penalties, optimizer, pyconfig, enpy_inds](const SLoss& loss, const PenaltyList<SOptimizer>& penalties,
+                                                          Metrics * const metrics,
+                                                          nsoptim::PhaseTimings * const timings) {
+    auto timed_pyconfig = pyconfig;
+    timed_pyconfig.timings = timings;
+    auto py_res = PenaYohaiInitialEstimators(loss, enpy_penalties, optimizer, timed_pyconfig);
 
     // Move metrics from the PY results.
     auto&& enpy_metrics = metrics->CreateSubMetrics("enpy_initest");
@@ -188,22 +259,24 @@ StartCoefficientsList<SOptimizer> EnpyInitialEstimatesImpl(
       enpy_metrics.AddSubMetrics(std::move(single_py_res.metrics));
     }
 
-    return PyResultToStartCoefficients(py_res, penalties, r_enpy_inds);
-  }
+    return PyResultToStartCoefficients(py_res, penalties, enpy_inds);
+  };
 }
 
-//! Compute the ENPY initial estimates using the options provided in `enpy_opts`.
-//! This function inspects `enpy_opts["en_options"]` to determine which LS-EN algorithm to use and only returns a
-//! non-empty list of start coefficients if LS-EN algorithm is compatible with both the coefficients and the penalty
-//! function used by the specified `SOptimizer` class.
+//! Prepare the computation of the ENPY initial estimates using the options provided in `enpy_opts`.
+//! This function inspects `enpy_opts["en_options"]` to determine which LS-EN algorithm to use and the deferred
+//! computation only returns a non-empty list of start coefficients if LS-EN algorithm is compatible with both the
+//! coefficients and the penalty function used by the specified `SOptimizer` class.
 //!
-//! @return a list of start coefficients. The returned list is either empty or contains lists of start coefficients for
-//!         *each* penalty parameter.
+//! @param s_optimizer the optimizer for the S-loss, used to concentrate the initial estimates from random subsets.
+//! @param num_threads number of threads for computing the ENPY estimates. If less than 1, the number of threads
+//!                    specified in `enpy_opts` is used.
+//! @return a function computing the list of start coefficients. The returned list is either empty or contains lists
+//!         of start coefficients for *each* penalty parameter.
 template<typename SOptimizer>
-StartCoefficientsList<SOptimizer> EnpyInitialEstimates(const SLoss& loss,
-                                                       const FwdList<typename SOptimizer::PenaltyFunction>& penalties,
-                                                       SEXP r_penalties, SEXP r_enpy_inds, SEXP r_enpy_opts,
-                                                       const Rcpp::List& optional_args, Metrics * metrics) {
+DeferredEnpy<SOptimizer> EnpyInitialEstimates(SEXP r_penalties, SEXP r_enpy_inds, SEXP r_enpy_opts,
+                                              const Rcpp::List& optional_args, const SOptimizer& s_optimizer,
+                                              const int num_threads) {
   using PenaltyFunction = typename SOptimizer::PenaltyFunction;
   using Coefficients = typename SOptimizer::Coefficients;
   using LsEnDal = nsoptim::DalEnOptimizer<LsRegressionLoss, PenaltyFunction>;
@@ -216,141 +289,1028 @@ StartCoefficientsList<SOptimizer> EnpyInitialEstimates(const SLoss& loss,
 
   switch (GetFallback(en_options, "algorithm", pense::kDefaultEnAlgorithm)) {
     case pense::EnAlgorithm::kDal:
-      return EnpyInitialEstimatesImpl<LsEnDal, SOptimizer>(loss, penalties, r_penalties, r_enpy_inds, enpy_opts,
-                                                           en_options, optional_args, metrics, 1);
+      return EnpyInitialEstimatesImpl<LsEnDal, SOptimizer>(r_penalties, r_enpy_inds, enpy_opts, en_options,
+                                                           optional_args, s_optimizer, num_threads, 1);
     case pense::EnAlgorithm::kRidge:
-      return EnpyInitialEstimatesImpl<LsRidge, SOptimizer>(loss, penalties, r_penalties, r_enpy_inds, enpy_opts,
-                                                           en_options, optional_args, metrics, 1);
+      return EnpyInitialEstimatesImpl<LsRidge, SOptimizer>(r_penalties, r_enpy_inds, enpy_opts, en_options,
+                                                           optional_args, s_optimizer, num_threads, 1);
     case pense::EnAlgorithm::kLinearizedAdmm:
-      return EnpyInitialEstimatesImpl<LsEnAdmm, SOptimizer>(loss, penalties, r_penalties, r_enpy_inds, enpy_opts,
-                                                            en_options, optional_args, metrics, 1);
+      return EnpyInitialEstimatesImpl<LsEnAdmm, SOptimizer>(r_penalties, r_enpy_inds, enpy_opts, en_options,
+                                                            optional_args, s_optimizer, num_threads, 1);
     case pense::EnAlgorithm::kLars:
     default:
-      return EnpyInitialEstimatesImpl<LsEnLars, SOptimizer>(loss, penalties, r_penalties, r_enpy_inds, enpy_opts,
-                                                            en_options, optional_args, metrics, 1);
+      return EnpyInitialEstimatesImpl<LsEnLars, SOptimizer>(r_penalties, r_enpy_inds, enpy_opts, en_options,
+                                                            optional_args, s_optimizer, num_threads, 1);
   }
 }
 
-//! Compute the PENSE Regularization Path using the provided optimizer for the PENSE objective function.
-//! The optimizer determines:
-//!   * the type of penalty function (EN vs. adaptive EN)
-//!   * the coefficients type (sparse vs. dense)
+//! Standardization of the training data in a CV fold, as computed by `.standardize_data()` in R.
+//! The standardized predictors are `(x - mux) * coef_scale` and the standardized response is `y - muy`.
+struct FoldStandardization {
+  arma::vec mux;  //!< Location of the predictors.
+  double muy;  //!< Location of the response.
+  arma::vec coef_scale;  //!< Scaling of the centered predictors.
+};
+
+//! Parse the standardization of the training data from an R list.
+//! Missing items default to no standardization.
 //!
-//! See `PenseEnRegression` for parameter documentation.
-//! @return the regularization path.
+//! @param r_standardization list with items `mux`, `muy`, and `coef_scale`.
+//! @param n_pred number of predictors.
+//! @return the parsed standardization.
+FoldStandardization ParseFoldStandardization(const Rcpp::List& r_standardization, const arma::uword n_pred) {
+  FoldStandardization standardization { arma::zeros(n_pred), 0., arma::ones(n_pred) };
+  if (r_standardization.containsElementNamed("mux")) {
+    standardization.mux = as<arma::vec>(r_standardization["mux"]);
+  }
+  if (r_standardization.containsElementNamed("muy")) {
+    standardization.muy = as<double>(r_standardization["muy"]);
+  }
+  if (r_standardization.containsElementNamed("coef_scale")) {
+    const arma::vec coef_scale = as<arma::vec>(r_standardization["coef_scale"]);
+    // The scale may be given as a single number for all predictors.
+    if (coef_scale.n_elem == 1) {
+      standardization.coef_scale.fill(coef_scale[0]);
+    } else {
+      standardization.coef_scale = coef_scale;
+    }
+  }
+  if (standardization.mux.n_elem != n_pred || standardization.coef_scale.n_elem != n_pred) {
+    throw std::invalid_argument("standardization of the training data does not match the number of predictors");
+  }
+  return standardization;
+}
+
+//! Starting points for continuing a regularization path from the optima of a previous fit.
 template<class SOptimizer>
-SEXP PenseRegressionImpl(SOptimizer optimizer, SEXP r_x, SEXP r_y, SEXP r_penalties,
-                         SEXP r_enpy_inds, const Rcpp::List& pense_opts, SEXP r_enpy_opts,
-                         const Rcpp::List& optional_args) {
-  using RList = Rcpp::List;
+struct ContinuationStarts {
+  //! The starting points for each penalty. Empty if there are no previous optima.
+  StartCoefficientsList<SOptimizer> starts;
+  //! Whether the penalty is bracketed by penalties of the previous fit.
+  std::vector<bool> bracketed;
+};
+
+//! Collect the starting points from the optima of a previous fit, if given in `optional_args["continuation"]`.
+//! The previous optima are given as list with one item per previous penalty, each a list with items `lambda`
+//! and `starts` (a list of coefficients). A penalty is bracketed if there are previous penalties with smaller and
+//! larger (or equal) `lambda`. The optima at these two penalties are used as starting points for the penalty.
+//! Penalties which are not bracketed start from the optima at the nearest previous penalty.
+//!
+//! @param penalties the penalties of the new regularization path.
+//! @param optional_args list of optional arguments.
+//! @return the starting points for each penalty.
+template<class SOptimizer>
+ContinuationStarts<SOptimizer> MakeContinuationStarts(const PenaltyList<SOptimizer>& penalties,
+                                                      const Rcpp::List& optional_args) {
+  ContinuationStarts<SOptimizer> continuation;
+  const auto previous = GetFallback(optional_args, "continuation", Rcpp::List());
+  if (previous.size() == 0) {
+    return continuation;
+  }
 
-  ConstRegressionDataPtr data(MakePredictorResponseData(r_x, r_y));
+  std::vector<double> previous_lambda;
+  std::vector<CoefficientsList<SOptimizer>> previous_starts;
+  for (auto&& r_previous_optima : previous) {
+    const auto previous_optima = as<Rcpp::List>(r_previous_optima);
+    previous_lambda.push_back(as<double>(previous_optima["lambda"]));
+    previous_starts.emplace_back(as<CoefficientsList<SOptimizer>>(previous_optima["starts"]));
+  }
 
-  pense::Mscale<pense::RhoBisquare> mscale(as<RList>(pense_opts["mscale"]));
-  SLoss loss(data, mscale, as<bool>(pense_opts["intercept"]));
-  auto penalties = MakePenalties<SOptimizer>(r_penalties, optional_args);
+  auto starts_it = continuation.starts.before_begin();
+  for (auto&& penalty : penalties) {
+    const double lambda = penalty.lambda();
+    const double tol = kContinuationLambdaTolerance * lambda;
+    int above = -1;
+    int below = -1;
+    for (int i = 0; i < static_cast<int>(previous_lambda.size()); ++i) {
+      if (previous_lambda[i] >= lambda - tol && (above < 0 || previous_lambda[i] < previous_lambda[above])) {
+        above = i;
+      }
+      if (previous_lambda[i] <= lambda + tol && (below < 0 || previous_lambda[i] > previous_lambda[below])) {
+        below = i;
+      }
+    }
+    continuation.bracketed.push_back(above >= 0 && below >= 0);
 
-  const double eps = GetFallback(pense_opts, "eps", pense::kDefaultConvergenceTolerance);
-  optimizer.convergence_tolerance(eps);
-  optimizer.loss(loss);
+    if (above < 0 || below < 0) {
+      // Use the nearest previous penalty.
+      above = below = std::max(above, below);
+    }
+    CoefficientsList<SOptimizer> starts(previous_starts[above]);
+    if (below != above) {
+      auto insert_it = starts.before_begin();
+      while (std::next(insert_it) != starts.end()) {
+        ++insert_it;
+      }
+      starts.insert_after(insert_it, previous_starts[below].begin(), previous_starts[below].end());
+    }
+    starts_it = continuation.starts.emplace_after(starts_it, std::move(starts));
+  }
+  return continuation;
+}
 
-  Metrics metrics("pense");
-  pense::RegularizationPath<SOptimizer> reg_path(
-    optimizer, penalties,
-    GetFallback(pense_opts, "max_optima", kDefaultMaxOptima),
-    GetFallback(pense_opts, "comparison_tol", kDefaultComparisonTol),
-    GetFallback(pense_opts, "num_threads", kDefaultNumberOfThreads));
+//! Get the index of the first penalty in a segment of the regularization path. The penalties are split into
+//! `n_segments` segments of consecutive penalties with (almost) equal size.
+//!
+//! @param segment the 0-based index of the segment. Segment `n_segments` gives the number of penalties.
+//! @param n_segments the number of segments.
+//! @param n_penalties the number of penalties.
+//! @return the 0-based index of the first penalty in the segment.
+int SegmentStart(const int segment, const int n_segments, const int n_penalties) noexcept {
+  return static_cast<int>(static_cast<std::int64_t>(segment) * n_penalties / n_segments);
+}
 
-  reg_path.ExplorationOptions(GetFallback(pense_opts, "explore_it", kDefaultExploreIt),
-                              GetFallback(pense_opts, "explore_tol", kDefaultExploreTol),
-                              GetFallback(pense_opts, "nr_tracks", kDefaultExploreSolutions));
+//! Add the first penalty of every segment of the regularization path to the ENPY indices, such that every segment
+//! starts from ENPY initial estimates.
+//!
+//! @param r_enpy_inds 1-based indices of the penalties at which ENPY initial estimates should be computed. If empty,
+//!                    no ENPY initial estimates are computed and no indices are added.
+//! @param n_penalties the number of penalties.
+//! @param n_segments the number of segments.
+//! @return the sorted 1-based indices.
+SEXP SegmentEnpyInds(SEXP r_enpy_inds, const int n_penalties, const int n_segments) {
+  auto enpy_inds = as<std::vector<int>>(r_enpy_inds);
+  if (n_segments < 2 || enpy_inds.empty()) {
+    return r_enpy_inds;
+  }
+  for (int segment = 1; segment < n_segments; ++segment) {
+    enpy_inds.push_back(SegmentStart(segment, n_segments, n_penalties) + 1);
+  }
+  std::sort(enpy_inds.begin(), enpy_inds.end());
+  enpy_inds.erase(std::unique(enpy_inds.begin(), enpy_inds.end()), enpy_inds.end());
+  return Rcpp::wrap(enpy_inds);
+}
 
-  reg_path.EnableWarmStarts(GetFallback(pense_opts, "warm_starts", kDefaultUseWarmStarts));
+//! Drop the indices of penalties bracketed by the penalties of a previous fit from the ENPY indices.
+//!
+//! @param r_enpy_inds 1-based indices of the penalties at which ENPY initial estimates should be computed.
+//! @param bracketed whether the penalty is bracketed by penalties of a previous fit.
+//! @return the remaining 1-based indices.
+SEXP ContinuationEnpyInds(SEXP r_enpy_inds, const std::vector<bool>& bracketed) {
+  if (bracketed.empty()) {
+    return r_enpy_inds;
+  }
+  std::vector<int> enpy_inds;
+  for (auto&& index : as<std::vector<int>>(r_enpy_inds)) {
+    if (index < 1 || index > static_cast<int>(bracketed.size()) || !bracketed[index - 1]) {
+      enpy_inds.push_back(index);
+    }
+  }
+  return Rcpp::wrap(enpy_inds);
+}
 
-  // Compute the initial estimators
-  auto&& cold_starts = EnpyInitialEstimates<SOptimizer>(loss, penalties, r_penalties, r_enpy_inds, r_enpy_opts,
-                                                        optional_args, &metrics);
+//! Create the S-loss for the given data with the M-scale and intercept options in `pense_opts`.
+SLoss MakeSLoss(ConstRegressionDataPtr data, const Rcpp::List& pense_opts) {
+  return SLoss(data, pense::Mscale<pense::RhoBisquare>(as<Rcpp::List>(pense_opts["mscale"])),
+               as<bool>(pense_opts["intercept"]));
+}
 
-  Rcpp::checkUserInterrupt();
+//! A PENSE regularization path prepared from the R arguments.
+//! All arguments are parsed when the path is created. Computing the path does not use the R API and can hence be
+//! done from any thread. Only converting the results to R objects must be done on the main thread.
+//! The path refers to its own members and must therefore not be copied or moved.
+template<class SOptimizer>
+class PensePath {
+  using Coefficients = typename SOptimizer::Coefficients;
 
-  // Enable computation of EN-PY-based solutions
-  if (!cold_starts.empty()) {
-    if (GetFallback(pense_opts, "strategy_enpy_individual", kDefaultStrategyEnpyIndividual)) {
-      // Use the EN-PY solutions only for the penalty they were computed for.
-      reg_path.EmplaceIndividualStartingPoints(std::move(cold_starts));
+ public:
+  //! Prepare the PENSE regularization path using the provided optimizer for the PENSE objective function.
+  //! See `PenseEnRegression` for documentation of the R arguments.
+  //!
+  //! @param optimizer the optimizer for the PENSE objective function.
+  //! @param data the data to compute the regularization path for.
+  //! @param num_threads number of threads for computing the path. If less than 1, the number of threads specified
+  //!                    in `pense_opts` and `enpy_opts` is used.
+  PensePath(const SOptimizer& optimizer, ConstRegressionDataPtr data, SEXP r_penalties, SEXP r_enpy_inds,
+            const Rcpp::List& pense_opts, SEXP r_enpy_opts, const Rcpp::List& optional_args, const int num_threads)
+      : loss_(MakeSLoss(data, pense_opts)),
+        penalties_(MakePenalties<SOptimizer>(r_penalties, optional_args)),
+        continuation_(MakeContinuationStarts<SOptimizer>(penalties_, optional_args)),
+        optimizer_(optimizer),
+        max_optima_(GetFallback(pense_opts, "max_optima", kDefaultMaxOptima)),
+        comparison_tol_(GetFallback(pense_opts, "comparison_tol", kDefaultComparisonTol)),
+        num_threads_(num_threads > 0 ? num_threads :
+                     GetFallback(pense_opts, "num_threads", kDefaultNumberOfThreads)),
+        memory_budget_(GetFallback(pense_opts, "memory_budget", kDefaultMemoryBudget)),
+        checkpoint_dir_(GetFallback(pense_opts, "checkpoint_dir", std::string())),
+        explore_it_(GetFallback(pense_opts, "explore_it", kDefaultExploreIt)),
+        explore_tol_(GetFallback(pense_opts, "explore_tol", kDefaultExploreTol)),
+        explored_keep_(GetFallback(pense_opts, "nr_tracks", kDefaultExploreSolutions)),
+        explore_racing_(GetFallback(pense_opts, "explore_racing", kDefaultExploreRacing)),
+        explore_cluster_tol_(GetFallback(pense_opts, "explore_cluster_tol", kDefaultExploreClusterTol)),
+        use_warm_starts_(GetFallback(pense_opts, "warm_starts", kDefaultUseWarmStarts)),
+        path_segments_(std::max(1, std::min<int>(GetFallback(pense_opts, "path_segments", kDefaultPathSegments),
+                                                 std::distance(penalties_.begin(), penalties_.end())))),
+        enpy_(EnpyInitialEstimates<SOptimizer>(
+          r_penalties, SegmentEnpyInds(ContinuationEnpyInds(r_enpy_inds, continuation_.bracketed),
+                                       static_cast<int>(std::distance(penalties_.begin(), penalties_.end())),
+                                       path_segments_),
+          r_enpy_opts, optional_args, optimizer, num_threads)),
+        strategy_enpy_individual_(GetFallback(pense_opts, "strategy_enpy_individual",
+                                              kDefaultStrategyEnpyIndividual)),
+        strategy_enpy_shared_(GetFallback(pense_opts, "strategy_enpy_shared", kDefaultStrategyEnpyShared)),
+        compact_results_(GetFallback(pense_opts, "compact_results", kDefaultCompactResults)),
+        nested_metrics_(GetFallback(pense_opts, "nested_metrics", kDefaultNestedMetrics)),
+        metrics_("pense") {
+    optimizer_.convergence_tolerance(GetFallback(pense_opts, "eps", pense::kDefaultConvergenceTolerance));
+    optimizer_.loss(loss_);
+
+    // Enable computation of the 0-based solutions, if requested.
+    if (GetFallback(pense_opts, "strategy_0", kDefaultStrategy0)) {
+      zero_starts_.emplace_front(1, loss_.ZeroCoefficients<Coefficients>());
     }
-    if (GetFallback(pense_opts, "strategy_enpy_shared", kDefaultStrategyEnpyShared)) {
-      // Use every EN-PY solution for all penalties.
-      for (auto&& starts_at_lambda : cold_starts) {
-        for (auto&& start : starts_at_lambda) {
-          reg_path.EmplaceSharedStartingPoint(std::move(start));
+
+    // Enable computation of the regularization paths using shared starting points (i.e., the same starting
+    // point at every penalty).
+    if (GetFallback(pense_opts, "strategy_other_shared", kDefaultStrategyOtherShared) &&
+        optional_args.containsElementNamed("shared_starts")) {
+      other_shared_starts_ = as<CoefficientsList<SOptimizer>>(optional_args["shared_starts"]);
+    }
+
+    // Enable computation of the regularization paths using individual starting points (i.e., a list of starting
+    // points, different for every penalty).
+    if (GetFallback(pense_opts, "strategy_other_individual", kDefaultStrategyOtherIndividual) &&
+        optional_args.containsElementNamed("individual_starts")) {
+      other_individual_starts_ = as<StartCoefficientsList<SOptimizer>>(optional_args["individual_starts"]);
+    }
+  }
+
+  PensePath(const PensePath&) = delete;
+  PensePath& operator=(const PensePath&) = delete;
+
+  //! Replace the data the regularization path is computed for. Does not use the R API.
+  //!
+  //! @param data the new data. Must have the same number of predictors.
+  void ReplaceData(ConstRegressionDataPtr data) {
+    loss_ = loss_.ReplaceData(data);
+    optimizer_.loss(loss_);
+  }
+
+  //! Compute the regularization path.
+  void Compute() {
+    pense::omp::NestingGuard nesting_guard;
+
+    // Account for the data of this job and for the optima retained along the path.
+    nsoptim::ScopedMemoryAccount data_memory(&timings_, "data", nsoptim::timings::MemoryBytes(loss_.data().cx()) +
+                                             nsoptim::timings::MemoryBytes(loss_.data().cy()));
+    nsoptim::ScopedMemoryAccount optima_memory(&timings_, "optima");
+
+    // Restore the initial estimators and the completed penalties from the checkpoint, if there is one.
+    const std::uint64_t checkpoint_key = CheckpointKey();
+    const std::string checkpoint_file = checkpoint_dir_.empty() ? std::string() :
+      pense::checkpoint::FileName(checkpoint_dir_, checkpoint_key);
+    const pense::checkpoint::Identity checkpoint_identity = CheckpointIdentity();
+    pense::checkpoint::State<Coefficients> restored;
+    const bool resume = !checkpoint_file.empty() &&
+      pense::checkpoint::Load(checkpoint_file, checkpoint_key, checkpoint_identity, &restored);
+
+    // Compute the initial estimators
+    StartCoefficientsList<SOptimizer> cold_starts;
+    if (resume) {
+      cold_starts = std::move(restored.starts);
+      metrics_.AddMetric("resumed_penalties", static_cast<int>(restored.completed.size()));
+    } else {
+      nsoptim::ScopedPhaseTimer timer(&timings_, "enpy");
+      cold_starts = enpy_(loss_, penalties_, &metrics_, &timings_);
+    }
+
+    if (pense::progress::Cancelled()) {
+      interrupted_ = true;
+      timings_.Report(&metrics_);
+      return;
+    }
+
+    // The checkpoint is re-written from the restored state, dropping incomplete records of an aborted write.
+    std::unique_ptr<pense::checkpoint::Writer> checkpoint;
+    if (!checkpoint_file.empty()) {
+      checkpoint.reset(new pense::checkpoint::Writer(checkpoint_file));
+      pense::checkpoint::WriteHeader(checkpoint.get(), checkpoint_key, checkpoint_identity, cold_starts);
+      if (!checkpoint->good()) {
+        metrics_.AddMetric("checkpoint_error", "cannot write checkpoint file " + checkpoint_file);
+        checkpoint.reset();
+      }
+    }
+
+    // A path restored from a checkpoint is resumed along the path, as the completed penalties are not aligned with
+    // the segments.
+    if (path_segments_ > 1 && restored.completed.empty()) {
+      ComputeSegments(cold_starts, std::move(restored.segments), checkpoint.get(), &optima_memory);
+      timings_.Report(&metrics_);
+      return;
+    }
+
+    pense::RegularizationPath<SOptimizer> reg_path(optimizer_, penalties_, max_optima_, comparison_tol_,
+                                                   num_threads_);
+    ConfigurePath(&reg_path);
+    AddStartingPoints(&reg_path, std::move(cold_starts));
+
+    auto optima_it = optima_.before_begin();
+    if (!restored.completed.empty()) {
+      // Restore the optima at the completed penalties and continue from the optima at the last of them.
+      CoefficientsList<SOptimizer> last_optima;
+      int completed = 0;
+      auto penalty_it = penalties_.begin();
+      for (auto solutions_it = restored.completed.begin(); solutions_it != restored.completed.end() &&
+           penalty_it != penalties_.end(); ++solutions_it, ++penalty_it, ++completed) {
+        last_optima.clear();
+        optima_it = optima_.emplace_after(optima_it);
+        auto compact_it = optima_it->before_begin();
+        for (auto&& solution : *solutions_it) {
+          compact_it = optima_it->emplace_after(compact_it, *penalty_it, std::move(solution.coefs),
+                                                solution.objf_value, solution.status, std::move(solution.message));
+          optima_memory.Add(compact_it->coefs.beta.MemoryBytes());
+          last_optima.push_front(compact_it->FullCoefficients());
         }
+        if (checkpoint) {
+          pense::checkpoint::WritePenalty(checkpoint.get(), *optima_it);
+        }
+        pense::progress::Step();
+      }
+      reg_path.Resume(completed, last_optima);
+    }
+
+    while (!reg_path.End()) {
+      // Compute the optima at the next penalty level.
+      auto next = reg_path.Next();
+
+      // The optima at an interrupted penalty are incomplete and hence discarded.
+      if (pense::progress::Cancelled()) {
+        interrupted_ = true;
+        break;
+      }
+
+      optima_it = StoreOptima(next.penalty, std::move(next.optima), optima_it, checkpoint.get(), &optima_memory);
+      pense::progress::Step();
+    }
+    timings_.Report(&metrics_);
+  }
+
+  //! Get the number of penalties along the regularization path.
+  int NumPenalties() const noexcept {
+    return static_cast<int>(penalties_.size());
+  }
+
+  //! Check if the computation was interrupted before reaching the end of the regularization path.
+  bool Interrupted() const noexcept {
+    return interrupted_;
+  }
+
+  //! Predict the response of the given observations with the first optimum at every penalty.
+  //! The coefficients are transformed back to the original scale of the data before predicting.
+  //!
+  //! @param x_test the predictors of the observations in the original scale.
+  //! @param standardization the standardization of the data used for computing this path.
+  //! @return a matrix with one column of predictions per penalty.
+  arma::mat Predict(const arma::mat& x_test, const FoldStandardization& standardization) const {
+    arma::mat predictions(x_test.n_rows, std::distance(optima_.begin(), optima_.end()));
+    arma::uword col = 0;
+    for (auto&& optima : optima_) {
+      if (optima.empty()) {
+        predictions.col(col++).fill(arma::datum::nan);
+        continue;
       }
+      const auto& coefs = optima.front().coefs;
+      const arma::vec beta = standardization.coef_scale % coefs.beta.template As<arma::vec>();
+      const double intercept = coefs.intercept + standardization.muy - arma::dot(standardization.mux, beta);
+      // Use the same convention for the intercept as `.run_replicated_cv()`.
+      predictions.col(col++) = x_test * beta - intercept;
     }
+    return predictions;
   }
 
-  // Enable computation of the 0-based solutions, if requested.
-  if (GetFallback(pense_opts, "strategy_0", kDefaultStrategy0)) {
-    StartCoefficientsList<SOptimizer> zeros;
-    zeros.emplace_front(1, loss.ZeroCoefficients<typename SOptimizer::Coefficients>());
-    reg_path.EmplaceIndividualStartingPoints(std::move(zeros));
+  //! Convert the computed regularization path to an R list. Must be called from the main thread.
+  //! If compact results are requested, the optima are wrapped with WrapOptimaPath() into item `path` and the
+  //! metrics are summarized in the flat table `metrics_table`. The nested metrics are only included if requested.
+  SEXP Wrap() {
+    if (compact_results_) {
+      Rcpp::List result = Rcpp::List::create(
+        Rcpp::Named("path") = pense::WrapOptimaPath(optima_),
+        Rcpp::Named("metrics_table") = pense::WrapMetricsTable(metrics_),
+        Rcpp::Named("interrupted") = interrupted_);
+      if (nested_metrics_) {
+        result["metrics"] = Rcpp::wrap(metrics_);
+      }
+      return Rcpp::wrap(result);
+    }
+
+    Rcpp::List combined_reg_path;
+    for (auto&& optima : optima_) {
+      Rcpp::List solutions;
+      for (auto&& optimum : optima) {
+        solutions.push_back(WrapOptimum(optimum));
+      }
+      combined_reg_path.push_back(solutions);
+    }
+
+    return Rcpp::wrap(Rcpp::List::create(Rcpp::Named("estimates") = combined_reg_path,
+                                         Rcpp::Named("metrics") = Rcpp::wrap(metrics_),
+                                         Rcpp::Named("interrupted") = interrupted_));
   }
 
-  // Enable computation of the regularization paths using shared starting points (i.e., the same starting
-  // point at every penalty).
-  if (GetFallback(pense_opts, "strategy_other_shared", kDefaultStrategyOtherShared) &&
-      optional_args.containsElementNamed("shared_starts")) {
-    auto shared_starts = as<CoefficientsList<SOptimizer>>(optional_args["shared_starts"]);
-    for (auto&& start : shared_starts) {
-      reg_path.EmplaceSharedStartingPoint(std::move(start));
+ private:
+  //! Key identifying the checkpoint of this regularization path by the data, the penalties and the main options.
+  std::uint64_t CheckpointKey() const {
+    using pense::enpy_initest_internal::HashCombine;
+    using pense::enpy_initest_internal::HashCombineInteger;
+    const auto fingerprint = pense::enpy_initest_internal::FingerprintData(loss_.data());
+    std::uint64_t key = HashCombineInteger(fingerprint.hash, fingerprint.check);
+    key = HashCombine(key, loss_.IncludeIntercept() ? 1. : 0.);
+    key = HashCombine(key, optimizer_.convergence_tolerance());
+    key = HashCombine(key, max_optima_);
+    key = HashCombine(key, explore_it_);
+    for (auto&& penalty : penalties_) {
+      key = HashCombineInteger(key, pense::enpy_initest_internal::HashPenalty(penalty));
     }
+    return key;
   }
 
-  // Enable computation of the regularization paths using individual starting points (i.e., a list of starting
-  // points, different for every penalty).
-  if (GetFallback(pense_opts, "strategy_other_individual", kDefaultStrategyOtherIndividual) &&
-      optional_args.containsElementNamed("individual_starts")) {
-    reg_path.EmplaceIndividualStartingPoints(
-      as<StartCoefficientsList<SOptimizer>>(optional_args["individual_starts"]));
+  //! Full identity of the regularization path, stored in the checkpoint and compared exactly before resuming.
+  pense::checkpoint::Identity CheckpointIdentity() const {
+    const auto fingerprint = pense::enpy_initest_internal::FingerprintData(loss_.data());
+    pense::checkpoint::Identity identity {
+      static_cast<std::uint64_t>(fingerprint.n_obs), static_cast<std::uint64_t>(fingerprint.n_pred),
+      fingerprint.hash, fingerprint.check, arma::vec(), {}, arma::vec() };
+
+    const auto n_penalties = std::distance(penalties_.begin(), penalties_.end());
+    identity.penalty_grid.set_size(2 * n_penalties);
+    identity.penalty_hashes.reserve(n_penalties);
+    arma::uword i = 0;
+    for (auto&& penalty : penalties_) {
+      identity.penalty_grid[i++] = penalty.alpha();
+      identity.penalty_grid[i++] = penalty.lambda();
+      identity.penalty_hashes.push_back(pense::enpy_initest_internal::HashPenalty(penalty));
+    }
+
+    identity.options = {
+      loss_.IncludeIntercept() ? 1. : 0., loss_.mscale().delta(), loss_.mscale().rho().cc(),
+      optimizer_.convergence_tolerance(), static_cast<double>(max_optima_), comparison_tol_,
+      static_cast<double>(explore_it_), explore_tol_, static_cast<double>(explored_keep_),
+      explore_racing_ ? 1. : 0., explore_cluster_tol_, use_warm_starts_ ? 1. : 0.,
+      strategy_enpy_individual_ ? 1. : 0., strategy_enpy_shared_ ? 1. : 0.,
+      zero_starts_.empty() ? 0. : 1.,
+      static_cast<double>(std::distance(other_shared_starts_.begin(), other_shared_starts_.end())),
+      static_cast<double>(std::distance(other_individual_starts_.begin(), other_individual_starts_.end())) };
+    // The continuation starts determine at which penalties the starting points are explored.
+    const arma::uword n_options = identity.options.n_elem;
+    identity.options.resize(n_options + continuation_.bracketed.size());
+    for (std::size_t i = 0; i < continuation_.bracketed.size(); ++i) {
+      identity.options[n_options + i] = continuation_.bracketed[i] ? 1. : 0.;
+    }
+    return identity;
   }
 
-  RList combined_reg_path;
-  while (!reg_path.End()) {
-    RList solutions;
-    Metrics& sub_metrics = metrics.CreateSubMetrics("lambda");
+  //! Apply the options for exploring and concentrating the starting points to a regularization path.
+  void ConfigurePath(pense::RegularizationPath<SOptimizer>* reg_path) {
+    reg_path->ExplorationOptions(explore_it_, explore_tol_, explored_keep_);
+    reg_path->EnableExplorationRacing(explore_racing_);
+    reg_path->ClusterStartingPoints(explore_cluster_tol_);
+    reg_path->EnableWarmStarts(use_warm_starts_);
+    // When continuing from a previous fit, the starting points at bracketed penalties are close to the optima and
+    // are only concentrated.
+    reg_path->SkipExplorationAt(continuation_.bracketed);
+    reg_path->Timings(&timings_);
+    reg_path->MemoryBudget(memory_budget_);
+  }
 
-    // Compute the optima at the next penalty level.
-    auto next = reg_path.Next();
+  //! Add the initial estimators and all other starting points to a regularization path.
+  //!
+  //! @param reg_path the regularization path.
+  //! @param cold_starts the initial estimators, one list for each penalty. May be empty.
+  void AddStartingPoints(pense::RegularizationPath<SOptimizer>* reg_path,
+                         StartCoefficientsList<SOptimizer>&& cold_starts) const {
+    // Enable computation of EN-PY-based solutions
+    if (!cold_starts.empty()) {
+      if (strategy_enpy_shared_) {
+        // Use every EN-PY solution for all penalties.
+        for (auto&& starts_at_lambda : cold_starts) {
+          for (auto&& start : starts_at_lambda) {
+            reg_path->EmplaceSharedStartingPoint(Coefficients(start));
+          }
+        }
+      }
+      if (strategy_enpy_individual_) {
+        // Use the EN-PY solutions only for the penalty they were computed for.
+        reg_path->EmplaceIndividualStartingPoints(std::move(cold_starts));
+      }
+    }
 
-    sub_metrics.AddMetric("alpha", next.penalty.alpha());
-    sub_metrics.AddMetric("lambda", next.penalty.lambda());
+    if (!zero_starts_.empty()) {
+      reg_path->EmplaceIndividualStartingPoints(StartCoefficientsList<SOptimizer>(zero_starts_));
+    }
+    for (auto&& start : other_shared_starts_) {
+      reg_path->EmplaceSharedStartingPoint(Coefficients(start));
+    }
+    if (!other_individual_starts_.empty()) {
+      reg_path->EmplaceIndividualStartingPoints(StartCoefficientsList<SOptimizer>(other_individual_starts_));
+    }
+    if (!continuation_.starts.empty()) {
+      reg_path->EmplaceIndividualStartingPoints(StartCoefficientsList<SOptimizer>(continuation_.starts));
+    }
+  }
 
-    for (auto&& optimum : next.optima) {
+  //! Store the optima at the next penalty without loss, residuals and metrics, and with sparse slope coefficients if
+  //! most of them are zero. The metrics of the optima are added to the metrics of the path.
+  //!
+  //! @param penalty the penalty of the optima.
+  //! @param optima the optima at the penalty.
+  //! @param optima_it iterator to the optima at the previous penalty.
+  //! @param checkpoint the checkpoint file the optima are appended to, or `nullptr`.
+  //! @param optima_memory the memory account of the stored optima.
+  //! @return iterator to the stored optima.
+  typename FwdList<CompactOptima<SOptimizer>>::iterator StoreOptima(
+      const typename SOptimizer::PenaltyFunction& penalty, Optima<SOptimizer>&& optima,
+      typename FwdList<CompactOptima<SOptimizer>>::iterator optima_it, pense::checkpoint::Writer* checkpoint,
+      nsoptim::ScopedMemoryAccount* optima_memory) {
+    Metrics& sub_metrics = metrics_.CreateSubMetrics("lambda");
+    sub_metrics.AddMetric("alpha", penalty.alpha());
+    sub_metrics.AddMetric("lambda", penalty.lambda());
+
+    for (auto&& optimum : optima) {
       if (optimum.metrics) {
         optimum.metrics->AddDetail("objf_value", optimum.objf_value);
         sub_metrics.AddSubMetrics(*optimum.metrics);
       }
-      solutions.push_back(WrapOptimum(optimum));
     }
+    optima_it = optima_.emplace_after(optima_it);
+    auto compact_it = optima_it->before_begin();
+    for (auto&& optimum : optima) {
+      compact_it = optima_it->emplace_after(compact_it, std::move(optimum));
+      optima_memory->Add(compact_it->coefs.beta.MemoryBytes());
+    }
+    if (checkpoint) {
+      pense::checkpoint::WritePenalty(checkpoint, *optima_it);
+    }
+    return optima_it;
+  }
 
-    combined_reg_path.push_back(solutions);
+  //! Compute the regularization path in `path_segments_` segments of consecutive penalties.
+  //! Each segment is an independent chain of warm starts, starting from the initial estimators and the other
+  //! starting points at its first penalty. The chains are computed in parallel, each by a single thread.
+  //! Afterwards, the segments are stitched together: the optima at the first penalty of a segment are tried as
+  //! starting points at the last penalty of the previous segment, and the optima at the last penalty of a segment
+  //! are carried forward into the next segment, as long as they improve the optima there.
+  //!
+  //! Every completed segment is appended to the checkpoint file as soon as it is finished. Segments restored from a
+  //! checkpoint are not re-computed.
+  //!
+  //! @param cold_starts the initial estimators, one list for each penalty. May be empty.
+  //! @param restored the segments restored from the checkpoint, keyed by the index of their first penalty.
+  //! @param checkpoint the checkpoint file the optima are appended to, or `nullptr`.
+  //! @param optima_memory the memory account of the stored optima.
+  void ComputeSegments(const StartCoefficientsList<SOptimizer>& cold_starts,
+                       std::map<std::uint64_t, std::vector<std::vector<pense::checkpoint::Solution>>>&& restored,
+                       pense::checkpoint::Writer* checkpoint, nsoptim::ScopedMemoryAccount* optima_memory) {
+    const int n_penalties = NumPenalties();
+    const int n_segments = path_segments_;
+    std::vector<const typename SOptimizer::PenaltyFunction*> penalties;
+    for (auto&& penalty : penalties_) {
+      penalties.push_back(&penalty);
+    }
+    std::vector<Optima<SOptimizer>> optima(n_penalties);
+
+    // Every segment explores and concentrates several starting points at every penalty.
+    const auto& data = loss_.data();
+    const double segment_work = static_cast<double>(n_penalties) / n_segments * max_optima_ *
+      data.n_obs() * data.n_pred();
+    pense::omp::ParallelFor(num_threads_, n_segments, segment_work, [&](const int segment) {
+      const int first = SegmentStart(segment, n_segments, n_penalties);
+      const int last = SegmentStart(segment + 1, n_segments, n_penalties);
+      const auto restored_it = restored.find(first);
+      if (restored_it != restored.end() && static_cast<int>(restored_it->second.size()) == last - first) {
+        // The optima of a restored segment are already converged, re-computing them is cheap.
+        for (int index = first; index < last; ++index) {
+          SOptimizer optimizer(optimizer_);
+          optimizer.penalty(*penalties[index]);
+          auto optima_it = optima[index].before_begin();
+          for (auto&& solution : restored_it->second[index - first]) {
+            optima_it = optima[index].emplace_after(
+              optima_it, optimizer.Optimize(Coefficients(solution.coefs.intercept,
+                solution.coefs.beta.template As<typename Coefficients::SlopeCoefficient>())));
+          }
+          pense::progress::Step();
+        }
+      } else {
+        pense::RegularizationPath<SOptimizer> reg_path(optimizer_, penalties_, max_optima_, comparison_tol_, 1);
+        ConfigurePath(&reg_path);
+        AddStartingPoints(&reg_path, StartCoefficientsList<SOptimizer>(cold_starts));
+        reg_path.Resume(first, CoefficientsList<SOptimizer>());
+        for (int index = first; index < last; ++index) {
+          optima[index] = reg_path.Next().optima;
+          // The optima of an interrupted segment are incomplete and hence not written to the checkpoint.
+          if (pense::progress::Cancelled()) {
+            return;
+          }
+          pense::progress::Step();
+        }
+      }
+
+      if (checkpoint) {
+        #pragma omp critical(pense_segment_checkpoint)
+        pense::checkpoint::WriteSegment(checkpoint, static_cast<std::uint64_t>(first), optima.begin() + first,
+                                        optima.begin() + last);
+      }
+    });
 
-    Rcpp::checkUserInterrupt();
+    if (pense::progress::Cancelled()) {
+      interrupted_ = true;
+      return;
+    }
+
+    // Stitch the segments together.
+    int improved = 0;
+    for (int segment = 1; segment < n_segments; ++segment) {
+      const int boundary = SegmentStart(segment, n_segments, n_penalties);
+      const int next_boundary = SegmentStart(segment + 1, n_segments, n_penalties);
+      improved += !CrossCheck(Starts(optima[boundary]), *penalties[boundary - 1], &optima[boundary - 1]).empty();
+      CoefficientsList<SOptimizer> carried = use_warm_starts_ ? Starts(optima[boundary - 1]) :
+                                                                CoefficientsList<SOptimizer>();
+      for (int index = boundary; index < next_boundary && !carried.empty(); ++index) {
+        carried = CrossCheck(std::move(carried), *penalties[index], &optima[index]);
+        improved += !carried.empty();
+      }
+    }
+    metrics_.AddMetric("path_segments", n_segments);
+    metrics_.AddMetric("segment_improved_penalties", improved);
+
+    auto optima_it = optima_.before_begin();
+    for (int index = 0; index < n_penalties; ++index) {
+      optima_it = StoreOptima(*penalties[index], std::move(optima[index]), optima_it, checkpoint, optima_memory);
+    }
+  }
+
+  //! Get the coefficients of the given optima.
+  static CoefficientsList<SOptimizer> Starts(const Optima<SOptimizer>& optima) {
+    CoefficientsList<SOptimizer> starts;
+    for (auto&& optimum : optima) {
+      starts.push_front(optimum.coefs);
+    }
+    return starts;
+  }
+
+  //! Optimize the objective function at the given penalty from additional starting points and add the new optima to
+  //! the optima at the penalty, if they are among the `max_optima_` best optima and not a duplicate.
+  //!
+  //! @param starts the additional starting points.
+  //! @param penalty the penalty.
+  //! @param optima the optima at the penalty, ordered from best to worst.
+  //! @return the coefficients of the new optima added to `optima`.
+  CoefficientsList<SOptimizer> CrossCheck(CoefficientsList<SOptimizer>&& starts,
+                                          const typename SOptimizer::PenaltyFunction& penalty,
+                                          Optima<SOptimizer>* optima) const {
+    CoefficientsList<SOptimizer> added;
+    for (auto&& start : starts) {
+      SOptimizer optimizer(optimizer_);
+      optimizer.penalty(penalty);
+      auto optimum = optimizer.Optimize(start);
+      if (optimum.status == nsoptim::OptimumStatus::kError) {
+        continue;
+      }
+
+      // Find the insert position and check for duplicates.
+      auto insert_it = optima->before_begin();
+      bool duplicate = false;
+      int rank = 0;
+      for (auto it = optima->begin(); it != optima->end(); ++it) {
+        if (pense::regpath::CoefficientsEquivalent(it->coefs, optimum.coefs, comparison_tol_)) {
+          duplicate = true;
+          break;
+        }
+        if (it->objf_value <= optimum.objf_value) {
+          insert_it = it;
+          ++rank;
+        }
+      }
+      if (duplicate || (max_optima_ > 0 && rank >= max_optima_)) {
+        continue;
+      }
+      added.push_front(optimum.coefs);
+      optima->insert_after(insert_it, std::move(optimum));
+
+      // Drop the worst optimum if there are too many.
+      if (max_optima_ > 0 && std::distance(optima->begin(), optima->end()) > max_optima_) {
+        auto before_last_it = optima->before_begin();
+        for (int i = 0; i < max_optima_; ++i) {
+          ++before_last_it;
+        }
+        optima->erase_after(before_last_it, optima->end());
+      }
+    }
+    return added;
+  }
+
+  SLoss loss_;
+  PenaltyList<SOptimizer> penalties_;
+  ContinuationStarts<SOptimizer> continuation_;
+  SOptimizer optimizer_;
+  const int max_optima_;
+  const double comparison_tol_;
+  const int num_threads_;
+  const double memory_budget_;
+  const std::string checkpoint_dir_;
+  const int explore_it_;
+  const double explore_tol_;
+  const int explored_keep_;
+  const bool explore_racing_;
+  const double explore_cluster_tol_;
+  const bool use_warm_starts_;
+  const int path_segments_;
+  DeferredEnpy<SOptimizer> enpy_;
+  const bool strategy_enpy_individual_;
+  const bool strategy_enpy_shared_;
+  const bool compact_results_;
+  const bool nested_metrics_;
+  StartCoefficientsList<SOptimizer> zero_starts_;
+  CoefficientsList<SOptimizer> other_shared_starts_;
+  StartCoefficientsList<SOptimizer> other_individual_starts_;
+  Metrics metrics_;
+  nsoptim::PhaseTimings timings_;
+  FwdList<CompactOptima<SOptimizer>> optima_;
+  bool interrupted_ = false;
+};
+
+//! Get the 0-based indices of the training observations.
+//!
+//! @param n_obs number of observations in the full data set.
+//! @param test_ind 1-based indices of the observations to leave out.
+//! @return 0-based indices of the remaining observations.
+arma::uvec TrainingIndices(const arma::uword n_obs, const arma::uvec& test_ind) {
+  arma::uvec keep(n_obs, arma::fill::ones);
+  for (auto&& index : test_ind) {
+    if (index >= 1 && index <= n_obs) {
+      keep[index - 1] = 0;
+    }
+  }
+  return arma::find(keep);
+}
+
+//! Deferred preparation of the data for a job.
+using DeferredJobData = std::function<ConstRegressionDataPtr()>;
+
+//! Get the data for a job. If the job specifies its own response `y`, the job uses the predictors of `data` with
+//! this response. The predictors are not copied and their cached norms and Gram matrices are shared by all jobs.
+//! If the job specifies `test_ind`, these observations are left out. If the job
+//! further specifies the `standardization` of the training data, the left-out data is standardized accordingly.
+//! If the job specifies `resample_ind`, the job uses these observations of `data`, where observations may be repeated
+//! (e.g., for a bootstrap replicate). The resampled data is a copy of the selected observations, but its column sums
+//! are derived from the column sums of `data`, which are computed only once for all resamples.
+//! The R arguments are parsed immediately, but the data is only prepared when the returned function is called.
+//! The function does not use the R API and can hence be called from any thread.
+//!
+//! @param data the full data set.
+//! @param job the job.
+//! @return a function returning the data for the job.
+DeferredJobData JobData(const ConstRegressionDataPtr& data, const Rcpp::List& job) {
+  if (job.containsElementNamed("y")) {
+    const arma::vec y = as<arma::vec>(job["y"]);
+    if (y.n_elem != data->n_obs()) {
+      throw std::invalid_argument("the response of a job has a different number of observations");
+    }
+    if (job.containsElementNamed("test_ind") || job.containsElementNamed("resample_ind")) {
+      throw std::invalid_argument("jobs with their own response must not leave out or resample observations");
+    }
+    // The returned data refers to the predictors of `data`, which must be kept alive.
+    return [data, y]() -> ConstRegressionDataPtr {
+      return std::shared_ptr<const nsoptim::PredictorResponseData>(
+        new nsoptim::PredictorResponseData(data->WithResponse(arma::vec(y))),
+        [data](const nsoptim::PredictorResponseData* with_response) { delete with_response; });
+    };
+  }
+  if (job.containsElementNamed("resample_ind")) {
+    if (job.containsElementNamed("test_ind")) {
+      throw std::invalid_argument("jobs must not both leave out and resample observations");
+    }
+    const arma::uvec resample_ind = as<arma::uvec>(job["resample_ind"]) - 1;
+    if (resample_ind.n_elem == 0 || resample_ind.max() >= data->n_obs()) {
+      throw std::invalid_argument("the resampled observations of a job are invalid");
+    }
+    return [data, resample_ind]() {
+      data->column_sums();
+      return std::make_shared<const nsoptim::PredictorResponseData>(data->Observations(resample_ind));
+    };
+  }
+  if (!job.containsElementNamed("test_ind")) {
+    return [data]() { return data; };
+  }
+  const arma::uvec train_ind = TrainingIndices(data->n_obs(), as<arma::uvec>(job["test_ind"]));
+  if (!job.containsElementNamed("standardization")) {
+    return [data, train_ind]() {
+      // The column sums of the training data (e.g., for the Lipschitz bounds in CD-PENSE) are derived from the
+      // column sums of the full data, which are computed only once for all folds.
+      data->column_sums();
+      return std::make_shared<const nsoptim::PredictorResponseData>(data->Observations(train_ind));
+    };
+  }
+
+  const auto standardization = ParseFoldStandardization(as<Rcpp::List>(job["standardization"]), data->n_pred());
+  return [data, train_ind, standardization]() {
+    arma::mat train_x = data->cx().rows(train_ind);
+    train_x.each_row() -= standardization.mux.t();
+    train_x.each_row() %= standardization.coef_scale.t();
+    arma::vec train_y = data->cy().elem(train_ind) - standardization.muy;
+    return std::make_shared<const nsoptim::PredictorResponseData>(std::move(train_x), std::move(train_y));
+  };
+}
+
+//! Estimate the memory held by a job while it is computed: the copy of its data, if any, and a square matrix of the
+//! size of the number of observations as upper bound for a sensitivity matrix of the PSCs.
+//!
+//! @param data the full data set.
+//! @param job the job.
+//! @return the estimated memory of the job, in bytes.
+double JobMemoryBytes(const nsoptim::PredictorResponseData& data, const Rcpp::List& job) {
+  const double n_obs = data.n_obs();
+  double bytes = n_obs * n_obs * sizeof(double);
+  if (job.containsElementNamed("y")) {
+    bytes += n_obs * sizeof(double);
+  } else if (job.containsElementNamed("test_ind")) {
+    const double n_train = n_obs - Rcpp::IntegerVector(job["test_ind"]).size();
+    bytes += n_train * (data.n_pred() + 1) * sizeof(double);
+  } else if (job.containsElementNamed("resample_ind")) {
+    const double n_resample = Rcpp::IntegerVector(job["resample_ind"]).size();
+    bytes = n_resample * n_resample * sizeof(double) + n_resample * (data.n_pred() + 1) * sizeof(double);
+  }
+  return bytes;
+}
+
+//! Prepare and compute the PENSE Regularization Paths for a batch of jobs on the same data.
+//! The jobs are distributed over the threads. If there are fewer jobs than threads, or if the memory budget does not
+//! allow computing as many jobs concurrently as there are threads, the jobs are computed one after the other and the
+//! threads are used within each job instead.
+//! The penalties of all jobs are added to the steps of the running computation. If the computation is cancelled,
+//! the remaining jobs stop early and their regularization paths are incomplete.
+//!
+//! See `PenseEnRegressionBatch` for parameter documentation.
+//! @return the computed regularization paths, one for each job.
+template<class SOptimizer>
+std::vector<std::unique_ptr<PensePath<SOptimizer>>> ComputeJobs(
+    const SOptimizer& optimizer, const ConstRegressionDataPtr& data, const Rcpp::List& jobs,
+    const Rcpp::List& pense_opts, SEXP r_enpy_opts, const Rcpp::List& optional_args) {
+  const int n_jobs = jobs.size();
+  const int num_threads = GetFallback(pense_opts, "num_threads", kDefaultNumberOfThreads);
+  const double memory_budget = GetFallback(pense_opts, "memory_budget", kDefaultMemoryBudget);
+  double job_bytes = 0;
+  for (int job_index = 0; job_index < n_jobs; ++job_index) {
+    job_bytes = std::max(job_bytes, JobMemoryBytes(*data, as<Rcpp::List>(jobs[job_index])));
+  }
+  const bool parallel_jobs = pense::omp::Enabled(num_threads) && n_jobs >= num_threads &&
+    pense::omp::MemoryLimitedThreads(num_threads, memory_budget, job_bytes) >= num_threads;
+
+  // Parse all jobs on the main thread. If the jobs are computed in parallel, the data of a job is prepared by the
+  // thread computing the job. The memory is thus first touched by this thread and, on NUMA systems, allocated
+  // close to it.
+  std::vector<std::unique_ptr<PensePath<SOptimizer>>> reg_paths;
+  std::vector<DeferredJobData> job_data;
+  reg_paths.reserve(n_jobs);
+  job_data.reserve(n_jobs);
+  for (int job_index = 0; job_index < n_jobs; ++job_index) {
+    const auto job = as<Rcpp::List>(jobs[job_index]);
+    job_data.emplace_back(JobData(data, job));
+    reg_paths.emplace_back(new PensePath<SOptimizer>(optimizer, parallel_jobs ? data : job_data.back()(),
+                                                     job["penalties"], job["enpy_inds"],
+                                                     GetFallback(job, "pense_opts", pense_opts),
+                                                     r_enpy_opts, GetFallback(job, "optional_args", optional_args),
+                                                     parallel_jobs ? 1 : 0));
+    pense::progress::AddSteps(reg_paths.back()->NumPenalties());
+  }
+
+  if (parallel_jobs) {
+    // Exceptions must not escape the parallel region. They are re-thrown on the main thread.
+    std::vector<std::exception_ptr> errors(n_jobs);
+    pense::omp::NestingGuard nesting_guard;
+    pense::blas::SingleThreadGuard blas_guard(num_threads);
+    // Spread the threads over the available places, if thread binding is enabled via `OMP_PROC_BIND`.
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic, 1) default(shared) proc_bind(spread)
+    for (int job_index = 0; job_index < n_jobs; ++job_index) {
+      try {
+        auto local_data = job_data[job_index]();
+        if (local_data != data) {
+          reg_paths[job_index]->ReplaceData(std::move(local_data));
+        }
+        reg_paths[job_index]->Compute();
+      } catch (...) {
+        errors[job_index] = std::current_exception();
+      }
+    }
+    for (auto&& error : errors) {
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+  } else {
+    for (auto&& reg_path : reg_paths) {
+      reg_path->Compute();
+    }
+  }
+  return reg_paths;
+}
+
+//! Compute the PENSE Regularization Path using the provided optimizer for the PENSE objective function.
+//! The optimizer determines:
+//!   * the type of penalty function (EN vs. adaptive EN)
+//!   * the coefficients type (sparse vs. dense)
+//!
+//! See `PenseEnRegression` for parameter documentation.
+//! @return the regularization path.
+template<class SOptimizer>
+SEXP PenseRegressionImpl(SOptimizer optimizer, SEXP r_x, SEXP r_y, SEXP r_penalties,
+                         SEXP r_enpy_inds, const Rcpp::List& pense_opts, SEXP r_enpy_opts,
+                         const Rcpp::List& optional_args) {
+  ConstRegressionDataPtr data(MakePredictorResponseData(r_x, r_y));
+  pense::progress::Scope progress(GetFallback(pense_opts, "progress", kDefaultReportProgress));
+  PensePath<SOptimizer> reg_path(optimizer, data, r_penalties, r_enpy_inds, pense_opts, r_enpy_opts,
+                                 optional_args, 0);
+  pense::progress::AddSteps(reg_path.NumPenalties());
+  reg_path.Compute();
+  return reg_path.Wrap();
+}
+
+//! Compute a batch of PENSE Regularization Paths using the provided optimizer for the PENSE objective function.
+//!
+//! See `PenseEnRegressionBatch` for parameter documentation.
+//! @return a list with one regularization path per job.
+template<class SOptimizer>
+SEXP PenseBatchRegressionImpl(SOptimizer optimizer, SEXP r_x, SEXP r_y, SEXP r_jobs,
+                              const Rcpp::List& pense_opts, SEXP r_enpy_opts, const Rcpp::List& optional_args) {
+  ConstRegressionDataPtr data(MakePredictorResponseData(r_x, r_y));
+  pense::progress::Scope progress(GetFallback(pense_opts, "progress", kDefaultReportProgress));
+  auto reg_paths = ComputeJobs(optimizer, data, as<Rcpp::List>(r_jobs), pense_opts, r_enpy_opts, optional_args);
+
+  Rcpp::List results;
+  for (auto&& reg_path : reg_paths) {
+    results.push_back(reg_path->Wrap());
   }
+  return Rcpp::wrap(results);
+}
 
-  RList pense_results = RList::create(Rcpp::Named("estimates") = combined_reg_path,
-                                      Rcpp::Named("metrics") = Rcpp::wrap(metrics));
+//! Compute the predictions for the left-out observations of CV folds using the provided optimizer for the
+//! PENSE objective function.
+//!
+//! See `PenseEnCrossValidation` for parameter documentation.
+//! @return a list with one matrix of predictions per job.
+template<class SOptimizer>
+SEXP PenseCrossValidationImpl(SOptimizer optimizer, SEXP r_x, SEXP r_y, SEXP r_jobs,
+                              const Rcpp::List& pense_opts, SEXP r_enpy_opts, const Rcpp::List& optional_args) {
+  ConstRegressionDataPtr data(MakePredictorResponseData(r_x, r_y));
+  const auto jobs = as<Rcpp::List>(r_jobs);
+  pense::progress::Scope progress(GetFallback(pense_opts, "progress", kDefaultReportProgress));
+  auto reg_paths = ComputeJobs(optimizer, data, jobs, pense_opts, r_enpy_opts, optional_args);
+  // Predictions from incomplete paths are meaningless.
+  if (pense::progress::Cancelled()) {
+    throw Rcpp::internal::InterruptedException();
+  }
 
-  return Rcpp::wrap(pense_results);
+  Rcpp::List predictions;
+  auto reg_path_it = reg_paths.cbegin();
+  for (auto&& r_job : jobs) {
+    const auto job = as<Rcpp::List>(r_job);
+    const arma::uvec test_ind = as<arma::uvec>(job["test_ind"]) - 1;
+    const auto standardization = ParseFoldStandardization(GetFallback(job, "standardization", Rcpp::List()),
+                                                          data->n_pred());
+    predictions.push_back(Rcpp::wrap((*reg_path_it++)->Predict(data->cx().rows(test_ind), standardization)));
+  }
+  return Rcpp::wrap(predictions);
 }
 
+//! Compute a single PENSE Regularization Path.
+struct SinglePathRunner {
+  //! See `PenseRegressionImpl` for parameter documentation.
+  template<class SOptimizer>
+  static SEXP Run(SOptimizer optimizer, SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds,
+                  const Rcpp::List& pense_opts, SEXP enpy_opts, const Rcpp::List& optional_args) {
+    return PenseRegressionImpl(std::move(optimizer), x, y, penalties, enpy_inds, pense_opts, enpy_opts,
+                               optional_args);
+  }
+};
+
+//! Compute a batch of PENSE Regularization Paths.
+//! The dispatchers forward the list of jobs as argument `penalties`, the argument `enpy_inds` is ignored.
+struct BatchRunner {
+  //! See `PenseBatchRegressionImpl` for parameter documentation.
+  template<class SOptimizer>
+  static SEXP Run(SOptimizer optimizer, SEXP x, SEXP y, SEXP jobs, SEXP,
+                  const Rcpp::List& pense_opts, SEXP enpy_opts, const Rcpp::List& optional_args) {
+    return PenseBatchRegressionImpl(std::move(optimizer), x, y, jobs, pense_opts, enpy_opts, optional_args);
+  }
+};
+
+//! Compute the predictions for the left-out observations of CV folds.
+//! The dispatchers forward the list of jobs as argument `penalties`, the argument `enpy_inds` is ignored.
+struct CrossValidationRunner {
+  //! See `PenseCrossValidationImpl` for parameter documentation.
+  template<class SOptimizer>
+  static SEXP Run(SOptimizer optimizer, SEXP x, SEXP y, SEXP jobs, SEXP,
+                  const Rcpp::List& pense_opts, SEXP enpy_opts, const Rcpp::List& optional_args) {
+    return PenseCrossValidationImpl(std::move(optimizer), x, y, jobs, pense_opts, enpy_opts, optional_args);
+  }
+};
+
 //! Compute the PENSE Regularization Path for the provided penalty function using the MM algorithm with the provided
 //! inner optimizer.
 //! By default, i.e., unless the inner optimizer can handle the given PenaltyFunction class, returns `R_NilValue`.
 //!
 //! See `PenseEnRegression` for parameter documentation.
 //! @return `R_NilValue`.
-template<typename InnerOptimizer, typename PenaltyFunction>
+template<typename Runner, typename InnerOptimizer, typename PenaltyFunction>
 SEXP PenseMMPenaltyImpl(SEXP, SEXP, SEXP, SEXP, const Rcpp::List&, SEXP, const Rcpp::List&,
                         const Rcpp::List&, const Rcpp::List&, double) {
   return R_NilValue;
@@ -362,15 +1322,15 @@ SEXP PenseMMPenaltyImpl(SEXP, SEXP, SEXP, SEXP, const Rcpp::List&, SEXP, const R
 //!
 //! See `PenseEnRegression` for parameter documentation.
 //! @return the regularization path.
-template<typename InnerOptimizer, typename PenaltyFunction, typename = typename
+template<typename Runner, typename InnerOptimizer, typename PenaltyFunction, typename = typename
          std::enable_if<std::is_same<PenaltyFunction, typename InnerOptimizer::PenaltyFunction>::value>::type >
 SEXP PenseMMPenaltyImpl(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds,
                         const Rcpp::List& pense_opts, SEXP enpy_opts, const Rcpp::List& optional_args,
                         const Rcpp::List& mm_options, const Rcpp::List& en_options, int) {
   using MMSOptimizer = nsoptim::MMOptimizer<SLoss, PenaltyFunction, InnerOptimizer,
                                             typename InnerOptimizer::Coefficients>;
-  return PenseRegressionImpl(MakeOptimizer<MMSOptimizer>(mm_options, en_options),
-                             x, y, penalties, enpy_inds, pense_opts, enpy_opts, optional_args);
+  return Runner::Run(MakeOptimizer<MMSOptimizer>(mm_options, en_options),
+                     x, y, penalties, enpy_inds, pense_opts, enpy_opts, optional_args);
 }
 
 //! Compute the PENSE Regularization Path for the provided penalty function using the MM algorithm
@@ -380,7 +1340,7 @@ SEXP PenseMMPenaltyImpl(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds,
 //!
 //! See `PenseEnRegression` for parameter documentation.
 //! @return the regularization path.
-template<typename PenaltyFunction>
+template<typename Runner, typename PenaltyFunction>
 SEXP PenseMMDispatch(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds, const Rcpp::List& pense_opts,
                      SEXP enpy_opts, const Rcpp::List& optional_args) {
   using SurrogateLoss = typename SLoss::ConvexSurrogateType;
@@ -391,43 +1351,43 @@ SEXP PenseMMDispatch(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds, const Rcpp:
   switch (algorithm) {
     case pense::EnAlgorithm::kDal: {
       using Optimizer = nsoptim::DalEnOptimizer<SurrogateLoss, PenaltyFunction>;
-      return PenseMMPenaltyImpl<Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
+      return PenseMMPenaltyImpl<Runner, Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
                                                             enpy_opts, optional_args, mm_options, en_options, 1);
     }
     case pense::EnAlgorithm::kRidge: {
       using Optimizer = AugmentedRidgeOptimizer<SurrogateLoss>;
-      return PenseMMPenaltyImpl<Optimizer, nsoptim::RidgePenalty>(x, y, penalties, enpy_inds, pense_opts,
+      return PenseMMPenaltyImpl<Runner, Optimizer, nsoptim::RidgePenalty>(x, y, penalties, enpy_inds, pense_opts,
                                                                   enpy_opts, optional_args, mm_options, en_options, 1);
     }
     case pense::EnAlgorithm::kLinearizedAdmm:
       if (use_sparse_coefs) {
         using Optimizer = nsoptim::LinearizedAdmmOptimizer<SurrogateLoss, PenaltyFunction, SparseCoefs>;
-        return PenseMMPenaltyImpl<Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
+        return PenseMMPenaltyImpl<Runner, Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
                                                               enpy_opts, optional_args, mm_options, en_options, 1);
       } else {
         using Optimizer = nsoptim::LinearizedAdmmOptimizer<SurrogateLoss, PenaltyFunction, DenseCoefs>;
-        return PenseMMPenaltyImpl<Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
+        return PenseMMPenaltyImpl<Runner, Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
                                                               enpy_opts, optional_args, mm_options, en_options, 1);
       }
     case pense::EnAlgorithm::kCoordinateDescent:
       if (use_sparse_coefs) {
         using Optimizer = nsoptim::CoordinateDescentOptimizer<SurrogateLoss, PenaltyFunction, SparseCoefs>;
-        return PenseMMPenaltyImpl<Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
+        return PenseMMPenaltyImpl<Runner, Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
                                                               enpy_opts, optional_args, mm_options, en_options, 1);
       } else {
         using Optimizer = nsoptim::CoordinateDescentOptimizer<SurrogateLoss, PenaltyFunction, DenseCoefs>;
-        return PenseMMPenaltyImpl<Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
+        return PenseMMPenaltyImpl<Runner, Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
                                                               enpy_opts, optional_args, mm_options, en_options, 1);
       }
     case pense::EnAlgorithm::kLars:
     default:
       if (use_sparse_coefs) {
         using Optimizer = nsoptim::AugmentedLarsOptimizer<SurrogateLoss, PenaltyFunction, SparseCoefs>;
-        return PenseMMPenaltyImpl<Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
+        return PenseMMPenaltyImpl<Runner, Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
                                                               enpy_opts, optional_args, mm_options, en_options, 1);
       } else {
         using Optimizer = nsoptim::AugmentedLarsOptimizer<SurrogateLoss, PenaltyFunction, DenseCoefs>;
-        return PenseMMPenaltyImpl<Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
+        return PenseMMPenaltyImpl<Runner, Optimizer, PenaltyFunction>(x, y, penalties, enpy_inds, pense_opts,
                                                               enpy_opts, optional_args, mm_options, en_options, 1);
       }
   }
@@ -438,7 +1398,7 @@ SEXP PenseMMDispatch(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds, const Rcpp:
 //!
 //! See `PenseEnRegression` for parameter documentation.
 //! @return `R_NilValue`.
-template<typename PenaltyFunction, typename Coefficients>
+template<typename Runner, typename PenaltyFunction, typename Coefficients>
 SEXP PenseCDPenaltyImpl(SEXP, SEXP, SEXP, SEXP, const Rcpp::List&, SEXP, const Rcpp::List&,
                         const Rcpp::List&, double) {
   return R_NilValue;
@@ -449,14 +1409,14 @@ SEXP PenseCDPenaltyImpl(SEXP, SEXP, SEXP, SEXP, const Rcpp::List&, SEXP, const R
 //!
 //! See `PenseEnRegression` for parameter documentation.
 //! @return the regularization path.
-template<typename PenaltyFunction, typename Coefficients, typename = typename
+template<typename Runner, typename PenaltyFunction, typename Coefficients, typename = typename
          std::enable_if<!std::is_same<PenaltyFunction, nsoptim::RidgePenalty>::value>::type >
 SEXP PenseCDPenaltyImpl(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds,
                         const Rcpp::List& pense_opts, SEXP enpy_opts, const Rcpp::List& optional_args,
                         const Rcpp::List& cd_options, int) {
   using Optimizer = pense::CDPense<PenaltyFunction, Coefficients>;
-  return PenseRegressionImpl(MakeOptimizer<Optimizer>(cd_options),
-                             x, y, penalties, enpy_inds, pense_opts, enpy_opts, optional_args);
+  return Runner::Run(MakeOptimizer<Optimizer>(cd_options),
+                     x, y, penalties, enpy_inds, pense_opts, enpy_opts, optional_args);
 }
 
 
@@ -466,17 +1426,17 @@ SEXP PenseCDPenaltyImpl(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds,
 //!
 //! See `PenseEnRegression` for parameter documentation.
 //! @return the regularization path.
-template<typename PenaltyFunction>
+template<typename Runner, typename PenaltyFunction>
 SEXP PenseCDDispatch(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds, const Rcpp::List& pense_opts,
                      SEXP enpy_opts, const Rcpp::List& optional_args) {
   const auto cd_options = GetFallback(pense_opts, "algo_opts", Rcpp::List());
   const bool use_sparse_coefs = GetFallback(pense_opts, "sparse", pense::kDefaultUseSparse);
 
   if (use_sparse_coefs) {
-    return PenseCDPenaltyImpl<PenaltyFunction, SparseCoefs>(
+    return PenseCDPenaltyImpl<Runner, PenaltyFunction, SparseCoefs>(
       x, y, penalties, enpy_inds, pense_opts, enpy_opts, optional_args, cd_options, 1);
   } else {
-    return PenseCDPenaltyImpl<PenaltyFunction, DenseCoefs>(
+    return PenseCDPenaltyImpl<Runner, PenaltyFunction, DenseCoefs>(
       x, y, penalties, enpy_inds, pense_opts, enpy_opts, optional_args, cd_options, 1);
   }
 }
@@ -490,44 +1450,35 @@ SEXP PenseCDDispatch(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds, const Rcpp:
 //!
 //! See `PenseEnRegression` for parameter documentation.
 //! @return the regularization path.
-template<typename PenaltyFunction>
+template<typename Runner, typename PenaltyFunction>
 SEXP PensePenaltyDispatch(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds,
                           SEXP r_pense_opts, SEXP enpy_opts, const Rcpp::List& optional_args) {
   const auto pense_options = as<Rcpp::List>(r_pense_opts);
   switch (GetFallback(pense_options, "algorithm", pense::kDefaultPenseAlgorithm)) {
     case pense::PenseAlgorithm::kCoordinateDescent:
-      return PenseCDDispatch<PenaltyFunction>(x, y, penalties, enpy_inds, pense_options,
+      return PenseCDDispatch<Runner, PenaltyFunction>(x, y, penalties, enpy_inds, pense_options,
                                               enpy_opts, optional_args);
     case pense::PenseAlgorithm::kAdmm:
      // Currently not implemented! Fall through to default MM algorithm.
     case pense::PenseAlgorithm::kMm:
     default:
-      return PenseMMDispatch<PenaltyFunction>(x, y, penalties, enpy_inds, pense_options,
+      return PenseMMDispatch<Runner, PenaltyFunction>(x, y, penalties, enpy_inds, pense_options,
                                               enpy_opts, optional_args);
   }
 }
 
 //! Compute the maximum lambda without penalty loadings.
 SEXP PenseMaxGradient(const arma::mat& x, const arma::vec& weights) {
-  double max_gradient = 0.;
-  for (arma::uword j = 0; j < x.n_cols; ++j) {
-    const double gradient_j = std::abs(arma::mean(x.col(j) % weights));
-    if (gradient_j > max_gradient) {
-      max_gradient = gradient_j;
-    }
-  }
+  // All gradients are computed in a single pass over the predictor matrix.
+  const arma::vec gradients = arma::abs(x.t() * weights) / x.n_rows;
+  const double max_gradient = gradients.n_elem > 0 ? gradients.max() : 0.;
   return Rcpp::wrap(max_gradient);
 }
 
 //! Compute the maximum lambda with penalty loadings.
 SEXP PenseMaxGradient(const arma::mat& x, const arma::vec& weights, std::unique_ptr<const arma::vec> loadings) {
-  double max_gradient = 0.;
-  for (arma::uword j = 0; j < x.n_cols; ++j) {
-    const double gradient_j = std::abs(arma::mean(x.col(j) % weights)) / loadings->at(j);
-    if (gradient_j > max_gradient) {
-      max_gradient = gradient_j;
-    }
-  }
+  const arma::vec gradients = arma::abs(x.t() * weights) / (*loadings * static_cast<double>(x.n_rows));
+  const double max_gradient = gradients.n_elem > 0 ? gradients.max() : 0.;
   return Rcpp::wrap(max_gradient);
 }
 
@@ -555,11 +1506,72 @@ SEXP PenseEnRegression(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds,
   const auto optional_args = as<Rcpp::List>(r_optional_args);
 
   if (optional_args.containsElementNamed("pen_loadings")) {
-    return PensePenaltyDispatch<nsoptim::AdaptiveEnPenalty>(x, y, penalties, enpy_inds, pense_opts,
-                                                            enpy_opts, optional_args);
+    return PensePenaltyDispatch<SinglePathRunner, nsoptim::AdaptiveEnPenalty>(x, y, penalties, enpy_inds,
+                                                                              pense_opts, enpy_opts, optional_args);
+  }
+
+  return PensePenaltyDispatch<SinglePathRunner, nsoptim::EnPenalty>(x, y, penalties, enpy_inds, pense_opts,
+                                                                    enpy_opts, optional_args);
+
+  END_RCPP
+}
+
+//! Compute a batch of (Adaptive) PENSE Regularization Paths on the same data.
+//!
+//! @param x numeric predictor matrix with `n` rows and `p` columns.
+//! @param y numeric response vector with `n` elements.
+//! @param jobs a list of jobs. Each job is a list with the following named items:
+//!               `penalties` ... a list of EN penalties with decreasing values of the lambda hyper-parameter.
+//!               `enpy_inds` ... a vector of 1-based indices for the `penalties` list, at which initial ENPY
+//!                               estimates should be computed.
+//!               `optional_args` ... optional list of optional arguments for this job. If missing, the shared
+//!                                   `optional_args` are used. Whether penalty loadings are used is determined by
+//!                                   the shared `optional_args`.
+//!               `test_ind` ... optional vector of 1-based indices of observations to leave out for this job.
+//!               `resample_ind` ... optional vector of 1-based indices of the observations used by this job.
+//!                                  Observations can be repeated. Must not be combined with `test_ind`.
+//! @param pense_opts a list of options for the PENSE algorithm.
+//! @param enpy_opts a list of options for the ENPY algorithm.
+//! @param optional_args a list of optional arguments shared by all jobs (see `PenseEnRegression`).
+SEXP PenseEnRegressionBatch(SEXP x, SEXP y, SEXP jobs, SEXP pense_opts, SEXP enpy_opts,
+                            SEXP r_optional_args) noexcept {
+  BEGIN_RCPP
+  const auto optional_args = as<Rcpp::List>(r_optional_args);
+
+  if (optional_args.containsElementNamed("pen_loadings")) {
+    return PensePenaltyDispatch<BatchRunner, nsoptim::AdaptiveEnPenalty>(x, y, jobs, R_NilValue, pense_opts,
+                                                                         enpy_opts, optional_args);
+  }
+
+  return PensePenaltyDispatch<BatchRunner, nsoptim::EnPenalty>(x, y, jobs, R_NilValue, pense_opts, enpy_opts,
+                                                               optional_args);
+
+  END_RCPP
+}
+
+//! Compute the predictions of (Adaptive) PENSE Regularization Paths for the left-out observations of CV folds.
+//!
+//! @param x numeric predictor matrix with `n` rows and `p` columns.
+//! @param y numeric response vector with `n` elements.
+//! @param jobs a list of jobs, one for each CV fold. Each job must specify `test_ind`, and can specify the
+//!             `standardization` of the training data as list with items `mux`, `muy`, and `coef_scale`, and
+//!             `pense_opts` to override the shared options. See `PenseEnRegressionBatch` for the other items.
+//! @param pense_opts a list of options for the PENSE algorithm.
+//! @param enpy_opts a list of options for the ENPY algorithm.
+//! @param optional_args a list of optional arguments shared by all jobs (see `PenseEnRegression`).
+//! @return a list of matrices with the predictions of the left-out observations, one column per penalty.
+SEXP PenseEnCrossValidation(SEXP x, SEXP y, SEXP jobs, SEXP pense_opts, SEXP enpy_opts,
+                            SEXP r_optional_args) noexcept {
+  BEGIN_RCPP
+  const auto optional_args = as<Rcpp::List>(r_optional_args);
+
+  if (optional_args.containsElementNamed("pen_loadings")) {
+    return PensePenaltyDispatch<CrossValidationRunner, nsoptim::AdaptiveEnPenalty>(
+      x, y, jobs, R_NilValue, pense_opts, enpy_opts, optional_args);
   }
 
-  return PensePenaltyDispatch<nsoptim::EnPenalty>(x, y, penalties, enpy_inds, pense_opts, enpy_opts, optional_args);
+  return PensePenaltyDispatch<CrossValidationRunner, nsoptim::EnPenalty>(x, y, jobs, R_NilValue, pense_opts,
+                                                                         enpy_opts, optional_args);
 
   END_RCPP
 }
@@ -30,6 +30,40 @@ namespace r_interface {
 SEXP PenseEnRegression(SEXP x, SEXP y, SEXP penalties, SEXP enpy_inds, SEXP pense_opts, SEXP enpy_opts,
                        SEXP optional_args) noexcept;
 
+//! Compute a batch of (Adaptive) PENSE Regularization Paths on the same data.
+//!
+//! @param x numeric predictor matrix with `n` rows and `p` columns.
+//! @param y numeric response vector with `n` elements.
+//! @param jobs a list of jobs. Each job is a list with the following named items:
+//!               `penalties` ... a list of EN penalties with decreasing values of the lambda hyper-parameter.
+//!               `enpy_inds` ... a vector of 1-based indices for the `penalties` list, at which initial ENPY
+//!                               estimates should be computed.
+//!               `optional_args` ... optional list of optional arguments for this job. If missing, the shared
+//!                                   `optional_args` are used. Whether penalty loadings are used is determined by
+//!                                   the shared `optional_args`.
+//!               `test_ind` ... optional vector of 1-based indices of observations to leave out for this job.
+//!               `y` ... optional numeric response vector with `n` elements for this job. If given, the job
+//!                       uses `x` with this response instead of `y`. Cannot be combined with `test_ind`.
+//! @param pense_opts a list of options for the PENSE algorithm.
+//! @param enpy_opts a list of options for the ENPY algorithm.
+//! @param optional_args a list of optional arguments shared by all jobs (see `PenseEnRegression`).
+SEXP PenseEnRegressionBatch(SEXP x, SEXP y, SEXP jobs, SEXP pense_opts, SEXP enpy_opts,
+                            SEXP optional_args) noexcept;
+
+//! Compute the predictions of (Adaptive) PENSE Regularization Paths for the left-out observations of CV folds.
+//!
+//! @param x numeric predictor matrix with `n` rows and `p` columns.
+//! @param y numeric response vector with `n` elements.
+//! @param jobs a list of jobs, one for each CV fold. Each job must specify `test_ind`, and can specify the
+//!             `standardization` of the training data as list with items `mux`, `muy`, and `coef_scale`, and
+//!             `pense_opts` to override the shared options. See `PenseEnRegressionBatch` for the other items.
+//! @param pense_opts a list of options for the PENSE algorithm.
+//! @param enpy_opts a list of options for the ENPY algorithm.
+//! @param optional_args a list of optional arguments shared by all jobs (see `PenseEnRegression`).
+//! @return a list of matrices with the predictions of the left-out observations, one column per penalty.
+SEXP PenseEnCrossValidation(SEXP x, SEXP y, SEXP jobs, SEXP pense_opts, SEXP enpy_opts,
+                            SEXP optional_args) noexcept;
+
 //! Get the smallest lambda such that the (Adaptive) PENSE estimate gives the empty model.
 //!
 //! @param x numeric predictor matrix with `n` rows and `p` columns.
@@ -8,11 +8,18 @@
 
 #include "r_robust_utils.hpp"
 
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
 #include "constants.hpp"
 #include "rcpp_integration.hpp"
 #include "r_interface_utils.hpp"
 #include "alias.hpp"
 #include "robust_scale_location.hpp"
+#include "omp_utils.hpp"
 
 using Rcpp::as;
 using pense::Mscale;
@@ -39,7 +46,190 @@ LocationScaleEstimate GenericMLocationScale(const arma::vec& x, const Mscale<T>&
   }
 }
 
+template<typename T, typename LocationRho>
+LocationScaleEstimate GenericMLocationScale(const arma::vec& x, const Mscale<T>& mscale,
+                                             const LocationRho& location_rho, arma::vec* residuals,
+                                             arma::vec* w_loc) {
+  return MLocationScale(x, mscale, location_rho, residuals, w_loc);
+}
+
 constexpr int kDefaultMLocationMaxIt = 100;
+constexpr int kDefaultNumThreads = 1;  //!< Default number of threads for searching over a grid of values.
+//! Consistency constant of the MAD for normally distributed values, the same as used by `stats::mad()`.
+constexpr double kMadConsistencyConstant = 1.4826;
+
+//! Workspace of a thread computing robust estimates of location and scale for several columns.
+struct ColumnWorkspace {
+  arma::vec residuals;
+  arma::vec weights;
+  arma::vec centered;
+};
+
+//! Call `fn(j, column, workspace)` for every column `j` of the matrix `x` using up to `num_threads` threads.
+//! The columns are not copied. Every thread uses its own workspace. Exceptions are re-thrown on the calling thread.
+template<typename Function>
+void ForEachColumn(const arma::mat& x, const int num_threads, const Function& fn) {
+  const int n_cols = static_cast<int>(x.n_cols);
+  auto workspaces = pense::omp::PerThread<ColumnWorkspace>(num_threads);
+  std::vector<std::exception_ptr> errors(n_cols);
+  pense::omp::ParallelFor(num_threads, n_cols, [&](const int col) {
+    try {
+      const arma::vec column(const_cast<double*>(x.colptr(col)), x.n_rows, false, true);
+      fn(col, column, &workspaces[pense::omp::ThreadNum()]);
+    } catch (...) {
+      errors[col] = std::current_exception();
+    }
+  });
+  for (auto&& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+//! Compute the M-location of every column in `x`, with the MAD of the column as scale.
+//! Columns with a MAD of 0 have a location of `NA`.
+template<typename RhoFunction>
+arma::vec ColumnMLocations(const arma::mat& x, const RhoFunction& rho, const double convergence_tol,
+                           const int max_it, const int num_threads) {
+  arma::vec locations(x.n_cols);
+  ForEachColumn(x, num_threads, [&](const int col, const arma::vec& column, ColumnWorkspace* workspace) {
+    workspace->residuals = arma::abs(column - arma::median(column));
+    const double scale = kMadConsistencyConstant * arma::median(workspace->residuals);
+    if (scale > std::numeric_limits<double>::epsilon()) {
+      locations[col] = MLocation(column, rho, scale, convergence_tol, max_it, &workspace->residuals,
+                                 &workspace->weights);
+    } else {
+      locations[col] = NA_REAL;
+    }
+  });
+  return locations;
+}
+
+//! Compute the M-estimate of location and the M-scale of every column in `x`.
+//! If `center` is not null, the columns are centered by `center` on the fly, without centering the matrix `x`.
+template<typename T, typename LocationRho>
+arma::mat ColumnMLocationScales(const arma::mat& x, const double* center, const Mscale<T>& mscale,
+                                const LocationRho& location_rho, const int num_threads) {
+  arma::mat estimates(2, x.n_cols);
+  ForEachColumn(x, num_threads, [&](const int col, const arma::vec& column, ColumnWorkspace* workspace) {
+    if (center) {
+      workspace->centered = column - center[col];
+    }
+    const auto estimate = GenericMLocationScale(center ? workspace->centered : column, mscale, location_rho,
+                                                &workspace->residuals, &workspace->weights);
+    estimates(0, col) = estimate.location;
+    estimates(1, col) = estimate.scale;
+  });
+  return estimates;
+}
+
+//! Search the maximum of a function of the M-scale over all vectors obtained by replacing the first `change` elements
+//! of `x` with values from `grid`.
+//! Since the M-scale (and hence its derivatives) is invariant to permutations of the values, only non-decreasing
+//! sequences of grid indices are considered. Every other combination is a permutation of one of these.
+//! The search is split by the grid index of the first element into disjoint parts which are searched in parallel.
+//! Within each part, consecutive combinations differ in few elements, hence the search state can carry over
+//! quantities from one combination to the next, e.g., the M-scale as starting point.
+//!
+//! `Search` must be copyable and provide the methods `void Evaluate(const arma::vec& values)` and
+//! `void Merge(const Search& other)`.
+//!
+//! @param x original values.
+//! @param grid grid of values.
+//! @param change number of elements in `x` to replace.
+//! @param num_threads number of threads.
+//! @param search the search state, already updated with the original values.
+template<typename Search>
+void SearchGrid(const arma::vec& x, const arma::vec& grid, const int change, const int num_threads, Search* search) {
+  const int grid_size = static_cast<int>(grid.n_elem);
+  if (change < 1 || grid_size < 1) {
+    return;
+  }
+
+  const Search initial_search = *search;
+  pense::omp::ParallelFor(num_threads, grid_size, [&](const int first_index) {
+    Search part_search = initial_search;
+    arma::vec values = x;
+    arma::uvec counters(change, arma::fill::value(first_index));
+    values.head(change).fill(grid[first_index]);
+    int p = 0;
+    do {
+      part_search.Evaluate(values);
+
+      // Move to the next non-decreasing sequence of grid indices. The first index is fixed.
+      p = change - 1;
+      while (p > 0 && counters[p] + 1 >= grid.n_elem) {
+        --p;
+      }
+      if (p > 0) {
+        const arma::uword next_index = counters[p] + 1;
+        for (int i = p; i < change; ++i) {
+          counters[i] = next_index;
+          values[i] = grid[next_index];
+        }
+      }
+    } while (p > 0);
+
+    #pragma omp critical(mscale_grid_search_merge)
+    search->Merge(part_search);
+  });
+}
+
+//! Search state for the maximum absolute derivative of the M-scale function.
+struct MaxDerivativeSearch {
+  explicit MaxDerivativeSearch(const Mscale<RhoBisquare>& _mscale) noexcept : mscale(_mscale) {}
+
+  void Evaluate(const arma::vec& values) {
+    // Start at the M-scale of the previous combination.
+    const auto derivatives = mscale.Derivative(values, &scale);
+    if (derivatives.n_elem > 0) {
+      max_derivative = std::max(max_derivative, arma::max(arma::abs(derivatives)));
+    }
+  }
+
+  void Merge(const MaxDerivativeSearch& other) noexcept {
+    max_derivative = std::max(max_derivative, other.max_derivative);
+  }
+
+  Mscale<RhoBisquare> mscale;
+  double scale = -1;
+  double max_derivative = 0;
+};
+
+//! Search state for the maximum elements in the gradient and Hessian of the M-scale function.
+struct MaxGradientHessianSearch {
+  explicit MaxGradientHessianSearch(const Mscale<RhoBisquare>& _mscale) noexcept
+      : mscale(_mscale), maxima(arma::fill::zeros) {}
+
+  void Evaluate(const arma::vec& values) {
+    const auto tmp_maxima = mscale.MaxGradientHessian(values);
+    // Start at the M-scale of the previous combination.
+    if (tmp_maxima[0] > mscale.eps()) {
+      mscale.SetInitial(tmp_maxima[0]);
+    }
+    Merge(tmp_maxima[1], tmp_maxima[2], tmp_maxima[0], tmp_maxima[0]);
+  }
+
+  void Merge(const MaxGradientHessianSearch& other) noexcept {
+    Merge(other.maxima[0], other.maxima[1], other.maxima[2], other.maxima[3]);
+  }
+
+  void Merge(const double max_gradient, const double max_hessian, const double scale_gradient,
+             const double scale_hessian) noexcept {
+    if (max_gradient > maxima[0]) {
+      maxima[0] = max_gradient;
+      maxima[2] = scale_gradient;
+    }
+    if (max_hessian > maxima[1]) {
+      maxima[1] = max_hessian;
+      maxima[3] = scale_hessian;
+    }
+  }
+
+  Mscale<RhoBisquare> mscale;
+  arma::vec::fixed<4> maxima;
+};
 }  // namespace
 
 namespace pense {
@@ -112,44 +302,17 @@ SEXP MaxMScaleDerivative(SEXP r_x, SEXP r_grid, SEXP r_change, SEXP r_mscale_opt
   auto grid = MakeVectorView(r_grid);
   auto change = as<int>(r_change);
   auto mscale_opts = as<Rcpp::List>(r_mscale_opts);
+  const int num_threads = GetFallback(mscale_opts, "num_threads", kDefaultNumThreads);
   switch (static_cast<RhoFunctionType>(GetFallback(mscale_opts, "rho",
                                                    static_cast<int>(RhoFunctionType::kRhoBisquare)))) {
     case RhoFunctionType::kRhoBisquare:
     default:
-      auto mscale = Mscale<RhoBisquare>(mscale_opts);
-      const auto derivatives = mscale.Derivative(x);
-      double max_md = 0;
-      if (derivatives.n_elem > 0) {
-        max_md = arma::max(arma::abs(derivatives));
-      }
-
-      arma::uvec counters(change, arma::fill::zeros);
-      int p = 0;
-      do {
-        for (int i = 0; i < change; ++i) {
-          x[i] = grid->at(counters[i]);
-        }
-        const auto derivatives = mscale.Derivative(x);
-        if (derivatives.n_elem > 0) {
-          const double md = arma::max(arma::abs(derivatives));
-          if (md > max_md) {
-            max_md = md;
-          }
-        }
-
-        p = change - 1;
-        while (p >= 0) {
-          ++counters[p];
-          if (counters[p] >= grid->n_elem) {
-            counters[p] = 0;
-            --p;
-          } else {
-            p = -2;
-          }
-        }
-      } while (p == -2);
-
-      return Rcpp::wrap(max_md);
+      MaxDerivativeSearch search(Mscale<RhoBisquare>(mscale_opts));
+      search.Evaluate(x);
+      // The search for the grid starts with the usual initial guess for the M-scale.
+      search.scale = -1;
+      SearchGrid(x, *grid, change, num_threads, &search);
+      return Rcpp::wrap(search.max_derivative);
   }
   END_RCPP;
 }
@@ -173,6 +336,7 @@ SEXP MaxMScaleGradientHessian(SEXP r_x, SEXP r_grid, SEXP r_change,
   auto grid = MakeVectorView(r_grid);
   auto change = as<int>(r_change);
   auto mscale_opts = as<Rcpp::List>(r_mscale_opts);
+  const int num_threads = GetFallback(mscale_opts, "num_threads", kDefaultNumThreads);
   const auto rho_fun = static_cast<RhoFunctionType>(
     GetFallback(mscale_opts, "rho",
                 static_cast<int>(RhoFunctionType::kRhoBisquare)));
@@ -180,51 +344,12 @@ SEXP MaxMScaleGradientHessian(SEXP r_x, SEXP r_grid, SEXP r_change,
   switch (rho_fun) {
   case RhoFunctionType::kRhoBisquare:
   default:
-    auto mscale = Mscale<RhoBisquare>(mscale_opts);
-    const auto tmp_maxima = mscale.MaxGradientHessian(x);
+    MaxGradientHessianSearch search(Mscale<RhoBisquare>(mscale_opts));
+    const auto tmp_maxima = search.mscale.MaxGradientHessian(x);
+    search.maxima = { tmp_maxima[1], tmp_maxima[2], tmp_maxima[0], tmp_maxima[0] };
 
-    if (tmp_maxima.n_elem < 1) {
-      return Rcpp::wrap(tmp_maxima);
-    }
-
-    arma::vec::fixed<4> maxima = { tmp_maxima[1], tmp_maxima[2],
-                                   tmp_maxima[0], tmp_maxima[0] };
-
-    if (change < 1) {
-      return Rcpp::wrap(maxima);
-    }
-
-    arma::uvec counters(change, arma::fill::zeros);
-    int p = 0;
-    do {
-      for (int i = 0; i < change; ++i) {
-        x[i] = grid->at(counters[i]);
-      }
-      const auto tmp_maxima = mscale.MaxGradientHessian(x);
-      if (tmp_maxima.n_elem == 3) {
-        if (tmp_maxima[1] > maxima[0]) {
-          maxima[0] = tmp_maxima[1];
-          maxima[2] = tmp_maxima[0];
-        }
-        if (tmp_maxima[2] > maxima[1]) {
-          maxima[1] = tmp_maxima[2];
-          maxima[3] = tmp_maxima[0];
-        }
-      }
-
-      p = change - 1;
-      while (p >= 0) {
-        ++counters[p];
-        if (counters[p] >= grid->n_elem) {
-          counters[p] = 0;
-          --p;
-        } else {
-          p = -2;
-        }
-      }
-    } while (p == -2);
-
-    return Rcpp::wrap(maxima);
+    SearchGrid(x, *grid, change, num_threads, &search);
+    return Rcpp::wrap(search.maxima);
   }
   END_RCPP;
 }
@@ -282,5 +407,51 @@ SEXP MLocationScale(SEXP r_x, SEXP r_mscale_opts, SEXP r_location_opts) noexcept
   return Rcpp::wrap(ret_vec);
   END_RCPP;
 }
+
+SEXP MLocationColumns(SEXP r_x, SEXP r_opts, SEXP r_num_threads) noexcept {
+  BEGIN_RCPP
+  const arma::mat x(REAL(r_x), Rf_nrows(r_x), Rf_ncols(r_x), false, true);
+  auto opts = as<Rcpp::List>(r_opts);
+  const int max_it = GetFallback(opts, "max_it", kDefaultMLocationMaxIt);
+  const double convergence_tol = GetFallback(opts, "eps", kDefaultConvergenceTolerance);
+  const int num_threads = as<int>(r_num_threads);
+
+  switch (static_cast<RhoFunctionType>(GetFallback(opts, "rho", static_cast<int>(RhoFunctionType::kRhoBisquare)))) {
+    case RhoFunctionType::kRhoHuber:
+      return Rcpp::wrap(ColumnMLocations(x, RhoHuber(GetFallback(opts, "cc", kDefaultHuberLocationCc)),
+                                         convergence_tol, max_it, num_threads));
+    case RhoFunctionType::kRhoBisquare:
+    default:
+      return Rcpp::wrap(ColumnMLocations(x, RhoBisquare(GetFallback(opts, "cc", kDefaultBisquareLocationCc)),
+                                         convergence_tol, max_it, num_threads));
+  }
+  END_RCPP;
+}
+
+SEXP MLocationScaleColumns(SEXP r_x, SEXP r_center, SEXP r_mscale_opts, SEXP r_location_opts,
+                           SEXP r_num_threads) noexcept {
+  BEGIN_RCPP
+  const arma::mat x(REAL(r_x), Rf_nrows(r_x), Rf_ncols(r_x), false, true);
+  const double* const center = Rf_isNull(r_center) ? nullptr : REAL(r_center);
+  if (center && static_cast<arma::uword>(Rf_xlength(r_center)) != x.n_cols) {
+    throw std::invalid_argument("length of the center does not match the number of columns");
+  }
+  auto mscale_opts = as<Rcpp::List>(r_mscale_opts);
+  auto location_opts = as<Rcpp::List>(r_location_opts);
+  const int num_threads = as<int>(r_num_threads);
+  const Mscale<RhoBisquare> mscale(mscale_opts);
+
+  switch (static_cast<RhoFunctionType>(GetFallback(location_opts, "rho",
+                                                   static_cast<int>(RhoFunctionType::kRhoBisquare)))) {
+    case RhoFunctionType::kRhoHuber:
+      return Rcpp::wrap(ColumnMLocationScales(
+        x, center, mscale, RhoHuber(GetFallback(location_opts, "cc", kDefaultHuberLocationCc)), num_threads));
+    case RhoFunctionType::kRhoBisquare:
+    default:
+      return Rcpp::wrap(ColumnMLocationScales(
+        x, center, mscale, RhoBisquare(GetFallback(location_opts, "cc", kDefaultBisquareLocationCc)), num_threads));
+  }
+  END_RCPP;
+}
 }  // namespace r_interface
 }  // namespace pense
@@ -70,6 +70,25 @@ SEXP MLocation(SEXP x, SEXP scale, SEXP opts) noexcept;
 //! @param location_opts a list of options for the location rho-function
 //! @return a vector with 2 elements: the location and the scale estimate.
 SEXP MLocationScale(SEXP x, SEXP mscale_opts, SEXP location_opts) noexcept;
+
+//! Compute the M-location of every column of a matrix, with the MAD of the column as scale.
+//!
+//! @param x numeric matrix.
+//! @param opts a list of options for the M-estimating equation.
+//! @param num_threads number of threads.
+//! @return a vector with the M-estimate of location of every column, or `NA` if the MAD of the column is 0.
+SEXP MLocationColumns(SEXP x, SEXP opts, SEXP num_threads) noexcept;
+
+//! Compute the M-estimate of the Location and Scale of every column of a matrix.
+//!
+//! @param x numeric matrix.
+//! @param center `NULL` or a numeric vector with one element per column of `x`. If given, the estimates are computed
+//!               for the centered columns `x[, j] - center[j]`, without forming the centered matrix.
+//! @param mscale_opts a list of options for the M-estimating equation.
+//! @param location_opts a list of options for the location rho-function
+//! @param num_threads number of threads.
+//! @return a matrix with 2 rows, the location and the scale estimate of every column.
+SEXP MLocationScaleColumns(SEXP x, SEXP center, SEXP mscale_opts, SEXP location_opts, SEXP num_threads) noexcept;
 }  // namespace r_interface
 }  // namespace pense
 
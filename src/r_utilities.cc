@@ -8,7 +8,40 @@
 
 #include "r_utilities.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <stdexcept>
+
+#include "rcpp_integration.hpp"
+#include "omp_utils.hpp"
+
+namespace {
+//! Minimum number of estimates predicted by a single thread.
+constexpr arma::uword kMinPredictColumnsPerThread = 4;
+
+//! Compute `x * beta` for blocks of columns of `beta` in parallel.
+template<typename Matrix>
+arma::mat BlockedProduct(const Matrix& x, const arma::sp_mat& beta, const int num_threads) {
+  const int n_blocks = static_cast<int>(std::min<arma::uword>(
+    static_cast<arma::uword>(std::max(num_threads, 1)),
+    std::max<arma::uword>(beta.n_cols / kMinPredictColumnsPerThread, 1)));
+  if (!pense::omp::Enabled(n_blocks) || n_blocks < 2) {
+    return arma::mat(x * beta);
+  }
+  arma::mat predictions(x.n_rows, beta.n_cols);
+  const arma::uword block_size = (beta.n_cols + n_blocks - 1) / n_blocks;
+  pense::blas::SingleThreadGuard blas_guard(n_blocks);
+  #pragma omp parallel for num_threads(n_blocks) schedule(static) default(shared)
+  for (int block = 0; block < n_blocks; ++block) {
+    const arma::uword first = block * block_size;
+    const arma::uword last = std::min(first + block_size, beta.n_cols);
+    if (first < last) {
+      predictions.cols(first, last - 1) = arma::mat(x * beta.cols(first, last - 1));
+    }
+  }
+  return predictions;
+}
+}  // namespace
 
 namespace pense {
 namespace r_interface {
@@ -43,5 +76,99 @@ SEXP ApproximateMatch(SEXP r_x, SEXP r_table, SEXP r_eps) noexcept {
   return r_matches;
 }
 
+SEXP PredictPath(SEXP r_x, SEXP r_beta, SEXP r_intercept, SEXP r_num_threads) noexcept {
+  BEGIN_RCPP
+  const Rcpp::List beta_list(r_beta);
+  const auto dim = Rcpp::as<arma::uvec>(beta_list["dim"]);
+  const arma::sp_mat beta(Rcpp::as<arma::uvec>(beta_list["i"]), Rcpp::as<arma::uvec>(beta_list["p"]),
+                          Rcpp::as<arma::vec>(beta_list["x"]), dim[0], dim[1]);
+  const arma::vec intercept = Rcpp::as<arma::vec>(r_intercept);
+  const int num_threads = Rcpp::as<int>(r_num_threads);
+  if (intercept.n_elem != beta.n_cols) {
+    throw std::invalid_argument("number of intercepts does not match the number of slope coefficients");
+  }
+
+  arma::mat predictions;
+  if (Rf_isMatrix(r_x) && TYPEOF(r_x) == REALSXP) {
+    const arma::mat x(REAL(r_x), Rf_nrows(r_x), Rf_ncols(r_x), false, true);
+    if (x.n_cols != beta.n_rows) {
+      throw std::invalid_argument("number of predictors does not match the slope coefficients");
+    }
+    predictions = BlockedProduct(x, beta, num_threads);
+  } else {
+    const arma::sp_mat x = Rcpp::as<arma::sp_mat>(r_x);
+    if (x.n_cols != beta.n_rows) {
+      throw std::invalid_argument("number of predictors does not match the slope coefficients");
+    }
+    predictions = BlockedProduct(x, beta, num_threads);
+  }
+  predictions.each_row() += intercept.t();
+  return Rcpp::wrap(predictions);
+  END_RCPP
+}
+
+SEXP StandardizeColumns(SEXP r_x, SEXP r_center, SEXP r_factor, SEXP r_num_threads) noexcept {
+  BEGIN_RCPP
+  const arma::uword n_rows = Rf_nrows(r_x);
+  const arma::uword n_cols = Rf_ncols(r_x);
+  const double* const x = REAL(r_x);
+  const double* const center = Rf_isNull(r_center) ? nullptr : REAL(r_center);
+  const double* const factor = Rf_isNull(r_factor) ? nullptr : REAL(r_factor);
+  if ((center && static_cast<arma::uword>(Rf_xlength(r_center)) != n_cols) ||
+      (factor && static_cast<arma::uword>(Rf_xlength(r_factor)) != n_cols)) {
+    throw std::invalid_argument("length of the center or scaling factors does not match the number of columns");
+  }
+
+  SEXP r_standardized = PROTECT(Rf_allocMatrix(REALSXP, n_rows, n_cols));
+  double* const standardized = REAL(r_standardized);
+  omp::ParallelFor(Rcpp::as<int>(r_num_threads), static_cast<int>(n_cols), [&](const int col) {
+    const double col_center = center ? center[col] : 0.;
+    const double col_factor = factor ? factor[col] : 1.;
+    const double* source = x + col * n_rows;
+    double* dest = standardized + col * n_rows;
+    for (arma::uword i = 0; i < n_rows; ++i) {
+      dest[i] = (source[i] - col_center) * col_factor;
+    }
+  });
+  UNPROTECT(1);
+  return r_standardized;
+  END_RCPP
+}
+
+SEXP KernelCountersStart() noexcept {
+  BEGIN_RCPP
+  return Rcpp::wrap(nsoptim::KernelCounters::Instance().Enable(true));
+  END_RCPP
+}
+
+SEXP KernelCountersStop() noexcept {
+  BEGIN_RCPP
+  auto& counters = nsoptim::KernelCounters::Instance();
+  counters.Enable(false);
+  Rcpp::List kernels;
+  for (std::size_t kernel = 0; kernel < nsoptim::kernel_counters::kNumKernels; ++kernel) {
+    const auto totals = counters.totals(static_cast<nsoptim::Kernel>(kernel));
+    if (totals.count == 0) {
+      continue;
+    }
+    Rcpp::NumericVector events(nsoptim::kernel_counters::kNumEvents, NA_REAL);
+    Rcpp::CharacterVector event_names(nsoptim::kernel_counters::kNumEvents);
+    for (std::size_t i = 0; i < nsoptim::kernel_counters::kNumEvents; ++i) {
+      event_names[i] = nsoptim::kernel_counters::kEventNames[i];
+      if (totals.events_available) {
+        events[i] = static_cast<double>(totals.events[i]);
+      }
+    }
+    events.names() = event_names;
+    kernels.push_back(Rcpp::List::create(Rcpp::Named("kernel") = nsoptim::kernel_counters::kKernelNames[kernel],
+                                         Rcpp::Named("count") = totals.count,
+                                         Rcpp::Named("threads") = totals.threads,
+                                         Rcpp::Named("wall_time") = totals.wall_time,
+                                         Rcpp::Named("events") = events));
+  }
+  return kernels;
+  END_RCPP
+}
+
 }  // namespace r_interface
 }  // namespace pense
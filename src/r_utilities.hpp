@@ -23,6 +23,40 @@ namespace r_interface {
 //!         if there is a match, or `NA_integer_` otherwise.
 SEXP ApproximateMatch(SEXP x, SEXP table, SEXP eps) noexcept;
 
+//! Compute the predictions of all coefficients along a regularization path at once.
+//!
+//! @param x numeric predictor matrix with `n` rows and `p` columns, either dense or of class `dgCMatrix`.
+//! @param beta the slope coefficients of the `L` estimates as column-compressed sparse matrix with `p` rows and `L`
+//!             columns (a list with items `i`, `p`, `x` and `dim`, with 0-based indices as in a `dgCMatrix`).
+//! @param intercept numeric vector with the `L` intercepts.
+//! @param num_threads number of threads for computing the predictions.
+//! @return a numeric matrix with `n` rows and `L` columns of predictions.
+SEXP PredictPath(SEXP x, SEXP beta, SEXP intercept, SEXP num_threads) noexcept;
+
+//! Center and scale the columns of a numeric matrix in a single pass over the matrix, i.e., compute
+//! `(x[, j] - center[j]) * factor[j]` for every column `j`.
+//!
+//! @param x numeric matrix with `p` columns.
+//! @param center numeric vector with `p` elements, or `NULL` to not center the columns.
+//! @param factor numeric vector with `p` scaling factors, or `NULL` to not scale the columns.
+//! @param num_threads number of threads.
+//! @return a new numeric matrix with the standardized columns.
+SEXP StandardizeColumns(SEXP x, SEXP center, SEXP factor, SEXP num_threads) noexcept;
+
+//! Start counting the wall-clock time and hardware events spent in the numerical kernels. Discards all previous
+//! counts.
+//!
+//! @return a logical scalar, `TRUE` if the hardware events are counted and `FALSE` if only the wall-clock time is
+//!         counted.
+SEXP KernelCountersStart() noexcept;
+
+//! Stop counting the numerical kernels and return the counts.
+//!
+//! @return a list with one element per kernel, with the number of calls, the number of distinct threads executing
+//!         the kernel, the total wall-clock time and the totals of the hardware events (`NA` if the events are
+//!         not available).
+SEXP KernelCountersStop() noexcept;
+
 }  // namespace r_interface
 }  // namespace pense
 
@@ -0,0 +1,67 @@
+//
+//  random_subset_initest.cc
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#include "random_subset_initest.hpp"
+
+#include <algorithm>
+#include <random>
+
+#include "rcpp_utils.hpp"
+
+using arma::uvec;
+using arma::uword;
+
+namespace {
+constexpr int kDefaultNumSubsets = 500;  //!< Number of random subsets.
+constexpr int kDefaultSubsetSize = 0;  //!< Determine the size of the subsets from the dimensions of the data.
+constexpr int kDefaultConcentrationSteps = 2;  //!< Number of iterations of the S-optimizer from every candidate.
+constexpr int kDefaultRetainMax = 10;  //!< Number of candidates to retain.
+constexpr int kDefaultSeed = 20220308;  //!< Seed for drawing the random subsets.
+constexpr int kDefaultNumThreads = 1;  //!< Default number of threads.
+}  // namespace
+
+namespace pense {
+namespace random_subset_initest_internal {
+RandomSubsetConfiguration ParseConfiguration(const Rcpp::List& config) noexcept {
+  return RandomSubsetConfiguration{
+    GetFallback(config, "num_subsets", kDefaultNumSubsets),
+    GetFallback(config, "subset_size", kDefaultSubsetSize),
+    GetFallback(config, "concentration_steps", kDefaultConcentrationSteps),
+    GetFallback(config, "retain_max", kDefaultRetainMax),
+    static_cast<std::uint32_t>(GetFallback(config, "seed", kDefaultSeed)),
+    GetFallback(config, "num_threads", kDefaultNumThreads),
+    nullptr
+  };
+}
+
+uword SubsetSize(const RandomSubsetConfiguration& config, const uword n_obs, const uword n_pred) noexcept {
+  const uword size = config.subset_size > 0 ? static_cast<uword>(config.subset_size) :
+    std::min(n_pred + 1, n_obs / 2);
+  return std::min(n_obs, std::max(size, kMinSubsetSize));
+}
+
+std::vector<uvec> RandomSubsets(const uword n_obs, const uword subset_size, const int num_subsets,
+                                const std::uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> unif(0., 1.);
+  std::vector<uvec> subsets;
+  subsets.reserve(std::max(num_subsets, 0));
+  for (int subset = 0; subset < num_subsets; ++subset) {
+    // Selection sampling yields a sorted random subset in a single pass.
+    uvec indices(subset_size);
+    uword selected = 0;
+    for (uword i = 0; i < n_obs && selected < subset_size; ++i) {
+      if ((n_obs - i) * unif(rng) < subset_size - selected) {
+        indices[selected++] = i;
+      }
+    }
+    subsets.push_back(std::move(indices));
+  }
+  return subsets;
+}
+}  // namespace random_subset_initest_internal
+}  // namespace pense
@@ -0,0 +1,158 @@
+//
+//  random_subset_initest.hpp
+//  pense
+//
+//  Created on 2026-10-14.
+//
+
+#ifndef RANDOM_SUBSET_INITEST_HPP_
+#define RANDOM_SUBSET_INITEST_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "nsoptim.hpp"
+#include "alias.hpp"
+#include "s_loss.hpp"
+#include "omp_utils.hpp"
+#include "enpy_types.hpp"
+
+namespace pense {
+namespace random_subset_initest_internal {
+//! Minimum number of observations in a random subset.
+constexpr arma::uword kMinSubsetSize = 3;
+//! Number of passes over a subset assumed for fitting the LS-EN estimate, for estimating the work.
+constexpr double kEstimatedSubsetPasses = 4;
+
+struct RandomSubsetConfiguration {
+  int num_subsets;  //!< Number of random subsets.
+  int subset_size;  //!< Number of observations in every subset. If less than 1, the size is determined from the
+                    //!< dimensions of the data (see `SubsetSize()`).
+  int concentration_steps;  //!< Number of iterations of the S-optimizer started from every candidate.
+  int retain_max;  //!< Retain at most this number of candidates with smallest objective function value.
+  std::uint32_t seed;  //!< Seed for drawing the random subsets.
+  int num_threads;  //!< Number of concurrent threads to use.
+  nsoptim::PhaseTimings* timings;  //!< Record the time spent on the random subsets, unless `nullptr`.
+};
+
+//! Parse an Rcpp::List into the RandomSubsetConfiguration structure.
+RandomSubsetConfiguration ParseConfiguration(const Rcpp::List& config) noexcept;
+
+//! Get the number of observations in every random subset.
+//! Unless given in the configuration, the subsets contain one more observation than there are predictors, but at
+//! most half of the observations, such that most subsets are free of outliers.
+//!
+//! @param config configuration object.
+//! @param n_obs the number of observations.
+//! @param n_pred the number of predictors.
+//! @return the number of observations in every subset.
+arma::uword SubsetSize(const RandomSubsetConfiguration& config, const arma::uword n_obs,
+                       const arma::uword n_pred) noexcept;
+
+//! Draw random subsets of observations. The subsets are the same for every call with the same arguments.
+//!
+//! @param n_obs the number of observations.
+//! @param subset_size the number of observations in every subset.
+//! @param num_subsets the number of subsets.
+//! @param seed the seed for the random number generator.
+//! @return a vector of sorted index vectors.
+std::vector<arma::uvec> RandomSubsets(const arma::uword n_obs, const arma::uword subset_size, const int num_subsets,
+                                      const std::uint32_t seed);
+}  // namespace random_subset_initest_internal
+
+//! Compute initial estimates for the S-loss from random subsets of the observations, in the spirit of the Fast-S
+//! algorithm.
+//! For every penalty, the LS-EN estimate is computed on each of many small random subsets of the observations, and
+//! every such candidate is concentrated by a few iterations of the S-optimizer on the full data. The candidates with
+//! the smallest objective function value are retained. All subsets are processed independently, in parallel.
+//!
+//! @param loss the S loss object for which to obtain initial estimates.
+//! @param penalties a list of penalties to compute the initial estimators for.
+//! @param ls_optim the optimizer to compute the LS-EN estimates on the random subsets.
+//! @param s_optim the optimizer to concentrate the candidates.
+//! @param config configuration object.
+//! @return a list of results, one for each given penalty, in the same order as `penalties`. The initial estimates
+//!         of every result are ordered by increasing objective function value.
+template<typename LsOptimizer, typename SOptimizer>
+alias::FwdList<PyResult<SOptimizer>> RandomSubsetInitialEstimators(
+    const SLoss& loss, const alias::FwdList<typename SOptimizer::PenaltyFunction>& penalties,
+    const LsOptimizer& ls_optim, const SOptimizer& s_optim,
+    const random_subset_initest_internal::RandomSubsetConfiguration& config) {
+  using random_subset_initest_internal::RandomSubsets;
+  using random_subset_initest_internal::SubsetSize;
+  using random_subset_initest_internal::kEstimatedSubsetPasses;
+  using Optimum = typename SOptimizer::Optimum;
+
+  const nsoptim::PredictorResponseData& data = loss.data();
+  const arma::uword subset_size = SubsetSize(config, data.n_obs(), data.n_pred());
+  const auto subsets = RandomSubsets(data.n_obs(), subset_size, config.num_subsets, config.seed);
+  const int concentration_steps = std::max(1, config.concentration_steps);
+  const int num_threads = std::max(1, config.num_threads);
+  // Fitting the LS-EN estimate needs a few passes over the subset, every concentration step at least one pass over
+  // all observations.
+  const double task_work = static_cast<double>(data.n_pred()) *
+    (subset_size * kEstimatedSubsetPasses + static_cast<double>(data.n_obs()) * concentration_steps);
+
+  alias::FwdList<PyResult<SOptimizer>> results;
+  auto results_it = results.before_begin();
+  blas::SingleThreadGuard blas_guard(num_threads);
+  for (auto&& penalty : penalties) {
+    nsoptim::ScopedPhaseTimer timer(config.timings, "random_subsets");
+    results_it = results.emplace_after(results_it, nsoptim::Metrics("random_subset_initest"));
+    std::vector<std::unique_ptr<Optimum>> candidates(subsets.size());
+
+    // Every subset is fitted and concentrated with its own copies of the optimizers.
+    omp::ParallelFor(num_threads, static_cast<int>(subsets.size()), task_work, [&](const int subset_index) {
+      nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRandomSubsetCandidate);
+      LsOptimizer subset_optim = ls_optim;
+      subset_optim.penalty(penalty);
+      subset_optim.loss(nsoptim::LsRegressionLoss(
+        std::make_shared<nsoptim::PredictorResponseData>(data.Observations(subsets[subset_index])),
+        loss.IncludeIntercept()));
+      const auto subset_optimum = subset_optim.Optimize();
+      if (subset_optimum.status == nsoptim::OptimumStatus::kError) {
+        return;
+      }
+
+      SOptimizer concentration_optim = s_optim;
+      concentration_optim.loss(loss);
+      concentration_optim.penalty(penalty);
+      auto optimum = concentration_optim.Optimize(subset_optimum.coefs, concentration_steps);
+      if (optimum.status != nsoptim::OptimumStatus::kError) {
+        optimum.metrics.reset();
+        candidates[subset_index].reset(new Optimum(std::move(optimum)));
+      }
+    });
+
+    std::vector<Optimum*> valid_candidates;
+    for (auto&& candidate : candidates) {
+      if (candidate) {
+        valid_candidates.push_back(candidate.get());
+      }
+    }
+    results_it->metrics.AddMetric("num_subsets", static_cast<int>(subsets.size()));
+    results_it->metrics.AddMetric("subset_size", static_cast<int>(subset_size));
+    results_it->metrics.AddMetric("failed_subsets", static_cast<int>(subsets.size() - valid_candidates.size()));
+
+    // Retain the best candidates, ordered by increasing objective function value. Ties keep the order of the subsets.
+    const std::size_t n_retain = config.retain_max > 0 ?
+      std::min(valid_candidates.size(), static_cast<std::size_t>(config.retain_max)) : valid_candidates.size();
+    std::stable_sort(valid_candidates.begin(), valid_candidates.end(), [](const Optimum* a, const Optimum* b) {
+      return a->objf_value < b->objf_value;
+    });
+    if (n_retain > 0) {
+      results_it->metrics.AddMetric("best_objf_value", valid_candidates.front()->objf_value);
+    }
+    auto estimates_it = results_it->initial_estimates.before_begin();
+    for (std::size_t i = 0; i < n_retain; ++i) {
+      estimates_it = results_it->initial_estimates.insert_after(estimates_it, std::move(*valid_candidates[i]));
+    }
+  }
+  return results;
+}
+}  // namespace pense
+
+#endif  // RANDOM_SUBSET_INITEST_HPP_
@@ -16,14 +16,25 @@
 namespace {
 constexpr int kAdmmMaxIt = 1000;
 constexpr double kAdmmAcceleration = 1;
+constexpr double kAdmmRelaxation = 1;
+constexpr bool kAdmmAdaptiveStep = false;
 
 constexpr int kCDLsMaxIt = 1000;
 constexpr int kCDLsResetIt = 8;
+constexpr bool kCDLsStrongRules = false;
+constexpr bool kCDLsCovarianceUpdates = true;
+constexpr nsoptim::CoordinateOrder kCDLsOrder = nsoptim::CoordinateOrder::kCyclic;
 
 constexpr int kCDPenseMaxIt = 1000;
 constexpr int kCDPenseResetIt = 8;
 constexpr double kCDPenseLinesearchMult = 0.;
 constexpr int kCDPenseLinesearchSteps = 10;
+constexpr bool kCDPenseActiveSet = false;
+constexpr bool kCDPenseStrongRules = false;
+constexpr bool kCDPenseCoordinateMetrics = true;
+constexpr int kCDPenseBlockSize = 0;
+constexpr int kCDPenseNumThreads = 1;
+constexpr nsoptim::CoordinateOrder kCDPenseOrder = nsoptim::CoordinateOrder::kCyclic;
 
 constexpr int kDalMaxIt = 100;
 constexpr int kDalMaxInnerIt = 100;
@@ -31,10 +42,13 @@ constexpr double kDalEtaMult = 2;
 constexpr double kDalEtaStartNumeratorCons = 0.01;
 constexpr double kDalEtaStartNumeratorAggr = 1;
 constexpr double kDalLambdaRelChangeAggr = 0.25;
+constexpr bool kDalSafeScreening = false;
 
 constexpr int kMmMaxIt = 500;
 constexpr nsoptim::MMConfiguration::TighteningType kMmTightening = nsoptim::MMConfiguration::TighteningType::kAdaptive;
 constexpr int kMmTighteningSteps = 10;
+constexpr double kMmMinWeightChange = 0;
+constexpr bool kMmAccelerate = false;
 }  // namespace
 
 namespace Rcpp {
@@ -44,7 +58,9 @@ nsoptim::AdmmLinearConfiguration Exporter<nsoptim::AdmmLinearConfiguration>::get
   const Rcpp::List config_list = as<const Rcpp::List>(r_obj_);
   nsoptim::AdmmLinearConfiguration tmp = {
     pense::GetFallback(config_list, "max_it", kAdmmMaxIt),
-    pense::GetFallback(config_list, "accelerate", kAdmmAcceleration)
+    pense::GetFallback(config_list, "accelerate", kAdmmAcceleration),
+    pense::GetFallback(config_list, "relaxation", kAdmmRelaxation),
+    pense::GetFallback(config_list, "adaptive_step", kAdmmAdaptiveStep)
   };
   return tmp;
 }
@@ -57,7 +73,8 @@ nsoptim::DalEnConfiguration Exporter<nsoptim::DalEnConfiguration>::get() const {
       pense::GetFallback(config_list, "eta_start_numerator_conservative", kDalEtaStartNumeratorCons),
       pense::GetFallback(config_list, "eta_start_numerator_aggressive", kDalEtaStartNumeratorAggr),
       pense::GetFallback(config_list, "lambda_relchange_aggressive", kDalLambdaRelChangeAggr),
-      pense::GetFallback(config_list, "eta_multiplier", kDalEtaMult)
+      pense::GetFallback(config_list, "eta_multiplier", kDalEtaMult),
+      pense::GetFallback(config_list, "safe_screening", kDalSafeScreening)
   };
   return tmp;
 }
@@ -68,7 +85,13 @@ pense::CDPenseConfiguration Exporter<pense::CDPenseConfiguration>::get() const {
       pense::GetFallback(config_list, "max_it", kCDPenseMaxIt),
       pense::GetFallback(config_list, "linesearch_mult", kCDPenseLinesearchMult),
       pense::GetFallback(config_list, "linesearch_steps", kCDPenseLinesearchSteps),
-      pense::GetFallback(config_list, "reset_it", kCDPenseResetIt)
+      pense::GetFallback(config_list, "reset_it", kCDPenseResetIt),
+      pense::GetFallback(config_list, "active_set", kCDPenseActiveSet),
+      pense::GetFallback(config_list, "strong_rules", kCDPenseStrongRules),
+      pense::GetFallback(config_list, "coordinate_metrics", kCDPenseCoordinateMetrics),
+      pense::GetFallback(config_list, "block_size", kCDPenseBlockSize),
+      pense::GetFallback(config_list, "num_threads", kCDPenseNumThreads),
+      pense::GetFallback(config_list, "coordinate_order", kCDPenseOrder)
   };
   return tmp;
 }
@@ -77,7 +100,10 @@ nsoptim::CDConfiguration Exporter<nsoptim::CDConfiguration>::get() const {
   const Rcpp::List config_list = as<const Rcpp::List>(r_obj_);
   nsoptim::CDConfiguration tmp = {
       pense::GetFallback(config_list, "max_it", kCDLsMaxIt),
-      pense::GetFallback(config_list, "reset_it", kCDLsResetIt)
+      pense::GetFallback(config_list, "reset_it", kCDLsResetIt),
+      pense::GetFallback(config_list, "strong_rules", kCDLsStrongRules),
+      pense::GetFallback(config_list, "covariance_updates", kCDLsCovarianceUpdates),
+      pense::GetFallback(config_list, "coordinate_order", kCDLsOrder)
   };
   return tmp;
 }
@@ -87,7 +113,9 @@ nsoptim::MMConfiguration Exporter<nsoptim::MMConfiguration>::get() const {
   nsoptim::MMConfiguration tmp = {
       pense::GetFallback(config_list, "max_it", kMmMaxIt),
       pense::GetFallback(config_list, "tightening", kMmTightening),
-      pense::GetFallback(config_list, "tightening_steps", kMmTighteningSteps)
+      pense::GetFallback(config_list, "tightening_steps", kMmTighteningSteps),
+      pense::GetFallback(config_list, "min_weight_change", kMmMinWeightChange),
+      pense::GetFallback(config_list, "accelerate", kMmAccelerate)
   };
   return tmp;
 }
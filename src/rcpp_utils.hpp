@@ -12,10 +12,13 @@
 #include <string>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
 #include "nsoptim.hpp"
+#include "compact_optimum.hpp"
 #include "constants.hpp"
 #include "enpy_types.hpp"
+#include "omp_utils.hpp"
 
 namespace pense {
 //! Get an item from the list or use the fallback if the item does not exist.
@@ -77,6 +80,48 @@ inline pense::RhoFunctionType GetFallback<pense::RhoFunctionType>(const Rcpp::Li
   return fallback;
 }
 
+//! enum-specific overload
+template<>
+inline pense::MscaleAlgorithm GetFallback<pense::MscaleAlgorithm>(const Rcpp::List& list, const std::string& name,
+                                                                  const pense::MscaleAlgorithm fallback) noexcept {
+  try {
+    // Check if the element exists to avoid unnecessary exceptions.
+    // An unsupported cast to `T` still triggers an exception, but this shouldn't happen very often!
+    if (list.containsElementNamed(name.c_str())) {
+      return static_cast<pense::MscaleAlgorithm>(Rcpp::as<int>(list[name]));
+    }
+  } catch (...) {}
+  return fallback;
+}
+
+//! enum-specific overload
+template<>
+inline pense::LooWarmStart GetFallback<pense::LooWarmStart>(const Rcpp::List& list, const std::string& name,
+                                                          const pense::LooWarmStart fallback) noexcept {
+  try {
+    // Check if the element exists to avoid unnecessary exceptions.
+    // An unsupported cast to `T` still triggers an exception, but this shouldn't happen very often!
+    if (list.containsElementNamed(name.c_str())) {
+      return static_cast<pense::LooWarmStart>(Rcpp::as<int>(list[name]));
+    }
+  } catch (...) {}
+  return fallback;
+}
+
+//! enum-specific overload
+template<>
+inline pense::InitialEstimatorMethod GetFallback<pense::InitialEstimatorMethod>(
+  const Rcpp::List& list, const std::string& name, const pense::InitialEstimatorMethod fallback) noexcept {
+  try {
+    // Check if the element exists to avoid unnecessary exceptions.
+    // An unsupported cast to `T` still triggers an exception, but this shouldn't happen very often!
+    if (list.containsElementNamed(name.c_str())) {
+      return static_cast<pense::InitialEstimatorMethod>(Rcpp::as<int>(list[name]));
+    }
+  } catch (...) {}
+  return fallback;
+}
+
 //! enum-specific overload
 template<>
 inline nsoptim::MMConfiguration::TighteningType GetFallback<nsoptim::MMConfiguration::TighteningType>(
@@ -91,6 +136,28 @@ inline nsoptim::MMConfiguration::TighteningType GetFallback<nsoptim::MMConfigura
   return fallback;
 }
 
+//! enum-specific overload
+template<>
+inline nsoptim::CoordinateOrder GetFallback<nsoptim::CoordinateOrder>(
+  const Rcpp::List& list, const std::string& name, const nsoptim::CoordinateOrder fallback) noexcept {
+  try {
+    // Check if the element exists to avoid unnecessary exceptions.
+    // An unsupported cast to `T` still triggers an exception, but this shouldn't happen very often!
+    if (list.containsElementNamed(name.c_str())) {
+      return static_cast<nsoptim::CoordinateOrder>(Rcpp::as<int>(list[name]));
+    }
+  } catch (...) {}
+  return fallback;
+}
+
+//! Check if the user requested an interrupt.
+//! The R API must only be used from the main thread, hence the check is skipped inside an active parallel region.
+inline void CheckUserInterrupt() {
+  if (!omp::InParallel()) {
+    Rcpp::checkUserInterrupt();
+  }
+}
+
 //! Wrap an Optimum for any EN-type penalty function into an R list.
 //!
 //! @param optimium the Optimum object.
@@ -107,6 +174,23 @@ Rcpp::List WrapOptimum(const T& optimum) {
                             Named("beta") = optimum.coefs.beta);
 }
 
+//! Wrap a compactly stored Optimum for any EN-type penalty function into an R list.
+//! The slope coefficients are wrapped in the same form as for the original Optimum.
+//!
+//! @param optimium the CompactOptimum object.
+//! @return the optimum as Rcpp::List.
+template <typename T>
+Rcpp::List WrapOptimum(const CompactOptimum<T>& optimum) {
+  using Rcpp::Named;
+  return Rcpp::List::create(Named("alpha") = optimum.penalty.alpha(),
+                            Named("lambda") = optimum.penalty.lambda(),
+                            Named("objf_value") = optimum.objf_value,
+                            Named("statuscode") = static_cast<int>(optimum.status),
+                            Named("status") = optimum.message,
+                            Named("intercept") = optimum.coefs.intercept,
+                            Named("beta") = optimum.FullCoefficients().beta);
+}
+
 //! Wrap a list of optima for any EN-type penalty function into an R list.
 //! @param optima list of Optimum objects.
 //! @return the optimum as Rcpp::List.
@@ -118,6 +202,162 @@ Rcpp::List WrapOptima(const std::forward_list<T>& optima) {
   }
   return output_list;
 }
+
+namespace compact {
+//! Append the row indices and values of the non-zero elements of a dense vector.
+inline void AppendNonZeros(const arma::vec& beta, std::vector<int>* row_ind, std::vector<double>* values) {
+  for (arma::uword i = 0; i < beta.n_elem; ++i) {
+    if (beta[i] != 0) {
+      row_ind->push_back(static_cast<int>(i));
+      values->push_back(beta[i]);
+    }
+  }
+}
+
+//! Append the row indices and values of the non-zero elements of a sparse vector.
+inline void AppendNonZeros(const arma::sp_vec& beta, std::vector<int>* row_ind, std::vector<double>* values) {
+  for (auto it = beta.begin(), end = beta.end(); it != end; ++it) {
+    row_ind->push_back(static_cast<int>(it.row()));
+    values->push_back(*it);
+  }
+}
+
+//! Append the row indices and values of the non-zero elements of compactly stored slope coefficients.
+inline void AppendNonZeros(const CompactSlope& beta, std::vector<int>* row_ind, std::vector<double>* values) {
+  if (beta.IsSparse()) {
+    AppendNonZeros(beta.Sparse(), row_ind, values);
+  } else {
+    AppendNonZeros(beta.Dense(), row_ind, values);
+  }
+}
+
+//! Collect the metrics of `metrics` and all its sub-metrics as rows of a table.
+class MetricsTable {
+ public:
+  //! Add the metrics and all sub-metrics.
+  //!
+  //! @param metrics the metrics to add.
+  //! @param parent_path the path of the parent metrics, or an empty string for the root.
+  void Add(const nsoptim::Metrics& metrics, const std::string& parent_path) {
+    const int node = ++nodes_;
+    const std::string path = parent_path.empty() ? metrics.name() : parent_path + "/" + metrics.name();
+    for (auto&& metric : metrics.DoubleMetrics()) {
+      AddRow(node, path, metric.name, metric.value);
+    }
+    for (auto&& metric : metrics.IntegerMetrics()) {
+      AddRow(node, path, metric.name, metric.value);
+    }
+    for (auto&& metric : metrics.StringMetrics()) {
+      AddRow(node, path, metric.name, NA_REAL);
+      text_.back() = metric.value;
+      has_text_.back() = true;
+    }
+    for (auto&& sub_metric : metrics.SubMetrics()) {
+      Add(sub_metric, path);
+    }
+  }
+
+  //! Convert the table to an R data frame.
+  Rcpp::DataFrame Wrap() const {
+    using Rcpp::Named;
+    Rcpp::CharacterVector text(text_.size());
+    for (std::size_t i = 0; i < text_.size(); ++i) {
+      text[i] = has_text_[i] ? Rcpp::String(text_[i]) : Rcpp::String(NA_STRING);
+    }
+    return Rcpp::DataFrame::create(Named("node") = Rcpp::wrap(node_), Named("path") = Rcpp::wrap(path_),
+                                   Named("metric") = Rcpp::wrap(metric_), Named("value") = Rcpp::wrap(value_),
+                                   Named("text") = text, Named("stringsAsFactors") = false);
+  }
+
+ private:
+  void AddRow(const int node, const std::string& path, const std::string& metric, const double value) {
+    node_.push_back(node);
+    path_.push_back(path);
+    metric_.push_back(metric);
+    value_.push_back(value);
+    text_.emplace_back();
+    has_text_.push_back(false);
+  }
+
+  int nodes_ = 0;
+  std::vector<int> node_;
+  std::vector<std::string> path_;
+  std::vector<std::string> metric_;
+  std::vector<double> value_;
+  std::vector<std::string> text_;
+  std::vector<bool> has_text_;
+};
+}  // namespace compact
+
+//! Wrap all optima along a regularization path into a compact R list.
+//! In contrast to WrapOptima, the optima are not wrapped individually. Instead, the coefficients of all optima are
+//! stored in the columns of a single column-compressed sparse matrix (items `i`, `p`, `x` and `dim`, with 0-based
+//! indices as in a `dgCMatrix`) and the other information in flat vectors with one element per optimum.
+//!
+//! @param path list of optima, one for each penalty.
+//! @return the optima as Rcpp::List.
+template <typename T>
+Rcpp::List WrapOptimaPath(const std::forward_list<std::forward_list<T>>& path) {
+  using Rcpp::Named;
+  int n_optima = 0;
+  int n_pred = 0;
+  for (auto&& optima : path) {
+    for (auto&& optimum : optima) {
+      n_pred = static_cast<int>(optimum.coefs.beta.n_elem);
+      ++n_optima;
+    }
+  }
+
+  Rcpp::NumericVector alpha(n_optima), lambda(n_optima), objf_value(n_optima), intercept(n_optima);
+  Rcpp::IntegerVector statuscode(n_optima), penalty_index(n_optima);
+  Rcpp::CharacterVector status(n_optima);
+  Rcpp::IntegerVector col_ptr(n_optima + 1);
+  std::vector<int> row_ind;
+  std::vector<double> values;
+
+  int col = 0;
+  int penalty = 0;
+  for (auto&& optima : path) {
+    ++penalty;
+    for (auto&& optimum : optima) {
+      alpha[col] = optimum.penalty.alpha();
+      lambda[col] = optimum.penalty.lambda();
+      objf_value[col] = optimum.objf_value;
+      intercept[col] = optimum.coefs.intercept;
+      statuscode[col] = static_cast<int>(optimum.status);
+      status[col] = optimum.message;
+      penalty_index[col] = penalty;
+      compact::AppendNonZeros(optimum.coefs.beta, &row_ind, &values);
+      col_ptr[++col] = static_cast<int>(values.size());
+    }
+  }
+
+  return Rcpp::List::create(Named("alpha") = alpha,
+                            Named("lambda") = lambda,
+                            Named("objf_value") = objf_value,
+                            Named("statuscode") = statuscode,
+                            Named("status") = status,
+                            Named("intercept") = intercept,
+                            Named("penalty_index") = penalty_index,
+                            Named("beta") = Rcpp::List::create(
+                              Named("i") = Rcpp::wrap(row_ind),
+                              Named("p") = col_ptr,
+                              Named("x") = Rcpp::wrap(values),
+                              Named("dim") = Rcpp::IntegerVector::create(n_pred, n_optima)));
+}
+
+//! Summarize metrics into a flat table.
+//! The table has one row per metric, with columns `node` (index of the metrics object in depth-first order),
+//! `path` (names of the metrics objects from the root, separated by "/"), `metric` (name of the metric),
+//! `value` (numeric value or `NA`) and `text` (string value or `NA`).
+//!
+//! @param metrics the metrics object.
+//! @return a data frame.
+inline Rcpp::DataFrame WrapMetricsTable(const nsoptim::Metrics& metrics) {
+  compact::MetricsTable table;
+  table.Add(metrics, "");
+  return table.Wrap();
+}
 }  // namespace pense
 
 namespace Rcpp {
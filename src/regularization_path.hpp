@@ -209,6 +209,7 @@ class OptimizerList {
   //! UpdateAll if OpenMP support is enabled and needed.
   void UpdateAll(const typename T::PenaltyFunction& penalty, std::true_type) {
     UOptima old_optima = std::move(items_);
+    blas::SingleThreadGuard blas_guard(num_threads_);
     #pragma omp parallel num_threads(num_threads_) shared(old_optima, items_, penalty) default(none)
     {
       #pragma omp single nowait
@@ -246,6 +247,7 @@ class OptimizerList {
     const double original_tol = optimizer->convergence_tolerance();
     optimizer->convergence_tolerance(explore_tol_);
 
+    blas::SingleThreadGuard blas_guard(num_threads_);
     #pragma omp parallel num_threads(num_threads_) default(none) shared(optimizer, starts, cold_items, cold_optima) \
       firstprivate(original_tol)
     {
@@ -627,6 +629,7 @@ class RegPathCombined {
   //! Compute the next "identical" solutions if OpenMP support is enabled and needed.
   void NextIdentical(UniqueOptima* next_optima, std::true_type) {
     GenericUniqueOptima< RegPathIdentical<Optimizer>* > ident_explore_optima(nr_explore_, comparison_tol_);
+    blas::SingleThreadGuard blas_guard(num_threads_);
     #pragma omp parallel num_threads(num_threads_) shared(rp_id_, next_optima, ident_explore_optima) default(none)
     {
       // First, explore all "identical" reg. paths.
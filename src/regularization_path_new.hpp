@@ -9,18 +9,37 @@
 #ifndef REGULARIZATION_PATH_NEW_HPP_
 #define REGULARIZATION_PATH_NEW_HPP_
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <random>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "nsoptim.hpp"
 
 #include "alias.hpp"
 #include "m_loss.hpp"
 #include "omp_utils.hpp"
+#include "progress.hpp"
+#include "rcpp_utils.hpp"
 
 namespace pense {
 namespace regpath {
+//! Maximum number of rounds for exploring starting points by successive halving.
+constexpr int kMaxRacingRounds = 16;
+//! Number of iterations assumed for concentrating a starting point when estimating the work of concentrating.
+constexpr int kEstimatedConcentrateIterations = 10;
+//! Number of vectors of the size of the residuals and of the coefficients assumed for the working memory of an
+//! optimizer when estimating the memory of a single optimization.
+constexpr double kEstimatedOptimizerStateVectors = 8;
 
 //! Test two coefficients for approximate equivalence.
 //!
@@ -45,11 +64,43 @@ bool CoefficientsEquivalent(const Coefficients& a, const Coefficients& b,
   return false;
 }
 
+//! Get the bucket of the given coefficients for hashed duplicate detection.
+//!
+//! The bucket is the L2 norm of the coefficient vector (including the intercept) quantized to multiples of
+//! `sqrt(eps)`. Coefficients which are equivalent according to `CoefficientsEquivalent()` are at most
+//! `sqrt(eps)` apart and hence their buckets differ by at most 1.
+//!
+//! @param coefs coefficients.
+//! @param eps numerical tolerance for comparison.
+//! @return the bucket of the coefficients.
+template<class Coefficients>
+std::int64_t CoefficientsBucket(const Coefficients& coefs, const double eps) noexcept {
+  // Keep a safe distance from the limits of the integer type, such that neighbouring buckets are well defined.
+  constexpr double kMaxBucket = 4.0e18;
+  const double norm = std::sqrt(coefs.intercept * coefs.intercept +
+                                arma::dot(coefs.beta, coefs.beta)) / std::sqrt(eps);
+  if (!(norm < kMaxBucket)) {
+    // Non-finite or extremely large coefficients share a single bucket.
+    return static_cast<std::int64_t>(kMaxBucket);
+  }
+  return static_cast<std::int64_t>(std::floor(norm));
+}
+
 //! A list of starting points with associated optimizer.
+//!
+//! The elements are sorted such that the *worst* element is at the front of the list, hence an element can be
+//! rejected in constant time if the list is full. Duplicate detection uses a hash index of the elements'
+//! coefficients (see `CoefficientsBucket()`), and the full tolerance comparison is only done for elements in
+//! neighbouring buckets.
+//! Modifying the coefficients of the elements through `Elements()` invalidates the duplicate detection, i.e.,
+//! the container should not be used for inserting new elements afterwards.
+//! The nodes of the list and of the hash index are allocated from thread-local pools, as the containers are created
+//! and discarded for every penalty level, often concurrently by all threads.
 template<class Ordering, typename... Ts>
 class OrderedTuples {
  public:
   using Element = std::tuple<Ts...>;
+  using ElementList = alias::PooledFwdList<Element>;
 
   enum class InsertResult { kGood, kBad, kDuplicate };
 
@@ -76,15 +127,21 @@ class OrderedTuples {
   OrderedTuples(const size_t max_size, const Ordering& order) noexcept
     : max_size_(max_size), order_(order), size_(0), elements_() {}
 
-  //! Default copy constructor. Copy assignment is not possible.
-  OrderedTuples(const OrderedTuples&) = default;
+  //! Copy constructor. The hash index must point to the copied elements. Copy assignment is not possible.
+  OrderedTuples(const OrderedTuples& other)
+      : max_size_(other.max_size_), order_(other.order_), size_(other.size_), elements_(other.elements_) {
+    for (auto it = elements_.begin(), end = elements_.end(); it != end; ++it) {
+      buckets_.emplace(order_.bucket(std::get<0>(*it)), it);
+    }
+  }
   OrderedTuples& operator=(const OrderedTuples&) = delete;
 
-  //! Move constructor.
+  //! Move constructor. Iterators into the moved list remain valid, hence the hash index can be moved as well.
   OrderedTuples(OrderedTuples&& other) noexcept :
       max_size_(other.max_size_), order_(std::move(other.order_)),
-      size_(other.size_), elements_(std::move(other.elements_)) {
+      size_(other.size_), elements_(std::move(other.elements_)), buckets_(std::move(other.buckets_)) {
     other.size_ = 0;
+    other.buckets_.clear();
   }
   OrderedTuples& operator=(OrderedTuples&&) = delete;
 
@@ -96,6 +153,7 @@ class OrderedTuples {
   //! Clear all elements from the list.
   void Clear() noexcept {
     elements_.clear();
+    buckets_.clear();
     size_ = 0;
   }
 
@@ -108,51 +166,189 @@ class OrderedTuples {
       return InsertResult::kBad;
     }
 
+    // Check for duplicates among the elements in the neighbouring buckets.
+    const std::int64_t bucket = order_.bucket(args...);
+    for (std::int64_t neighbour = bucket - 1; neighbour <= bucket + 1; ++neighbour) {
+      const auto candidates = buckets_.equal_range(neighbour);
+      for (auto cand_it = candidates.first; cand_it != candidates.second; ++cand_it) {
+        const auto& candidate = *cand_it->second;
+        if (!order_.before(candidate, std::forward<Ts>(args)...) &&
+            !order_.after(candidate, std::forward<Ts>(args)...) &&
+            order_.equivalent(candidate, std::forward<Ts>(args)...)) {
+          return InsertResult::kDuplicate;
+        }
+      }
+    }
+
     // Determine insert position.
     const auto elements_end = elements_.end();
     auto current_it = elements_.begin();
     auto insert_it = elements_.before_begin();
 
-    while (current_it != elements_end) {
-      const bool better = order_.before(*current_it, std::forward<Ts>(args)...);
-
-      // Check if the coefficients are equal to the element at question.
-      if (!better && !order_.after(*current_it, std::forward<Ts>(args)...) &&
-          order_.equivalent(*current_it, std::forward<Ts>(args)...)) {
-        return InsertResult::kDuplicate;
-      } else if (!better) {
-        break;
-      }
-
+    while (current_it != elements_end && order_.before(*current_it, std::forward<Ts>(args)...)) {
       ++current_it;
       ++insert_it;
     }
 
     // No duplicate has been detected. Add after the insert position.
-    elements_.emplace_after(insert_it, std::forward<Ts>(args)...);
+    buckets_.emplace(bucket, elements_.emplace_after(insert_it, std::forward<Ts>(args)...));
     // Ensure that the size stays within the limits.
     if (++size_ > max_size_ && max_size_ > 0) {
+      const auto worst = buckets_.equal_range(order_.bucket(std::get<0>(elements_.front())));
+      for (auto worst_it = worst.first; worst_it != worst.second; ++worst_it) {
+        if (worst_it->second == elements_.begin()) {
+          buckets_.erase(worst_it);
+          break;
+        }
+      }
       elements_.erase_after(elements_.before_begin());
       --size_;
     }
     return InsertResult::kGood;
   }
 
-  const alias::FwdList<Element>& Elements() const noexcept {
+  //! Insert all elements from the other container into this container.
+  //!
+  //! @param other container with the elements to insert. The container is empty afterwards.
+  void Merge(OrderedTuples&& other) {
+    for (auto&& element : other.elements_) {
+      EmplaceElement(std::move(element), std::index_sequence_for<Ts...>{});
+    }
+    other.Clear();
+  }
+
+  const ElementList& Elements() const noexcept {
     return elements_;
   }
 
-  alias::FwdList<Element>& Elements() noexcept {
+  ElementList& Elements() noexcept {
     return elements_;
   }
 
  private:
+  template<std::size_t... I>
+  InsertResult EmplaceElement(Element&& element, std::index_sequence<I...>) {
+    return Emplace(std::move(std::get<I>(element))...);
+  }
+
   const size_t max_size_;
   Ordering order_;
   size_t size_;
-  alias::FwdList<Element> elements_;
+  using BucketIndex = std::unordered_multimap<std::int64_t, typename ElementList::iterator, std::hash<std::int64_t>,
+    std::equal_to<std::int64_t>, NodeAllocator<std::pair<const std::int64_t, typename ElementList::iterator>>>;
+
+  ElementList elements_;
+  BucketIndex buckets_;
+};
+
+//! Clusters of near-identical starting points.
+//!
+//! Starting points are in the same cluster if they have the same active set and their residuals are close, i.e.,
+//! if the norm of the difference of the residuals is less than `tolerance` times the norm of the residuals. The
+//! residuals are compared through a sketch, the projection onto `kStartSketchDimension` random sign vectors, which
+//! can be computed in `O(k p)` operations for every starting point.
+class StartClusters {
+ public:
+  //! Dimension of the residual sketches.
+  static constexpr arma::uword kStartSketchDimension = 16;
+
+  //! Create empty clusters for starting points on the given data.
+  //!
+  //! @param data the predictor-response data.
+  //! @param tolerance relative tolerance for the difference of the residuals.
+  StartClusters(const nsoptim::PredictorResponseData& data, const double tolerance)
+      : tolerance_(tolerance), ones_sketch_(kStartSketchDimension) {
+    // The random signs are drawn from a fixed seed to not alter R's RNG state and to make the clusters reproducible.
+    std::mt19937 rng(kStartSketchSeed);
+    arma::mat signs(data.n_obs(), kStartSketchDimension);
+    for (auto&& sign : signs) {
+      sign = (rng() & 1u) ? 1. : -1.;
+    }
+    signs /= std::sqrt(static_cast<double>(kStartSketchDimension));
+    x_sketch_ = signs.t() * data.cx();
+    y_sketch_ = signs.t() * data.cy();
+    ones_sketch_ = arma::sum(signs, 0).t();
+  }
+
+  //! Remove all clusters.
+  void Clear() noexcept {
+    representatives_.clear();
+  }
+
+  //! Add the coefficients to the clusters.
+  //!
+  //! @param coefs the coefficients of a starting point.
+  //! @return `true` if the coefficients are the first in their cluster, `false` if the cluster already has a
+  //!         representative.
+  template<typename Coefficients>
+  bool Add(const Coefficients& coefs) {
+    arma::uvec active = ActiveSet(coefs.beta);
+    arma::vec sketch = y_sketch_ - coefs.intercept * ones_sketch_ - x_sketch_ * coefs.beta;
+    const double sketch_norm = arma::norm(sketch, 2);
+    const std::size_t hash = ActiveSetHash(active);
+
+    const auto candidates = representatives_.equal_range(hash);
+    for (auto cand_it = candidates.first; cand_it != candidates.second; ++cand_it) {
+      const auto& candidate = cand_it->second;
+      if (candidate.active.n_elem == active.n_elem && arma::all(candidate.active == active) &&
+          arma::norm(candidate.sketch - sketch, 2) <= tolerance_ * std::max(candidate.sketch_norm, sketch_norm)) {
+        return false;
+      }
+    }
+    representatives_.emplace(hash, Representative { std::move(active), std::move(sketch), sketch_norm });
+    return true;
+  }
+
+ private:
+  //! Seed for drawing the random signs.
+  static constexpr std::uint32_t kStartSketchSeed = 20200615u;
+
+  struct Representative {
+    arma::uvec active;
+    arma::vec sketch;
+    double sketch_norm;
+  };
+
+  static arma::uvec ActiveSet(const arma::vec& beta) {
+    return arma::find(beta);
+  }
+
+  static arma::uvec ActiveSet(const arma::sp_vec& beta) {
+    arma::uvec active(beta.n_nonzero);
+    arma::uword i = 0;
+    for (auto beta_it = beta.begin(), beta_end = beta.end(); beta_it != beta_end; ++beta_it) {
+      active[i++] = beta_it.row();
+    }
+    return active;
+  }
+
+  static std::size_t ActiveSetHash(const arma::uvec& active) noexcept {
+    std::size_t hash = active.n_elem;
+    for (auto&& index : active) {
+      hash ^= static_cast<std::size_t>(index) + 0x9e3779b9u + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+  }
+
+  double tolerance_;
+  arma::mat x_sketch_;
+  arma::vec y_sketch_;
+  arma::vec ones_sketch_;
+  std::unordered_multimap<std::size_t, Representative> representatives_;
 };
 
+//! Individual and shared starting points selected for exploration, one flag per starting point. An empty list of
+//! flags selects all starting points.
+struct StartSelection {
+  std::vector<char> individual;
+  std::vector<char> shared;
+};
+
+//! Check if the starting point at `index` is selected.
+inline bool Selected(const std::vector<char>& flags, const std::size_t index) noexcept {
+  return flags.empty() || flags[index];
+}
+
 template<class Coefficients>
 class DuplicateCoefficients {
  public:
@@ -176,6 +372,12 @@ class DuplicateCoefficients {
     return CoefficientsEquivalent(std::get<0>(el), coefs, eps_);
   }
 
+  //! Get the hash bucket of the element.
+  template<typename... Args>
+  std::int64_t bucket(const Coefficients& coefs, Args&&...) const noexcept {
+    return CoefficientsBucket(coefs, eps_);
+  }
+
  private:
   const double eps_;
 };
@@ -225,6 +427,18 @@ class OptimaOrder {
     return CoefficientsEquivalent(std::get<0>(el).coefs, opt.coefs, eps_);
   }
 
+  //! Get the hash bucket of the element.
+  template<typename... Args>
+  std::int64_t bucket(const Coefficients& coefs, Args&&...) const noexcept {
+    return CoefficientsBucket(coefs, eps_);
+  }
+
+  //! Get the hash bucket of the element.
+  template<typename... Args>
+  std::int64_t bucket(const Optimum& opt, Args&&...) const noexcept {
+    return CoefficientsBucket(opt.coefs, eps_);
+  }
+
  private:
   const double eps_;
 };
@@ -300,6 +514,44 @@ class RegularizationPath {
     explore_it_ = explore_it;
     explore_tol_ = explore_tol;
     explored_keep_ = explored_keep;
+    prefetched_explored_.reset();
+  }
+
+  //! Concentrate the starting points at some penalties without exploring them first, e.g., because the starting
+  //! points are already close to the optima.
+  //!
+  //! @param skipped whether to skip the exploration at the penalty at the same position. Penalties after the last
+  //!                element are explored.
+  void SkipExplorationAt(std::vector<bool> skipped) {
+    skip_exploration_ = std::move(skipped);
+    prefetched_explored_.reset();
+  }
+
+  //! Enable/disable exploring the starting points by successive halving.
+  //! If enabled, all starting points are explored with a small number of iterations, the worse half is discarded and
+  //! the remaining starting points are explored further with twice the number of iterations. This is repeated until
+  //! only the requested number of explored solutions remain. The surviving solutions receive at most the number of
+  //! exploration iterations in total. If all explored solutions are retained, racing has no effect.
+  //!
+  //! @param enabled whether to explore by successive halving or not.
+  void EnableExplorationRacing(const bool enabled) noexcept {
+    explore_racing_ = enabled;
+    prefetched_explored_.reset();
+  }
+
+  //! Explore only one of several near-identical starting points.
+  //! Starting points with the same active set and residuals which differ by less than `tolerance` (relative to the
+  //! norm of the residuals) almost surely lead to the same explored solution. Only the first of these starting
+  //! points is explored. The solutions carried forward from the previous penalty are always explored.
+  //!
+  //! @param tolerance relative tolerance for the difference of the residuals. If 0, all starting points are explored.
+  void ClusterStartingPoints(const double tolerance) {
+    if (tolerance > 0) {
+      start_clusters_.reset(new regpath::StartClusters(optimizer_template_.loss().data(), tolerance));
+    } else {
+      start_clusters_.reset();
+    }
+    prefetched_explored_.reset();
   }
 
   //! Enable/disable carrying forward solutions from the previous penalty.
@@ -309,6 +561,22 @@ class RegularizationPath {
     use_warm_start_ = enabled;
   }
 
+  //! Limit the number of concurrent optimizations such that their estimated working memory fits into the budget.
+  //!
+  //! @param memory_budget the memory budget, in bytes. If not positive, the number of threads is not limited.
+  void MemoryBudget(const double memory_budget) noexcept {
+    const auto& data = optimizer_template_.loss().data();
+    num_threads_ = omp::MemoryLimitedThreads(num_threads_, memory_budget, regpath::kEstimatedOptimizerStateVectors *
+                                             (data.n_obs() + data.n_pred()) * sizeof(double));
+  }
+
+  //! Record the time spent exploring and concentrating the solutions.
+  //!
+  //! @param timings the timings to add the phases to, or `nullptr` to disable timing.
+  void Timings(nsoptim::PhaseTimings* timings) noexcept {
+    timings_ = timings;
+  }
+
   //! Add a starting point to be used only at the specified penalty.
   //!
   //! @param penalty penalty at which the starting point should be used.
@@ -321,6 +589,7 @@ class RegularizationPath {
       }
       emplace_it++;
     }
+    prefetched_explored_.reset();
   }
 
   //! Add a starting point to be used for all penalties.
@@ -328,14 +597,40 @@ class RegularizationPath {
   //! @param coefs starting point.
   void EmplaceSharedStartingPoint(Coefficients&& coefs) {
     shared_starts_.Emplace(std::move(coefs));
+    prefetched_explored_.reset();
+  }
+
+  //! Skip the first `completed` penalties, e.g., if their optima were restored from a checkpoint. The optima at the
+  //! last completed penalty are carried forward to the next penalty, as if they were computed by `Next()`.
+  //! Must be called after the starting points are added.
+  //!
+  //! @param completed the number of completed penalties.
+  //! @param last_optima the coefficients of the optima at the last completed penalty.
+  void Resume(const int completed, const alias::FwdList<Coefficients>& last_optima) {
+    for (int i = 0; i < completed && !End(); ++i) {
+      ++individual_starts_it_;
+      ++penalty_index_;
+      optimizer_template_.penalty(*penalties_it_++);
+    }
+    best_starts_.Clear();
+    prefetched_explored_.reset();
+    for (auto&& coefs : last_optima) {
+      // The optima are already converged, hence re-computing them from their coefficients is cheap.
+      Optimizer optimizer(optimizer_template_);
+      auto optimum = optimizer.Optimize(coefs);
+      best_starts_.Emplace(std::move(optimum), std::move(optimizer));
+    }
   }
 
+  //! Compute the optima at the next penalty.
+  //! The computation stops early if the running computation is cancelled (see progress::Cancelled()). In this case,
+  //! the returned optima are incomplete and should be discarded.
   Solutions Next() {
     ++individual_starts_it_;
     const auto& current_penalty = *penalties_it_++;
     optimizer_template_.penalty(current_penalty);
 
-    auto explored_solutions = explore_it_ > 0 ? Explore() : SkipExploration();
+    auto explored_solutions = ExploreAt(penalty_index_++) ? Explore() : SkipExploration();
     return Solutions { current_penalty, Concentrate(std::move(explored_solutions)) };
   }
 
@@ -350,9 +645,13 @@ class RegularizationPath {
   const double comparison_tol_;
   int num_threads_;  //< OpenMP requires it to be an lvalue!
   bool use_warm_start_ = true;
+  bool explore_racing_ = false;
   int explore_it_ = 0;
   double explore_tol_ = 0;
   int explored_keep_ = 1;
+  std::vector<bool> skip_exploration_;
+  std::size_t penalty_index_ = 0;  //< Index of the next penalty.
+  nsoptim::PhaseTimings* timings_ = nullptr;
 
   alias::FwdList<UniqueCoefficients> individual_starts_;
   UniqueCoefficients shared_starts_;
@@ -360,123 +659,349 @@ class RegularizationPath {
 
   typename alias::FwdList<UniqueCoefficients>::iterator individual_starts_it_;
   typename PenaltyList::const_iterator penalties_it_;
+  //! Solutions explored from the individual and shared starting points of the next penalty, one buffer per thread.
+  std::unique_ptr<std::vector<ExploredSolutions>> prefetched_explored_;
+  //! Clusters of near-identical starting points, or `nullptr` if all starting points are explored.
+  std::unique_ptr<regpath::StartClusters> start_clusters_;
+
+  //! Select the individual and shared starting points to explore, skipping all but the first starting point in
+  //! every cluster of near-identical starting points.
+  //!
+  //! @param individual_starts the individual starting points for the penalty.
+  regpath::StartSelection SelectStarts(const UniqueCoefficients& individual_starts) {
+    regpath::StartSelection selection;
+    if (start_clusters_) {
+      start_clusters_->Clear();
+      selection.individual.reserve(individual_starts.Size());
+      for (auto&& start : individual_starts.Elements()) {
+        selection.individual.push_back(start_clusters_->Add(std::get<0>(start)));
+      }
+      selection.shared.reserve(shared_starts_.Size());
+      for (auto&& start : shared_starts_.Elements()) {
+        selection.shared.push_back(start_clusters_->Add(std::get<0>(start)));
+      }
+    }
+    return selection;
+  }
+
+  //! Check if the starting points at the penalty with the given index are explored.
+  bool ExploreAt(const std::size_t index) const noexcept {
+    return explore_it_ > 0 && (index >= skip_exploration_.size() || !skip_exploration_[index]);
+  }
+
+  //! Estimate the work of optimizing the objective function from a single starting point with the given number of
+  //! iterations. Every iteration needs at least one pass over the predictor matrix.
+  double OptimizationWork(const int iterations) const {
+    const auto& data = optimizer_template_.loss().data();
+    return std::max(iterations, 1) * static_cast<double>(data.n_obs()) * std::max<arma::uword>(data.n_pred(), 1);
+  }
 
   ExploredSolutions Explore() {
-    if (omp::Enabled(num_threads_)) {
-      return Explore(std::true_type{});
+    nsoptim::ScopedPhaseTimer timer(timings_, "explore");
+    if (explore_racing_) {
+      return Race();
+    }
+    return Explore(explore_it_, explored_keep_);
+  }
+
+  //! Explore all starting points with `explore_it` iterations.
+  //!
+  //! @param explore_it the number of iterations for exploring.
+  //! @param keep the number of explored solutions to retain. If 0, all explored solutions are retained.
+  ExploredSolutions Explore(const int explore_it, const std::size_t keep) {
+    // Starting points explored while concentrating the previous penalty are only available to the parallel code.
+    const int n_starts = static_cast<int>(individual_starts_it_->Size() + shared_starts_.Size() + best_starts_.Size());
+    if (prefetched_explored_ || omp::Enabled(num_threads_, n_starts, OptimizationWork(explore_it))) {
+      return Explore(explore_it, keep, std::true_type{});
     } else {
-      return Explore(std::false_type{});
+      return Explore(explore_it, keep, std::false_type{});
     }
   }
 
-  ExploredSolutions Explore(std::true_type) {
-    ExploredSolutions explored_solutions(explored_keep_, ExploredSolutionsOrder(comparison_tol_));
-    const auto is_end = individual_starts_it_->Elements().end();
-    const auto sh_end = shared_starts_.Elements().end();
+  //! Explore the starting points by successive halving (see `EnableExplorationRacing()`).
+  ExploredSolutions Race() {
+    if (explored_keep_ <= 0) {
+      // All explored solutions are retained, hence no starting point would ever be discarded.
+      return Explore(explore_it_, 0);
+    }
+    const std::size_t keep = static_cast<std::size_t>(explored_keep_);
+    std::size_t remaining = individual_starts_it_->Size() + shared_starts_.Size() +
+      (use_warm_start_ ? best_starts_.Size() : 0);
+    // The budget doubles in every round, hence the survivors receive at most `explore_it` iterations in total if
+    // the first round uses `explore_it / (2^(rounds + 1) - 1)` iterations.
+    int rounds = 0;
+    while (remaining > keep && rounds < regpath::kMaxRacingRounds) {
+      remaining = (remaining + 1) / 2;
+      ++rounds;
+    }
+    const int budget = std::max(1, explore_it_ / ((1 << (rounds + 1)) - 1));
+    return Race(Explore(budget, 0), 2 * budget, keep);
+  }
+
+  //! Discard the worse half of the explored solutions and explore the others further, until only `keep` remain.
+  //!
+  //! @param explored the explored solutions.
+  //! @param budget the number of iterations for exploring the retained solutions.
+  //! @param keep the number of explored solutions to retain in the end.
+  ExploredSolutions Race(ExploredSolutions&& explored, const int budget, const std::size_t keep) {
+    if (explored.Size() <= keep || progress::Cancelled()) {
+      return std::move(explored);
+    }
+    const std::size_t retain = std::max(keep, (explored.Size() + 1) / 2);
+
+    // The elements are sorted such that the worst are in front.
+    std::vector<typename ExploredSolutions::Element*> survivors;
+    survivors.reserve(retain);
+    auto survivor_it = explored.Elements().begin();
+    std::advance(survivor_it, explored.Size() - retain);
+    for (const auto end = explored.Elements().end(); survivor_it != end; ++survivor_it) {
+      survivors.push_back(&(*survivor_it));
+    }
 
+    const int n_survivors = static_cast<int>(survivors.size());
+    ExploredSolutions retained = omp::Enabled(num_threads_, n_survivors, OptimizationWork(budget)) ?
+      ExploreSurvivors(survivors, budget, retain, std::true_type{}) :
+      ExploreSurvivors(survivors, budget, retain, std::false_type{});
+    return Race(std::move(retained), 2 * budget, keep);
+  }
+
+  //! Explore the solutions surviving a round of racing further, in parallel.
+  //!
+  //! @param survivors the surviving explored solutions.
+  //! @param budget the number of iterations for exploring the survivors.
+  //! @param retain the number of explored solutions to retain.
+  ExploredSolutions ExploreSurvivors(const std::vector<typename ExploredSolutions::Element*>& survivors,
+                                     const int budget, const std::size_t retain, std::true_type) {
+    // Every thread of the team collects the explored solutions in its own buffer. The team is created here, even if
+    // the path is computed in a parallel region of its own, hence the thread numbers are within the buffers.
+    std::vector<ExploredSolutions> thread_explored = ThreadExploredBuffers(retain);
+
+    blas::SingleThreadGuard blas_guard(num_threads_);
     #pragma omp parallel \
                 num_threads(num_threads_) \
                 default(shared)
     {
       #pragma omp single nowait
-      for (auto is_it = individual_starts_it_->Elements().begin(); is_it != is_end; ++is_it) {
+      for (auto survivor_it = survivors.begin(), end = survivors.end(); survivor_it != end; ++survivor_it) {
         #pragma omp task \
-                    default(none) \
-                    firstprivate(is_it) \
-                    shared(explore_tol_, explore_it_) \
-                    shared(explored_solutions, optimizer_template_)
-        {
-          Optimizer optimizer(optimizer_template_);
-          optimizer.convergence_tolerance(explore_tol_);
-          auto optimum = optimizer.Optimize(std::get<0>(*is_it), explore_it_);
-
-          #pragma omp critical(insert_explored)
-          explored_solutions.Emplace(std::move(optimum.coefs), std::move(optimum.objf_value),
-                                     std::move(optimizer), std::move(optimum.metrics));
-
+                    firstprivate(survivor_it, budget) \
+                    shared(thread_explored)
+        if (!progress::Cancelled()) {
+          ExploreSurvivor(*survivor_it, budget, &thread_explored[omp::ThreadNum()]);
         }
       }
+    }
 
-      #pragma omp single nowait
-      for (auto sh_it = shared_starts_.Elements().begin(); sh_it != sh_end; ++sh_it) {
-        #pragma omp task \
-                    firstprivate(sh_it) \
-                    default(none) \
-                    shared(explore_tol_, explore_it_) \
-                    shared(explored_solutions, optimizer_template_)
-        {
-          Optimizer optimizer(optimizer_template_);
-          optimizer.convergence_tolerance(explore_tol_);
-          auto optimum = optimizer.Optimize(std::get<0>(*sh_it), explore_it_);
+    ExploredSolutions retained(retain, ExploredSolutionsOrder(comparison_tol_));
+    for (auto&& buffer : thread_explored) {
+      retained.Merge(std::move(buffer));
+    }
+    return retained;
+  }
+
+  //! Explore the solutions surviving a round of racing further, one after the other.
+  //!
+  //! @param survivors the surviving explored solutions.
+  //! @param budget the number of iterations for exploring the survivors.
+  //! @param retain the number of explored solutions to retain.
+  ExploredSolutions ExploreSurvivors(const std::vector<typename ExploredSolutions::Element*>& survivors,
+                                     const int budget, const std::size_t retain, std::false_type) {
+    ExploredSolutions retained(retain, ExploredSolutionsOrder(comparison_tol_));
+    for (auto&& survivor : survivors) {
+      if (progress::Cancelled()) {
+        break;
+      }
+      ExploreSurvivor(survivor, budget, &retained);
+    }
+    return retained;
+  }
 
-          #pragma omp critical(insert_explored)
-          explored_solutions.Emplace(std::move(optimum.coefs), std::move(optimum.objf_value),
-                                     std::move(optimizer), std::move(optimum.metrics));
+  //! Explore a solution surviving a round of racing further.
+  //!
+  //! @param survivor the surviving explored solution. Its optimizer is moved to `explored`.
+  //! @param budget the number of iterations for exploring the survivor.
+  //! @param explored the explored solutions to add the solution to.
+  void ExploreSurvivor(typename ExploredSolutions::Element* survivor, const int budget,
+                       ExploredSolutions* explored) const {
+    nsoptim::ScopedPhaseTimer timer(timings_, "optimize_explore");
+    auto&& optimizer = std::get<2>(*survivor);
+    auto optimum = optimizer.Optimize(budget);
+    if (optimum.metrics && std::get<3>(*survivor)) {
+      optimum.metrics->AddSubMetrics(std::move(*std::get<3>(*survivor)));
+    }
+    explored->Emplace(std::move(optimum.coefs), std::move(optimum.objf_value), std::move(optimizer),
+                      std::move(optimum.metrics));
+  }
 
-        }
+  ExploredSolutions Explore(const int explore_it, const std::size_t keep, std::true_type) {
+    ExploredSolutions explored_solutions(keep, ExploredSolutionsOrder(comparison_tol_));
+    // Every thread collects the explored solutions in its own buffer. The buffers are merged after all tasks are done.
+    // If the starting points have already been explored while concentrating the previous penalty, the buffers
+    // already contain these solutions.
+    const bool prefetched = static_cast<bool>(prefetched_explored_);
+    std::vector<ExploredSolutions> thread_explored = prefetched ? std::move(*prefetched_explored_) :
+                                                                  ThreadExploredBuffers(keep);
+    prefetched_explored_.reset();
+    const bool explore_best_starts = use_warm_start_ || (individual_starts_it_->Size() == 0 &&
+                                                         shared_starts_.Size() == 0);
+    const regpath::StartSelection selection = prefetched ? regpath::StartSelection() :
+                                                           SelectStarts(*individual_starts_it_);
+
+    blas::SingleThreadGuard blas_guard(num_threads_);
+    #pragma omp parallel \
+                num_threads(num_threads_) \
+                default(shared)
+    {
+      #pragma omp single nowait
+      if (!prefetched) {
+        ExploreStartingPoints(optimizer_template_, *individual_starts_it_, selection, explore_it, &thread_explored);
       }
 
       #pragma omp single nowait
-      if (use_warm_start_ || explored_solutions.Size() == 0) {
-      const auto bs_end = best_starts_.Elements().end();
+      if (explore_best_starts) {
+        const auto bs_end = best_starts_.Elements().end();
 
         for (auto bs_it = best_starts_.Elements().begin(); bs_it != bs_end; ++bs_it) {
           #pragma omp task \
-                      firstprivate(bs_it) \
+                      firstprivate(bs_it, explore_it) \
                       default(none) \
-                      shared(explore_tol_, explore_it_, explored_solutions, optimizer_template_)
-          {
+                      shared(explore_tol_, thread_explored, optimizer_template_, timings_)
+          if (!progress::Cancelled()) {
+            nsoptim::ScopedPhaseTimer timer(timings_, "optimize_explore");
             auto&& optimizer = std::get<1>(*bs_it);
             optimizer.convergence_tolerance(explore_tol_);
             optimizer.penalty(optimizer_template_.penalty());
-            auto optimum = optimizer.Optimize(explore_it_);
-
-            #pragma omp critical(insert_explored)
-            explored_solutions.Emplace(std::move(optimum.coefs), std::move(optimum.objf_value),
-                                       std::move(optimizer), std::move(optimum.metrics));
+            auto optimum = optimizer.Optimize(explore_it);
 
+            thread_explored[omp::ThreadNum()].Emplace(std::move(optimum.coefs), std::move(optimum.objf_value),
+                                                      std::move(optimizer), std::move(optimum.metrics));
           }
         }
       }
     }
 
-    Rcpp::checkUserInterrupt();
+    for (auto&& explored : thread_explored) {
+      explored_solutions.Merge(std::move(explored));
+    }
     return explored_solutions;
   }
 
-  ExploredSolutions Explore(std::false_type) {
-    ExploredSolutions explored_solutions(explored_keep_, ExploredSolutionsOrder(comparison_tol_));
+  //! Create one empty buffer of explored solutions per thread.
+  //!
+  //! @param keep the number of explored solutions retained by every buffer. If 0, all are retained.
+  std::vector<ExploredSolutions> ThreadExploredBuffers(const std::size_t keep) const {
+    return omp::PerThread<ExploredSolutions>(num_threads_, keep, ExploredSolutionsOrder(comparison_tol_));
+  }
+
+  //! Create tasks exploring the individual and the shared starting points.
+  //! The exploration does not depend on the optima at the previous penalty level and can hence be done at any time.
+  //! Must be called from within a parallel region by a single thread. The given objects must stay alive
+  //! until all tasks are finished.
+  //!
+  //! @param optimizer_template optimizer with the penalty for which the starting points are explored.
+  //! @param individual_starts the individual starting points for this penalty.
+  //! @param selection the selected starting points (see `SelectStarts()`).
+  //! @param explore_it the number of iterations for exploring.
+  //! @param thread_explored per-thread buffers for the explored solutions.
+  void ExploreStartingPoints(const Optimizer& optimizer_template, const UniqueCoefficients& individual_starts,
+                             const regpath::StartSelection& selection, const int explore_it,
+                             std::vector<ExploredSolutions>* thread_explored) const {
+    const Optimizer* const template_ptr = &optimizer_template;
+    const double explore_tol = explore_tol_;
+    nsoptim::PhaseTimings* const timings = timings_;
+    const auto is_end = individual_starts.Elements().end();
+    const auto sh_end = shared_starts_.Elements().end();
+    std::size_t index = 0;
+
+    for (auto is_it = individual_starts.Elements().begin(); is_it != is_end; ++is_it) {
+      if (!regpath::Selected(selection.individual, index++)) {
+        continue;
+      }
+      #pragma omp task \
+                  default(none) \
+                  firstprivate(is_it, template_ptr, explore_it, explore_tol, thread_explored, timings)
+      if (!progress::Cancelled()) {
+        nsoptim::ScopedPhaseTimer timer(timings, "optimize_explore");
+        Optimizer optimizer(*template_ptr);
+        optimizer.convergence_tolerance(explore_tol);
+        auto optimum = optimizer.Optimize(std::get<0>(*is_it), explore_it);
+
+        (*thread_explored)[omp::ThreadNum()].Emplace(std::move(optimum.coefs), std::move(optimum.objf_value),
+                                                     std::move(optimizer), std::move(optimum.metrics));
+      }
+    }
+
+    index = 0;
+    for (auto sh_it = shared_starts_.Elements().begin(); sh_it != sh_end; ++sh_it) {
+      if (!regpath::Selected(selection.shared, index++)) {
+        continue;
+      }
+      #pragma omp task \
+                  default(none) \
+                  firstprivate(sh_it, template_ptr, explore_it, explore_tol, thread_explored, timings)
+      if (!progress::Cancelled()) {
+        nsoptim::ScopedPhaseTimer timer(timings, "optimize_explore");
+        Optimizer optimizer(*template_ptr);
+        optimizer.convergence_tolerance(explore_tol);
+        auto optimum = optimizer.Optimize(std::get<0>(*sh_it), explore_it);
+
+        (*thread_explored)[omp::ThreadNum()].Emplace(std::move(optimum.coefs), std::move(optimum.objf_value),
+                                                     std::move(optimizer), std::move(optimum.metrics));
+      }
+    }
+  }
+
+  ExploredSolutions Explore(const int explore_it, const std::size_t keep, std::false_type) {
+    ExploredSolutions explored_solutions(keep, ExploredSolutionsOrder(comparison_tol_));
+    const regpath::StartSelection selection = SelectStarts(*individual_starts_it_);
+    std::size_t index = 0;
 
     for (auto& start : individual_starts_it_->Elements()) {
+      if (!regpath::Selected(selection.individual, index++)) {
+        continue;
+      }
+      nsoptim::ScopedPhaseTimer timer(timings_, "optimize_explore");
       Optimizer optimizer(optimizer_template_);
       optimizer.convergence_tolerance(explore_tol_);
-      auto optimum = optimizer.Optimize(std::get<0>(start), explore_it_);
+      auto optimum = optimizer.Optimize(std::get<0>(start), explore_it);
       explored_solutions.Emplace(std::move(optimum.coefs), std::move(optimum.objf_value),
                                  std::move(optimizer), std::move(optimum.metrics));
 
-      Rcpp::checkUserInterrupt();
+      if (progress::Cancelled()) {
+        return explored_solutions;
+      }
     }
 
+    index = 0;
     for (auto& start : shared_starts_.Elements()) {
+      if (!regpath::Selected(selection.shared, index++)) {
+        continue;
+      }
+      nsoptim::ScopedPhaseTimer timer(timings_, "optimize_explore");
       Optimizer optimizer(optimizer_template_);
       optimizer.convergence_tolerance(explore_tol_);
-      auto optimum = optimizer.Optimize(std::get<0>(start), explore_it_);
+      auto optimum = optimizer.Optimize(std::get<0>(start), explore_it);
       explored_solutions.Emplace(std::move(optimum.coefs), std::move(optimum.objf_value),
                                  std::move(optimizer), std::move(optimum.metrics));
 
-      Rcpp::checkUserInterrupt();
+      if (progress::Cancelled()) {
+        return explored_solutions;
+      }
     }
 
     if (use_warm_start_ || explored_solutions.Size() == 0) {
       for (auto& start : best_starts_.Elements()) {
+        nsoptim::ScopedPhaseTimer timer(timings_, "optimize_explore");
         auto&& optimizer = std::get<1>(start);
         optimizer.convergence_tolerance(explore_tol_);
         optimizer.penalty(optimizer_template_.penalty());
-        auto optimum = optimizer.Optimize(explore_it_);
+        auto optimum = optimizer.Optimize(explore_it);
         explored_solutions.Emplace(std::move(optimum.coefs), std::move(optimum.objf_value),
                                   std::move(optimizer), std::move(optimum.metrics));
 
-        Rcpp::checkUserInterrupt();
+        if (progress::Cancelled()) {
+          break;
+        }
       }
     }
     return explored_solutions;
@@ -510,9 +1035,11 @@ class RegularizationPath {
   }
 
   alias::Optima<Optimizer> Concentrate(ExploredSolutions&& explored) {
+    nsoptim::ScopedPhaseTimer timer(timings_, "concentrate");
     best_starts_.Clear();
 
-    if (omp::Enabled(num_threads_)) {
+    if (omp::Enabled(num_threads_, static_cast<int>(explored.Size()),
+                     OptimizationWork(regpath::kEstimatedConcentrateIterations))) {
       Concentrate(std::move(explored), std::true_type{});
     } else {
       Concentrate(std::move(explored), std::false_type{});
@@ -529,6 +1056,7 @@ class RegularizationPath {
     const double conv_threshold = optimizer_template_.convergence_tolerance();
 
     for (auto&& start : explored.Elements()) {
+      nsoptim::ScopedPhaseTimer timer(timings_, "optimize_concentrate");
       auto&& optimizer = std::get<2>(start);
       optimizer.convergence_tolerance(conv_threshold);
       auto optim = (std::get<1>(start) > 0) ?
@@ -542,25 +1070,51 @@ class RegularizationPath {
       }
       best_starts_.Emplace(std::move(optim), std::move(optimizer));
 
-      Rcpp::checkUserInterrupt();
+      if (progress::Cancelled()) {
+        break;
+      }
     }
   }
 
   void Concentrate(ExploredSolutions&& explored, std::true_type) {
     const double conv_threshold = optimizer_template_.convergence_tolerance();
     const auto ex_end = explored.Elements().end();
+    // Every thread collects the optima in its own buffer. The buffers are merged after all tasks are done.
+    auto thread_optima = omp::PerThread<BestOptima>(num_threads_, max_optima_, BestOptimaOrder(comparison_tol_));
+
+    // The starting points for the next penalty do not depend on the optima at this penalty. Explore them
+    // while concentrating to keep all threads busy.
+    const bool prefetch = ExploreAt(penalty_index_) && !explore_racing_ && penalties_it_ != penalties_.end();
+    std::unique_ptr<Optimizer> next_template;
+    std::vector<ExploredSolutions> next_explored;
+    if (prefetch) {
+      next_template.reset(new Optimizer(optimizer_template_));
+      next_template->penalty(*penalties_it_);
+      next_explored = ThreadExploredBuffers(explored_keep_);
+    }
+    const auto next_individual_starts_it = std::next(individual_starts_it_);
+    const regpath::StartSelection next_selection = prefetch ? SelectStarts(*next_individual_starts_it) :
+                                                              regpath::StartSelection();
 
+    blas::SingleThreadGuard blas_guard(num_threads_);
     #pragma omp parallel \
                 num_threads(num_threads_) \
                 default(shared)
     {
+      #pragma omp single nowait
+      if (prefetch) {
+        ExploreStartingPoints(*next_template, *next_individual_starts_it, next_selection, explore_it_,
+                              &next_explored);
+      }
+
       #pragma omp single nowait
       for (auto ex_it = explored.Elements().begin(); ex_it != ex_end; ++ex_it) {
         #pragma omp task \
                     default(none) \
                     firstprivate(ex_it, conv_threshold) \
-                    shared(best_starts_)
-        {
+                    shared(thread_optima, timings_)
+        if (!progress::Cancelled()) {
+          nsoptim::ScopedPhaseTimer timer(timings_, "optimize_concentrate");
           auto&& optimizer = std::get<2>(*ex_it);
           optimizer.convergence_tolerance(conv_threshold);
           auto optim = (std::get<1>(*ex_it) > 0) ?
@@ -572,12 +1126,17 @@ class RegularizationPath {
             exploration_metrics.AddSubMetrics(std::move(*std::get<3>(*ex_it)));
             std::get<3>(*ex_it).reset();
           }
-          #pragma omp critical(insert_concentrated)
-          best_starts_.Emplace(std::move(optim), std::move(optimizer));
+          thread_optima[omp::ThreadNum()].Emplace(std::move(optim), std::move(optimizer));
         }
       }
     }
-    Rcpp::checkUserInterrupt();
+
+    for (auto&& optima : thread_optima) {
+      best_starts_.Merge(std::move(optima));
+    }
+    if (prefetch) {
+      prefetched_explored_.reset(new std::vector<ExploredSolutions>(std::move(next_explored)));
+    }
   }
 };
 } // namespace pense
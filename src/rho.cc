@@ -6,6 +6,7 @@
 //  Copyright © 2019 David Kepplinger. All rights reserved.
 //
 
+#include <algorithm>
 #include <cmath>
 #include "nsoptim.hpp"
 
@@ -15,12 +16,17 @@ using arma::vec;
 
 namespace {
 //! Actual implementations of the bisquare function.
+//! The implementations are branch-free, such that loops over these functions can be vectorized by the compiler.
 //! Note that the derivatives are for the *unstandardized* bisquare function, while BisquareFunctionValueStd
 //! gives the *standardized* value, i.e., BisquareFunctionValueStd(t, cc_scaled) == 1 for all |t| > cc_scaled!
 double BisquareFunctionValueStd(double x, const double cc_scaled) noexcept;
 double BisquareDerivativeValue(double x, const double cc_scaled) noexcept;
 double BisquareSecondDerivativeValue(double x, const double cc_scaled) noexcept;
 double BisquareWeightValue(double x, const double cc_scaled) noexcept;
+//! Clamp the value to the interval [-cc_scaled, cc_scaled]. The derivative and the weight of the bisquare function
+//! vanish outside this interval, hence clamping does not change their products with the value, but keeps these
+//! products finite for infinite values.
+double BisquareClamp(double x, const double cc_scaled) noexcept;
 
 //! Actual implementations of the Huber function.
 double HuberFunctionValue(double x, const double scale, const double cc) noexcept;
@@ -171,6 +177,7 @@ void RhoBisquare::EvaluateStd(const vec& x, const double scale, vec* out) const
 }
 
 double RhoBisquare::SumStd(const vec& x, const double scale) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareSum);
   double tmp = 0.;
   const double cc_scaled = cc_ * scale;
   for (auto read_it = x.cbegin(); read_it != x.cend(); ++read_it) {
@@ -190,6 +197,7 @@ vec RhoBisquare::Derivative(const vec& x, const double scale) const noexcept {
 }
 
 void RhoBisquare::Derivative(const vec& x, const double scale, vec* out) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareDerivative);
   const double cc_scaled = cc_ * scale;
   auto read_it = x.cbegin();
   out->copy_size(x);
@@ -209,6 +217,7 @@ arma::vec RhoBisquare::DerivativeStd(const arma::vec& x, const double scale) con
 }
 
 void RhoBisquare::DerivativeStd(const arma::vec& x, const double scale, arma::vec* out) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareDerivative);
   const double cc_scaled = cc_ * scale;
   const double rho_inf = UpperBound();
   auto read_it = x.cbegin();
@@ -268,6 +277,7 @@ vec RhoBisquare::Weight(const vec& x, const double scale) const noexcept {
 }
 
 void RhoBisquare::Weight(const vec& x, const double scale, vec* out) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareWeight);
   const double cc_scaled = cc_ * scale;
   auto read_it = x.cbegin();
   out->copy_size(x);
@@ -287,6 +297,7 @@ vec RhoBisquare::WeightStd(const vec& x, const double scale) const noexcept {
 }
 
 void RhoBisquare::WeightStd(const vec& x, const double scale, vec* out) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareWeight);
   const double cc_scaled = cc_ * scale;
   const double rho_inf = UpperBound();
   auto read_it = x.cbegin();
@@ -295,45 +306,118 @@ void RhoBisquare::WeightStd(const vec& x, const double scale, vec* out) const no
     *write_it = BisquareWeightValue(*read_it, cc_scaled) / rho_inf;
   }
 }
+
+double RhoBisquare::FusedSumStd(const vec& x, const double scale, double* cross) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareSum);
+  const double cc_scaled = cc_ * scale;
+  double sum = 0.;
+  double deriv_cross = 0.;
+  for (auto read_it = x.cbegin(); read_it != x.cend(); ++read_it) {
+    sum += BisquareFunctionValueStd(*read_it, cc_scaled);
+    deriv_cross += BisquareDerivativeValue(*read_it, cc_scaled) * BisquareClamp(*read_it, cc_scaled);
+  }
+  *cross = deriv_cross / UpperBound();
+  return sum;
+}
+
+double RhoBisquare::TrialSumStd(const vec& x, const double step, const vec& direction,
+                                const double scale) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareSum);
+  const double cc_scaled = cc_ * scale;
+  double sum = 0.;
+  auto dir_it = direction.cbegin();
+  for (auto read_it = x.cbegin(); read_it != x.cend(); ++read_it, ++dir_it) {
+    sum += BisquareFunctionValueStd(*read_it + step * *dir_it, cc_scaled);
+  }
+  return sum;
+}
+
+double RhoBisquare::TrialSumStd(const vec& x, const double shift, const double scale) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareSum);
+  const double cc_scaled = cc_ * scale;
+  double sum = 0.;
+  for (auto read_it = x.cbegin(); read_it != x.cend(); ++read_it) {
+    sum += BisquareFunctionValueStd(*read_it + shift, cc_scaled);
+  }
+  return sum;
+}
+
+double RhoBisquare::FusedDerivative(const vec& x, const double scale, vec* first) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareDerivative);
+  const double cc_scaled = cc_ * scale;
+  double cross = 0.;
+  auto read_it = x.cbegin();
+  first->copy_size(x);
+  for (auto write_it = first->begin(), end = first->end(); write_it != end; ++write_it, ++read_it) {
+    *write_it = BisquareDerivativeValue(*read_it, cc_scaled);
+    cross += *write_it * BisquareClamp(*read_it, cc_scaled);
+  }
+  return cross;
+}
+
+double RhoBisquare::FusedDerivatives(const vec& x, const double scale, vec* first, vec* second) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareDerivative);
+  const double cc_scaled = cc_ * scale;
+  double cross = 0.;
+  auto read_it = x.cbegin();
+  first->copy_size(x);
+  second->copy_size(x);
+  auto write_2nd_it = second->begin();
+  for (auto write_it = first->begin(), end = first->end(); write_it != end; ++write_it, ++write_2nd_it, ++read_it) {
+    *write_it = BisquareDerivativeValue(*read_it, cc_scaled);
+    *write_2nd_it = BisquareSecondDerivativeValue(*read_it, cc_scaled);
+    cross += *write_it * BisquareClamp(*read_it, cc_scaled);
+  }
+  return cross;
+}
+
+double RhoBisquare::FusedWeight(const vec& x, const double scale, vec* weights) const noexcept {
+  nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kRhoBisquareWeight);
+  const double cc_scaled = cc_ * scale;
+  double weighted_squares = 0.;
+  auto read_it = x.cbegin();
+  weights->copy_size(x);
+  for (auto write_it = weights->begin(), end = weights->end(); write_it != end; ++write_it, ++read_it) {
+    *write_it = BisquareWeightValue(*read_it, cc_scaled);
+    const double clamped = BisquareClamp(*read_it, cc_scaled);
+    weighted_squares += *write_it * clamped * clamped;
+  }
+  return weighted_squares;
+}
 }  // namespace pense
 
 namespace {
 inline double BisquareFunctionValueStd(double x, const double cc_scaled) noexcept {
-  if (std::abs(x) > cc_scaled) {
-    return 1.;
-  }
   x /= cc_scaled;
-  x *= x;
+  // Clamping at 1 avoids the branch for |x| > cc_scaled: the polynomial evaluates to 1 at x^2 = 1.
+  x = std::min(x * x, 1.);
   return x * (3. + x * (-3. + x));
 }
 
 inline double BisquareDerivativeValue(double x, const double cc_scaled) noexcept {
-  if (std::abs(x) > cc_scaled) {
-    return 0.;
-  }
+  // The derivative vanishes for |x| >= cc_scaled. Clamping avoids `inf * 0` for infinite values.
+  x = BisquareClamp(x, cc_scaled);
   const double a = x / cc_scaled;
-  const double u = 1. - a * a;
+  const double u = std::max(1. - a * a, 0.);
   return x * u * u;
 }
 
 inline double BisquareSecondDerivativeValue(double x, const double cc_scaled) noexcept {
-  if (std::abs(x) > cc_scaled) {
-    return 0.;
-  }
   x /= cc_scaled;
-  x *= x;
+  x = std::min(x * x, 1.);
   return (1. - x) * (1. - 5. * x);
 }
 
 inline double BisquareWeightValue(double x, const double cc_scaled) noexcept {
-  if (std::abs(x) > cc_scaled) {
-    return 0.;
-  }
   x /= cc_scaled;
-  x = (1 - x) * (1 + x);
+  x = std::max((1 - x) * (1 + x), 0.);
   return x * x;
 }
 
+inline double BisquareClamp(double x, const double cc_scaled) noexcept {
+  return std::min(std::max(x, -cc_scaled), cc_scaled);
+}
+
 inline double HuberFunctionValue(double x, const double scale, const double cc) noexcept {
   x = std::abs(x) / scale;
   if (x > cc) {
@@ -154,6 +154,44 @@ class RhoBisquare {
   arma::vec WeightStd(const arma::vec& x, const double scale) const noexcept;
   void      WeightStd(const arma::vec& x, const double scale, arma::vec* out) const noexcept;
 
+  //! Compute the sum of the *standardized* rho function evaluated at x/scale, as `SumStd(x, scale)`, in the same pass
+  //! as the cross product of the derivative of the *standardized* rho function with `x`.
+  //!
+  //! @param cross output for sum_{i = 1}^n DerivativeStd(x[i], scale) * x[i].
+  //! @return sum_{i = 1}^n EvaluateStd(x[i], scale).
+  double FusedSumStd(const arma::vec& x, const double scale, double* cross) const noexcept;
+
+  //! Compute the sum of the *standardized* rho function evaluated at the trial values (x + step * direction)/scale,
+  //! without storing the trial values.
+  //!
+  //! @return sum_{i = 1}^n EvaluateStd(x[i] + step * direction[i], scale).
+  double TrialSumStd(const arma::vec& x, const double step, const arma::vec& direction,
+                     const double scale) const noexcept;
+
+  //! Compute the sum of the *standardized* rho function evaluated at the trial values (x + shift)/scale,
+  //! without storing the trial values.
+  //!
+  //! @return sum_{i = 1}^n EvaluateStd(x[i] + shift, scale).
+  double TrialSumStd(const arma::vec& x, const double shift, const double scale) const noexcept;
+
+  //! Compute the derivative of the *unstandardized* rho function evaluated at x/scale, as
+  //! `Derivative(x, scale, first)`, in the same pass as the cross product with `x`.
+  //!
+  //! @return sum_{i = 1}^n first[i] * x[i].
+  double FusedDerivative(const arma::vec& x, const double scale, arma::vec* first) const noexcept;
+
+  //! Compute the first and second derivative of the *unstandardized* rho function evaluated at x/scale, as
+  //! `Derivative(x, scale, first)` and `SecondDerivative(x, scale, second)`, in a single pass over `x`.
+  //!
+  //! @return sum_{i = 1}^n first[i] * x[i].
+  double FusedDerivatives(const arma::vec& x, const double scale, arma::vec* first,
+                          arma::vec* second) const noexcept;
+
+  //! Compute the weights as `Weight(x, scale, weights)` in the same pass as the weighted sum of squares of `x`.
+  //!
+  //! @return sum_{i = 1}^n weights[i] * x[i]^2.
+  double FusedWeight(const arma::vec& x, const double scale, arma::vec* weights) const noexcept;
+
   //! Get the upper bound of the rho function, i.e., the limiting value of `operator()(x)` for x to infinity.
   double UpperBound() const noexcept;
 
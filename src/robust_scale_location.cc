@@ -7,14 +7,17 @@
 //
 
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
 #include "nsoptim.hpp"
 #include "rcpp_utils.hpp"
 #include "robust_scale_location.hpp"
 #include "constants.hpp"
 
 using arma::vec;
-using arma::median;
-using arma::abs;
 using arma::uword;
 
 namespace {
@@ -22,26 +25,65 @@ constexpr double kTauSizeC2Squared = 9.;
 constexpr double kTauSizeConsistencyConstant = 1. / 0.961;
 
 constexpr double kMadScaleConsistencyConstant = 1.4826;
+
+//! Get the scratch buffer for the current thread, filled with the absolute values of `values`.
+//! The buffer is re-used for all calls from the same thread, i.e., this does not allocate memory unless `values`
+//! is longer than in any previous call.
+//!
+//! @param values a vector of values.
+//! @return a reference to the scratch buffer holding the absolute values.
+std::vector<double>& AbsoluteValuesScratch(const vec& values) {
+  static thread_local std::vector<double> scratch;
+  scratch.resize(values.n_elem);
+  std::transform(values.cbegin(), values.cend(), scratch.begin(), [](const double v) { return std::abs(v); });
+  return scratch;
+}
+
+//! Compute the median of the values in the buffer, in linear time.
+//! The buffer is partially re-ordered such that the element at position `size / 2` is at its sorted position and
+//! all elements before it are not larger.
+//!
+//! @param buffer a non-empty buffer of values.
+//! @return the median of the values in the buffer.
+double PartitionMedian(std::vector<double>* buffer) {
+  const auto mid = buffer->begin() + buffer->size() / 2;
+  std::nth_element(buffer->begin(), mid, buffer->end());
+  if (buffer->size() % 2 == 1) {
+    return *mid;
+  }
+  // For an even number of elements, the lower middle element is the largest element before `mid`.
+  return 0.5 * (*mid + *std::max_element(buffer->begin(), mid));
+}
 }  // namespace
 
 namespace pense {
 double TauSize(const vec& values) noexcept {
-  const vec abs_values(abs(values));
-  const double sigma_0 = median(abs_values);
+  if (values.n_elem == 0) {
+    return 0.;
+  }
+  const double sigma_0 = PartitionMedian(&AbsoluteValuesScratch(values));
 
   if (sigma_0 < kNumericZero) {
     return 0.;
   }
 
-  const double tau_size = arma::mean(arma::clamp(arma::square(abs_values / sigma_0),
-                                                 0, kTauSizeC2Squared));
+  double tau_size = 0;
+  for (auto&& value : values) {
+    const double std_value = value / sigma_0;
+    tau_size += std::min(std_value * std_value, kTauSizeC2Squared);
+  }
+  tau_size /= values.n_elem;
   return sigma_0 * kTauSizeConsistencyConstant * sqrt(tau_size);
 }
 
 namespace robust_scale_location {
 double InitialScaleEstimate(const vec& values, const double delta, const double eps) {
+  if (values.n_elem == 0) {
+    return 0.;
+  }
   // Try the MAD of the uncentered values.
-  const double mad = kMadScaleConsistencyConstant * median(abs(values));
+  auto& abs_values = AbsoluteValuesScratch(values);
+  const double mad = kMadScaleConsistencyConstant * PartitionMedian(&abs_values);
   if (mad > eps) {
     return mad;
   } else if (static_cast<uword>((1 - delta) * values.n_elem) > values.n_elem / 2) {
@@ -49,9 +91,24 @@ double InitialScaleEstimate(const vec& values, const double delta, const double
     // compute the variance of the additional elements (i.e., the variance without considering the smallest
     // 50% of the observations)
     const uword lower_index = values.n_elem / 2;
-    const uword upper_index = static_cast<uword>((1 - delta) * values.n_elem);
-    const vec ordered_values = arma::sort(abs(values));
-    const double scale = arma::var(ordered_values.rows(lower_index, upper_index));
+    const uword upper_index = std::min<uword>((1 - delta) * values.n_elem, values.n_elem - 1);
+    // After computing the median, the element at `lower_index` is at its sorted position and all elements behind it are
+    // not smaller. Partitioning the remaining elements at `upper_index` therefore puts the order statistics
+    // `lower_index` to `upper_index` (in arbitrary order) in this range of the buffer.
+    const double count = upper_index - lower_index + 1;
+    if (count < 2) {
+      return 0.;
+    }
+    const auto range_begin = abs_values.begin() + lower_index;
+    const auto range_end = abs_values.begin() + upper_index + 1;
+    std::nth_element(range_begin + 1, range_end - 1, abs_values.end());
+
+    const double mean = std::accumulate(range_begin, range_end, 0.) / count;
+    double scale = 0;
+    for (auto it = range_begin; it != range_end; ++it) {
+      scale += (*it - mean) * (*it - mean);
+    }
+    scale /= count - 1;
     if (scale > eps) {
       return scale;
     }
@@ -59,6 +116,71 @@ double InitialScaleEstimate(const vec& values, const double delta, const double
   return 0.;
 }
 
+double MaxAbsRankTwoOffDiagonal(const vec& a, const vec& b, const double c) {
+  const uword n = a.n_elem;
+  if (n < 2) {
+    return 0.;
+  }
+
+  // Convex hull of the points (a_i, b_i) by Andrew's monotone chain algorithm.
+  std::vector<uword> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](const uword i, const uword k) {
+    return a[i] < a[k] || (a[i] == a[k] && b[i] < b[k]);
+  });
+  const auto cross = [&](const uword o, const uword p, const uword q) {
+    return (a[p] - a[o]) * (b[q] - b[o]) - (b[p] - b[o]) * (a[q] - a[o]);
+  };
+  std::vector<uword> hull(2 * n);
+  uword hull_size = 0;
+  for (uword j = 0; j < n; ++j) {
+    while (hull_size >= 2 && cross(hull[hull_size - 2], hull[hull_size - 1], order[j]) <= 0) {
+      --hull_size;
+    }
+    hull[hull_size++] = order[j];
+  }
+  for (uword j = n - 1, lower_size = hull_size + 1; j > 0; --j) {
+    while (hull_size >= lower_size && cross(hull[hull_size - 2], hull[hull_size - 1], order[j - 1]) <= 0) {
+      --hull_size;
+    }
+    hull[hull_size++] = order[j - 1];
+  }
+  // The first point is repeated at the end.
+  hull.resize(hull_size > 1 ? hull_size - 1 : hull_size);
+
+  double max_value = 0;
+  for (uword i = 0; i < n; ++i) {
+    // The value for the pair (i, k) is the linear function w' (a_k, b_k), which attains its extremes at the hull.
+    const double w_a = c * a[i] - b[i];
+    const double w_b = -a[i];
+    double hull_max = -std::numeric_limits<double>::infinity();
+    double hull_min = std::numeric_limits<double>::infinity();
+    uword argmax = 0;
+    uword argmin = 0;
+    for (auto&& k : hull) {
+      const double value = w_a * a[k] + w_b * b[k];
+      if (value > hull_max) {
+        hull_max = value;
+        argmax = k;
+      }
+      if (value < hull_min) {
+        hull_min = value;
+        argmin = k;
+      }
+    }
+    if (argmax != i && argmin != i) {
+      max_value = std::max(max_value, std::max(std::abs(hull_max), std::abs(hull_min)));
+    } else {
+      // The extreme is attained at the point itself, which is excluded. Search all other points.
+      for (uword k = 0; k < n; ++k) {
+        if (k != i) {
+          max_value = std::max(max_value, std::abs(w_a * a[k] + w_b * b[k]));
+        }
+      }
+    }
+  }
+  return max_value;
+}
 }  // namespace robust_scale_location
 
 }  // namespace pense
@@ -9,12 +9,18 @@
 #ifndef ROBUST_SCALE_LOCATION_HPP_
 #define ROBUST_SCALE_LOCATION_HPP_
 
+#include <algorithm>
 #include <exception>
 #include <string>
+#include <utility>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 #include "nsoptim.hpp"
 #include "rho.hpp"
 #include "constants.hpp"
+#include "omp_utils.hpp"
 #include "rcpp_utils.hpp"
 
 namespace pense {
@@ -23,6 +29,10 @@ namespace robust_scale_location {
 constexpr double kDefaultMscaleDelta = 0.5;
 //! Default number of iterations for the M-scale algorithm.
 constexpr int kDefaultMscaleMaxIt = 100;
+//! Default number of threads for evaluating the M-scale equation.
+constexpr int kDefaultMscaleNumThreads = 1;
+//! Minimum number of values per thread for evaluating the M-scale equation in parallel.
+constexpr arma::uword kMinParallelMscaleChunk = 1u << 15;
 
 template <typename T>
 struct DefaultMscaleConstant {
@@ -42,8 +52,92 @@ struct DefaultMscaleConstant<RhoBisquare> {
 //! @return an initial, inaccurate, estimate of the scale of `values`.
 double InitialScaleEstimate(const arma::vec& values, const double delta, const double eps);
 
+//! Compute the maximum of `|c a_i a_k - a_i b_k - a_k b_i|` over all pairs `i != k`, i.e., the largest off-diagonal
+//! element of the matrix `c a a' - a b' - b a'` in absolute value.
+//! For fixed `i`, the values are linear in the points `(a_k, b_k)`, hence their extremes are attained at the vertices
+//! of the convex hull of the points. The maximum is therefore found in O(n log n + n h) time and O(n) memory, where `h`
+//! is the number of vertices of the convex hull.
+//!
+//! @param a the first vector.
+//! @param b the second vector, of the same length.
+//! @param c the factor of the term `a a'`.
+//! @return the maximum absolute off-diagonal element.
+double MaxAbsRankTwoOffDiagonal(const arma::vec& a, const arma::vec& b, const double c);
 }  // namespace robust_scale_location
 
+//! The gradient and the Hessian of the M-scale function, evaluated at a point.
+//! The Hessian is the sum of a diagonal matrix and a matrix of rank 2. It is not stored explicitly, but only the
+//! vectors defining it, hence the memory and the time for computing Hessian-vector products are O(n).
+class MscaleGradientHessian {
+ public:
+  //! Create an empty object, e.g., if the M-scale is 0.
+  MscaleGradientHessian() noexcept : scale_(0), factor_(0), sum_2nd_(0) {}
+
+  //! Create the gradient and Hessian from the derivatives of the rho function.
+  //!
+  //! @param values the values at which the derivatives are evaluated.
+  //! @param scale the M-scale of the values.
+  //! @param rho_1st the 1st derivative of rho (times the standardized values).
+  //! @param rho_2nd the 2nd derivative of rho.
+  //! @param denom the denominator of the derivatives of the M-scale.
+  MscaleGradientHessian(const arma::vec& values, const double scale, arma::vec&& rho_1st, const arma::vec& rho_2nd,
+                        const double denom)
+      : scale_(scale), factor_(scale / (denom * denom)), sum_2nd_(arma::sum(rho_2nd % values % values) / denom),
+        diagonal_(denom * rho_2nd), rho_1st_(std::move(rho_1st)), rho_2nd_values_(rho_2nd % values) {
+    gradient_ = rho_1st_ * (scale / denom);
+  }
+
+  //! Check if the gradient and Hessian are available.
+  bool empty() const noexcept {
+    return gradient_.n_elem == 0;
+  }
+
+  //! The M-scale at the point.
+  double scale() const noexcept {
+    return scale_;
+  }
+
+  //! The gradient of the M-scale function.
+  const arma::vec& gradient() const noexcept {
+    return gradient_;
+  }
+
+  //! Compute the product of the Hessian with a vector.
+  //!
+  //! @param vector the vector to multiply the Hessian with.
+  //! @return the Hessian-vector product.
+  arma::vec HessianProduct(const arma::vec& vector) const {
+    const double rho_1st_dot = arma::dot(rho_1st_, vector);
+    const double rho_2nd_dot = arma::dot(rho_2nd_values_, vector);
+    return factor_ * (diagonal_ % vector + rho_1st_ * (sum_2nd_ * rho_1st_dot - rho_2nd_dot) -
+                      rho_2nd_values_ * rho_1st_dot);
+  }
+
+  //! Get the diagonal of the Hessian.
+  arma::vec HessianDiagonal() const {
+    return factor_ * (diagonal_ + rho_1st_ % (sum_2nd_ * rho_1st_ - 2 * rho_2nd_values_));
+  }
+
+  //! Get the largest element of the Hessian in absolute value.
+  double MaxAbsHessian() const {
+    if (empty()) {
+      return 0;
+    }
+    const double max_off_diagonal = robust_scale_location::MaxAbsRankTwoOffDiagonal(rho_1st_, rho_2nd_values_,
+                                                                                     sum_2nd_);
+    return std::max(factor_ * max_off_diagonal, arma::max(arma::abs(HessianDiagonal())));
+  }
+
+ private:
+  double scale_;
+  double factor_;
+  double sum_2nd_;
+  arma::vec diagonal_;
+  arma::vec rho_1st_;
+  arma::vec rho_2nd_values_;
+  arma::vec gradient_;
+};
+
 //! The result of simultaneous estimation of the M-location and M-scale.
 struct LocationScaleEstimate {
   double location;
@@ -79,7 +173,9 @@ class Mscale {
       max_it_(GetFallback(user_options, "max_it",
         robust_scale_location::kDefaultMscaleMaxIt)),
       eps_(GetFallback(user_options, "eps", kDefaultConvergenceTolerance)),
-      scale_(-1) {}
+      scale_(-1),
+      algorithm_(GetFallback(user_options, "algorithm", kDefaultMscaleAlgorithm)),
+      num_threads_(GetFallback(user_options, "num_threads", robust_scale_location::kDefaultMscaleNumThreads)) {}
 
   //! Construct the M-scale function.
   //!
@@ -87,9 +183,10 @@ class Mscale {
   //! @param delta right-hand side of the M-estimation equation.
   //! @param max_it maximum number of iterations.
   //! @param eps numerical tolerance for convergence.
+  //! @param algorithm algorithm to solve the M-scale equation.
   Mscale(const RhoFunction& rho, const double delta, const int max_it,
-         const double eps) noexcept
-      : rho_(rho), delta_(delta), max_it_(max_it), eps_(eps), scale_(-1) {}
+         const double eps, const MscaleAlgorithm algorithm = kDefaultMscaleAlgorithm) noexcept
+      : rho_(rho), delta_(delta), max_it_(max_it), eps_(eps), scale_(-1), algorithm_(algorithm) {}
 
   Mscale(const Mscale&) = default;
   Mscale& operator=(const Mscale&) = default;
@@ -144,19 +241,76 @@ class Mscale {
     return it_;
   }
 
+  //! Check if the M-scale of the given values is less than `bound`, without solving the M-scale equation.
+  //! Since the left-hand side of the M-scale equation is decreasing in the scale, the M-scale is less than `bound`
+  //! if and only if (1/n) sum_{i = 1}^n rho(value[i] / bound) < delta.
+  //! This requires only a single pass over the values.
+  //!
+  //! @param values a vector of values.
+  //! @param bound the upper bound to check.
+  //! @return `true` if the M-scale of the given values is less than `bound`, `false` otherwise.
+  bool IsLessThan(const arma::vec& values, const double bound) const {
+    if (bound < kNumericZero) {
+      return false;
+    }
+    return rho_.SumStd(values, bound) < delta_ * values.n_elem;
+  }
+
+  //! Check if the M-scale of the trial values `values + step * direction` is less than `bound`, in a single pass and
+  //! without storing the trial values (see `IsLessThan(values, bound)`).
+  //!
+  //! @param values a vector of values.
+  //! @param step the step along `direction`.
+  //! @param direction the direction of the trial step, of the same length as `values`.
+  //! @param bound the upper bound to check.
+  //! @return `true` if the M-scale of the trial values is less than `bound`, `false` otherwise.
+  bool IsLessThan(const arma::vec& values, const double step, const arma::vec& direction, const double bound) const {
+    if (bound < kNumericZero) {
+      return false;
+    }
+    return rho_.TrialSumStd(values, step, direction, bound) < delta_ * values.n_elem;
+  }
+
+  //! Check if the M-scale of the trial values `values + shift` is less than `bound`, in a single pass and
+  //! without storing the trial values (see `IsLessThan(values, bound)`).
+  //!
+  //! @param values a vector of values.
+  //! @param shift the shift of all values.
+  //! @param bound the upper bound to check.
+  //! @return `true` if the M-scale of the trial values is less than `bound`, `false` otherwise.
+  bool IsLessThan(const arma::vec& values, const double shift, const double bound) const {
+    if (bound < kNumericZero) {
+      return false;
+    }
+    return rho_.TrialSumStd(values, shift, bound) < delta_ * values.n_elem;
+  }
+
   //! Compute the 1st derivative of the M-scale function with respect to each element.
   //!
   //! @param values vector of values
   //! @return a vector of derivatives, one for each element in `values`. If the scale is 0 or the M-scale equation
   //!   is violated, an empty vector is returned.
   arma::vec Derivative(const arma::vec& values) const {
-    const double scale = ComputeMscale(values, InitialEstimate(values));
-    if (scale < eps_) {
+    double scale = -1;
+    return Derivative(values, &scale);
+  }
+
+  //! Compute the 1st derivative of the M-scale function with respect to each element, starting the M-scale
+  //! iterations at the given scale.
+  //!
+  //! @param values vector of values
+  //! @param scale on input, the initial guess for the M-scale. If not positive, the usual initial guess is used.
+  //!              On output, the M-scale of `values`.
+  //! @return a vector of derivatives, one for each element in `values`. If the scale is 0 or the M-scale equation
+  //!   is violated, an empty vector is returned.
+  arma::vec Derivative(const arma::vec& values, double* scale) const {
+    *scale = ComputeMscale(values, (*scale > eps_) ? *scale : InitialEstimate(values));
+    if (*scale < eps_) {
       return arma::vec();
     }
 
-    const auto deriv_rho = rho_.Derivative(values, scale);
-    const auto denom = sum(deriv_rho % values) / scale;
+    arma::vec deriv_rho;
+    const double denom = rho_.FusedDerivative(values, *scale, &deriv_rho) / *scale;
     if (denom < eps_) {
       return arma::vec(values.n_elem, arma::fill::value(R_PosInf));
     } else {
@@ -181,16 +335,16 @@ class Mscale {
 
     arma::mat grad_hess(values.n_elem, values.n_elem + 2, arma::fill::zeros);
 
-    // Compute the gradient and its maximum
-    grad_hess.col(0) = rho_.Derivative(values, scale);
-    const auto denom = arma::sum(grad_hess.col(0) % values);
+    // Compute the first and second derivatives in a single pass
+    arma::vec rho_1st, rho_2nd;
+    const double denom = rho_.FusedDerivatives(values, scale, &rho_1st, &rho_2nd);
+    grad_hess.col(0) = rho_1st;
 
     grad_hess.at(1, 2) = denom;
     grad_hess.at(2, 2) = scale;
     grad_hess.at(3, 2) = violation;
 
     // Compute the Hessian and its maximum
-    const auto rho_2nd = rho_.SecondDerivative(values, scale);
     const auto sum_2nd = arma::sum(rho_2nd % values % values) / denom;
     grad_hess.col(1) = rho_2nd;
     double diag_offset;
@@ -198,7 +352,7 @@ class Mscale {
       diag_offset = denom * rho_2nd[i];
       for (int k = i; k < values.n_elem; ++k) {
         grad_hess(i, k + 2) = HessianElementUnscaled(
-          i, k, grad_hess.unsafe_col(0), rho_2nd, values, sum_2nd, diag_offset);
+          i, k, rho_1st, rho_2nd, values, sum_2nd, diag_offset);
 
         grad_hess(i, k + 2) *= scale / (denom * denom);
         diag_offset = 0;
@@ -233,32 +387,44 @@ class Mscale {
       return maxima;
     }
 
-    // Compute the gradient and its maximum
-    const auto rho_1st = rho_.Derivative(values, maxima[0]);
-    const auto denom = sum(rho_1st % values);
-    maxima[1] = (denom < eps_) ? R_PosInf :
-      (arma::max(rho_1st) * maxima[0] / denom);
-
-    // Compute the Hessian and its maximum
-    const auto rho_2nd = rho_.SecondDerivative(values, maxima[0]);
-    const auto sum_2nd = sum(rho_2nd % values % values) / denom;
-    double diag_offset;
+    // Compute the first and second derivatives in a single pass
+    arma::vec rho_1st, rho_2nd;
+    const double denom = rho_.FusedDerivatives(values, maxima[0], &rho_1st, &rho_2nd);
+    if (denom < eps_) {
+      maxima[1] = maxima[2] = R_PosInf;
+      return maxima;
+    }
+    maxima[1] = arma::max(rho_1st) * maxima[0] / denom;
 
-    for (int i = 0; i < values.n_elem; ++i) {
-      diag_offset = denom * rho_2nd[i];
-      for (int k = i; k < values.n_elem; ++k) {
-        const auto tmp = std::abs(HessianElementUnscaled(
-          i, k, rho_1st, rho_2nd, values, sum_2nd, diag_offset));
+    // The maximum of the Hessian is found without computing all of its elements.
+    const MscaleGradientHessian grad_hess(values, maxima[0], std::move(rho_1st), rho_2nd, denom);
+    maxima[2] = grad_hess.MaxAbsHessian();
+    return maxima;
+  }
 
-        diag_offset = 0;
-        if (tmp > maxima[2]) {
-          maxima[2] = tmp;
-        }
-      }
+  //! Compute the gradient and the Hessian of the M-scale function evaluated at the given vector.
+  //! In contrast to `GradientHessian()`, the Hessian is not computed explicitly, but only Hessian-vector products
+  //! are available, requiring O(n) time and memory.
+  //!
+  //! @param values vector of values
+  //! @return the gradient and the Hessian. If the scale is 0 or the M-scale equation is violated, the returned object
+  //!   is empty.
+  MscaleGradientHessian ImplicitGradientHessian(const arma::vec& values) {
+    const double scale = this->operator()(values);
+    if (scale < eps_) {
+      return MscaleGradientHessian();
+    }
+    const auto violation = rho_.SumStd(values, scale) - values.n_elem * delta_;
+    if (violation * violation > values.n_elem * values.n_elem * eps_ * eps_) {
+      return MscaleGradientHessian();
     }
-    maxima[2] *= maxima[0] / (denom * denom);
 
-    return maxima;
+    arma::vec rho_1st, rho_2nd;
+    const double denom = rho_.FusedDerivatives(values, scale, &rho_1st, &rho_2nd);
+    if (denom < eps_) {
+      return MscaleGradientHessian();
+    }
+    return MscaleGradientHessian(values, scale, std::move(rho_1st), rho_2nd, denom);
   }
 
   //! Get the rho function object.
@@ -281,45 +447,139 @@ class Mscale {
     return delta_;
   }
 
+  //! Get the algorithm used to solve the M-scale equation.
+  MscaleAlgorithm algorithm() const noexcept {
+    return algorithm_;
+  }
+
  private:
-  double ComputeMscale(const arma::vec& values, double scale) const {
-    const double rho_denom = 1. / (delta_ * values.n_elem);
+  double ComputeMscale(const arma::vec& values, const double scale) const {
+    int iter = 0;
+    return ComputeMscale(values, scale, &iter);
+  }
+
+  double ComputeMscale(const arma::vec& values, const double scale) {
+    return ComputeMscale(values, scale, &it_);
+  }
+
+  double ComputeMscale(const arma::vec& values, const double scale, int* iter) const {
     if (scale < kNumericZero) {
       return 0;
     }
+    nsoptim::ScopedKernelCounter kernel_counter(nsoptim::Kernel::kMscale);
+    switch (algorithm_) {
+      case MscaleAlgorithm::kNewton:
+        return NewtonMscale(values, scale, iter);
+      case MscaleAlgorithm::kFixedPoint:
+      default:
+        return FixedPointMscale(values, scale, iter);
+    }
+  }
 
-    int iter = 0;
+  //! Solve the M-scale equation with the fixed-point iterations s <- s * sqrt(sum rho(values / s) / (n delta)).
+  double FixedPointMscale(const arma::vec& values, double scale, int* iter) const {
+    const double rho_denom = 1. / (delta_ * values.n_elem);
+
+    *iter = 0;
     double err = eps_;
     // Start iterations
     do {
-      const double rho_sum = rho_.SumStd(values, scale);
+      const double rho_sum = RhoSumStd(values, scale);
       const double new_scale = scale * std::sqrt(rho_sum * rho_denom);
       err = std::abs(new_scale - scale);
       scale = new_scale;
-    } while (++iter < max_it_ && err > eps_ * scale);
+    } while (++(*iter) < max_it_ && err > eps_ * scale);
 
     return scale;
   }
 
-  double ComputeMscale(const arma::vec& values, double scale) {
-    const double rho_denom = 1. / (delta_ * values.n_elem);
-    if (scale < kNumericZero) {
-      return 0;
-    }
+  //! Solve the M-scale equation with safeguarded Newton-Raphson steps.
+  //! Because the left-hand side of the M-scale equation is decreasing in the scale, every evaluation narrows a bracket
+  //! around the solution. Newton steps leaving the bracket are replaced by a bisection step, or by a fixed-point step
+  //! as long as the bracket is still open on one side.
+  double NewtonMscale(const arma::vec& values, double scale, int* iter) const {
+    const double rhs = delta_ * values.n_elem;
+    double lower = 0;
+    double upper = std::numeric_limits<double>::infinity();
 
-    it_ = 0;
+    *iter = 0;
     double err = eps_;
     // Start iterations
     do {
-      const double rho_sum = rho_.SumStd(values, scale);
-      const double new_scale = scale * std::sqrt(rho_sum * rho_denom);
+      double cross = 0;
+      const double violation = RhoFusedSumStd(values, scale, &cross) - rhs;
+      if (violation > 0) {
+        lower = scale;
+      } else {
+        upper = scale;
+      }
+
+      // The derivative of the left-hand side with respect to the scale is -cross / scale^3.
+      double new_scale = (cross > kNumericZero) ? scale + violation * scale * scale * scale / cross : -1;
+      if (!(new_scale > lower && new_scale <= upper)) {
+        new_scale = (lower > 0 && upper < std::numeric_limits<double>::infinity()) ?
+          0.5 * (lower + upper) : scale * std::sqrt((violation + rhs) / rhs);
+      }
       err = std::abs(new_scale - scale);
       scale = new_scale;
-    } while (++it_ < max_it_ && err > eps_ * scale);
+    } while (++(*iter) < max_it_ && err > eps_ * scale);
 
     return scale;
   }
 
+  //! Number of chunks for evaluating the rho function in parallel, or 1 if the values should be processed
+  //! by the calling thread.
+  int ParallelChunks(const arma::vec& values) const noexcept {
+    if (!omp::Enabled(num_threads_) || omp::InParallel()) {
+      return 1;
+    }
+    const arma::uword max_chunks = values.n_elem / robust_scale_location::kMinParallelMscaleChunk;
+    return max_chunks < static_cast<arma::uword>(num_threads_) ? std::max<int>(1, max_chunks) : num_threads_;
+  }
+
+  //! Compute `rho_.SumStd(values, scale)` and, if `cross` is not `nullptr`, the cross product as for
+  //! `rho_.FusedSumStd(values, scale, cross)`, splitting long vectors into chunks processed in parallel.
+  //! The chunk sums are added in a fixed order, hence the result does not depend on the scheduling of the threads.
+  double ChunkedRhoSum(const arma::vec& values, const double scale, const int chunks, double* cross) const {
+    const arma::uword chunk_size = values.n_elem / chunks;
+    std::vector<double> sums(chunks, 0.);
+    std::vector<double> crosses(cross ? chunks : 0, 0.);
+    int num_threads = num_threads_;
+    blas::SingleThreadGuard blas_guard(num_threads);
+    #pragma omp parallel for num_threads(num_threads) schedule(static) default(shared)
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+      const arma::uword begin = chunk * chunk_size;
+      const arma::uword size = (chunk + 1 < chunks) ? chunk_size : values.n_elem - begin;
+      const arma::vec chunk_values(const_cast<double*>(values.memptr()) + begin, size, false, true);
+      if (cross) {
+        sums[chunk] = rho_.FusedSumStd(chunk_values, scale, &crosses[chunk]);
+      } else {
+        sums[chunk] = rho_.SumStd(chunk_values, scale);
+      }
+    }
+    double sum = 0;
+    for (int chunk = 0; chunk < chunks; ++chunk) {
+      sum += sums[chunk];
+    }
+    if (cross) {
+      *cross = 0;
+      for (auto&& chunk_cross : crosses) {
+        *cross += chunk_cross;
+      }
+    }
+    return sum;
+  }
+
+  double RhoSumStd(const arma::vec& values, const double scale) const {
+    const int chunks = ParallelChunks(values);
+    return (chunks > 1) ? ChunkedRhoSum(values, scale, chunks, nullptr) : rho_.SumStd(values, scale);
+  }
+
+  double RhoFusedSumStd(const arma::vec& values, const double scale, double* cross) const {
+    const int chunks = ParallelChunks(values);
+    return (chunks > 1) ? ChunkedRhoSum(values, scale, chunks, cross) : rho_.FusedSumStd(values, scale, cross);
+  }
+
   double InitialEstimate(const arma::vec& values) const {
     // If the internal scale is already set, use it as initial estimate.
     if (scale_ > eps_) {
@@ -346,6 +606,8 @@ class Mscale {
   int it_ = -1;
   double eps_;
   double scale_;
+  MscaleAlgorithm algorithm_;
+  int num_threads_ = robust_scale_location::kDefaultMscaleNumThreads;
 };
 
 //! Computation of the M-location of the given vector.
@@ -355,27 +617,29 @@ class Mscale {
 //! @param scale the scale of the values.
 //! @param convergence_tol numeric convergence tolerance.
 //! @param max_it maximum number of iterations.
+//! @param residuals workspace for the residuals. Resized as necessary.
+//! @param w_loc workspace for the weights. Resized as necessary.
 //! @return location of the given values.
 template <class RhoFunction>
 double MLocation(const arma::vec& values, const RhoFunction& rho, const double scale,
-                 const double convergence_tol, const int max_it) {
+                 const double convergence_tol, const int max_it, arma::vec* residuals, arma::vec* w_loc) {
   const double scaled_conv_tol = convergence_tol * scale;
   int it = 0;
   double location = arma::median(values);
 
-  arma::vec residuals(values.n_elem);
-  arma::vec w_loc(values.n_elem);
+  residuals->set_size(values.n_elem);
+  w_loc->set_size(values.n_elem);
   while (it++ < max_it) {
-    residuals = values - location;
-    rho.Weight(residuals, scale, &w_loc);
+    *residuals = values - location;
+    rho.Weight(*residuals, scale, w_loc);
     const double prev_location = location;
-    const double w_loc_sum = arma::accu(w_loc);
+    const double w_loc_sum = arma::accu(*w_loc);
 
     if (w_loc_sum < convergence_tol) {
       throw ZeroWeightsException();
     }
 
-    location = arma::accu(w_loc % values) / w_loc_sum;
+    location = arma::accu(*w_loc % values) / w_loc_sum;
 
     if (std::abs(prev_location - location) < scaled_conv_tol) {
       break;
@@ -385,15 +649,34 @@ double MLocation(const arma::vec& values, const RhoFunction& rho, const double s
   return location;
 }
 
+//! Computation of the M-location of the given vector.
+//!
+//! @param values values to compute the location and scale from.
+//! @param rho rho-function for the M-location.
+//! @param scale the scale of the values.
+//! @param convergence_tol numeric convergence tolerance.
+//! @param max_it maximum number of iterations.
+//! @return location of the given values.
+template <class RhoFunction>
+double MLocation(const arma::vec& values, const RhoFunction& rho, const double scale,
+                 const double convergence_tol, const int max_it) {
+  arma::vec residuals;
+  arma::vec w_loc;
+  return MLocation(values, rho, scale, convergence_tol, max_it, &residuals, &w_loc);
+}
+
 //! Simultaneous computation of the M-location and M-scale of the given vector.
 //!
 //! @param values values to compute the location and scale from.
 //! @param mscale M-scale definition.
 //! @param location_rho rho-function for the M-location.
+//! @param residuals workspace for the residuals. Resized as necessary.
+//! @param w_loc workspace for the location weights. Resized as necessary.
 //! @return location (first) and scale (second) of the given values.
 template <class ScaleRhoFunction, class LocationRhoFunction>
 LocationScaleEstimate MLocationScale(const arma::vec& values, const Mscale<ScaleRhoFunction>& mscale,
-                                     const LocationRhoFunction& location_rho) {
+                                     const LocationRhoFunction& location_rho, arma::vec* residuals,
+                                     arma::vec* w_loc) {
   int it = 0;
   LocationScaleEstimate est {arma::median(values)};
   est.scale = robust_scale_location::InitialScaleEstimate(values - est.location, mscale.delta(), mscale.eps());
@@ -406,20 +689,20 @@ LocationScaleEstimate MLocationScale(const arma::vec& values, const Mscale<Scale
   const double convergence_tol = est.scale * mscale.eps();
   const double recip_sqrt_delta = 1. / sqrt(mscale.delta());
 
-  arma::vec residuals(values.n_elem);
-  arma::vec w_loc(values.n_elem);
+  residuals->set_size(values.n_elem);
+  w_loc->set_size(values.n_elem);
   while (it++ < mscale.max_it()) {
-    residuals = values - est.location;
-    location_rho.Weight(residuals, est.scale, &w_loc);
-    const double w_scale_mean = mscale.rho().SumStd(residuals, est.scale) / residuals.n_elem;
-    const double w_loc_sum = arma::accu(w_loc);
+    *residuals = values - est.location;
+    location_rho.Weight(*residuals, est.scale, w_loc);
+    const double w_scale_mean = mscale.rho().SumStd(*residuals, est.scale) / residuals->n_elem;
+    const double w_loc_sum = arma::accu(*w_loc);
 
     if (w_loc_sum < convergence_tol) {
       throw ZeroWeightsException();
     }
 
     const LocationScaleEstimate prev_est = est;
-    est.location = arma::accu(w_loc % values) / w_loc_sum;
+    est.location = arma::accu(*w_loc % values) / w_loc_sum;
     est.scale = prev_est.scale * std::sqrt(w_scale_mean) * recip_sqrt_delta;
 
     if (std::abs(prev_est.location - est.location) < convergence_tol &&
@@ -430,6 +713,20 @@ LocationScaleEstimate MLocationScale(const arma::vec& values, const Mscale<Scale
 
   return est;
 }
+
+//! Simultaneous computation of the M-location and M-scale of the given vector.
+//!
+//! @param values values to compute the location and scale from.
+//! @param mscale M-scale definition.
+//! @param location_rho rho-function for the M-location.
+//! @return location (first) and scale (second) of the given values.
+template <class ScaleRhoFunction, class LocationRhoFunction>
+LocationScaleEstimate MLocationScale(const arma::vec& values, const Mscale<ScaleRhoFunction>& mscale,
+                                     const LocationRhoFunction& location_rho) {
+  arma::vec residuals;
+  arma::vec w_loc;
+  return MLocationScale(values, mscale, location_rho, &residuals, &w_loc);
+}
 }  // namespace pense
 
 #endif  // ROBUST_SCALE_LOCATION_HPP_
@@ -36,7 +36,7 @@ class SLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
 
   SLoss(ConstDataPtr data, const Mscale<RhoBisquare>& mscale, const bool include_intercept = true) noexcept
     : include_intercept_(include_intercept), data_(data), mscale_(mscale),
-      pred_norm_(std::min(arma::norm(data->cx(), "inf"), arma::norm(data->cx(), 1))) {}
+      pred_norm_(data->pred_norm_bound()) {}
 
   SLoss(const SLoss& other) = default;
   SLoss& operator=(const SLoss& other) = delete;
@@ -159,6 +159,27 @@ class SLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
     return data_->cy() - data_->cx() * where.beta - where.intercept;
   }
 
+  //! Compute the residuals at `where` and store them in the caller-owned workspace `residuals`.
+  //! If the workspace is already of the correct size, no memory is allocated.
+  //!
+  //! @param where point where to compute the residuals.
+  //! @param residuals workspace for the residuals.
+  template<typename Coefficients>
+  void Residuals(const Coefficients& where, arma::vec* residuals) const {
+    data_->Residuals(where.beta, where.intercept, residuals);
+  }
+
+  //! Evaluate the S loss function, using the caller-owned workspace for the residuals.
+  //!
+  //! @param where point where to evaluate the loss function.
+  //! @param residuals workspace for the residuals. On return, holds the residuals at `where`.
+  //! @return loss evaluated at `where`.
+  template<typename T>
+  double Evaluate(const nsoptim::RegressionCoefficients<T>& where, arma::vec* residuals) {
+    Residuals(where, residuals);
+    return Evaluate(*residuals);
+  }
+
   //! Get the weights for the surrogate LS-loss at the given residuals.
   //!
   //! @param residuals residuals where the surrogate weights are computed.
@@ -171,8 +192,8 @@ class SLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
       throw ZeroWeightsException();
     }
 
-    arma::vec weights = mscale_.rho().Weight(residuals, scale);
-    const double denominator = arma::dot(weights, arma::square(residuals));
+    arma::vec weights;
+    const double denominator = mscale_.rho().FusedWeight(residuals, scale, &weights);
 
     return weights * residuals.n_elem * scale * scale / denominator;
   }
@@ -203,6 +224,14 @@ class SLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
     return ConvexSurrogateType(data_, SurrogateWeights(residuals), include_intercept_);
   }
 
+  //! Update a convex surrogate for the S loss function, previously obtained from `GetConvexSurrogate()`, in place.
+  //!
+  //! @param residuals residuals of the point where the convex surrogate should be constructed.
+  //! @param surrogate the weighted-ls loss surrogate loss function to update.
+  void UpdateConvexSurrogate(const ResidualType& residuals, ConvexSurrogateType* surrogate) {
+    surrogate->UpdateWeights(SurrogateWeights(residuals));
+  }
+
   //! Clone the S loss function. The returned object does not share anything with this loss function.
   //!
   //! @return a deep copy of this S loss function.
@@ -248,7 +277,7 @@ class SLoss : public nsoptim::LossFunction<nsoptim::PredictorResponseData> {
  private:
   SLoss(const SLoss& other, ConstDataPtr data) :
       include_intercept_(other.include_intercept_), data_(data), mscale_(other.mscale_),
-      pred_norm_(std::min(arma::norm(data->cx(), "inf"), arma::norm(data->cx(), 1))) {}
+      pred_norm_(data->pred_norm_bound()) {}
 
   bool include_intercept_;
   ConstDataPtr data_;